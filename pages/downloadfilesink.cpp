@@ -0,0 +1,239 @@
+#include "downloadfilesink.h"
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QThread>
+
+namespace {
+// 缓冲区上限：超过后 GUI 线程停止读 reply，由 reply 的读缓冲和 TCP 窗口向服务端施加背压。
+constexpr qint64 kHighWaterBytes = 32LL * 1024 * 1024;
+// 回落到这里以下才通知继续读，避免在上限附近频繁切换。
+constexpr qint64 kLowWaterBytes = 8LL * 1024 * 1024;
+// 每写入这么多字节保存一次摘要检查点，崩溃后最多重新下载这一段。
+constexpr qint64 kHashCheckpointBytes = 64LL * 1024 * 1024;
+} // namespace
+
+DownloadFileSink::DownloadFileSink(QObject *parent)
+    : QObject(parent)
+{
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName("DownloadFileSink");
+    m_thread->start();
+}
+
+DownloadFileSink::~DownloadFileSink()
+{
+    shutdown({});
+    delete m_thread;
+}
+
+void DownloadFileSink::open(const QString &key, const QString &path, const FileUtils::Sha256Stream &hash, bool hashValid)
+{
+    Command command;
+    command.type = CommandType::Open;
+    command.key = key;
+    command.path = path;
+    command.hash = hash;
+    command.hashValid = hashValid;
+    enqueue(std::move(command));
+}
+
+void DownloadFileSink::write(const QString &key, qint64 offset, const QByteArray &data)
+{
+    if (data.isEmpty()) return;
+    Command command;
+    command.type = CommandType::Write;
+    command.key = key;
+    command.offset = offset;
+    command.data = data;
+    enqueue(std::move(command));
+}
+
+void DownloadFileSink::restart(const QString &key)
+{
+    Command command;
+    command.type = CommandType::Restart;
+    command.key = key;
+    enqueue(std::move(command));
+}
+
+void DownloadFileSink::disableHash(const QString &key)
+{
+    Command command;
+    command.type = CommandType::DisableHash;
+    command.key = key;
+    enqueue(std::move(command));
+}
+
+void DownloadFileSink::close(const QString &key, qint64 truncateTo)
+{
+    Command command;
+    command.type = CommandType::Close;
+    command.key = key;
+    command.offset = truncateTo;
+    enqueue(std::move(command));
+}
+
+qint64 DownloadFileSink::writableBytes()
+{
+    QMutexLocker locker(&m_mutex);
+    const qint64 available = kHighWaterBytes - m_pendingBytes;
+    if (available <= 0) {
+        m_waitingForSpace = true;
+        return 0;
+    }
+    return available;
+}
+
+QHash<QString, DownloadFileSink::CloseResult> DownloadFileSink::shutdown(const QHash<QString, qint64> &truncateTo)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_stopping) return {};
+        m_stopping = true;
+        m_shutdownTruncate = truncateTo;
+        m_wakeWorker.wakeOne();
+    }
+    // 已排队的数据会先写完，再统一关闭文件。
+    m_thread->wait();
+    return m_shutdownResults;
+}
+
+void DownloadFileSink::enqueue(Command command)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_stopping) return;
+    m_pendingBytes += command.data.size();
+    m_queue.enqueue(std::move(command));
+    m_wakeWorker.wakeOne();
+}
+
+void DownloadFileSink::run()
+{
+    while (true) {
+        Command command;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.isEmpty() && !m_stopping) m_wakeWorker.wait(&m_mutex);
+            if (m_queue.isEmpty()) break;
+            command = m_queue.dequeue();
+        }
+
+        process(command);
+
+        bool notify = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            m_pendingBytes -= command.data.size();
+            if (m_waitingForSpace && m_pendingBytes <= kLowWaterBytes) {
+                m_waitingForSpace = false;
+                notify = true;
+            }
+        }
+        if (notify) emit spaceAvailable();
+    }
+
+    const QStringList keys = m_files.keys();
+    for (const QString &key : keys) {
+        m_shutdownResults.insert(key, closeFile(key, m_shutdownTruncate.value(key, -1)));
+    }
+}
+
+void DownloadFileSink::process(Command &command)
+{
+    if (command.type == CommandType::Open) {
+        closeFile(command.key, -1);
+        OpenFile state;
+        state.file = new QFile(command.path);
+        state.hash = command.hash;
+        state.hashValid = command.hashValid;
+        // 分段下载按偏移随机写入，统一用不截断的读写模式打开。
+        if (!state.file->open(QIODevice::ReadWrite)) {
+            state.failed = true;
+            state.error = state.file->errorString();
+            emit writeFailed(command.key, "无法写入目标路径");
+        }
+        m_files.insert(command.key, state);
+        return;
+    }
+
+    if (command.type == CommandType::Close) {
+        const CloseResult result = closeFile(command.key, command.offset);
+        emit fileClosed(command.key, result.ok, result.error, result.sha256, result.hashState);
+        return;
+    }
+
+    auto it = m_files.find(command.key);
+    if (it == m_files.end() || it->failed) return;
+    OpenFile &state = it.value();
+
+    if (command.type == CommandType::DisableHash) {
+        state.hashValid = false;
+        return;
+    }
+
+    if (command.type == CommandType::Restart) {
+        if (!state.file->resize(0)) {
+            fail(state, command.key, state.file->errorString());
+            return;
+        }
+        state.hash.reset();
+        state.hashValid = true;
+        state.bytesSinceCheckpoint = 0;
+        return;
+    }
+
+    QFile *file = state.file;
+    if ((file->pos() != command.offset && !file->seek(command.offset))
+        || file->write(command.data) != command.data.size()) {
+        fail(state, command.key, file->errorString().isEmpty() ? QStringLiteral("写入长度不完整") : file->errorString());
+        return;
+    }
+    if (!state.hashValid) return;
+    state.hash.addData(command.data);
+    state.bytesSinceCheckpoint += command.data.size();
+    if (state.bytesSinceCheckpoint >= kHashCheckpointBytes && file->flush()) {
+        // 仅在文件已 flush 后保存，保证摘要状态与 .part 长度一致。
+        state.bytesSinceCheckpoint = 0;
+        emit hashCheckpoint(command.key, state.hash.saveState());
+    }
+}
+
+void DownloadFileSink::fail(OpenFile &state, const QString &key, const QString &error)
+{
+    state.failed = true;
+    state.error = error;
+    emit writeFailed(key, error);
+}
+
+DownloadFileSink::CloseResult DownloadFileSink::closeFile(const QString &key, qint64 truncateTo)
+{
+    CloseResult result;
+    auto it = m_files.find(key);
+    if (it == m_files.end()) {
+        result.error = QStringLiteral("文件未打开");
+        return result;
+    }
+    OpenFile state = it.value();
+    m_files.erase(it);
+
+    result.ok = !state.failed;
+    result.error = state.error;
+    if (state.file->isOpen()) {
+        if (!state.file->flush() && result.ok) {
+            result.ok = false;
+            result.error = state.file->errorString();
+        }
+        state.file->close();
+    }
+    if (result.ok && truncateTo >= 0 && state.file->size() > truncateTo && !state.file->resize(truncateTo)) {
+        result.ok = false;
+        result.error = state.file->errorString();
+    }
+    if (result.ok && state.hashValid && truncateTo < 0) {
+        result.sha256 = state.hash.resultHex();
+        result.hashState = state.hash.saveState();
+    }
+    delete state.file;
+    return result;
+}
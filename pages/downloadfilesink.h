@@ -0,0 +1,97 @@
+#ifndef DOWNLOADFILESINK_H
+#define DOWNLOADFILESINK_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <QWaitCondition>
+
+#include "fileutils.h"
+
+class QFile;
+class QThread;
+
+// 模型下载的写盘线程：GUI 线程只把网络数据放进有界缓冲，写文件、flush 和 SHA-256 都在专用 I/O 线程完成。
+// 同一文件的命令严格按提交顺序执行，结果通过信号（排队连接）回到 GUI 线程。
+class DownloadFileSink : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct CloseResult {
+        bool ok = false;
+        QString error;
+        QString sha256;
+        QByteArray hashState;
+    };
+
+    explicit DownloadFileSink(QObject *parent = nullptr);
+    ~DownloadFileSink() override;
+
+    // 以读写方式打开 .part（不截断）；hashValid 为 false 时不做增量摘要。
+    void open(const QString &key, const QString &path, const FileUtils::Sha256Stream &hash, bool hashValid);
+    void write(const QString &key, qint64 offset, const QByteArray &data);
+    // 服务端返回了完整文件：清空 .part 并重置摘要。
+    void restart(const QString &key);
+    // 分段乱序写入时摘要无意义，停止计算。
+    void disableHash(const QString &key);
+    // truncateTo >= 0 时关闭后把文件截到该长度（分段下载只保留连续前缀）。
+    void close(const QString &key, qint64 truncateTo = -1);
+
+    // 缓冲区还能接收的字节数；为 0 时调用方应停止读 reply，等待 spaceAvailable。
+    qint64 writableBytes();
+    // 退出前同步关闭所有文件并停止线程，返回各文件的摘要状态。
+    QHash<QString, CloseResult> shutdown(const QHash<QString, qint64> &truncateTo);
+
+signals:
+    void spaceAvailable();
+    void hashCheckpoint(const QString &key, const QByteArray &hashState);
+    void writeFailed(const QString &key, const QString &error);
+    void fileClosed(const QString &key, bool ok, const QString &error, const QString &sha256, const QByteArray &hashState);
+
+private:
+    enum class CommandType { Open, Write, Restart, DisableHash, Close };
+
+    struct Command {
+        CommandType type = CommandType::Write;
+        QString key;
+        QString path;
+        qint64 offset = 0;
+        QByteArray data;
+        FileUtils::Sha256Stream hash;
+        bool hashValid = false;
+    };
+
+    struct OpenFile {
+        QFile *file = nullptr;
+        FileUtils::Sha256Stream hash;
+        bool hashValid = false;
+        qint64 bytesSinceCheckpoint = 0;
+        bool failed = false;
+        QString error;
+    };
+
+    void enqueue(Command command);
+    void run();
+    void process(Command &command);
+    void fail(OpenFile &state, const QString &key, const QString &error);
+    CloseResult closeFile(const QString &key, qint64 truncateTo);
+
+    QThread *m_thread = nullptr;
+    QMutex m_mutex;
+    QWaitCondition m_wakeWorker;
+    QQueue<Command> m_queue;
+    qint64 m_pendingBytes = 0;
+    bool m_waitingForSpace = false;
+    bool m_stopping = false;
+    QHash<QString, qint64> m_shutdownTruncate;
+
+    // 仅由 I/O 线程访问。
+    QHash<QString, OpenFile> m_files;
+    QHash<QString, CloseResult> m_shutdownResults;
+};
+
+#endif // DOWNLOADFILESINK_H
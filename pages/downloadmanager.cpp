@@ -1,5 +1,6 @@
 #include "downloadmanager.h"
 
+#include "downloadfilesink.h"
 #include "downloadspage.h"
 #include "fileutils.h"
 
@@ -22,6 +23,109 @@
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 
+namespace {
+QJsonObject modelUpdateInfoToJson(const ModelUpdateInfo &info)
+{
+    QJsonObject obj;
+    obj["filePath"] = info.filePath;
+    obj["modelDir"] = info.modelDir;
+    obj["baseName"] = info.baseName;
+    obj["displayName"] = info.displayName;
+    obj["currentVersion"] = info.currentVersion;
+    obj["latestVersion"] = info.latestVersion;
+    obj["downloadUrl"] = info.downloadUrl;
+    obj["downloadFileName"] = info.downloadFileName;
+    obj["sha256"] = info.sha256;
+    obj["metadataSource"] = info.metadataSource;
+    obj["sourceUrl"] = info.sourceUrl;
+    obj["latestVersionJson"] = info.latestVersionJson;
+    obj["modelId"] = info.modelId;
+    obj["currentVersionId"] = info.currentVersionId;
+    obj["latestVersionId"] = info.latestVersionId;
+    obj["sizeMB"] = info.sizeMB;
+    obj["hasUpdate"] = info.hasUpdate;
+    obj["latestFileExistsLocally"] = info.latestFileExistsLocally;
+    obj["previewState"] = static_cast<int>(info.previewState);
+    return obj;
+}
+
+ModelUpdateInfo modelUpdateInfoFromJson(const QJsonObject &obj)
+{
+    ModelUpdateInfo info;
+    info.filePath = obj.value("filePath").toString();
+    if (info.filePath.isEmpty()) return info;
+    info.modelDir = obj.value("modelDir").toString(QFileInfo(info.filePath).absolutePath());
+    info.baseName = obj.value("baseName").toString(QFileInfo(info.filePath).completeBaseName());
+    info.displayName = obj.value("displayName").toString(info.baseName);
+    info.currentVersion = obj.value("currentVersion").toString();
+    info.latestVersion = obj.value("latestVersion").toString();
+    info.downloadUrl = obj.value("downloadUrl").toString();
+    info.downloadFileName = obj.value("downloadFileName").toString();
+    info.sha256 = obj.value("sha256").toString();
+    info.metadataSource = obj.value("metadataSource").toString();
+    info.sourceUrl = obj.value("sourceUrl").toString();
+    info.latestVersionJson = obj.value("latestVersionJson").toObject();
+    info.modelId = obj.value("modelId").toInt();
+    info.currentVersionId = obj.value("currentVersionId").toInt();
+    info.latestVersionId = obj.value("latestVersionId").toInt();
+    info.sizeMB = obj.value("sizeMB").toDouble();
+    info.hasUpdate = obj.value("hasUpdate").toBool(false);
+    info.latestFileExistsLocally = obj.value("latestFileExistsLocally").toBool(false);
+    info.previewState = static_cast<ModelPreviewState>(
+        obj.value("previewState").toInt(static_cast<int>(ModelPreviewState::MissingOrUnknown)));
+    return info;
+}
+
+// 解析 "bytes 100-199/1000"（总长可为 *），返回分片起点和完整大小。
+bool parseContentRange(const QByteArray &value, qint64 *start, qint64 *total)
+{
+    const QByteArray trimmed = value.trimmed();
+    if (!trimmed.startsWith("bytes ")) return false;
+    const QByteArray spec = trimmed.mid(6).trimmed();
+    const qsizetype dash = spec.indexOf('-');
+    const qsizetype slash = spec.indexOf('/');
+    if (dash <= 0 || slash <= dash) return false;
+
+    bool ok = false;
+    const qint64 first = spec.left(dash).toLongLong(&ok);
+    if (!ok) return false;
+    qint64 size = -1;
+    const QByteArray totalText = spec.mid(slash + 1).trimmed();
+    if (totalText != "*") {
+        size = totalText.toLongLong(&ok);
+        if (!ok) return false;
+    }
+    if (start) *start = first;
+    if (total) *total = size;
+    return true;
+}
+
+QString formatMegabytes(qint64 bytes)
+{
+    return QString::number(double(bytes) / 1024.0 / 1024.0, 'f', 1) + " MB";
+}
+
+// 限速令牌与进度刷新的节拍。
+constexpr int kTransferTickMs = 100;
+constexpr qint64 kProgressIntervalMs = 500;
+// reply 的读缓冲上限，缓冲满后由 TCP 窗口向服务端施加背压；限速时收得更紧。
+constexpr qint64 kReplyReadBufferSize = 4LL * 1024 * 1024;
+constexpr qint64 kThrottledReadBufferSize = 256 * 1024;
+// 每个分片至少这么大，小文件拆分的握手开销不划算。
+constexpr qint64 kMinSegmentBytes = 16LL * 1024 * 1024;
+// 续传记录的合并写盘间隔：摘要检查点很频繁，只更新内存，停顿后统一写一次。
+constexpr int kResumeSaveDelayMs = 3000;
+
+QString formatDuration(qint64 seconds)
+{
+    if (seconds >= 3600) {
+        return QString("%1:%2:%3").arg(seconds / 3600).arg((seconds / 60) % 60, 2, 10, QChar('0'))
+            .arg(seconds % 60, 2, 10, QChar('0'));
+    }
+    return QString("%1:%2").arg(seconds / 60, 2, 10, QChar('0')).arg(seconds % 60, 2, 10, QChar('0'));
+}
+} // namespace
+
 DownloadManager::DownloadManager(DownloadsPage *page,
                                  QNetworkAccessManager *network,
                                  QThreadPool *previewThreadPool,
@@ -34,6 +138,18 @@ DownloadManager::DownloadManager(DownloadsPage *page,
     m_previewTimer = new QTimer(this);
     m_previewTimer->setSingleShot(true);
     connect(m_previewTimer, &QTimer::timeout, this, &DownloadManager::processPreviewLoadBatch);
+
+    m_resumeSaveTimer = new QTimer(this);
+    m_resumeSaveTimer->setSingleShot(true);
+    m_resumeSaveTimer->setInterval(kResumeSaveDelayMs);
+    connect(m_resumeSaveTimer, &QTimer::timeout, this, &DownloadManager::saveResumeStore);
+
+    m_fileSink = new DownloadFileSink(this);
+    connect(m_fileSink, &DownloadFileSink::spaceAvailable, this, &DownloadManager::onSinkSpaceAvailable);
+    connect(m_fileSink, &DownloadFileSink::hashCheckpoint, this, &DownloadManager::onSinkHashCheckpoint);
+    connect(m_fileSink, &DownloadFileSink::writeFailed, this, &DownloadManager::onSinkWriteFailed);
+    connect(m_fileSink, &DownloadFileSink::fileClosed, this, &DownloadManager::onSinkFileClosed);
+    loadResumeStore();
 }
 
 DownloadManager::~DownloadManager()
@@ -219,28 +335,8 @@ void DownloadManager::ensureCacheLoaded()
     m_restoringCache = true;
     for (const QJsonValue &val : items) {
         const QJsonObject obj = val.toObject();
-        ModelUpdateInfo info;
-        info.filePath = obj.value("filePath").toString();
+        const ModelUpdateInfo info = modelUpdateInfoFromJson(obj);
         if (info.filePath.isEmpty()) continue;
-        info.modelDir = obj.value("modelDir").toString(QFileInfo(info.filePath).absolutePath());
-        info.baseName = obj.value("baseName").toString(QFileInfo(info.filePath).completeBaseName());
-        info.displayName = obj.value("displayName").toString(info.baseName);
-        info.currentVersion = obj.value("currentVersion").toString();
-        info.latestVersion = obj.value("latestVersion").toString();
-        info.downloadUrl = obj.value("downloadUrl").toString();
-        info.downloadFileName = obj.value("downloadFileName").toString();
-        info.sha256 = obj.value("sha256").toString();
-        info.metadataSource = obj.value("metadataSource").toString();
-        info.sourceUrl = obj.value("sourceUrl").toString();
-        info.latestVersionJson = obj.value("latestVersionJson").toObject();
-        info.modelId = obj.value("modelId").toInt();
-        info.currentVersionId = obj.value("currentVersionId").toInt();
-        info.latestVersionId = obj.value("latestVersionId").toInt();
-        info.sizeMB = obj.value("sizeMB").toDouble();
-        info.hasUpdate = obj.value("hasUpdate").toBool(false);
-        info.latestFileExistsLocally = obj.value("latestFileExistsLocally").toBool(false);
-        info.previewState = static_cast<ModelPreviewState>(
-            obj.value("previewState").toInt(static_cast<int>(ModelPreviewState::MissingOrUnknown)));
 
         const QString status = obj.value("status").toString(info.hasUpdate ? "发现新版本" : "已是最新");
         addOrUpdateCard(info, status, QFile::exists(info.filePath));
@@ -263,30 +359,12 @@ void DownloadManager::saveCache() const
             const ModelUpdateInfo info = m_infos.value(filePath);
             QString status = m_page->cardStatusText(filePath);
             if (status.contains("检查中") || status.contains("计算 Hash")) continue;
-            if (status.contains("下载中") || status.contains("认证重试") || status.contains("队列")) {
+            if (status.contains("下载中") || status.contains("续传") || status.contains("认证重试")
+                || status.contains("队列") || status.contains("重新下载")) {
                 status = info.hasUpdate ? "发现新版本" : "已是最新";
             }
 
-            QJsonObject obj;
-            obj["filePath"] = info.filePath;
-            obj["modelDir"] = info.modelDir;
-            obj["baseName"] = info.baseName;
-            obj["displayName"] = info.displayName;
-            obj["currentVersion"] = info.currentVersion;
-            obj["latestVersion"] = info.latestVersion;
-            obj["downloadUrl"] = info.downloadUrl;
-            obj["downloadFileName"] = info.downloadFileName;
-            obj["sha256"] = info.sha256;
-            obj["metadataSource"] = info.metadataSource;
-            obj["sourceUrl"] = info.sourceUrl;
-            obj["latestVersionJson"] = info.latestVersionJson;
-            obj["modelId"] = info.modelId;
-            obj["currentVersionId"] = info.currentVersionId;
-            obj["latestVersionId"] = info.latestVersionId;
-            obj["sizeMB"] = info.sizeMB;
-            obj["hasUpdate"] = info.hasUpdate;
-            obj["latestFileExistsLocally"] = info.latestFileExistsLocally;
-            obj["previewState"] = static_cast<int>(info.previewState);
+            QJsonObject obj = modelUpdateInfoToJson(info);
             obj["status"] = status;
             items.append(obj);
         }
@@ -312,16 +390,45 @@ void DownloadManager::shutdown()
     if (m_shuttingDown) return;
     m_shuttingDown = true;
     if (m_previewTimer) m_previewTimer->stop();
-    if (m_activeReply) {
-        m_activeReply->disconnect(this);
-        m_activeReply->abort();
-        m_activeReply = nullptr;
+    if (m_transferTimer) m_transferTimer->stop();
+    // 正在下载、校验和排队中的任务记为“中断”，下次启动时按 .part 续传。
+    QList<ModelFileDownloadTask> interrupted;
+    QHash<QString, qint64> truncateTo;
+    for (ActiveDownload *download : std::as_const(m_activeDownloads)) {
+        for (DownloadSegment &segment : download->segments) {
+            if (!segment.reply) continue;
+            segment.reply->disconnect(this);
+            segment.reply->abort();
+            segment.reply = nullptr;
+        }
+        // 分段乱序写入，只有从头连续的部分可以续传。
+        if (download->segmented) truncateTo.insert(download->task.filePath, contiguousPrefix(download));
+    }
+    // 写盘线程先落完缓冲里的数据，再关闭文件并交回摘要状态。
+    const QHash<QString, DownloadFileSink::CloseResult> closed = m_fileSink->shutdown(truncateTo);
+    for (ActiveDownload *download : std::as_const(m_activeDownloads)) {
+        const DownloadFileSink::CloseResult result = closed.value(download->task.filePath);
+        if (download->hashValid && result.ok && !result.hashState.isEmpty()) download->task.hashState = result.hashState;
+        if (!download->writeFailed && QFile::exists(download->task.tempPath)) interrupted.append(download->task);
+        delete download;
+    }
+    m_activeDownloads.clear();
+    for (const ModelFileDownloadTask &task : std::as_const(m_verifyingTasks)) {
+        if (QFile::exists(task.tempPath)) interrupted.append(task);
     }
-    if (m_activeFile) {
-        m_activeFile->close();
-        delete m_activeFile;
-        m_activeFile = nullptr;
+    m_verifyingTasks.clear();
+    for (const ModelFileDownloadTask &task : std::as_const(interrupted)) {
+        if (!m_resumeTasks.contains(task.filePath)) m_resumeOrder.append(task.filePath);
+        m_resumeTasks.insert(task.filePath, task);
+        if (!m_interruptedDownloadPaths.contains(task.filePath)) m_interruptedDownloadPaths.append(task.filePath);
     }
+    for (const ModelFileDownloadTask &task : std::as_const(m_downloadQueue)) {
+        if (task.filePath.isEmpty() || m_canceledPaths.contains(task.filePath)) continue;
+        if (!m_resumeTasks.contains(task.filePath)) m_resumeOrder.append(task.filePath);
+        m_resumeTasks.insert(task.filePath, task);
+        if (!m_interruptedDownloadPaths.contains(task.filePath)) m_interruptedDownloadPaths.append(task.filePath);
+    }
+    saveResumeStore();
     m_downloadQueue.clear();
     m_queuedDownloadPaths.clear();
     m_pendingPreviewLoads.clear();
@@ -464,7 +571,7 @@ void DownloadManager::startSelectedDownloads()
         const ModelUpdateInfo info = m_infos.value(filePath);
         if (!info.hasUpdate) continue;
         const QString status = cardStatusText(filePath);
-        if (status.contains("已忽略") || status.contains("下载中") ||
+        if (status.contains("已忽略") || status.contains("下载中") || status.contains("续传中") ||
             status.contains("认证重试") || status.contains("队列") ||
             status.contains("完成")) {
             continue;
@@ -478,28 +585,30 @@ void DownloadManager::startSelectedDownloads()
 void DownloadManager::enqueueModelDownload(const ModelUpdateInfo &info)
 {
     if (info.filePath.isEmpty()) return;
-    if ((m_downloading && m_activeTask.filePath == info.filePath)
+    if (m_activeDownloads.contains(info.filePath) || m_verifyingTasks.contains(info.filePath)
         || m_queuedDownloadPaths.contains(info.filePath)) {
         emit statusMessageChanged("该模型已经在下载队列中。");
         return;
     }
 
-    bool overwrite = false;
-    const QString targetPath = chooseTargetPath(info, &overwrite);
-    if (targetPath.isEmpty()) return;
-
     ModelFileDownloadTask task;
-    task.info = info;
-    task.targetPath = targetPath;
-    task.tempPath = targetPath + ".part";
-    task.filePath = info.filePath;
-    task.overwrite = overwrite;
-    if (m_page) m_page->updateCardTargetPath(info.filePath, targetPath);
+    if (!resumableTaskFor(info, &task)) {
+        bool overwrite = false;
+        const QString targetPath = chooseTargetPath(info, &overwrite);
+        if (targetPath.isEmpty()) return;
+
+        task.info = info;
+        task.targetPath = targetPath;
+        task.tempPath = targetPath + ".part";
+        task.filePath = info.filePath;
+        task.overwrite = overwrite;
+    }
+    if (m_page) m_page->updateCardTargetPath(info.filePath, task.targetPath);
     m_downloadQueue.enqueue(task);
     m_queuedDownloadPaths.insert(info.filePath);
     m_canceledPaths.remove(info.filePath);
     updateStatus(info.filePath, "已加入下载队列");
-    if (!m_downloading) processNextModelDownload();
+    processNextModelDownload();
 }
 
 QString DownloadManager::chooseTargetPath(const ModelUpdateInfo &info, bool *overwrite) const
@@ -541,131 +650,553 @@ void DownloadManager::retryFailedDownloads()
     if (!queued) emit statusMessageChanged("当前没有下载失败任务可重试。");
 }
 
-void DownloadManager::processNextModelDownload()
+void DownloadManager::resumeInterruptedDownloads()
 {
-    if (m_downloadQueue.isEmpty()) {
-        m_downloading = false;
-        m_activeTask = ModelFileDownloadTask();
-        return;
+    if (m_interruptedDownloadPaths.isEmpty()) return;
+    ensureCacheLoaded();
+
+    const QStringList paths = m_interruptedDownloadPaths;
+    m_interruptedDownloadPaths.clear();
+    int resumed = 0;
+    for (const QString &filePath : paths) {
+        if (!m_resumeTasks.contains(filePath)) continue;
+        ModelUpdateInfo info = m_infos.value(filePath);
+        if (info.filePath.isEmpty()) {
+            // 下载列表缓存里没有该模型时，用续传记录里的版本信息重建卡片。
+            info = m_resumeTasks.value(filePath).info;
+            addOrUpdateCard(info, "下载已中断", QFile::exists(filePath));
+        }
+        enqueueModelDownload(info);
+        ++resumed;
     }
+    saveResumeStore();
+    if (resumed > 0) emit statusMessageChanged(QString("正在恢复 %1 个中断的模型下载。").arg(resumed));
+}
 
-    m_downloading = true;
-    m_activeTask = m_downloadQueue.dequeue();
-    m_queuedDownloadPaths.remove(m_activeTask.filePath);
-    if (m_canceledPaths.contains(m_activeTask.info.filePath)) {
-        m_canceledPaths.remove(m_activeTask.info.filePath);
-        QTimer::singleShot(0, this, &DownloadManager::processNextModelDownload);
-        return;
+void DownloadManager::setTransferLimits(int maxConcurrentDownloads,
+                                        int segmentsPerFile,
+                                        qint64 bandwidthLimitBytesPerSecond)
+{
+    m_maxConcurrentDownloads = qBound(1, maxConcurrentDownloads, 8);
+    m_segmentsPerFile = qBound(1, segmentsPerFile, 8);
+    const qint64 limit = qMax<qint64>(0, bandwidthLimitBytesPerSecond);
+    if (limit != m_bandwidthLimit) {
+        m_bandwidthLimit = limit;
+        m_bandwidthTokens = 0;
+        // 限速时收紧 reply 的读缓冲，令 TCP 窗口承担背压，而不是把数据堆在内存里。
+        for (ActiveDownload *download : std::as_const(m_activeDownloads)) {
+            for (const DownloadSegment &segment : std::as_const(download->segments)) {
+                if (segment.reply) segment.reply->setReadBufferSize(m_bandwidthLimit > 0 ? kThrottledReadBufferSize : kReplyReadBufferSize);
+            }
+        }
     }
-    const QUrl downloadUrl(m_activeTask.info.downloadUrl);
-    const bool downloadHasToken = QUrlQuery(downloadUrl).hasQueryItem("token");
+    if (!m_shuttingDown && !m_downloadQueue.isEmpty()) QTimer::singleShot(0, this, &DownloadManager::processNextModelDownload);
+}
+
+void DownloadManager::processNextModelDownload()
+{
+    if (m_shuttingDown) return;
+    while (m_activeDownloads.size() < m_maxConcurrentDownloads && !m_downloadQueue.isEmpty()) {
+        const ModelFileDownloadTask task = m_downloadQueue.dequeue();
+        m_queuedDownloadPaths.remove(task.filePath);
+        if (m_canceledPaths.remove(task.filePath)) continue;
+        startModelDownload(task);
+    }
+    if (m_transferTimer && m_activeDownloads.isEmpty()) m_transferTimer->stop();
+}
+
+void DownloadManager::startModelDownload(ModelFileDownloadTask task)
+{
     if (!m_network || !m_makeRequest) {
-        updateStatus(m_activeTask.info.filePath, "下载失败: 下载器未初始化");
-        QTimer::singleShot(0, this, &DownloadManager::processNextModelDownload);
+        updateStatus(task.info.filePath, "下载失败: 下载器未初始化");
         return;
     }
 
-    QFile::remove(m_activeTask.tempPath);
-    QDir().mkpath(QFileInfo(m_activeTask.tempPath).absolutePath());
+    QDir().mkpath(QFileInfo(task.tempPath).absolutePath());
+
+    auto *download = new ActiveDownload;
+    download->hashValid = true;
+    FileUtils::Sha256Stream hash;
+
+    // 只有登记过续传信息的 .part 才接着写，避免把旧版本残留拼进新文件。
+    const qint64 partialSize = QFileInfo(task.tempPath).size();
+    task.resumeOffset = 0;
+    task.computedSha256.clear();
+    if (partialSize > 0 && m_resumeTasks.contains(task.filePath)) {
+        FileUtils::Sha256Stream restored;
+        const qint64 hashedBytes = restored.restoreState(task.hashState)
+            ? qint64(restored.processedBytes())
+            : -1;
+        if (task.expectedSize > 0 && partialSize == task.expectedSize) {
+            if (hashedBytes == partialSize) task.computedSha256 = restored.resultHex();
+            delete download;
+            verifyAndFinishDownload(task);
+            return;
+        }
+        if (task.expectedSize <= 0 || partialSize < task.expectedSize) {
+            task.resumeOffset = partialSize;
+            if (hashedBytes >= 0 && hashedBytes <= partialSize
+                && (hashedBytes == partialSize || QFile::resize(task.tempPath, hashedBytes))) {
+                // 截回最后一次摘要检查点，检查点之后未计入摘要的尾部重新下载。
+                task.resumeOffset = hashedBytes;
+                hash = restored;
+            } else {
+                // 没有可用的摘要状态：照常续传，完成后回退到整文件校验。
+                download->hashValid = false;
+                task.hashState.clear();
+            }
+        }
+    }
+    if (task.resumeOffset == 0) {
+        QFile::remove(task.tempPath);
+        task.etag.clear();
+        task.lastModified.clear();
+        task.hashState.clear();
+        task.expectedSize = -1;
+        hash.reset();
+        download->hashValid = true;
+    }
 
-    m_activeFile = new QFile(m_activeTask.tempPath, this);
-    if (!m_activeFile->open(QIODevice::WriteOnly)) {
-        updateStatus(m_activeTask.info.filePath, "下载失败: 无法写入目标路径");
-        m_activeFile->deleteLater();
-        m_activeFile = nullptr;
-        QTimer::singleShot(0, this, &DownloadManager::processNextModelDownload);
-        return;
+    // 打开失败由写盘线程通过 writeFailed 回报，届时中止请求。
+    m_fileSink->open(task.filePath, task.tempPath, hash, download->hashValid);
+    download->task = task;
+
+    DownloadSegment segment;
+    segment.start = task.resumeOffset;
+    download->segments.append(segment);
+    download->sampleTimer.start();
+    m_activeDownloads.insert(task.filePath, download);
+
+    if (task.resumeOffset > 0) {
+        updateStatus(task.info.filePath, QString("续传中... (已下载 %1)").arg(formatMegabytes(task.resumeOffset)));
+    } else {
+        updateStatus(task.info.filePath, "下载中...");
+    }
+    const int initialPercent = task.expectedSize > 0 ? int((task.resumeOffset * 100) / task.expectedSize) : 0;
+    updateProgress(task.info.filePath, initialPercent, "--");
+
+    if (!m_transferTimer) {
+        m_transferTimer = new QTimer(this);
+        m_transferTimer->setInterval(kTransferTickMs);
+        connect(m_transferTimer, &QTimer::timeout, this, &DownloadManager::onTransferTick);
+    }
+    if (!m_transferTimer->isActive()) {
+        m_progressTimer.start();
+        m_transferTimer->start();
     }
-    m_activeWriteFailed = false;
-    m_activeWriteError.clear();
 
-    m_downloadTimer.restart();
-    updateStatus(m_activeTask.info.filePath, "下载中...");
-    updateProgress(m_activeTask.info.filePath, 0, "--");
+    startSegmentRequest(download, 0);
+}
 
-    QNetworkReply *reply = m_network->get(m_makeRequest(downloadUrl, !downloadHasToken));
-    m_activeReply = reply;
+void DownloadManager::startSegmentRequest(ActiveDownload *download, int index)
+{
+    const DownloadSegment segment = download->segments.at(index);
+    const ModelFileDownloadTask &task = download->task;
+    const QUrl downloadUrl(task.info.downloadUrl);
+    const bool downloadHasToken = QUrlQuery(downloadUrl).hasQueryItem("token");
 
-    connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
-        if (!writeActiveReplyData(reply)) reply->abort();
+    QNetworkRequest request = m_makeRequest(downloadUrl, !downloadHasToken);
+    // 模型文件按原始字节续传，禁止透明压缩导致偏移错位。
+    request.setRawHeader("Accept-Encoding", "identity");
+    // 首段在允许分段时以 bytes=0- 探测服务端是否支持 Range，拿到总大小后再拆分。
+    const bool probeForSegments = index == 0 && segment.start == 0
+                                  && m_segmentsPerFile > 1 && !task.singleConnection;
+    if (segment.start > 0 || segment.end >= 0 || probeForSegments) {
+        QByteArray range = "bytes=" + QByteArray::number(segment.start) + "-";
+        if (segment.end >= 0) range += QByteArray::number(segment.end);
+        request.setRawHeader("Range", range);
+        // 弱 ETag 不能用于 If-Range，退回 Last-Modified。
+        const QString validator = (!task.etag.isEmpty() && !task.etag.startsWith("W/"))
+            ? task.etag
+            : task.lastModified;
+        if (segment.start > 0 && !validator.isEmpty()) request.setRawHeader("If-Range", validator.toLatin1());
+    }
+
+    QNetworkReply *reply = m_network->get(request);
+    reply->setReadBufferSize(m_bandwidthLimit > 0 ? kThrottledReadBufferSize : kReplyReadBufferSize);
+    download->segments[index].reply = reply;
+
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, download, index, reply]() {
+        if (!handleSegmentHeaders(download, index)) reply->abort();
+    });
+    connect(reply, &QNetworkReply::readyRead, this, [this, download, index, reply]() {
+        if (!drainSegment(download, index, m_bandwidthLimit > 0 ? m_bandwidthTokens : -1)) reply->abort();
     });
-    connect(reply, &QNetworkReply::downloadProgress, this, [this](qint64 received, qint64 total) {
-        const int percent = total > 0 ? int((received * 100) / total) : 0;
-        const double seconds = qMax(0.1, double(m_downloadTimer.elapsed()) / 1000.0);
-        const double mbps = (double(received) / 1024.0 / 1024.0) / seconds;
-        updateProgress(m_activeTask.info.filePath, percent, QString::number(mbps, 'f', 2) + " MB/s");
+    connect(reply, &QNetworkReply::finished, this, [this, download, index, reply]() {
+        onSegmentFinished(download, index, reply);
     });
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        writeActiveReplyData(reply);
-        closeActiveFile();
+}
+
+bool DownloadManager::handleSegmentHeaders(ActiveDownload *download, int index)
+{
+    QNetworkReply *reply = download->segments.at(index).reply;
+    if (!reply || download->segments.at(index).headersChecked) return true;
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    // 重定向和错误响应不落盘，交给 finished 处理。
+    if (status < 200 || status >= 300) return true;
+
+    DownloadSegment &segment = download->segments[index];
+    segment.headersChecked = true;
+    qint64 totalSize = -1;
+    if (status == 206) {
+        qint64 rangeStart = -1;
+        if (!parseContentRange(reply->rawHeader("Content-Range"), &rangeStart, &totalSize)
+            || rangeStart != segment.start) {
+            download->restartRequested = true;
+            return false;
+        }
+    } else {
+        if (index > 0) {
+            // 附加分段收到整文件响应：服务端不支持或拒绝了该 Range。
+            download->restartRequested = true;
+            return false;
+        }
+        if (segment.start > 0) {
+            // 服务端忽略 Range 或 If-Range 校验不通过，返回了完整文件：从头覆盖 .part。
+            m_fileSink->restart(download->task.filePath);
+            segment.start = 0;
+            download->task.resumeOffset = 0;
+            download->task.hashState.clear();
+            download->hashValid = true;
+        }
+        const QVariant length = reply->header(QNetworkRequest::ContentLengthHeader);
+        if (length.isValid()) totalSize = length.toLongLong();
+    }
+
+    const QString etag = QString::fromLatin1(reply->rawHeader("ETag")).trimmed();
+    if ((segment.start > 0 || index > 0) && !download->task.etag.isEmpty()
+        && !etag.isEmpty() && etag != download->task.etag) {
+        download->restartRequested = true;
+        return false;
+    }
+    if (index > 0) return true;
+
+    download->task.etag = etag;
+    download->task.lastModified = QString::fromLatin1(reply->rawHeader("Last-Modified")).trimmed();
+    if (totalSize > 0) download->task.expectedSize = totalSize;
+    rememberResumableTask(download->task, false);
+    if (status == 206 && segment.start == 0) splitIntoSegments(download);
+    return true;
+}
+
+void DownloadManager::splitIntoSegments(ActiveDownload *download)
+{
+    const qint64 totalSize = download->task.expectedSize;
+    if (m_segmentsPerFile <= 1 || download->task.singleConnection || totalSize <= 0) return;
+    const int count = int(qMin<qint64>(m_segmentsPerFile, totalSize / kMinSegmentBytes));
+    if (count < 2) return;
+
+    // 分段数据乱序落盘，无法边下边算摘要，完成后回退到整文件校验。
+    download->segmented = true;
+    download->hashValid = false;
+    download->task.hashState.clear();
+    m_fileSink->disableHash(download->task.filePath);
+    const qint64 chunk = totalSize / count;
+    download->segments[0].end = chunk - 1;
+    for (int i = 1; i < count; ++i) {
+        DownloadSegment segment;
+        segment.start = i * chunk;
+        segment.end = i == count - 1 ? totalSize - 1 : (i + 1) * chunk - 1;
+        download->segments.append(segment);
+    }
+    for (int i = 1; i < count; ++i) startSegmentRequest(download, i);
+}
+
+bool DownloadManager::drainSegment(ActiveDownload *download, int index, qint64 budget)
+{
+    QNetworkReply *reply = download->segments.at(index).reply;
+    if (!reply || download->writeFailed || download->segments.at(index).cutoff) return !download->writeFailed;
+    if (!download->segments.at(index).headersChecked) {
+        if (!handleSegmentHeaders(download, index)) return false;
+        if (!download->segments.at(index).headersChecked) {
+            // 非 2xx 响应体（错误页）不能写进 .part，否则续传时会被当成模型数据。
+            reply->readAll();
+            return true;
+        }
+    }
+
+    const DownloadSegment &segment = download->segments.at(index);
+    qint64 available = reply->bytesAvailable();
+    if (budget >= 0) available = qMin(available, budget);
+    // 写盘缓冲已满时数据留在 reply 里，等 spaceAvailable 再读。reply 结束时例外，剩余量受读缓冲上限约束。
+    if (!reply->isFinished()) available = qMin(available, m_fileSink->writableBytes());
+    if (segment.end >= 0) available = qMin(available, segment.end - segment.start + 1 - segment.written);
+    if (available > 0) {
+        const QByteArray data = reply->read(available);
+        if (m_bandwidthLimit > 0) m_bandwidthTokens = qMax<qint64>(0, m_bandwidthTokens - data.size());
+        if (!data.isEmpty() && !writeSegmentData(download, index, data)) return false;
+    }
+
+    DownloadSegment &current = download->segments[index];
+    if (current.end >= 0 && current.written >= current.end - current.start + 1 && !reply->isFinished()) {
+        // 开放式首段已读满分配给它的区间，主动断开，剩余部分由其它分段负责。
+        current.cutoff = true;
+        current.done = true;
+        current.reply = nullptr;
+        reply->disconnect(this);
+        reply->abort();
         reply->deleteLater();
-        m_activeReply = nullptr;
-
-        if (m_activeWriteFailed) {
-            QFile::remove(m_activeTask.tempPath);
-            updateStatus(m_activeTask.info.filePath,
-                         "下载失败: 写入文件失败" +
-                             (m_activeWriteError.isEmpty() ? QString() : " (" + m_activeWriteError + ")"));
-            QTimer::singleShot(0, this, &DownloadManager::processNextModelDownload);
-            return;
+        QTimer::singleShot(0, this, [this, filePath = download->task.filePath]() {
+            checkActiveDownloadComplete(filePath);
+        });
+    }
+    return true;
+}
+
+bool DownloadManager::writeSegmentData(ActiveDownload *download, int index, const QByteArray &data)
+{
+    DownloadSegment &segment = download->segments[index];
+    m_fileSink->write(download->task.filePath, segment.start + segment.written, data);
+    segment.written += data.size();
+    download->sessionBytes += data.size();
+    return true;
+}
+
+void DownloadManager::onSegmentFinished(ActiveDownload *download, int index, QNetworkReply *reply)
+{
+    drainSegment(download, index, -1);
+    reply->deleteLater();
+    DownloadSegment &segment = download->segments[index];
+    segment.done = true;
+    segment.reply = nullptr;
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (!download->failed && !segment.cutoff) {
+        if (download->writeFailed) {
+            download->failed = true;
+        } else if (download->restartRequested || (status == 416 && segment.start > 0)) {
+            download->restartRequested = true;
+            download->failed = true;
+        } else if (reply->error() != QNetworkReply::NoError) {
+            download->failed = true;
+            download->errorStatus = status;
+            download->errorText = m_replyError ? m_replyError(reply) : reply->errorString();
+        } else if (segment.end >= 0 && segment.written != segment.end - segment.start + 1) {
+            download->failed = true;
+            download->errorText = QStringLiteral("分段数据不完整");
         }
+        if (download->failed) abortOtherSegments(download, index);
+    }
+    checkActiveDownloadComplete(download->task.filePath);
+}
 
-        if (reply->error() != QNetworkReply::NoError) {
-            const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-            const bool canTokenRetry = (status == 401 || status == 403) &&
-                                      !m_activeTask.info.downloadUrl.contains("token=", Qt::CaseInsensitive) &&
-                                      m_apiKey && !m_apiKey().isEmpty() && m_tokenUrl;
-            if (canTokenRetry) {
-                QFile::remove(m_activeTask.tempPath);
-                m_activeTask.info.downloadUrl = m_tokenUrl(QUrl(m_activeTask.info.downloadUrl)).toString();
-                m_downloadQueue.enqueue(m_activeTask);
-                m_queuedDownloadPaths.insert(m_activeTask.filePath);
-                updateStatus(m_activeTask.info.filePath, "认证重试中...");
-                QTimer::singleShot(0, this, &DownloadManager::processNextModelDownload);
-                return;
-            }
-            QFile::remove(m_activeTask.tempPath);
-            updateStatus(m_activeTask.info.filePath, "下载失败: " + (m_replyError ? m_replyError(reply) : reply->errorString()));
-            QTimer::singleShot(0, this, &DownloadManager::processNextModelDownload);
-            return;
+void DownloadManager::abortOtherSegments(ActiveDownload *download, int keepIndex)
+{
+    for (int i = 0; i < download->segments.size(); ++i) {
+        if (i == keepIndex) continue;
+        DownloadSegment &segment = download->segments[i];
+        if (segment.reply) {
+            QNetworkReply *reply = segment.reply;
+            reply->disconnect(this);
+            reply->abort();
+            reply->deleteLater();
         }
+        segment.reply = nullptr;
+        segment.done = true;
+    }
+}
 
-        verifyAndFinishDownload(m_activeTask);
-    });
+void DownloadManager::checkActiveDownloadComplete(const QString &filePath)
+{
+    ActiveDownload *download = m_activeDownloads.value(filePath);
+    if (!download || download->closing) return;
+    for (const DownloadSegment &segment : std::as_const(download->segments)) {
+        if (!segment.done) return;
+    }
+    completeActiveDownload(download);
+}
+
+qint64 DownloadManager::contiguousPrefix(const ActiveDownload *download) const
+{
+    // 从文件头起连续写满的长度；分段下载中断后只保留这一段用于续传。
+    qint64 position = download->task.resumeOffset;
+    for (const DownloadSegment &segment : download->segments) {
+        if (segment.start != position) break;
+        position = segment.start + segment.written;
+        if (segment.end < 0 || segment.written != segment.end - segment.start + 1) break;
+    }
+    return position;
+}
+
+qint64 DownloadManager::completedBytes(const ActiveDownload *download) const
+{
+    qint64 bytes = download->task.resumeOffset;
+    for (const DownloadSegment &segment : download->segments) bytes += segment.written;
+    return bytes;
+}
+
+void DownloadManager::completeActiveDownload(ActiveDownload *download)
+{
+    // 先让写盘线程写完缓冲并关闭文件，结果在 onSinkFileClosed 里处理；期间仍占用下载名额。
+    download->closing = true;
+    const bool failed = download->failed || download->writeFailed;
+    const qint64 truncateTo = failed && download->segmented ? contiguousPrefix(download) : -1;
+    m_fileSink->close(download->task.filePath, truncateTo);
+}
+
+void DownloadManager::onSinkFileClosed(const QString &filePath, bool ok, const QString &error,
+                                       const QString &sha256, const QByteArray &hashState)
+{
+    if (m_shuttingDown) return;
+    ActiveDownload *download = m_activeDownloads.value(filePath);
+    if (!download || !download->closing) return;
+    m_activeDownloads.remove(filePath);
+
+    ModelFileDownloadTask task = download->task;
+    if (!ok && !download->writeFailed) {
+        download->writeFailed = true;
+        download->writeError = error;
+    }
+    if (download->hashValid && !hashState.isEmpty()) task.hashState = hashState;
+    const bool failed = download->failed || download->writeFailed;
+
+    if (!failed) {
+        if (download->hashValid) task.computedSha256 = sha256;
+        delete download;
+        verifyAndFinishDownload(task);
+        return;
+    }
+
+    if (download->writeFailed) {
+        QFile::remove(task.tempPath);
+        forgetResumableTask(task.filePath);
+        updateStatus(task.info.filePath,
+                     "下载失败: 写入文件失败" +
+                         (download->writeError.isEmpty() ? QString() : " (" + download->writeError + ")"));
+    } else if (download->restartRequested) {
+        if (download->segmented) task.singleConnection = true;
+        requeueFromScratch(task);
+    } else {
+        const int status = download->errorStatus;
+        const bool canTokenRetry = (status == 401 || status == 403) &&
+                                   !task.info.downloadUrl.contains("token=", Qt::CaseInsensitive) &&
+                                   m_apiKey && !m_apiKey().isEmpty() && m_tokenUrl;
+        // 分段下载的文件已由写盘线程截到连续前缀。
+        const qint64 keptBytes = contiguousPrefix(download);
+        if (canTokenRetry) {
+            task.info.downloadUrl = m_tokenUrl(QUrl(task.info.downloadUrl)).toString();
+            if (keptBytes > 0) rememberResumableTask(task, false);
+            m_downloadQueue.enqueue(task);
+            m_queuedDownloadPaths.insert(task.filePath);
+            updateStatus(task.info.filePath, "认证重试中...");
+        } else if (keptBytes > 0) {
+            // 网络中断保留 .part，重试时以 Range 从断点继续。
+            rememberResumableTask(task, false);
+            updateStatus(task.info.filePath,
+                         QString("下载失败: %1（已保留 %2，重试将续传）").arg(download->errorText, formatMegabytes(keptBytes)));
+        } else {
+            QFile::remove(task.tempPath);
+            forgetResumableTask(task.filePath);
+            updateStatus(task.info.filePath, "下载失败: " + download->errorText);
+        }
+    }
+    delete download;
+    QTimer::singleShot(0, this, &DownloadManager::processNextModelDownload);
 }
 
-bool DownloadManager::writeActiveReplyData(QNetworkReply *reply)
+void DownloadManager::onSinkWriteFailed(const QString &filePath, const QString &error)
 {
-    if (!reply || !m_activeFile || m_activeWriteFailed) return !m_activeWriteFailed;
-    const QByteArray data = reply->readAll();
-    if (data.isEmpty()) return true;
-    const qint64 written = m_activeFile->write(data);
-    if (written == data.size()) return true;
+    ActiveDownload *download = m_activeDownloads.value(filePath);
+    if (!download || download->closing || download->writeFailed) return;
+    download->writeFailed = true;
+    download->writeError = error;
+    download->failed = true;
+    abortOtherSegments(download, -1);
+    checkActiveDownloadComplete(filePath);
+}
+
+void DownloadManager::onSinkHashCheckpoint(const QString &filePath, const QByteArray &hashState)
+{
+    ActiveDownload *download = m_activeDownloads.value(filePath);
+    if (!download || !download->hashValid) return;
+    download->task.hashState = hashState;
+    rememberResumableTask(download->task, false);
+}
+
+void DownloadManager::onSinkSpaceAvailable()
+{
+    drainAllSegments();
+}
 
-    m_activeWriteFailed = true;
-    m_activeWriteError = m_activeFile->errorString();
-    if (m_activeWriteError.isEmpty()) m_activeWriteError = QStringLiteral("写入长度不完整");
-    return false;
+void DownloadManager::drainAllSegments()
+{
+    QList<QPair<QString, int>> openSegments;
+    for (auto it = m_activeDownloads.cbegin(); it != m_activeDownloads.cend(); ++it) {
+        for (int i = 0; i < it.value()->segments.size(); ++i) {
+            if (it.value()->segments.at(i).reply) openSegments.append(qMakePair(it.key(), i));
+        }
+    }
+    const qint64 share = m_bandwidthLimit > 0 && !openSegments.isEmpty()
+        ? qMax<qint64>(1, m_bandwidthTokens / openSegments.size())
+        : -1;
+    for (const auto &entry : std::as_const(openSegments)) {
+        // 上一个分段失败可能已结束整个下载，逐个重新查找。
+        ActiveDownload *download = m_activeDownloads.value(entry.first);
+        if (!download || entry.second >= download->segments.size()) continue;
+        QNetworkReply *reply = download->segments.at(entry.second).reply;
+        if (!reply || reply->bytesAvailable() <= 0) continue;
+        const qint64 budget = share >= 0 ? qMin(share, m_bandwidthTokens) : -1;
+        if (!drainSegment(download, entry.second, budget)) reply->abort();
+    }
 }
 
-void DownloadManager::closeActiveFile()
+void DownloadManager::onTransferTick()
 {
-    if (!m_activeFile) return;
-    if (!m_activeFile->flush() && !m_activeWriteFailed) {
-        m_activeWriteFailed = true;
-        m_activeWriteError = m_activeFile->errorString();
+    if (m_bandwidthLimit > 0 && !m_activeDownloads.isEmpty()) {
+        // 令牌桶：每个 tick 补充限额的 1/10，最多积攒 1/4 秒的额度，按连接平均分配。
+        const qint64 burst = qMax<qint64>(m_bandwidthLimit / 4, 64 * 1024);
+        m_bandwidthTokens = qMin(burst, m_bandwidthTokens + m_bandwidthLimit * kTransferTickMs / 1000);
+        drainAllSegments();
+    }
+    if (m_progressTimer.elapsed() >= kProgressIntervalMs) {
+        m_progressTimer.restart();
+        updateTransferProgress();
+    }
+}
+
+void DownloadManager::updateTransferProgress()
+{
+    for (ActiveDownload *download : std::as_const(m_activeDownloads)) {
+        const qint64 elapsed = download->sampleTimer.restart();
+        if (elapsed > 0) {
+            const double instant = double(download->sessionBytes - download->sampledBytes) * 1000.0 / double(elapsed);
+            download->bytesPerSecond = download->bytesPerSecond <= 0.0
+                ? instant
+                : download->bytesPerSecond * 0.7 + instant * 0.3;
+            download->sampledBytes = download->sessionBytes;
+        }
+
+        const qint64 done = completedBytes(download);
+        const qint64 total = download->task.expectedSize;
+        const int percent = total > 0 ? int((done * 100) / total) : 0;
+        QString text = QString::number(download->bytesPerSecond / 1024.0 / 1024.0, 'f', 2) + " MB/s";
+        if (total > 0 && download->bytesPerSecond > 1.0) {
+            text += " · 剩余 " + formatDuration(qint64(double(total - done) / download->bytesPerSecond));
+        }
+        if (download->segments.size() > 1) text += QString(" · %1 段").arg(download->segments.size());
+        updateProgress(download->task.info.filePath, percent, text);
     }
-    m_activeFile->close();
-    m_activeFile->deleteLater();
-    m_activeFile = nullptr;
 }
 
 void DownloadManager::verifyAndFinishDownload(const ModelFileDownloadTask &task)
 {
+    // 校验期间仍占用该模型的下载名额，防止同一文件被重复排队。
+    m_verifyingTasks.insert(task.filePath, task);
     const QFileInfo tempInfo(task.tempPath);
     if (!tempInfo.exists() || tempInfo.size() <= 0) {
         QFile::remove(task.tempPath);
+        forgetResumableTask(task.filePath);
         updateStatus(task.info.filePath, "下载失败: 下载文件为空");
+        m_verifyingTasks.remove(task.filePath);
+        QTimer::singleShot(0, this, &DownloadManager::processNextModelDownload);
+        return;
+    }
+
+    if (task.expectedSize > 0 && tempInfo.size() != task.expectedSize) {
+        QFile::remove(task.tempPath);
+        forgetResumableTask(task.filePath);
+        updateStatus(task.info.filePath, "下载失败: 文件大小与服务端不一致");
+        m_verifyingTasks.remove(task.filePath);
         QTimer::singleShot(0, this, &DownloadManager::processNextModelDownload);
         return;
     }
@@ -673,6 +1204,21 @@ void DownloadManager::verifyAndFinishDownload(const ModelFileDownloadTask &task)
     const QString expected = task.info.sha256.trimmed();
     if (expected.isEmpty()) {
         finishModelDownload(task);
+        m_verifyingTasks.remove(task.filePath);
+        QTimer::singleShot(0, this, &DownloadManager::processNextModelDownload);
+        return;
+    }
+
+    if (!task.computedSha256.isEmpty()) {
+        // 摘要已随下载增量算完，无需再读一遍文件。
+        if (task.computedSha256.compare(expected, Qt::CaseInsensitive) != 0) {
+            QFile::remove(task.tempPath);
+            forgetResumableTask(task.filePath);
+            updateStatus(task.info.filePath, "下载失败: SHA256 校验失败");
+        } else {
+            finishModelDownload(task);
+        }
+        m_verifyingTasks.remove(task.filePath);
         QTimer::singleShot(0, this, &DownloadManager::processNextModelDownload);
         return;
     }
@@ -684,12 +1230,15 @@ void DownloadManager::verifyAndFinishDownload(const ModelFileDownloadTask &task)
         const QString actual = watcher->result();
         watcher->deleteLater();
         if (m_shuttingDown) return;
+        m_verifyingTasks.remove(task.filePath);
 
         if (actual.isEmpty()) {
             QFile::remove(task.tempPath);
+            forgetResumableTask(task.filePath);
             updateStatus(task.info.filePath, "下载失败: 无法计算 SHA256");
         } else if (actual.compare(expected, Qt::CaseInsensitive) != 0) {
             QFile::remove(task.tempPath);
+            forgetResumableTask(task.filePath);
             updateStatus(task.info.filePath, "下载失败: SHA256 校验失败");
         } else {
             finishModelDownload(task);
@@ -703,6 +1252,8 @@ void DownloadManager::verifyAndFinishDownload(const ModelFileDownloadTask &task)
 
 void DownloadManager::finishModelDownload(const ModelFileDownloadTask &task)
 {
+    // 到这里 .part 已完整校验，无论安装成败都不再作为续传来源。
+    forgetResumableTask(task.filePath);
     if (QFile::exists(task.targetPath) && !task.overwrite && task.targetPath != task.tempPath) {
         QFile::remove(task.tempPath);
         updateStatus(task.info.filePath, "下载失败: 目标文件已存在");
@@ -737,6 +1288,142 @@ void DownloadManager::finishModelDownload(const ModelFileDownloadTask &task)
     emit modelFileDownloaded(task.info, task.targetPath);
 }
 
+void DownloadManager::requeueFromScratch(ModelFileDownloadTask task)
+{
+    // 断点与服务端文件不一致（分片起点不符、ETag 变化或 416）：丢弃 .part 后重新排队一次完整下载。
+    QFile::remove(task.tempPath);
+    forgetResumableTask(task.filePath);
+    task.resumeOffset = 0;
+    task.expectedSize = -1;
+    task.etag.clear();
+    task.lastModified.clear();
+    task.hashState.clear();
+    m_downloadQueue.enqueue(task);
+    m_queuedDownloadPaths.insert(task.filePath);
+    updateStatus(task.info.filePath, "服务端文件已变化，重新下载...");
+}
+
+QString DownloadManager::resumeStorePath() const
+{
+    return qApp->applicationDirPath() + "/config/download_resume.json";
+}
+
+void DownloadManager::loadResumeStore()
+{
+    QFile file(resumeStorePath());
+    if (!file.open(QIODevice::ReadOnly)) return;
+    const QJsonArray items = QJsonDocument::fromJson(file.readAll()).object().value("items").toArray();
+    for (const QJsonValue &val : items) {
+        const QJsonObject obj = val.toObject();
+        ModelFileDownloadTask task;
+        task.info = modelUpdateInfoFromJson(obj.value("info").toObject());
+        task.filePath = task.info.filePath;
+        task.targetPath = obj.value("targetPath").toString();
+        task.tempPath = obj.value("tempPath").toString();
+        task.overwrite = obj.value("overwrite").toBool(false);
+        task.expectedSize = obj.value("expectedSize").toInteger(-1);
+        task.etag = obj.value("etag").toString();
+        task.lastModified = obj.value("lastModified").toString();
+        task.hashState = QByteArray::fromBase64(obj.value("hashState").toString().toLatin1());
+        if (task.filePath.isEmpty() || task.targetPath.isEmpty() || task.tempPath.isEmpty()) continue;
+        if (m_resumeTasks.contains(task.filePath)) continue;
+        m_resumeTasks.insert(task.filePath, task);
+        m_resumeOrder.append(task.filePath);
+        if (obj.value("interrupted").toBool(false)) m_interruptedDownloadPaths.append(task.filePath);
+    }
+}
+
+void DownloadManager::saveResumeStore() const
+{
+    // 立即写盘时顺带取消待执行的合并写入，内容已包含在这一次里
+    if (m_resumeSaveTimer) m_resumeSaveTimer->stop();
+    QJsonArray items;
+    for (const QString &filePath : m_resumeOrder) {
+        if (!m_resumeTasks.contains(filePath)) continue;
+        const ModelFileDownloadTask task = m_resumeTasks.value(filePath);
+        QJsonObject obj;
+        obj["info"] = modelUpdateInfoToJson(task.info);
+        obj["targetPath"] = task.targetPath;
+        obj["tempPath"] = task.tempPath;
+        obj["overwrite"] = task.overwrite;
+        obj["expectedSize"] = task.expectedSize;
+        obj["etag"] = task.etag;
+        obj["lastModified"] = task.lastModified;
+        obj["hashState"] = QString::fromLatin1(task.hashState.toBase64());
+        obj["interrupted"] = m_interruptedDownloadPaths.contains(filePath);
+        items.append(obj);
+    }
+
+    const QString storePath = resumeStorePath();
+    if (items.isEmpty()) {
+        QFile::remove(storePath);
+        return;
+    }
+    QDir().mkpath(QFileInfo(storePath).absolutePath());
+    QSaveFile file(storePath);
+    QJsonObject root;
+    root["version"] = 1;
+    root["items"] = items;
+    const QByteArray payload = QJsonDocument(root).toJson(QJsonDocument::Compact);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(payload) != payload.size()
+        || !file.commit()) {
+        qWarning() << "Unable to save download resume state:" << file.errorString();
+    }
+}
+
+bool DownloadManager::resumableTaskFor(const ModelUpdateInfo &info, ModelFileDownloadTask *task)
+{
+    if (!task || !m_resumeTasks.contains(info.filePath)) return false;
+    ModelFileDownloadTask saved = m_resumeTasks.value(info.filePath);
+    const bool sameVersion = saved.info.latestVersionId == info.latestVersionId
+                             && saved.info.sha256.compare(info.sha256, Qt::CaseInsensitive) == 0;
+    const bool targetTaken = !saved.overwrite && QFile::exists(saved.targetPath);
+    if (!sameVersion || targetTaken) {
+        QFile::remove(saved.tempPath);
+        forgetResumableTask(info.filePath);
+        return false;
+    }
+
+    // 沿用上次的目标路径和覆盖策略，续传不再弹出保存方式选择。
+    const QString savedUrl = saved.info.downloadUrl;
+    saved.info = info;
+    if (QUrlQuery(QUrl(savedUrl)).hasQueryItem("token")) saved.info.downloadUrl = savedUrl;
+    *task = saved;
+    return true;
+}
+
+void DownloadManager::rememberResumableTask(const ModelFileDownloadTask &task, bool interrupted)
+{
+    if (task.filePath.isEmpty()) return;
+    if (!m_resumeTasks.contains(task.filePath)) m_resumeOrder.append(task.filePath);
+    m_resumeTasks.insert(task.filePath, task);
+    if (interrupted) {
+        if (!m_interruptedDownloadPaths.contains(task.filePath)) m_interruptedDownloadPaths.append(task.filePath);
+    } else {
+        m_interruptedDownloadPaths.removeAll(task.filePath);
+    }
+    scheduleResumeStoreSave();
+}
+
+void DownloadManager::scheduleResumeStoreSave()
+{
+    if (m_shuttingDown) {
+        saveResumeStore();
+        return;
+    }
+    if (m_resumeSaveTimer && !m_resumeSaveTimer->isActive()) m_resumeSaveTimer->start();
+}
+
+void DownloadManager::forgetResumableTask(const QString &filePath)
+{
+    if (!m_resumeTasks.contains(filePath)) return;
+    m_resumeTasks.remove(filePath);
+    m_resumeOrder.removeAll(filePath);
+    m_interruptedDownloadPaths.removeAll(filePath);
+    saveResumeStore();
+}
+
 QString DownloadManager::uniqueFilePath(const QString &dirPath, const QString &fileName)
 {
     QDir dir(dirPath);
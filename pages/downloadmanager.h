@@ -17,8 +17,8 @@
 
 #include "downloadmodels.h"
 
+class DownloadFileSink;
 class DownloadsPage;
-class QFile;
 class QNetworkAccessManager;
 class QThreadPool;
 
@@ -83,6 +83,9 @@ public:
     void enqueueModelDownload(const ModelUpdateInfo &info);
     void ignoreSelectedUpdates();
     void retryFailedDownloads();
+    bool hasInterruptedDownloads() const { return !m_interruptedDownloadPaths.isEmpty(); }
+    void resumeInterruptedDownloads();
+    void setTransferLimits(int maxConcurrentDownloads, int segmentsPerFile, qint64 bandwidthLimitBytesPerSecond);
 
 signals:
     void statusMessageChanged(const QString &message);
@@ -93,16 +96,72 @@ private slots:
     void processPreviewLoadBatch();
     void onPreviewLoaded();
     void processNextModelDownload();
+    void onTransferTick();
+    void onSinkSpaceAvailable();
+    void onSinkHashCheckpoint(const QString &filePath, const QByteArray &hashState);
+    void onSinkWriteFailed(const QString &filePath, const QString &error);
+    void onSinkFileClosed(const QString &filePath, bool ok, const QString &error,
+                          const QString &sha256, const QByteArray &hashState);
 
 private:
+    // 一个 Range 分片对应一条连接；未分段的下载只有一个开放式分片。
+    struct DownloadSegment {
+        QPointer<QNetworkReply> reply;
+        qint64 start = 0;          // 本段在文件中的起点
+        qint64 end = -1;           // 含端点；-1 表示读到响应结束
+        qint64 written = 0;
+        bool headersChecked = false;
+        bool done = false;
+        bool cutoff = false;       // 开放式首段读满本段后被主动断开，不算失败
+    };
+
+    struct ActiveDownload {
+        ModelFileDownloadTask task;
+        QList<DownloadSegment> segments;
+        bool segmented = false;
+        bool hashValid = false;     // 写盘线程是否在做增量摘要
+        bool closing = false;       // 已请求写盘线程关闭文件，等待 fileClosed
+        bool writeFailed = false;
+        QString writeError;
+        bool restartRequested = false;
+        bool failed = false;
+        QString errorText;
+        int errorStatus = 0;
+        QElapsedTimer sampleTimer;
+        qint64 sessionBytes = 0;
+        qint64 sampledBytes = 0;
+        double bytesPerSecond = 0.0;
+    };
+
     static DownloadPreviewLoadResult processPreviewTask(const QString &filePath, const QString &previewPath);
     static QString uniqueFilePath(const QString &dirPath, const QString &fileName);
 
     QString chooseTargetPath(const ModelUpdateInfo &info, bool *overwrite) const;
-    bool writeActiveReplyData(QNetworkReply *reply);
-    void closeActiveFile();
+    void startModelDownload(ModelFileDownloadTask task);
+    void startSegmentRequest(ActiveDownload *download, int index);
+    bool handleSegmentHeaders(ActiveDownload *download, int index);
+    void splitIntoSegments(ActiveDownload *download);
+    bool drainSegment(ActiveDownload *download, int index, qint64 budget);
+    bool writeSegmentData(ActiveDownload *download, int index, const QByteArray &data);
+    void onSegmentFinished(ActiveDownload *download, int index, QNetworkReply *reply);
+    void abortOtherSegments(ActiveDownload *download, int keepIndex);
+    void completeActiveDownload(ActiveDownload *download);
+    void checkActiveDownloadComplete(const QString &filePath);
+    qint64 contiguousPrefix(const ActiveDownload *download) const;
+    qint64 completedBytes(const ActiveDownload *download) const;
+    void drainAllSegments();
+    void updateTransferProgress();
     void verifyAndFinishDownload(const ModelFileDownloadTask &task);
     void finishModelDownload(const ModelFileDownloadTask &task);
+    void requeueFromScratch(ModelFileDownloadTask task);
+
+    QString resumeStorePath() const;
+    void loadResumeStore();
+    void saveResumeStore() const;
+    void scheduleResumeStoreSave();
+    bool resumableTaskFor(const ModelUpdateInfo &info, ModelFileDownloadTask *task);
+    void rememberResumableTask(const ModelFileDownloadTask &task, bool interrupted);
+    void forgetResumableTask(const QString &filePath);
 
     DownloadsPage *m_page = nullptr;
     QNetworkAccessManager *m_network = nullptr;
@@ -131,13 +190,21 @@ private:
     QQueue<ModelFileDownloadTask> m_downloadQueue;
     QSet<QString> m_queuedDownloadPaths;
     QSet<QString> m_canceledPaths;
-    QPointer<QNetworkReply> m_activeReply;
-    ModelFileDownloadTask m_activeTask;
-    QFile *m_activeFile = nullptr;
-    bool m_activeWriteFailed = false;
-    QString m_activeWriteError;
-    bool m_downloading = false;
-    QElapsedTimer m_downloadTimer;
+    QHash<QString, ActiveDownload *> m_activeDownloads;
+    QHash<QString, ModelFileDownloadTask> m_verifyingTasks;
+    int m_maxConcurrentDownloads = 2;
+    int m_segmentsPerFile = 1;
+    qint64 m_bandwidthLimit = 0;       // 字节/秒，0 为不限速
+    qint64 m_bandwidthTokens = 0;
+    QTimer *m_transferTimer = nullptr;
+    QTimer *m_resumeSaveTimer = nullptr;
+    DownloadFileSink *m_fileSink = nullptr;
+    QElapsedTimer m_progressTimer;
+
+    // 可续传任务：按模型路径保存 .part 位置、ETag 和完整大小，持久化到 config/download_resume.json。
+    QHash<QString, ModelFileDownloadTask> m_resumeTasks;
+    QStringList m_resumeOrder;
+    QStringList m_interruptedDownloadPaths;
 };
 
 #endif // DOWNLOADMANAGER_H
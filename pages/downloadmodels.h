@@ -1,6 +1,7 @@
 #ifndef DOWNLOADMODELS_H
 #define DOWNLOADMODELS_H
 
+#include <QByteArray>
 #include <QJsonObject>
 #include <QImage>
 #include <QPointer>
@@ -71,6 +72,13 @@ struct ModelFileDownloadTask {
     QString tempPath;
     QString filePath;
     bool overwrite = false;
+    qint64 resumeOffset = 0;   // 本次请求开始时 .part 已有的字节数，>0 时以 Range 续传
+    qint64 expectedSize = -1;  // 服务端报告的完整文件大小，未知为 -1
+    QString etag;              // 续传时作为 If-Range 校验，避免把不同版本的数据拼在一起
+    QString lastModified;
+    QByteArray hashState;      // .part 已落盘前缀的 SHA-256 中间状态，续传时恢复
+    QString computedSha256;    // 下载过程中增量算出的完整摘要，为空时回退到整文件校验
+    bool singleConnection = false; // 分段下载被服务端拒绝后退回单连接
 };
 
 struct DownloadPreviewLoadResult {
@@ -58,6 +58,9 @@ SettingsState SettingsState::fromJson(const QJsonObject &root, const QString &de
     state.confirmCloseWhileLauncherRunning = root["confirm_close_launcher_running"].toBool(true);
     state.modelUpdateDownloadPolicy = root["model_update_download_policy"].toInt(0);
     state.autoCheckUpdatesOnStartup = root["auto_check_update_on_startup"].toBool(true);
+    state.downloadConcurrency = root["download_concurrency"].toInt(2);
+    state.downloadSegments = root["download_segments"].toInt(1);
+    state.downloadBandwidthLimitKB = root["download_bandwidth_limit_kb"].toInt(0);
     state.themeId = kThemeSettingsEnabled ? root["theme_id"].toString("steam_dark") : QStringLiteral("steam_dark");
     state.customThemePath = kThemeSettingsEnabled ? root["custom_theme_path"].toString() : QString();
     state.normalize();
@@ -98,6 +101,9 @@ void SettingsState::writeToJson(QJsonObject &root) const
     root["confirm_close_launcher_running"] = normalized.confirmCloseWhileLauncherRunning;
     root["model_update_download_policy"] = normalized.modelUpdateDownloadPolicy;
     root["auto_check_update_on_startup"] = normalized.autoCheckUpdatesOnStartup;
+    root["download_concurrency"] = normalized.downloadConcurrency;
+    root["download_segments"] = normalized.downloadSegments;
+    root["download_bandwidth_limit_kb"] = normalized.downloadBandwidthLimitKB;
     root["theme_id"] = normalized.themeId;
     root["custom_theme_path"] = normalized.customThemePath;
 }
@@ -108,6 +114,9 @@ void SettingsState::normalize()
     if (blurRadius > 100) blurRadius = 100;
     if (renderThreadCount < 1) renderThreadCount = 4;
     if (modelUpdateDownloadPolicy < 0 || modelUpdateDownloadPolicy > 2) modelUpdateDownloadPolicy = 0;
+    downloadConcurrency = qBound(1, downloadConcurrency, 8);
+    downloadSegments = qBound(1, downloadSegments, 8);
+    if (downloadBandwidthLimitKB < 0) downloadBandwidthLimitKB = 0;
     if (userGalleryMatchMode < 0 || userGalleryMatchMode > 2) userGalleryMatchMode = 0;
     if (collectionFolderTopLevel && collectionFolderSecondLevel) collectionFolderSecondLevel = false;
     if (!kThemeSettingsEnabled) {
@@ -230,6 +239,9 @@ SettingsPage::SettingsPage(QWidget *parent)
         emit testCivitaiApiKeyRequested(state().civitaiApiKey);
     });
     if (ui->comboModelUpdateDownloadPolicy) connect(ui->comboModelUpdateDownloadPolicy, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &SettingsPage::emitStateChanged);
+    if (ui->spinDownloadConcurrency) connect(ui->spinDownloadConcurrency, QOverload<int>::of(&QSpinBox::valueChanged), this, &SettingsPage::emitStateChanged);
+    if (ui->spinDownloadSegments) connect(ui->spinDownloadSegments, QOverload<int>::of(&QSpinBox::valueChanged), this, &SettingsPage::emitStateChanged);
+    if (ui->spinDownloadBandwidthLimit) connect(ui->spinDownloadBandwidthLimit, QOverload<int>::of(&QSpinBox::valueChanged), this, &SettingsPage::emitStateChanged);
     if (ui->comboUserGalleryMatchMode) connect(ui->comboUserGalleryMatchMode, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &SettingsPage::emitStateChanged);
     if (ui->chkComfyModelNameFallback) connect(ui->chkComfyModelNameFallback, &QCheckBox::toggled, this, &SettingsPage::emitStateChanged);
     if (ui->spinUiScale) connect(ui->spinUiScale, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &SettingsPage::emitStateChanged);
@@ -293,6 +305,9 @@ SettingsState SettingsPage::state() const
     s.civitaiApiKey = ui->editCivitaiApiKey ? ui->editCivitaiApiKey->text().trimmed() : QString();
     s.modelUpdateDownloadPolicy = ui->comboModelUpdateDownloadPolicy ? ui->comboModelUpdateDownloadPolicy->currentIndex() : 0;
     s.autoCheckUpdatesOnStartup = !ui->chkAutoCheckUpdatesOnStartup || ui->chkAutoCheckUpdatesOnStartup->isChecked();
+    s.downloadConcurrency = ui->spinDownloadConcurrency ? ui->spinDownloadConcurrency->value() : 2;
+    s.downloadSegments = ui->spinDownloadSegments ? ui->spinDownloadSegments->value() : 1;
+    s.downloadBandwidthLimitKB = ui->spinDownloadBandwidthLimit ? ui->spinDownloadBandwidthLimit->value() : 0;
     s.useCivitaiName = ui->chkUseCivitaiName && ui->chkUseCivitaiName->isChecked();
     s.suppressLocalWarnings = ui->chkSuppressLocalWarnings && ui->chkSuppressLocalWarnings->isChecked();
     s.userGalleryMatchMode = ui->comboUserGalleryMatchMode ? ui->comboUserGalleryMatchMode->currentIndex() : 0;
@@ -337,6 +352,9 @@ void SettingsPage::setState(const SettingsState &state)
     if (ui->editCivitaiApiKey) ui->editCivitaiApiKey->setText(state.civitaiApiKey);
     if (ui->comboModelUpdateDownloadPolicy) ui->comboModelUpdateDownloadPolicy->setCurrentIndex(qBound(0, state.modelUpdateDownloadPolicy, 2));
     if (ui->chkAutoCheckUpdatesOnStartup) ui->chkAutoCheckUpdatesOnStartup->setChecked(state.autoCheckUpdatesOnStartup);
+    if (ui->spinDownloadConcurrency) ui->spinDownloadConcurrency->setValue(state.downloadConcurrency);
+    if (ui->spinDownloadSegments) ui->spinDownloadSegments->setValue(state.downloadSegments);
+    if (ui->spinDownloadBandwidthLimit) ui->spinDownloadBandwidthLimit->setValue(state.downloadBandwidthLimitKB);
     if (ui->chkUseCivitaiName) ui->chkUseCivitaiName->setChecked(state.useCivitaiName);
     if (ui->chkSuppressLocalWarnings) ui->chkSuppressLocalWarnings->setChecked(state.suppressLocalWarnings);
     if (ui->comboUserGalleryMatchMode) ui->comboUserGalleryMatchMode->setCurrentIndex(qBound(0, state.userGalleryMatchMode, 2));
@@ -33,6 +33,9 @@ struct SettingsState {
     QString civitaiApiKey;
     int modelUpdateDownloadPolicy = 0;
     bool autoCheckUpdatesOnStartup = true;
+    int downloadConcurrency = 2;           // 同时下载的模型数
+    int downloadSegments = 1;              // 单文件分段连接数，1 为不分段
+    int downloadBandwidthLimitKB = 0;      // 全局下载限速 KB/s，0 为不限速
     bool useCivitaiName = false;
     bool suppressLocalWarnings = false;
     int userGalleryMatchMode = 0;
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""Minimal local stand-in for the Civitai endpoints used by metadata sync.
+
+Start it, then launch the app with
+    SD_LORA_MANAGER_CIVITAI_API=http://127.0.0.1:8765/api/v1
+and run "同步元信息" on a model folder. Every SHA256 resolves to a synthetic
+version; every N-th request answers 429 so the backoff path gets exercised.
+
+    python scripts/mock_civitai_api.py --port 8765 --rate-limit-every 50 --latency 0.2
+
+With --download-base the model endpoint also lists a newer version whose file
+is served by scripts/mock_range_server.py, so "检查更新" offers downloads that
+exercise the resumable download path (see that script for the modes).
+"""
+import argparse
+import hashlib
+import json
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+import mock_range_server
+
+STATS = {"requests": 0, "bulk": 0, "by_hash": 0, "models": 0, "versions": 0, "429": 0}
+LOCK = threading.Lock()
+ARGS = None
+
+
+def ids_for_hash(sha256):
+    # 同一个 Hash 总是映射到同一个版本；每 3 个版本共用一个模型，用来验证详情去重。
+    digest = int(hashlib.sha1(sha256.upper().encode()).hexdigest()[:8], 16)
+    version_id = 100000 + digest % 800000
+    return version_id // 3, version_id
+
+
+def version_json(sha256, model_id, version_id):
+    file_name = f"{version_id}.safetensors"
+    file_json = {"name": file_name, "hashes": {"SHA256": sha256.upper()}}
+    version = {
+        "id": version_id,
+        "modelId": model_id,
+        "name": f"v{version_id}",
+        "baseModel": "SDXL 1.0",
+        "trainedWords": ["mock_trigger"],
+        "files": [file_json],
+        "images": [],
+    }
+    if ARGS.download_base:
+        # 文件内容由下载模拟服务按文件名生成；本地文件对应的版本保留其真实哈希
+        size = ARGS.download_size_mb * 1024 * 1024
+        file_json["downloadUrl"] = f"{ARGS.download_base.rstrip('/')}/{file_name}?size={size}"
+        file_json["sizeKB"] = size / 1024
+        if not sha256:
+            file_json["hashes"]["SHA256"] = mock_range_server.content_sha256(file_name, size)
+        # 版本号越大越新，让同一模型下较早的版本能看到更新
+        version["publishedAt"] = time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime(1700000000 + version_id))
+    return version
+
+
+def model_json(model_id, versions):
+    return {"id": model_id, "name": f"Mock Model {model_id}", "type": "LORA",
+            "description": "mock", "tags": ["mock"], "modelVersions": versions}
+
+
+class Handler(BaseHTTPRequestHandler):
+    def log_message(self, fmt, *args):
+        pass
+
+    def reply(self, status, payload=None, headers=None):
+        body = json.dumps(payload or {}).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        for key, value in (headers or {}).items():
+            self.send_header(key, value)
+        self.end_headers()
+        self.wfile.write(body)
+
+    def throttled(self):
+        with LOCK:
+            STATS["requests"] += 1
+            count = STATS["requests"]
+        time.sleep(ARGS.latency)
+        if ARGS.rate_limit_every > 0 and count % ARGS.rate_limit_every == 0:
+            with LOCK:
+                STATS["429"] += 1
+            self.reply(429, {"error": "Too Many Requests"}, {"Retry-After": "2"})
+            return True
+        return False
+
+    def do_POST(self):
+        if self.throttled():
+            return
+        if not self.path.startswith("/api/v1/model-versions/by-hash"):
+            return self.reply(404)
+        length = int(self.headers.get("Content-Length", "0"))
+        hashes = json.loads(self.rfile.read(length) or b"[]")
+        with LOCK:
+            STATS["bulk"] += 1
+        versions = [version_json(h, *ids_for_hash(h)) for h in hashes if not h.upper().startswith("0")]
+        self.reply(200, versions)
+
+    def do_GET(self):
+        if self.throttled():
+            return
+        parts = self.path.split("?")[0].strip("/").split("/")
+        if parts[:3] == ["api", "v1", "model-versions"] and len(parts) == 5 and parts[3] == "by-hash":
+            with LOCK:
+                STATS["by_hash"] += 1
+            sha256 = parts[4]
+            if sha256.upper().startswith("0"):
+                return self.reply(404, {"error": "Model not found"})
+            return self.reply(200, version_json(sha256, *ids_for_hash(sha256)))
+        if parts[:3] == ["api", "v1", "model-versions"] and len(parts) == 4:
+            with LOCK:
+                STATS["versions"] += 1
+            version_id = int(parts[3])
+            return self.reply(200, version_json("", version_id // 3, version_id))
+        if parts[:3] == ["api", "v1", "models"] and len(parts) == 4:
+            with LOCK:
+                STATS["models"] += 1
+            model_id = int(parts[3])
+            versions = [version_json("", model_id, model_id * 3 + i) for i in range(3)]
+            return self.reply(200, model_json(model_id, versions))
+        self.reply(404)
+
+
+def main():
+    global ARGS
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=8765)
+    parser.add_argument("--latency", type=float, default=0.1, help="seconds added to every response")
+    parser.add_argument("--rate-limit-every", type=int, default=0, help="answer 429 to every N-th request (0 = never)")
+    parser.add_argument("--download-base", default="", help="file URL prefix of mock_range_server.py, e.g. http://127.0.0.1:8766/files")
+    parser.add_argument("--download-size-mb", type=int, default=256, help="size of the files offered for download")
+    ARGS = parser.parse_args()
+
+    server = ThreadingHTTPServer(("127.0.0.1", ARGS.port), Handler)
+    print(f"Mock Civitai API on http://127.0.0.1:{ARGS.port}/api/v1 (Ctrl+C to stop)")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print(json.dumps(STATS, indent=2))
+
+
+if __name__ == "__main__":
+    main()
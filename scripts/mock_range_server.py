@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""Local HTTP stand-in for model file downloads with Range support.
+
+Every GET /files/<name>?size=<bytes> answers with deterministic synthetic
+content for <name>, so a finished download can be checked by SHA-256 without
+storing anything on disk. Point the metadata mock at it and the update check
+offers these files as new versions:
+
+    python scripts/mock_range_server.py --port 8766 --mode drop --drop-after-mb 48
+    python scripts/mock_civitai_api.py --port 8765 --download-base http://127.0.0.1:8766/files --download-size-mb 256
+    SD_LORA_MANAGER_CIVITAI_API=http://127.0.0.1:8765/api/v1  (then launch the app)
+
+Modes:
+    range        honour Range / If-Range and answer 206 (default)
+    full         ignore Range and always answer 200 with the whole file
+    etag-change  the first resumed request sees a new ETag; the content stays
+                 the same, so the client must restart from byte 0 and still
+                 pass the SHA-256 check
+    drop         cut every connection after --drop-after-mb of body, so each
+                 retry has to resume from the partial file
+
+Segmented and throttled transfers (any mode):
+    --rate-kbps N            cap every connection at N KiB/s, so a single
+                             stream is slow and splitting into segments pays
+    --fail-segment-every N   cut every N-th bounded range (bytes=a-b) halfway,
+                             so one segment has to be retried on its own
+    --report                 print active connections and aggregate MB/s
+                             every second, to check the client's global cap
+
+    python scripts/mock_range_server.py --rate-kbps 2048 --fail-segment-every 5 --report
+    python scripts/mock_range_server.py --print-sha256 demo.safetensors --size-mb 256
+"""
+import argparse
+import hashlib
+import json
+import random
+import re
+import threading
+import time
+from functools import lru_cache
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, unquote, urlsplit
+
+STATS = {"requests": 0, "200": 0, "206": 0, "416": 0, "if_range_mismatch": 0,
+         "dropped": 0, "bytes": 0, "resumes": 0, "segments": 0, "segments_failed": 0,
+         "max_active": 0, "max_active_per_file": 0}
+LOCK = threading.Lock()
+ARGS = None
+ETAG_GENERATION = {}   # 文件名 → ETag 代数，etag-change 模式下首次续传时加一
+ACTIVE = {}            # 文件名 → 正在发送正文的连接数
+
+# 内容按素数长度的块循环：常见的 2 的幂偏移错位都会让摘要对不上。
+BLOCK_SIZE = 65521
+
+
+@lru_cache(maxsize=64)
+def content_block(name):
+    return random.Random(name).randbytes(BLOCK_SIZE)
+
+
+def content_slice(name, start, length):
+    block = content_block(name)
+    offset = start % BLOCK_SIZE
+    data = bytearray()
+    while len(data) < length:
+        data += block[offset:offset + length - len(data)]
+        offset = 0
+    return bytes(data)
+
+
+@lru_cache(maxsize=256)
+def content_sha256(name, size):
+    digest = hashlib.sha256()
+    step = BLOCK_SIZE * 16
+    for start in range(0, size, step):
+        digest.update(content_slice(name, start, min(step, size - start)))
+    return digest.hexdigest().upper()
+
+
+def current_etag(name):
+    with LOCK:
+        return f'"{name}-{ETAG_GENERATION.get(name, 0)}"'
+
+
+def parse_range(header, size):
+    # 只支持单段 bytes=a- / bytes=a-b；多段和后缀形式按不支持处理（回 200）。
+    match = re.fullmatch(r"bytes=(\d+)-(\d*)", header.strip())
+    if not match:
+        return None
+    start = int(match.group(1))
+    end = int(match.group(2)) if match.group(2) else size - 1
+    return start, min(end, size - 1)
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def count(self, key, amount=1):
+        with LOCK:
+            STATS[key] += amount
+
+    def do_HEAD(self):
+        self.handle_file(head_only=True)
+
+    def do_GET(self):
+        self.handle_file(head_only=False)
+
+    def handle_file(self, head_only):
+        self.count("requests")
+        url = urlsplit(self.path)
+        parts = url.path.strip("/").split("/", 1)
+        if len(parts) != 2 or parts[0] != "files" or not parts[1]:
+            self.send_error(404)
+            return
+        name = unquote(parts[1])
+        query = parse_qs(url.query)
+        size = int(query.get("size", [ARGS.size_mb * 1024 * 1024])[0])
+
+        range_header = self.headers.get("Range")
+        byte_range = parse_range(range_header, size) if range_header and ARGS.mode != "full" else None
+        if byte_range and byte_range[0] > 0:
+            self.count("resumes")
+            if ARGS.mode == "etag-change":
+                with LOCK:
+                    if name not in ETAG_GENERATION:
+                        ETAG_GENERATION[name] = 1
+        etag = current_etag(name)
+        if byte_range and self.headers.get("If-Range") and self.headers.get("If-Range") != etag:
+            # If-Range 不匹配：按规范返回完整的新文件
+            self.count("if_range_mismatch")
+            byte_range = None
+
+        if byte_range and byte_range[0] >= size:
+            self.count("416")
+            self.send_response(416)
+            self.send_header("Content-Range", f"bytes */{size}")
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+            return
+
+        start, end = byte_range if byte_range else (0, size - 1)
+        status = 206 if byte_range else 200
+        self.count(str(status))
+        fail_segment = False
+        if byte_range and re.fullmatch(r"bytes=\d+-\d+", range_header.strip()):
+            with LOCK:
+                STATS["segments"] += 1
+                fail_segment = ARGS.fail_segment_every > 0 and STATS["segments"] % ARGS.fail_segment_every == 0
+        self.send_response(status)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(end - start + 1))
+        self.send_header("Accept-Ranges", "none" if ARGS.mode == "full" else "bytes")
+        self.send_header("ETag", etag)
+        self.send_header("Last-Modified", "Mon, 01 Jan 2024 00:00:00 GMT")
+        self.send_header("Content-Disposition", f'attachment; filename="{name}"')
+        if status == 206:
+            self.send_header("Content-Range", f"bytes {start}-{end}/{size}")
+        self.end_headers()
+        if head_only:
+            return
+        with LOCK:
+            ACTIVE[name] = ACTIVE.get(name, 0) + 1
+            STATS["max_active"] = max(STATS["max_active"], sum(ACTIVE.values()))
+            STATS["max_active_per_file"] = max(STATS["max_active_per_file"], ACTIVE[name])
+        try:
+            self.send_body(name, start, end, fail_segment)
+        finally:
+            with LOCK:
+                ACTIVE[name] -= 1
+
+    def send_body(self, name, start, end, fail_segment):
+        limit = end - start + 1
+        if ARGS.mode == "drop":
+            limit = min(limit, int(ARGS.drop_after_mb * 1024 * 1024))
+        if fail_segment:
+            self.count("segments_failed")
+            limit = min(limit, (end - start + 1) // 2)
+        sent = 0
+        # 限速时缩小每次写入的块，速率更平滑
+        chunk = 64 * 1024 if ARGS.rate_kbps > 0 else 256 * 1024
+        started = time.monotonic()
+        try:
+            while sent < limit:
+                data = content_slice(name, start + sent, min(chunk, limit - sent))
+                self.wfile.write(data)
+                sent += len(data)
+                self.count("bytes", len(data))
+                if ARGS.rate_kbps > 0:
+                    ahead = sent / (ARGS.rate_kbps * 1024) - (time.monotonic() - started)
+                    if ahead > 0:
+                        time.sleep(ahead)
+        except (BrokenPipeError, ConnectionResetError):
+            return
+        if sent < end - start + 1:
+            # 模拟断网：不发剩余数据直接关闭连接
+            self.count("dropped")
+            self.close_connection = True
+            self.connection.shutdown(2)
+
+
+def report_loop():
+    last = STATS["bytes"]
+    while True:
+        time.sleep(1)
+        with LOCK:
+            total = STATS["bytes"]
+            active = sum(ACTIVE.values())
+        if active or total != last:
+            print(f"active {active:2d}  {(total - last) / 1048576:7.2f} MB/s  total {total / 1048576:9.1f} MB", flush=True)
+        last = total
+
+
+def main():
+    global ARGS
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=8766)
+    parser.add_argument("--mode", choices=["range", "full", "etag-change", "drop"], default="range")
+    parser.add_argument("--size-mb", type=int, default=256, help="file size when the URL has no ?size=")
+    parser.add_argument("--drop-after-mb", type=float, default=32, help="body bytes per connection in drop mode")
+    parser.add_argument("--rate-kbps", type=int, default=0, help="per-connection cap in KiB/s (0 = unlimited)")
+    parser.add_argument("--fail-segment-every", type=int, default=0, help="cut every N-th bounded range halfway (0 = never)")
+    parser.add_argument("--report", action="store_true", help="print throughput once per second")
+    parser.add_argument("--print-sha256", metavar="NAME", help="print the SHA-256 served for NAME and exit")
+    ARGS = parser.parse_args()
+
+    if ARGS.print_sha256:
+        print(content_sha256(ARGS.print_sha256, ARGS.size_mb * 1024 * 1024))
+        return
+
+    server = ThreadingHTTPServer(("127.0.0.1", ARGS.port), Handler)
+    print(f"Mock download server on http://127.0.0.1:{ARGS.port}/files ({ARGS.mode}, Ctrl+C to stop)")
+    if ARGS.report:
+        threading.Thread(target=report_loop, daemon=True).start()
+    started = time.monotonic()
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    STATS["seconds"] = round(time.monotonic() - started, 1)
+    print(json.dumps(STATS, indent=2))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,352 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""Load test for the image sync server with simulated clients.
+
+Generates an image tree, then connects N clients that AUTH and send an empty
+CLIENT_MANIFEST, so the server backfills every file to all of them at once.
+While that runs, new files are dropped into the tree at a fixed interval and
+each client records how long it took to receive them. Prints MB/s per client
+and in total, latency percentiles for new files, and the peak RSS of the server.
+
+1. Generate the tree:
+    python scripts/sync_load_test.py generate --tree D:/sync_bench --files 2000 --size-kb 800
+2. Run against the headless server (the SD_Sync_Server build target). The script
+   writes its settings file, starts it with a fresh index and stops it afterwards:
+    python scripts/sync_load_test.py run --tree D:/sync_bench --server build/SD_Sync_Server --clients 4
+
+Without --server the clients connect to a server that is already running, e.g.
+the GUI app with the tree added as a sync folder and the whitelist off:
+    python scripts/sync_load_test.py run --tree D:/sync_bench --key <AES key> --pid <app PID>
+
+Requires the "cryptography" package. Files are random bytes with image
+extensions: enough for the sync path, not for the preview tier.
+"""
+import argparse
+import json
+import os
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import uuid
+import zlib
+
+try:
+    from cryptography.hazmat.primitives.ciphers.aead import AESGCM
+except ImportError:
+    sys.exit("Missing dependency: pip install cryptography")
+
+LOCK = threading.Lock()
+# 新文件的相对路径 → 写入完成的时刻
+CREATED = {}
+
+
+def derive_key(text):
+    # 与服务端一致：UTF-8 后补零或截断到 32 字节。
+    return text.encode("utf-8")[:32].ljust(32, b"\0")
+
+
+def seal(aes, metadata, data=b""):
+    body = json.dumps(metadata, separators=(",", ":")).encode()
+    plain = struct.pack(">II", 4 + len(body) + len(data), len(body)) + body + data
+    iv = os.urandom(12)
+    sealed = aes.encrypt(iv, plain, None)
+    cipher, tag = sealed[:-16], sealed[-16:]
+    return struct.pack(">I", len(cipher) + 28) + iv + tag + cipher
+
+
+def recv_exact(sock, size):
+    chunks = []
+    while size > 0:
+        chunk = sock.recv(min(size, 1 << 20))
+        if not chunk:
+            raise ConnectionError("server closed the connection")
+        chunks.append(chunk)
+        size -= len(chunk)
+    return b"".join(chunks)
+
+
+def open_packet(aes, sock):
+    (length,) = struct.unpack(">I", recv_exact(sock, 4))
+    frame = recv_exact(sock, length)
+    iv, tag, cipher = frame[:12], frame[12:28], frame[28:]
+    plain = aes.decrypt(iv, cipher + tag, None)
+    _, json_len = struct.unpack(">II", plain[:8])
+    body = plain[8:]
+    if json_len & 0x80000000:
+        # deflate_v1：qCompress 格式，4 字节原始长度 + zlib 流
+        json_len &= 0x7FFFFFFF
+        body = zlib.decompress(body[4:])
+    return json.loads(body[:json_len]), len(frame) + 4, len(body) - json_len
+
+
+class Client(threading.Thread):
+    def __init__(self, index, args):
+        super().__init__(daemon=True)
+        self.index = index
+        self.args = args
+        self.wire_bytes = 0
+        self.file_bytes = 0
+        self.files = 0
+        self.first_packet = None
+        self.last_packet = None
+        self.latencies = []
+        self.error = None
+        self.stop = threading.Event()
+
+    def run(self):
+        try:
+            self.session()
+        except Exception as exc:  # 记录后由主线程统一报告
+            self.error = f"{type(exc).__name__}: {exc}"
+
+    def session(self):
+        aes = AESGCM(derive_key(self.args.key))
+        sock = socket.create_connection((self.args.host, self.args.port), timeout=self.args.idle)
+        caps = ["deflate_v1"] if self.args.legacy else ["chunked_v1", "deflate_v1"]
+        sock.sendall(seal(aes, {"cmd": "AUTH", "deviceId": f"loadtest-{self.index}",
+                                "deviceName": f"LoadTest {self.index}", "caps": caps}))
+        meta, _, _ = open_packet(aes, sock)
+        if meta.get("cmd") != "FOLDER_LIST":
+            raise RuntimeError(f"unexpected first packet {meta.get('cmd')}")
+        # 空 Manifest：服务端把索引里的所有文件补发过来。
+        sock.sendall(seal(aes, {"cmd": "CLIENT_MANIFEST", "files": {}}))
+
+        streams = {}
+        while not self.stop.is_set():
+            try:
+                meta, wire, data = open_packet(aes, sock)
+            except socket.timeout:
+                break
+            now = time.perf_counter()
+            self.first_packet = self.first_packet or now
+            self.last_packet = now
+            self.wire_bytes += wire
+            self.file_bytes += data
+            cmd = meta.get("cmd")
+            if cmd == "SYNC_BEGIN":
+                streams[meta["id"]] = meta["path"]
+            elif cmd in ("SYNC_END", "SYNC_ABORT"):
+                path = streams.pop(meta["id"], None)
+                if cmd == "SYNC_END":
+                    self.finish(path, now)
+            elif cmd == "SYNC":
+                self.finish(meta.get("path"), now)
+        sock.close()
+
+    def finish(self, path, now):
+        self.files += 1
+        with LOCK:
+            created = CREATED.get(path)
+        if created is not None:
+            self.latencies.append(now - created)
+
+
+def generate(args):
+    os.makedirs(args.tree, exist_ok=True)
+    per_dir = max(1, args.files_per_dir)
+    for i in range(args.files):
+        folder = os.path.join(args.tree, f"batch_{i // per_dir:04d}")
+        os.makedirs(folder, exist_ok=True)
+        with open(os.path.join(folder, f"img_{i:06d}.png"), "wb") as fh:
+            fh.write(os.urandom(args.size_kb * 1024))
+    print(f"Generated {args.files} files of {args.size_kb} KB in {args.tree}")
+
+
+def peak_rss_mb(pid):
+    # Linux 读 VmHWM；其他平台有 psutil 时取当前 RSS 采样的最大值。
+    try:
+        with open(f"/proc/{pid}/status") as fh:
+            for line in fh:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1]) / 1024
+    except OSError:
+        pass
+    try:
+        import psutil
+        return psutil.Process(pid).memory_info().rss / (1024 * 1024)
+    except Exception:
+        return None
+
+
+def percentile(values, fraction):
+    if not values:
+        return None
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def write_live_files(args, stop):
+    # 写在树根下的单独目录里，相对路径与服务端一致：根目录名/live/xxx.png
+    root_name = os.path.basename(os.path.normpath(args.tree))
+    folder = os.path.join(args.tree, "live")
+    os.makedirs(folder, exist_ok=True)
+    written = 0
+    while written < args.live_files and not stop.wait(args.live_interval):
+        name = f"live_{uuid.uuid4().hex[:12]}.png"
+        with open(os.path.join(folder, name), "wb") as fh:
+            fh.write(os.urandom(args.size_kb * 1024))
+        with LOCK:
+            CREATED[f"{root_name}/live/{name}"] = time.perf_counter()
+        written += 1
+    return written
+
+
+class HeadlessServer:
+    """Starts SD_Sync_Server on a temporary settings file and state directory, stops it on exit."""
+
+    def __init__(self, args):
+        self.args = args
+        self.workdir = tempfile.TemporaryDirectory(prefix="sync_load_test_")
+        self.listening = threading.Event()
+        self.log = []
+        self.process = None
+
+    def __enter__(self):
+        settings = {"port": self.args.port, "aesKey": self.args.key,
+                    "roots": [os.path.abspath(self.args.tree)], "whitelistEnabled": False}
+        settings_path = os.path.join(self.workdir.name, "settings.json")
+        with open(settings_path, "w", encoding="utf-8") as fh:
+            json.dump(settings, fh)
+        # 每次使用新的状态目录：索引为空，客户端拿到完整补发
+        self.process = subprocess.Popen(
+            [self.args.server, settings_path, "--state-dir", os.path.join(self.workdir.name, "state")],
+            stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+        threading.Thread(target=self.read_output, daemon=True).start()
+        deadline = time.monotonic() + self.args.startup_timeout
+        while not self.listening.wait(0.2):
+            if self.process.poll() is not None or time.monotonic() > deadline:
+                tail = "\n".join(self.log[-20:])
+                self.stop()
+                sys.exit(f"Sync server did not start listening on port {self.args.port}.\n{tail}")
+        return self
+
+    def __exit__(self, *exc):
+        self.stop()
+
+    def read_output(self):
+        # 持续读取输出，否则管道写满后服务端会阻塞在日志上
+        for raw in self.process.stdout:
+            line = raw.decode("utf-8", "replace").rstrip()
+            self.log.append(line)
+            if self.args.server_log:
+                print(f"[server] {line}", file=sys.stderr, flush=True)
+            if line.split("] ", 1)[-1] == f"LISTENING {self.args.port}":
+                self.listening.set()
+
+    def stop(self):
+        if self.process and self.process.poll() is None:
+            # 关闭标准输入即正常退出（保存索引后结束）
+            self.process.stdin.close()
+            try:
+                self.process.wait(15)
+            except subprocess.TimeoutExpired:
+                self.process.kill()
+                self.process.wait()
+        self.workdir.cleanup()
+
+
+def run(args):
+    if args.server:
+        args.key = args.key or uuid.uuid4().hex
+        with HeadlessServer(args) as server:
+            args.pid = args.pid or server.process.pid
+            run_clients(args)
+    elif not args.key:
+        sys.exit("--key is required when connecting to an already running server")
+    else:
+        run_clients(args)
+
+
+def run_clients(args):
+    clients = [Client(i, args) for i in range(args.clients)]
+    started = time.perf_counter()
+    for client in clients:
+        client.start()
+
+    peak = [None]
+    stop = threading.Event()
+
+    def sample_rss():
+        while not stop.wait(0.5):
+            value = peak_rss_mb(args.pid)
+            if value is not None:
+                peak[0] = max(peak[0] or 0, value)
+
+    if args.pid:
+        threading.Thread(target=sample_rss, daemon=True).start()
+    writer = threading.Thread(target=write_live_files, args=(args, stop), daemon=True)
+    writer.start()
+
+    # 每个客户端在 --idle 秒内收不到数据即视为结束。
+    for client in clients:
+        client.join(args.timeout)
+    stop.set()
+    for client in clients:
+        client.stop.set()
+    elapsed = time.perf_counter() - started
+
+    report = {"clients": [], "elapsed_s": round(elapsed, 2)}
+    total_bytes = 0
+    latencies = []
+    for client in clients:
+        active = (client.last_packet - client.first_packet) if client.first_packet and client.last_packet else 0
+        total_bytes += client.wire_bytes
+        latencies += client.latencies
+        report["clients"].append({
+            "client": client.index,
+            "files": client.files,
+            "wire_mb": round(client.wire_bytes / 1e6, 2),
+            "mb_per_s": round(client.wire_bytes / 1e6 / active, 2) if active > 0 else None,
+            "new_files_seen": len(client.latencies),
+            "error": client.error,
+        })
+    report["total_mb_per_s"] = round(total_bytes / 1e6 / elapsed, 2) if elapsed > 0 else None
+    report["new_file_latency_s"] = {
+        "count": len(latencies),
+        "p50": percentile(latencies, 0.5),
+        "p95": percentile(latencies, 0.95),
+        "max": max(latencies) if latencies else None,
+    }
+    if args.pid:
+        report["server_peak_rss_mb"] = round(peak[0], 1) if peak[0] is not None else None
+    print(json.dumps(report, indent=2, ensure_ascii=False))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    gen = sub.add_parser("generate", help="create a synthetic image tree")
+    gen.add_argument("--tree", required=True)
+    gen.add_argument("--files", type=int, default=1000)
+    gen.add_argument("--files-per-dir", type=int, default=200)
+    gen.add_argument("--size-kb", type=int, default=800)
+
+    bench = sub.add_parser("run", help="connect simulated clients to the sync server")
+    bench.add_argument("--tree", required=True, help="the synced folder")
+    bench.add_argument("--server", help="path to SD_Sync_Server; started and stopped by this script")
+    bench.add_argument("--server-log", action="store_true", help="echo the server log to stderr")
+    bench.add_argument("--startup-timeout", type=float, default=120.0,
+                       help="seconds to wait for the server to index the tree and listen")
+    bench.add_argument("--key", help="AES key (random with --server, required otherwise)")
+    bench.add_argument("--host", default="127.0.0.1")
+    bench.add_argument("--port", type=int, default=12345)
+    bench.add_argument("--clients", type=int, default=4)
+    bench.add_argument("--legacy", action="store_true", help="do not announce chunked_v1 (whole-file SYNC packets)")
+    bench.add_argument("--live-files", type=int, default=20, help="new files created during the run")
+    bench.add_argument("--live-interval", type=float, default=1.0, help="seconds between new files")
+    bench.add_argument("--size-kb", type=int, default=800, help="size of each new file")
+    bench.add_argument("--idle", type=float, default=10.0, help="a client stops after this many idle seconds")
+    bench.add_argument("--timeout", type=float, default=3600.0, help="hard limit per client")
+    bench.add_argument("--pid", type=int, default=0, help="server process id for peak RSS (automatic with --server)")
+
+    args = parser.parse_args()
+    generate(args) if args.command == "generate" else run(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -4,6 +4,15 @@
 The Qt application calls this script as a subprocess and reads one JSON object
 from stdout. Keep stderr for diagnostics only so the C++ side can parse stdout
 reliably.
+
+With --serve the script stays alive and keeps the ONNX session warm between
+requests; it exits when stdin closes. Every frame is one JSON header line,
+optionally followed by raw bytes whose length the header gives:
+  {"id", "cmd": "describe", "model_dir"} -> {"id", "ok", "width", "height", "nchw"}
+  {"id", "cmd": "infer", "model_dir", "tensor_bytes": N} + N bytes of float32
+      -> {"id", "ok", "elapsed_sec", "scores_bytes": M} + M bytes of float32
+The caller preprocesses the image and applies the threshold itself. The older
+{"id", "image", "model_dir", "threshold"} request still returns one JSON line.
 """
 
 from __future__ import annotations
@@ -15,6 +24,8 @@ import math
 import os
 import sys
 import time
+from collections import deque
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
 
 
@@ -73,6 +84,34 @@ def resolve_hw(shape: list) -> tuple[int, int, bool]:
     return dims[2] or 448, dims[1] or 448, False
 
 
+def fit_size(width: int, height: int, max_width: int, max_height: int):
+    # Same integer rule as wd14FitSize in the Qt app: shrink only, keep the aspect ratio, round half up.
+    if width <= max_width and height <= max_height:
+        return width, height
+    if width * max_height >= height * max_width:
+        return max_width, max(1, (height * max_width * 2 + width) // (2 * width))
+    return max(1, (width * max_height * 2 + height) // (2 * height)), max_height
+
+
+def area_resize_axis(values, size: int, axis: int):
+    # Area-average downscale along one axis, step for step the same as areaResampleLine in the Qt app
+    # (float64 prefix sums, same operation order), so single-image and batch tagging see identical inputs.
+    import numpy as np
+
+    n = values.shape[axis]
+    values = np.moveaxis(values, axis, 0)
+    prefix = np.zeros((n + 1,) + values.shape[1:], dtype=np.float64)
+    np.cumsum(values, axis=0, out=prefix[1:])
+    x = np.arange(size + 1, dtype=np.float64) * n / size
+    k = np.floor(x).astype(np.int64)
+    inside = k < n
+    k_in = np.minimum(k, n - 1)
+    frac = (x - k).reshape((-1,) + (1,) * (values.ndim - 1))
+    integral = np.where(inside.reshape(frac.shape), prefix[np.minimum(k, n)] + frac * values[k_in], prefix[n])
+    scale = n / size
+    return np.moveaxis((integral[1:] - integral[:-1]) / scale, 0, axis)
+
+
 def preprocess(image_path: Path, width: int, height: int, nchw: bool):
     try:
         import numpy as np
@@ -86,13 +125,17 @@ def preprocess(image_path: Path, width: int, height: int, nchw: bool):
     except Exception as exc:
         raise RuntimeError(f"Failed to read image: {exc}")
 
-    image.thumbnail((width, height), Image.Resampling.LANCZOS)
-    canvas = Image.new("RGB", (width, height), (255, 255, 255))
-    left = (width - image.width) // 2
-    top = (height - image.height) // 2
-    canvas.paste(image, (left, top))
-
-    array = np.asarray(canvas, dtype=np.float32)
+    pixels = np.asarray(image, dtype=np.float64)
+    fitted_width, fitted_height = fit_size(image.width, image.height, width, height)
+    if fitted_width != image.width:
+        pixels = area_resize_axis(pixels, fitted_width, 1)
+    if fitted_height != image.height:
+        pixels = area_resize_axis(pixels, fitted_height, 0)
+
+    array = np.full((height, width, 3), 255.0, dtype=np.float32)
+    left = (width - fitted_width) // 2
+    top = (height - fitted_height) // 2
+    array[top:top + fitted_height, left:left + fitted_width] = pixels.astype(np.float32)
     array = array[:, :, ::-1]  # RGB -> BGR, matching common WD14 ONNX exports.
     if nchw:
         array = array.transpose(2, 0, 1)
@@ -131,14 +174,15 @@ def create_runtime(model_dir: Path):
     return session, input_info, output_info, width, height, nchw, labels
 
 
-def infer_image(image_path: Path, threshold: float, runtime) -> dict:
-    session, input_info, output_info, width, height, nchw, labels = runtime
-    started = time.perf_counter()
-    if not image_path.exists():
-        raise RuntimeError(f"Image not found: {image_path}")
-    input_tensor = preprocess(image_path, width, height, nchw)
-    scores = session.run([output_info.name], {input_info.name: input_tensor})[0]
-    flat_scores = scores.reshape(-1).tolist()
+def max_batch_size(runtime) -> int:
+    """Exports with a fixed batch dimension only accept that many images per run."""
+    shape = list(runtime[1].shape)
+    if shape and isinstance(shape[0], int) and shape[0] > 0:
+        return shape[0]
+    return 0
+
+
+def scores_to_result(flat_scores: list, labels: list[dict], threshold: float, elapsed: float) -> dict:
     usable_count = min(len(flat_scores), len(labels))
     ratings: list[dict] = []
     tags: list[dict] = []
@@ -162,13 +206,69 @@ def infer_image(image_path: Path, threshold: float, runtime) -> dict:
     return {
         "ok": True,
         "error": "",
-        "elapsed_sec": round(time.perf_counter() - started, 4),
+        "elapsed_sec": round(elapsed, 4),
         "ratings": ratings,
         "tags": tags,
     }
 
 
-def run_batch(manifest_path: Path, model_dir: Path, threshold: float) -> None:
+def infer_image(image_path: Path, threshold: float, runtime) -> dict:
+    session, input_info, output_info, width, height, nchw, labels = runtime
+    started = time.perf_counter()
+    if not image_path.exists():
+        raise RuntimeError(f"Image not found: {image_path}")
+    input_tensor = preprocess(image_path, width, height, nchw)
+    scores = session.run([output_info.name], {input_info.name: input_tensor})[0]
+    return scores_to_result(scores.reshape(-1).tolist(), labels, threshold, time.perf_counter() - started)
+
+
+def failed_item(image_path: Path, error: str) -> dict:
+    return {
+        "event": "item",
+        "ok": False,
+        "image": str(image_path),
+        "error": error,
+        "elapsed_sec": 0.0,
+        "ratings": [],
+        "tags": [],
+    }
+
+
+def timed_preprocess(image_path: Path, width: int, height: int, nchw: bool):
+    started = time.perf_counter()
+    if not image_path.exists():
+        raise RuntimeError(f"Image not found: {image_path}")
+    return preprocess(image_path, width, height, nchw), time.perf_counter() - started
+
+
+def run_inference_batch(batch: list, threshold: float, runtime) -> list[dict]:
+    """batch: [(path, tensor, preprocess_sec)]; one session.run for the whole batch."""
+    import numpy as np
+
+    session, input_info, output_info, _, _, _, labels = runtime
+    started = time.perf_counter()
+    try:
+        scores = session.run([output_info.name], {input_info.name: np.concatenate([t for _, t, _ in batch], axis=0)})[0]
+        shared = (time.perf_counter() - started) / len(batch)
+        rows = [(path, scores[i].reshape(-1).tolist(), prep + shared) for i, (path, _, prep) in enumerate(batch)]
+    except Exception:
+        if len(batch) == 1:
+            raise
+        # 模型不接受这个批大小时逐张重试，结果不受影响
+        rows = []
+        for path, tensor, prep in batch:
+            single_started = time.perf_counter()
+            single = session.run([output_info.name], {input_info.name: tensor})[0]
+            rows.append((path, single.reshape(-1).tolist(), prep + time.perf_counter() - single_started))
+    results = []
+    for path, flat_scores, elapsed in rows:
+        result = scores_to_result(flat_scores, labels, threshold, elapsed)
+        result.update({"event": "item", "image": str(path)})
+        results.append(result)
+    return results
+
+
+def run_batch(manifest_path: Path, model_dir: Path, threshold: float, batch_size: int, workers: int) -> None:
     try:
         paths = [Path(line.rstrip("\r\n")) for line in manifest_path.read_text(encoding="utf-8-sig").splitlines() if line.strip()]
     except Exception as exc:
@@ -178,27 +278,125 @@ def run_batch(manifest_path: Path, model_dir: Path, threshold: float) -> None:
     except Exception as exc:
         emit({"event": "fatal", "ok": False, "error": str(exc)}, 1)
 
-    emit_line({"event": "started", "ok": True, "total": len(paths)})
+    fixed = max_batch_size(runtime)
+    batch_size = max(1, min(batch_size, fixed) if fixed else batch_size)
+    workers = max(1, workers)
+    _, _, _, width, height, nchw, _ = runtime
+
+    emit_line({"event": "started", "ok": True, "total": len(paths), "batch_size": batch_size})
     succeeded = 0
     failed = 0
-    for image_path in paths:
+    # 解码和缩放在线程池里进行（Pillow 与 numpy 在这些操作中释放 GIL），
+    # 主线程按清单顺序取结果凑批推理；预取窗口限制了同时驻留的张量数量。
+    window = max(batch_size * 2, workers * 2)
+    with ThreadPoolExecutor(max_workers=workers) as pool:
+        pending: deque = deque()
+        remaining = iter(paths)
+
+        def refill() -> None:
+            while len(pending) < window:
+                image_path = next(remaining, None)
+                if image_path is None:
+                    return
+                pending.append((image_path, pool.submit(timed_preprocess, image_path, width, height, nchw)))
+
+        refill()
+        while pending:
+            batch = []
+            while pending and len(batch) < batch_size:
+                image_path, future = pending.popleft()
+                try:
+                    tensor, prep = future.result()
+                    batch.append((image_path, tensor, prep))
+                except Exception as exc:
+                    emit_line(failed_item(image_path, str(exc)))
+                    failed += 1
+                refill()
+            if not batch:
+                continue
+            try:
+                results = run_inference_batch(batch, threshold, runtime)
+            except Exception as exc:
+                results = [failed_item(image_path, str(exc)) for image_path, _, _ in batch]
+            for result in results:
+                if result["ok"]:
+                    succeeded += 1
+                else:
+                    failed += 1
+                emit_line(result)
+    emit({"event": "done", "ok": True, "total": len(paths), "succeeded": succeeded, "failed": failed})
+
+
+def write_frame(header: dict, payload: bytes = b"") -> None:
+    sys.stdout.buffer.write(json.dumps(header, ensure_ascii=False, allow_nan=False).encode("utf-8") + b"\n")
+    if payload:
+        sys.stdout.buffer.write(payload)
+    sys.stdout.buffer.flush()
+
+
+def read_exact(stream, size: int) -> bytes:
+    data = stream.read(size)
+    if data is None or len(data) != size:
+        raise EOFError("stdin closed while reading tensor")
+    return data
+
+
+def infer_tensor(tensor_bytes: bytes, runtime) -> tuple[bytes, float]:
+    import numpy as np
+
+    session, input_info, output_info, width, height, nchw, _labels = runtime
+    shape = (1, 3, height, width) if nchw else (1, height, width, 3)
+    expected = 4 * math.prod(shape)
+    if len(tensor_bytes) != expected:
+        raise RuntimeError(f"tensor size mismatch: got {len(tensor_bytes)} bytes, expected {expected}")
+    array = np.frombuffer(tensor_bytes, dtype=np.float32).reshape(shape)
+    started = time.perf_counter()
+    scores = session.run([output_info.name], {input_info.name: array})[0]
+    elapsed = time.perf_counter() - started
+    return np.asarray(scores, dtype="<f4").reshape(-1).tobytes(), elapsed
+
+
+def serve() -> None:
+    # 帧头是 UTF-8 JSON，张量和分数是原始字节，所以直接读写二进制流。
+    stdin = sys.stdin.buffer
+    runtime = None
+    runtime_dir = None
+    write_frame({"event": "ready", "ok": True})
+    while True:
+        line = stdin.readline()
+        if not line:
+            return
+        if not line.strip():
+            continue
+        request_id = None
         try:
-            result = infer_image(image_path, threshold, runtime)
-            result.update({"event": "item", "image": str(image_path)})
-            succeeded += 1
+            request = json.loads(line.decode("utf-8"))
+            request_id = request.get("id")
+            # 先读完随帧的张量，出错时也不会把剩余字节当成下一行。
+            tensor_bytes = read_exact(stdin, int(request["tensor_bytes"])) if "tensor_bytes" in request else b""
+            model_dir = Path(request["model_dir"])
+            if runtime is None or runtime_dir != model_dir:
+                # 切换模型时先释放旧的 session，避免两份模型同时占用显存。
+                runtime = None
+                runtime = create_runtime(model_dir)
+                runtime_dir = model_dir
+            cmd = request.get("cmd")
+            if cmd == "describe":
+                _session, _input, _output, width, height, nchw, _labels = runtime
+                write_frame({"id": request_id, "ok": True, "width": width, "height": height, "nchw": nchw})
+            elif cmd == "infer":
+                scores, elapsed = infer_tensor(tensor_bytes, runtime)
+                write_frame({"id": request_id, "ok": True, "elapsed_sec": round(elapsed, 3),
+                             "scores_bytes": len(scores)}, scores)
+            else:
+                result = infer_image(Path(request["image"]), float(request.get("threshold", 0.35)), runtime)
+                result["id"] = request_id
+                write_frame(result)
+        except EOFError:
+            return
         except Exception as exc:
-            result = {
-                "event": "item",
-                "ok": False,
-                "image": str(image_path),
-                "error": str(exc),
-                "elapsed_sec": 0.0,
-                "ratings": [],
-                "tags": [],
-            }
-            failed += 1
-        emit_line(result)
-    emit({"event": "done", "ok": True, "total": len(paths), "succeeded": succeeded, "failed": failed})
+            write_frame({"id": request_id, "ok": False, "error": f"WD14 inference failed: {exc}",
+                         "elapsed_sec": 0.0, "ratings": [], "tags": []})
 
 
 def main() -> None:
@@ -206,12 +404,21 @@ def main() -> None:
     source = parser.add_mutually_exclusive_group(required=True)
     source.add_argument("--image")
     source.add_argument("--manifest")
-    parser.add_argument("--model-dir", required=True)
+    source.add_argument("--serve", action="store_true")
+    parser.add_argument("--model-dir")
     parser.add_argument("--threshold", type=float, default=0.35)
+    parser.add_argument("--batch-size", type=int, default=8, help="images per session.run in --manifest mode")
+    parser.add_argument("--workers", type=int, default=max(1, (os.cpu_count() or 2) - 1),
+                        help="preprocessing threads in --manifest mode")
     args = parser.parse_args()
+    if args.serve:
+        serve()
+        return
+    if not args.model_dir:
+        parser.error("--model-dir is required")
     model_dir = Path(args.model_dir)
     if args.manifest:
-        run_batch(Path(args.manifest), model_dir, args.threshold)
+        run_batch(Path(args.manifest), model_dir, args.threshold, args.batch_size, args.workers)
         return
     try:
         runtime = create_runtime(model_dir)
@@ -1,6 +1,7 @@
 #include "llmpromptwidget.h"
 #include "ui_llmpromptwidget.h"
 #include "styleconstants.h"
+#include "gallerycorpus.h"
 #include "tagutils.h"
 
 #include <QAbstractItemView>
@@ -2001,26 +2002,6 @@ QStringList LlmPromptWidget::readInstalledModelsSync(bool *ok, QString *errorTex
     return result;
 }
 
-QList<LlmPromptWidget::GalleryCacheItem> LlmPromptWidget::loadGalleryCache() const
-{
-    QList<GalleryCacheItem> items;
-    QFile file(qApp->applicationDirPath() + "/config/user_gallery_cache.json");
-    if (!file.open(QIODevice::ReadOnly)) return items;
-
-    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-    QJsonObject root = doc.object();
-    for (auto it = root.begin(); it != root.end(); ++it) {
-        GalleryCacheItem item;
-        item.path = it.key();
-        QJsonObject obj = it.value().toObject();
-        item.prompt = obj["p"].toString();
-        item.negativePrompt = obj["np"].toString();
-        item.parameters = obj["param"].toString();
-        items.append(item);
-    }
-    return items;
-}
-
 QStringList LlmPromptWidget::collectLocalLoraFiles() const
 {
     QStringList files;
@@ -2215,20 +2196,6 @@ QStringList LlmPromptWidget::parsePromptToTags(const QString &prompt) const
     return result;
 }
 
-QStringList LlmPromptWidget::extractLorasFromPrompt(const QString &prompt) const
-{
-    QStringList result;
-    QRegularExpression re("<lora:([^:>]+)");
-    auto it = re.globalMatch(prompt);
-    while (it.hasNext()) {
-        QString name = it.next().captured(1).trimmed();
-        if (!name.isEmpty() && !result.contains(name)) {
-            result.append(name);
-        }
-    }
-    return result;
-}
-
 QStringList LlmPromptWidget::splitPromptTokens(const QString &prompt) const
 {
     QString normalized = prompt;
@@ -2486,8 +2453,9 @@ QString LlmPromptWidget::renderPromptTemplate(const QHash<QString, QString> &val
 
 QString LlmPromptWidget::preferenceSummary() const
 {
-    QList<GalleryCacheItem> items = loadGalleryCache();
-    if (items.isEmpty()) {
+    // 主窗口发布的图库快照，与 imageCache 共享数据，不再重新读取缓存文件
+    const GalleryCorpusSnapshot corpus = GalleryCorpus::instance()->snapshot();
+    if (corpus.images.isEmpty()) {
         return "No gallery history cache available.";
     }
 
@@ -2495,12 +2463,12 @@ QString LlmPromptWidget::preferenceSummary() const
     QMap<QString, int> loraCounts;
     QMap<QString, int> negativeCounts;
 
-    for (const GalleryCacheItem &item : items) {
+    for (const UserImageInfo &item : corpus.images) {
         for (const QString &tag : parsePromptToTags(item.prompt)) {
             tagCounts[tag]++;
         }
-        for (const QString &lora : extractLorasFromPrompt(item.prompt)) {
-            loraCounts[lora]++;
+        for (const ImageParameters::Lora &lora : item.params.loras) {
+            if (lora.fromPrompt) loraCounts[lora.name]++;
         }
         for (const QString &tag : parsePromptToTags(item.negativePrompt)) {
             negativeCounts[tag]++;
@@ -2953,23 +2921,40 @@ void LlmPromptWidget::onRefreshCandidatesClicked()
         ui->listLoraCandidates->addItem(createLoraCandidateItem(path, meta, true));
     }
 
-    QList<QPair<int, GalleryCacheItem>> imageScores;
-    for (const GalleryCacheItem &item : loadGalleryCache()) {
-        int score = 0;
-        for (const QString &keyword : keywords) {
-            if (item.prompt.contains(keyword, Qt::CaseInsensitive)) score += 2;
-            if (item.path.contains(keyword, Qt::CaseInsensitive)) score += 1;
+    const GalleryCorpusSnapshot corpus = GalleryCorpus::instance()->snapshot();
+    QVector<UserImageInfo> rankedImages;
+    if (!keywords.isEmpty() && corpus.indexesVersion != 0) {
+        // 任一关键词命中即可，按全文索引的相关度排序；索引可能略落后于图库，已移除的图片跳过
+        QStringList terms;
+        for (QString keyword : keywords) {
+            while (keyword.startsWith('-')) keyword.remove(0, 1);
+            if (!keyword.isEmpty()) terms << keyword;
         }
-        if (keywords.isEmpty()) score = 1;
-        if (score > 0) imageScores.append(qMakePair(score, item));
+        const QVector<PromptSearchIndex::Hit> hits = corpus.searchIndex.search(terms.join(" OR "), limit);
+        for (const PromptSearchIndex::Hit &hit : hits) {
+            const auto it = corpus.images.constFind(hit.path);
+            if (it != corpus.images.constEnd()) rankedImages.append(it.value());
+        }
+    } else {
+        QList<QPair<int, UserImageInfo>> imageScores;
+        for (const UserImageInfo &item : corpus.images) {
+            int score = 0;
+            for (const QString &keyword : keywords) {
+                if (item.prompt.contains(keyword, Qt::CaseInsensitive)) score += 2;
+                if (item.path.contains(keyword, Qt::CaseInsensitive)) score += 1;
+            }
+            if (keywords.isEmpty()) score = 1;
+            if (score > 0) imageScores.append(qMakePair(score, item));
+        }
+        std::sort(imageScores.begin(), imageScores.end(), [](const auto &a, const auto &b){
+            if (a.first == b.first) return a.second.path < b.second.path;
+            return a.first > b.first;
+        });
+        for (int i = 0; i < imageScores.size() && i < limit; ++i) rankedImages.append(imageScores[i].second);
     }
-    std::sort(imageScores.begin(), imageScores.end(), [](const auto &a, const auto &b){
-        if (a.first == b.first) return a.second.path < b.second.path;
-        return a.first > b.first;
-    });
 
-    for (int i = 0; i < imageScores.size() && i < limit; ++i) {
-        const GalleryCacheItem &item = imageScores[i].second;
+    for (int i = 0; i < rankedImages.size(); ++i) {
+        const UserImageInfo &item = rankedImages.at(i);
         QString label = QFileInfo(item.path).fileName();
         if (!item.prompt.isEmpty()) {
             label += " | " + item.prompt.left(80);
@@ -71,13 +71,6 @@ private:
         LmStudio
     };
 
-    struct GalleryCacheItem {
-        QString path;
-        QString prompt;
-        QString negativePrompt;
-        QString parameters;
-    };
-
     struct LoraMetadataInfo {
         QString displayName;
         QString filePath;
@@ -177,7 +170,6 @@ private:
 
     QStringList extractKeywords() const;
     QStringList readInstalledModelsSync(bool *ok = nullptr, QString *errorText = nullptr) const;
-    QList<GalleryCacheItem> loadGalleryCache() const;
     QStringList collectLocalLoraFiles() const;
     LoraMetadataInfo readLoraMetadata(const QString &filePath) const;
     QString findLoraPreviewPath(const QString &filePath) const;
@@ -186,7 +178,6 @@ private:
     void queueLoraCandidateThumbnailLoads();
     QString preferenceSummary() const;
     QStringList parsePromptToTags(const QString &prompt) const;
-    QStringList extractLorasFromPrompt(const QString &prompt) const;
     QStringList splitPromptTokens(const QString &prompt) const;
     QString normalizeLooseText(const QString &text) const;
     QStringList parseReplaceInstruction(QString *oldTarget = nullptr, QString *newTarget = nullptr) const;
@@ -5,6 +5,8 @@
 #include "tableviewstylehelper.h"
 #include "styleconstants.h"
 #include "fileutils.h"
+#include "wd14taggerdaemon.h"
+#include "gallerycorpus.h"
 
 #include <QAbstractItemView>
 #include <QAction>
@@ -45,9 +47,11 @@
 #include <QSet>
 #include <QSignalBlocker>
 #include <QSlider>
+#include <QSpinBox>
 #include <QStandardPaths>
 #include <QSaveFile>
 #include <QTemporaryFile>
+#include <QThread>
 #include <QTableWidgetItem>
 #include <QTreeWidgetItem>
 #include <QTreeWidget>
@@ -252,33 +256,6 @@ Wd14TranslationInfo parseWd14TranslationInfo(const QString &tag, QString raw)
     return info;
 }
 
-QHash<QString, int> readWd14TagUsageCountsWorker(const QString &cachePath)
-{
-    QHash<QString, int> counts;
-    QFile file(cachePath);
-    if (!file.open(QIODevice::ReadOnly)) return counts;
-
-    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
-    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
-        if (it.key().startsWith("__") || !it.value().isObject()) continue;
-        const QJsonObject image = it.value().toObject();
-        QSet<QString> tagsInImage;
-        const auto collect = [&tagsInImage](QString prompt) {
-            prompt.replace("\r\n", ",");
-            prompt.replace('\n', ',');
-            prompt.replace('\r', ',');
-            for (const QString &part : prompt.split(',', Qt::SkipEmptyParts)) {
-                const QString key = normalizedWd14TagKey(part);
-                if (!key.isEmpty()) tagsInImage.insert(key);
-            }
-        };
-        collect(image.value("p").toString());
-        collect(image.value("np").toString());
-        for (const QString &key : tagsInImage) counts[key] += 1;
-    }
-    return counts;
-}
-
 class Wd14ScoreItem : public QTreeWidgetItem
 {
 public:
@@ -409,16 +386,13 @@ PromptParserWidget::PromptParserWidget(QWidget *parent)
     connect(ui->btnCopyCommon, &QPushButton::clicked, this, [this]() { copyCompareTags(compareCommonTags, "共同 Tag"); });
     connect(ui->btnCopyCompareAll, &QPushButton::clicked, this, &PromptParserWidget::copyCompareAll);
 
-    wd14Process = new QProcess(this);
-    wd14Process->setProcessChannelMode(QProcess::SeparateChannels);
-    connect(wd14Process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, [this](int exitCode, QProcess::ExitStatus exitStatus) {
-        Q_UNUSED(exitStatus);
+    m_wd14Daemon = new Wd14TaggerDaemon(this);
+    connect(m_wd14Daemon, &Wd14TaggerDaemon::finished,
+            this, [this](Wd14InferenceResult result) {
         setWd14Running(false);
-        const Wd14InferenceResult result = parseWd14ProcessOutput(
-            wd14Process->readAllStandardOutput(),
-            wd14Process->readAllStandardError(),
-            exitCode);
+        const auto memory = systemMemorySnapshot();
+        result.totalMemory = memory.first;
+        result.availableMemory = memory.second;
         ui->lblWd14Elapsed->setText(QString("用时: %1 sec.").arg(result.elapsedSec, 0, 'f', 2));
         updateWd14MemoryLabel(result.totalMemory, result.availableMemory);
 
@@ -431,9 +405,9 @@ PromptParserWidget::PromptParserWidget(QWidget *parent)
         ui->lblWd14Status->setText(QString("WD14 反推完成，共 %1 个标签。").arg(result.tags.size()));
         appendWd14History(result, m_activeWd14Settings);
     });
-    connect(wd14Process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError) {
+    connect(m_wd14Daemon, &Wd14TaggerDaemon::startFailed, this, [this](const QString &error) {
         setWd14Running(false);
-        ui->lblWd14Status->setText("WD14 Python 进程启动失败: " + wd14Process->errorString());
+        ui->lblWd14Status->setText("WD14 Python 进程启动失败: " + error);
     });
 
     m_wd14BatchProcess = new QProcess(this);
@@ -516,6 +490,8 @@ PromptParserWidget::PromptParserWidget(QWidget *parent)
     connect(ui->chkWd14IncludeConfidence, &QCheckBox::toggled, this, saveSettingsLater);
     connect(ui->chkWd14ReplaceUnderscore, &QCheckBox::toggled, this, saveSettingsLater);
     connect(ui->chkWd14EscapeBrackets, &QCheckBox::toggled, this, saveSettingsLater);
+    connect(ui->spinWd14BatchSize, &QSpinBox::valueChanged, this, [this]() { saveWd14Settings(); });
+    connect(ui->spinWd14BatchWorkers, &QSpinBox::valueChanged, this, [this]() { saveWd14Settings(); });
 
     ui->btnWd14Copy->setEnabled(false);
     ui->treeWd14Ratings->setRootIsDecorated(false);
@@ -630,6 +606,7 @@ PromptParserWidget::PromptParserWidget(QWidget *parent)
 
     loadWd14Settings();
     updateWd14BatchSettingsSummary();
+    connect(GalleryCorpus::instance(), &GalleryCorpus::indexesChanged, this, &PromptParserWidget::loadWd14TagUsageCounts);
     loadWd14TagUsageCounts();
 }
 
@@ -639,10 +616,6 @@ PromptParserWidget::~PromptParserWidget()
         m_wd14BatchProcess->kill();
         m_wd14BatchProcess->waitForFinished(1000);
     }
-    if (wd14Process && wd14Process->state() != QProcess::NotRunning) {
-        wd14Process->kill();
-        wd14Process->waitForFinished(1000);
-    }
     delete ui;
 }
 
@@ -1205,6 +1178,14 @@ void PromptParserWidget::loadWd14Settings()
     ui->chkWd14IncludeConfidence->setChecked(root.value("wd14_include_confidence").toBool(false));
     ui->chkWd14ReplaceUnderscore->setChecked(root.value("wd14_replace_underscore").toBool(true));
     ui->chkWd14EscapeBrackets->setChecked(root.value("wd14_escape_brackets").toBool(false));
+    {
+        // 默认值与脚本的 --batch-size / --workers 默认值一致
+        const QSignalBlocker sizeBlocker(ui->spinWd14BatchSize);
+        const QSignalBlocker workersBlocker(ui->spinWd14BatchWorkers);
+        ui->spinWd14BatchSize->setValue(root.value("wd14_batch_size").toInt(8));
+        ui->spinWd14BatchWorkers->setValue(
+            root.value("wd14_batch_workers").toInt(qMax(1, QThread::idealThreadCount() - 1)));
+    }
 
     const QString presetDir = wd14PresetDirectory();
     QDir dir(presetDir);
@@ -1246,6 +1227,8 @@ void PromptParserWidget::saveWd14Settings() const
     root["wd14_include_confidence"] = ui->chkWd14IncludeConfidence->isChecked();
     root["wd14_replace_underscore"] = ui->chkWd14ReplaceUnderscore->isChecked();
     root["wd14_escape_brackets"] = ui->chkWd14EscapeBrackets->isChecked();
+    root["wd14_batch_size"] = ui->spinWd14BatchSize->value();
+    root["wd14_batch_workers"] = ui->spinWd14BatchWorkers->value();
     root["wd14_active_preset"] = ui->comboWd14Preset->currentText().trimmed().isEmpty()
         ? "default.json"
         : ui->comboWd14Preset->currentText().trimmed();
@@ -1557,7 +1540,7 @@ void PromptParserWidget::setWd14Running(bool running)
 
 void PromptParserWidget::runWd14Tagger()
 {
-    if (wd14Process->state() != QProcess::NotRunning) return;
+    if (m_wd14Daemon->isBusy()) return;
     if (m_wd14BatchProcess && m_wd14BatchProcess->state() != QProcess::NotRunning) {
         ui->lblWd14Status->setText("批量 WD14 正在运行，请先停止或等待完成。");
         return;
@@ -1580,68 +1563,14 @@ void PromptParserWidget::runWd14Tagger()
         return;
     }
 
-    QStringList args;
-    args << scriptPath
-         << "--image" << wd14ImagePath
-         << "--model-dir" << modelDir
-         << "--threshold" << QString::number(ui->spinWd14Threshold->value(), 'f', 4);
-
     saveWd14Settings();
     m_activeWd14Settings = currentWd14Settings();
     setWd14Running(true);
-    ui->lblWd14Status->setText("WD14 Python 反推运行中...");
+    ui->lblWd14Status->setText(m_wd14Daemon->isRunning()
+                                   ? "WD14 Python 反推运行中..."
+                                   : "WD14 Python 反推运行中（首次需启动 Python 并加载模型）...");
     ui->lblWd14Elapsed->setText("用时: 计算中...");
-    wd14Process->start(selectedPythonPath(), args);
-}
-
-Wd14InferenceResult PromptParserWidget::parseWd14ProcessOutput(const QByteArray &stdoutBytes, const QByteArray &stderrBytes, int exitCode) const
-{
-    Wd14InferenceResult result;
-    const auto memory = systemMemorySnapshot();
-    result.totalMemory = memory.first;
-    result.availableMemory = memory.second;
-
-    QByteArray jsonBytes = stdoutBytes.trimmed();
-    const int firstBrace = jsonBytes.indexOf('{');
-    const int lastBrace = jsonBytes.lastIndexOf('}');
-    if (firstBrace >= 0 && lastBrace > firstBrace) {
-        jsonBytes = jsonBytes.mid(firstBrace, lastBrace - firstBrace + 1);
-    }
-
-    QJsonParseError parseError;
-    const QJsonDocument doc = QJsonDocument::fromJson(jsonBytes, &parseError);
-    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
-        QString message = QString("WD14 Python 输出不是有效 JSON (exit %1): %2").arg(exitCode).arg(parseError.errorString());
-        const QString stderrText = QString::fromUtf8(stderrBytes).trimmed();
-        if (!stderrText.isEmpty()) message += "\n" + stderrText.left(1000);
-        const QString stdoutText = QString::fromUtf8(stdoutBytes).trimmed();
-        if (!stdoutText.isEmpty()) message += "\nstdout:\n" + stdoutText.left(1000);
-        result.error = message;
-        return result;
-    }
-
-    const QJsonObject obj = doc.object();
-    result.ok = obj.value("ok").toBool(false) && exitCode == 0;
-    result.error = obj.value("error").toString();
-    result.elapsedSec = obj.value("elapsed_sec").toDouble(0.0);
-
-    const QJsonArray ratings = obj.value("ratings").toArray();
-    for (const QJsonValue &value : ratings) {
-        const Wd14TagScore score = parseScoreObject(value.toObject());
-        if (!score.tag.isEmpty()) result.ratings.append(score);
-    }
-
-    const QJsonArray tags = obj.value("tags").toArray();
-    for (const QJsonValue &value : tags) {
-        const Wd14TagScore score = parseScoreObject(value.toObject());
-        if (!score.tag.isEmpty()) result.tags.append(score);
-    }
-
-    if (!result.ok && result.error.isEmpty()) {
-        result.error = QString::fromUtf8(stderrBytes).trimmed();
-        if (result.error.isEmpty()) result.error = QString("WD14 Python 反推失败 (exit %1)。").arg(exitCode);
-    }
-    return result;
+    m_wd14Daemon->request(selectedPythonPath(), scriptPath, wd14ImagePath, modelDir, ui->spinWd14Threshold->value());
 }
 
 QStringList PromptParserWidget::splitWd14TagList(const QString &text) const
@@ -1675,22 +1604,16 @@ QString PromptParserWidget::formatWd14Tag(const QString &tag, const Wd14RenderSe
 
 void PromptParserWidget::loadWd14TagUsageCounts()
 {
-    const QString cachePath = qApp->applicationDirPath() + "/config/user_gallery_cache.json";
-    const qint64 modified = QFileInfo(cachePath).lastModified().toMSecsSinceEpoch();
-    if (m_wd14UsageWatcher || modified == m_wd14UsageCacheModified) return;
-
-    m_wd14UsageCacheModified = modified;
-    m_wd14UsageWatcher = new QFutureWatcher<QHash<QString, int>>(this);
-    connect(m_wd14UsageWatcher, &QFutureWatcher<QHash<QString, int>>::finished, this, [this]() {
-        if (!m_wd14UsageWatcher) return;
-        m_wd14TagUsageCounts = m_wd14UsageWatcher->result();
-        m_wd14UsageWatcher->deleteLater();
-        m_wd14UsageWatcher = nullptr;
-        updateWd14TagUsageColumn();
-    });
-    m_wd14UsageWatcher->setFuture(QtConcurrent::run([cachePath]() {
-        return readWd14TagUsageCountsWorker(cachePath);
-    }));
+    // 直接取图库 Tag 统计：正面或负面提示词中含该 Tag 的图片数。统计没有更新时沿用已有结果
+    const GalleryCorpusSnapshot corpus = GalleryCorpus::instance()->snapshot();
+    if (corpus.indexesVersion == m_wd14UsageCorpusVersion) return;
+
+    m_wd14UsageCorpusVersion = corpus.indexesVersion;
+    m_wd14TagUsageCounts.clear();
+    for (const TagStatistics::TagCount &count : corpus.tagStats.query()) {
+        m_wd14TagUsageCounts.insert(count.key, count.any);
+    }
+    updateWd14TagUsageColumn();
 }
 
 void PromptParserWidget::updateWd14TagUsageColumn()
@@ -1698,7 +1621,7 @@ void PromptParserWidget::updateWd14TagUsageColumn()
     for (int i = 0; i < ui->treeWd14Tags->topLevelItemCount(); ++i) {
         QTreeWidgetItem *item = ui->treeWd14Tags->topLevelItem(i);
         const QString sourceTag = item->data(0, Qt::UserRole).toString();
-        const int count = m_wd14TagUsageCounts.value(normalizedWd14TagKey(sourceTag));
+        const int count = m_wd14TagUsageCounts.value(TagUtils::normalizedPromptTagKey(sourceTag));
         item->setText(5, QString::number(count));
         item->setData(5, Qt::UserRole, count);
     }
@@ -1732,7 +1655,7 @@ void PromptParserWidget::applyWd14Result(const Wd14InferenceResult &result, cons
         score.category = info.category;
         score.translation = info.translation;
         score.priority = info.priority;
-        score.usageCount = m_wd14TagUsageCounts.value(normalizedWd14TagKey(score.tag));
+        score.usageCount = m_wd14TagUsageCounts.value(TagUtils::normalizedPromptTagKey(score.tag));
         visibleTags.append(score);
     }
 
@@ -2052,7 +1975,7 @@ void PromptParserWidget::applyWd14BatchExistingPolicy()
 
 void PromptParserWidget::startWd14Batch(bool retryOnly)
 {
-    if (m_wd14BatchProcess->state() != QProcess::NotRunning || wd14Process->state() != QProcess::NotRunning) {
+    if (m_wd14BatchProcess->state() != QProcess::NotRunning || m_wd14Daemon->isBusy()) {
         ui->lblWd14BatchStatus->setText("单图或批量 WD14 正在运行，请等待或先停止。");
         return;
     }
@@ -2117,11 +2040,15 @@ void PromptParserWidget::startWd14Batch(bool retryOnly)
     m_wd14BatchModel->notifyAll();
     updateWd14BatchCounts();
     ui->lblWd14BatchStatus->setText(QString("正在启动批量打标，共 %1 张图片...").arg(paths.size()));
+    // 批量进程会另外加载一份模型，先释放单图常驻进程占用的内存
+    m_wd14Daemon->shutdown();
     QStringList arguments;
     arguments << scriptPath
               << "--manifest" << m_wd14BatchManifestPath
               << "--model-dir" << modelDir
-              << "--threshold" << QString::number(m_activeWd14BatchSettings.threshold, 'f', 4);
+              << "--threshold" << QString::number(m_activeWd14BatchSettings.threshold, 'f', 4)
+              << "--batch-size" << QString::number(ui->spinWd14BatchSize->value())
+              << "--workers" << QString::number(ui->spinWd14BatchWorkers->value());
     m_wd14BatchProcess->start(selectedPythonPath(), arguments);
 }
 
@@ -2167,9 +2094,11 @@ void PromptParserWidget::setWd14BatchRunning(bool running)
     ui->btnWd14BatchEditSettings->setEnabled(idle);
     ui->comboWd14BatchExistingPolicy->setEnabled(idle);
     ui->chkWd14BatchRecursive->setEnabled(idle);
+    ui->spinWd14BatchSize->setEnabled(idle);
+    ui->spinWd14BatchWorkers->setEnabled(idle);
     ui->editWd14BatchPrefix->setEnabled(idle);
     ui->editWd14BatchSuffix->setEnabled(idle);
-    ui->btnWd14Run->setEnabled(!running && wd14Process->state() == QProcess::NotRunning);
+    ui->btnWd14Run->setEnabled(!running && !m_wd14Daemon->isBusy());
 }
 
 void PromptParserWidget::updateWd14BatchSettingsSummary()
@@ -2341,7 +2270,10 @@ void PromptParserWidget::processWd14BatchEvent(const QJsonObject &event)
             if (item.status == Wd14BatchStatus::Waiting) item.status = Wd14BatchStatus::Running;
         }
         m_wd14BatchModel->notifyAll();
-        ui->lblWd14BatchStatus->setText(QString("模型已加载，正在处理 %1 张图片...").arg(event.value("total").toInt()));
+        const int batchSize = event.value("batch_size").toInt(1);
+        ui->lblWd14BatchStatus->setText(batchSize > 1
+            ? QString("模型已加载，正在处理 %1 张图片（每批 %2 张）...").arg(event.value("total").toInt()).arg(batchSize)
+            : QString("模型已加载，正在处理 %1 张图片...").arg(event.value("total").toInt()));
         return;
     }
     if (type == "fatal") {
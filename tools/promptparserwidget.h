@@ -23,6 +23,7 @@ class QListWidget;
 class QProcess;
 class QPlainTextEdit;
 class QStackedWidget;
+class Wd14TaggerDaemon;
 
 class PromptParserWidget : public QWidget
 {
@@ -56,13 +57,12 @@ private:
     QString m_lastParsedNegative;   // 最近一次解析图片得到的负面提示词原文
     TagFlowWidget *compareTagWidgetA = nullptr;
     TagFlowWidget *compareTagWidgetB = nullptr;
-    QProcess *wd14Process = nullptr;
+    Wd14TaggerDaemon *m_wd14Daemon = nullptr;
     QProcess *m_wd14BatchProcess = nullptr;
     QString wd14ImagePath;
     QString wd14LastTagsText;
-    QHash<QString, int> m_wd14TagUsageCounts;
-    QFutureWatcher<QHash<QString, int>> *m_wd14UsageWatcher = nullptr;
-    qint64 m_wd14UsageCacheModified = -1;
+    QHash<QString, int> m_wd14TagUsageCounts;   // TagUtils::normalizedPromptTagKey → 图片数
+    quint64 m_wd14UsageCorpusVersion = 0;
     Wd14HistoryModel *m_wd14HistoryModel = nullptr;
     QFutureWatcher<QVector<Wd14HistoryEntry>> *m_wd14HistoryWatcher = nullptr;
     bool m_wd14HistoryLoaded = false;
@@ -118,7 +118,6 @@ private:
     void updateWd14ThresholdFromSpin(double value);
     void applyWd14Result(const Wd14InferenceResult &result, const Wd14RenderSettings *settings = nullptr);
     void updateWd14MemoryLabel(quint64 totalBytes, quint64 availableBytes);
-    Wd14InferenceResult parseWd14ProcessOutput(const QByteArray &stdoutBytes, const QByteArray &stderrBytes, int exitCode) const;
     void loadWd14TagUsageCounts();
     void updateWd14TagUsageColumn();
     QString formatWd14Tag(const QString &tag, const Wd14RenderSettings *settings = nullptr) const;
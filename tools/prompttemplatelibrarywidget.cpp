@@ -2,6 +2,7 @@
 #include "tableviewstylehelper.h"
 #include "ui_prompttemplatelibrarywidget.h"
 
+#include "gallerycorpus.h"
 #include "imagemetadataparser.h"
 #include "styleconstants.h"
 #include "tagflowwidget.h"
@@ -534,17 +535,6 @@ void populateModelTriggerChildren(QTreeWidgetItem *modelItem)
     addTriggerChildren(customTriggers, AppStyle::color("successGreenBright"));
 }
 
-void addTagCounts(const QString &prompt, QMap<QString, int> &counts,
-                  QHash<QString, QString> &displayTags)
-{
-    for (const QString &tag : parsePromptTags(prompt)) {
-        const QString key = TagUtils::normalizedPromptTagKey(tag);
-        if (key.isEmpty()) continue;
-        if (!displayTags.contains(key)) displayTags.insert(key, tag);
-        counts[key] += 1;
-    }
-}
-
 QString removeLeadingTagFromDisplayText(const QString &tag, QString display)
 {
     display = display.trimmed();
@@ -604,41 +594,21 @@ QString removeLeadingTagFromDisplayText(const QString &tag, QString display)
     return display;
 }
 
-QVector<PromptTemplateLibraryWidget::TagUsageRow> readTagRowsWorker(const QString &cachePath, int scope)
+// 常用 Tag 直接取全局 Tag 统计，不再逐图重新解析提示词。
+QVector<PromptTemplateLibraryWidget::TagUsageRow> readTagRowsWorker(const GalleryCorpusSnapshot &corpus, int scope)
 {
     QVector<PromptTemplateLibraryWidget::TagUsageRow> rows;
-    QFile file(cachePath);
-    if (!file.open(QIODevice::ReadOnly)) return rows;
-
-    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
-    QMap<QString, int> positiveCounts;
-    QMap<QString, int> negativeCounts;
-    QHash<QString, QString> positiveDisplayTags;
-    QHash<QString, QString> negativeDisplayTags;
-    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
-        if (it.key().startsWith("__")) continue;
-        const QJsonObject obj = it.value().toObject();
-        if (scope == 0 || scope == 2) {
-            addTagCounts(obj["p"].toString(), positiveCounts, positiveDisplayTags);
-        }
-        if (scope == 1 || scope == 2) {
-            addTagCounts(obj["np"].toString(), negativeCounts, negativeDisplayTags);
-        }
-    }
-
-    auto appendRows = [&rows](const QMap<QString, int> &counts,
-                              const QHash<QString, QString> &displayTags,
-                              const QString &kind) {
-        for (auto it = counts.constBegin(); it != counts.constEnd(); ++it) {
-            PromptTemplateLibraryWidget::TagUsageRow row;
-            row.tag = displayTags.value(it.key(), it.key());
-            row.kind = kind;
-            row.count = it.value();
-            rows.append(row);
-        }
+    auto appendRow = [&rows](const QString &tag, const QString &kind, int count) {
+        PromptTemplateLibraryWidget::TagUsageRow row;
+        row.tag = tag;
+        row.kind = kind;
+        row.count = count;
+        rows.append(row);
     };
-    if (scope == 0 || scope == 2) appendRows(positiveCounts, positiveDisplayTags, "正面");
-    if (scope == 1 || scope == 2) appendRows(negativeCounts, negativeDisplayTags, "负面");
+    for (const TagStatistics::TagCount &count : corpus.tagStats.query()) {
+        if ((scope == 0 || scope == 2) && count.positive > 0) appendRow(count.display, "正面", count.positive);
+        if ((scope == 1 || scope == 2) && count.negative > 0) appendRow(count.display, "负面", count.negative);
+    }
 
     std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
         if (a.count != b.count) return a.count > b.count;
@@ -848,6 +818,15 @@ PromptTemplateLibraryWidget::PromptTemplateLibraryWidget(QWidget *parent)
     connect(ui->btnNewPlaceholder, &QPushButton::clicked, this, &PromptTemplateLibraryWidget::onNewPlaceholderClicked);
     connect(ui->btnDeletePlaceholder, &QPushButton::clicked, this, &PromptTemplateLibraryWidget::onDeletePlaceholderClicked);
 
+    // 图库 Tag 统计更新后丢弃已加载的行，正在显示的选择器立即重新读取
+    connect(GalleryCorpus::instance(), &GalleryCorpus::indexesChanged, this, [this]() {
+        if (m_tagWatcher) return;
+        m_allTagRows.clear();
+        m_loadedTagScope = -1;
+        for (TagPickerUi *picker : {&m_templateTagPicker, &m_generateTagPicker}) {
+            if (picker->page && picker->page->isVisible()) loadTagPickerRows(*picker, true);
+        }
+    });
     connect(ui->tabTemplateManageSide, &QTabWidget::currentChanged, this, [this](int index) {
         if (ui->tabTemplateManageSide->widget(index) == m_templateTagPicker.page) loadTagPickerRows(m_templateTagPicker, false);
         if (ui->tabTemplateManageSide->widget(index) == m_templateModelTriggerPicker.page
@@ -2961,9 +2940,9 @@ void PromptTemplateLibraryWidget::loadTagPickerRows(TagPickerUi &picker, bool fo
         refreshTagPickerTable(picker);
         return;
     }
-    picker.status->setText("正在读取 user_gallery_cache.json 并统计常用 Tag...");
+    picker.status->setText("正在统计图库常用 Tag...");
     picker.table->setRowCount(0);
-    const QString cachePath = qApp->applicationDirPath() + "/config/user_gallery_cache.json";
+    const GalleryCorpusSnapshot corpus = GalleryCorpus::instance()->snapshot();
     m_tagWatcher = new QFutureWatcher<QVector<TagUsageRow>>(this);
     connect(m_tagWatcher, &QFutureWatcher<QVector<TagUsageRow>>::finished, this, [this, &picker, scope]() {
         if (!m_tagWatcher) return;
@@ -2973,8 +2952,8 @@ void PromptTemplateLibraryWidget::loadTagPickerRows(TagPickerUi &picker, bool fo
         m_tagWatcher = nullptr;
         refreshTagPickerTable(picker);
     });
-    m_tagWatcher->setFuture(QtConcurrent::run([cachePath, scope]() {
-        return readTagRowsWorker(cachePath, scope);
+    m_tagWatcher->setFuture(QtConcurrent::run([corpus, scope]() {
+        return readTagRowsWorker(corpus, scope);
     }));
 }
 
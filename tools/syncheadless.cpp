@@ -0,0 +1,130 @@
+#include "syncserver.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+#include <cstdio>
+#include <thread>
+
+// 无界面的同步服务：按设置文件启动 SyncServer，日志写到标准输出，标准输入关闭（EOF）时保存索引并退出。
+// 供 scripts/sync_load_test.py 等脚本直接拉起，不需要运行完整的界面程序。
+//
+// 设置文件（JSON）：{"port": 12345, "aesKey": "...", "roots": ["D:/sync_bench"],
+//                   "whitelistEnabled": false, "whitelist": ["deviceId"]}
+namespace {
+void printLine(const QString &text) {
+    const QByteArray line = (QDateTime::currentDateTime().toString("[HH:mm:ss] ") + text + '\n').toUtf8();
+    std::fwrite(line.constData(), 1, size_t(line.size()), stdout);
+    std::fflush(stdout);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("SD_Sync_Server");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless image sync server. Close stdin (Ctrl+D / Ctrl+Z) to stop.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("settings", "JSON settings file: port, aesKey, roots, whitelistEnabled, whitelist.");
+    const QCommandLineOption stateDirOption("state-dir",
+                                            "Directory for sync_index.json and the preview cache "
+                                            "(default: sync_state next to the settings file).",
+                                            "dir");
+    parser.addOption(stateDirOption);
+    parser.process(app);
+    if (parser.positionalArguments().size() != 1) parser.showHelp(1);
+
+    const QString settingsPath = parser.positionalArguments().constFirst();
+    QFile file(settingsPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        printLine("Cannot open settings file: " + file.errorString());
+        return 1;
+    }
+    QJsonParseError parseError;
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll(), &parseError).object();
+    if (parseError.error != QJsonParseError::NoError) {
+        printLine("Invalid settings file: " + parseError.errorString());
+        return 1;
+    }
+
+    const int port = root.value("port").toInt(12345);
+    SyncServer::Settings settings;
+    settings.aesKey = root.value("aesKey").toString().toUtf8();
+    settings.whitelistEnabled = root.value("whitelistEnabled").toBool(false);
+    for (const QJsonValue &id : root.value("whitelist").toArray()) settings.whitelist.insert(id.toString());
+    QStringList rootPaths;
+    for (const QJsonValue &path : root.value("roots").toArray()) {
+        const QFileInfo info(path.toString());
+        if (!info.isDir()) {
+            printLine("Sync folder does not exist: " + path.toString());
+            return 1;
+        }
+        rootPaths << QDir::cleanPath(info.absoluteFilePath());
+    }
+    if (settings.aesKey.isEmpty() || port <= 0 || port > 65535 || rootPaths.isEmpty()) {
+        printLine("Settings need a non-empty aesKey, a port in 1-65535 and at least one folder in roots.");
+        return 1;
+    }
+    const QString stateDir = parser.isSet(stateDirOption)
+        ? parser.value(stateDirOption)
+        : QFileInfo(settingsPath).absolutePath() + "/sync_state";
+
+    // 与 SyncWidget 相同：服务对象在独立线程中运行，这里只转发日志和状态
+    QThread serverThread;
+    serverThread.setObjectName("SyncServer");
+    SyncServer *server = new SyncServer();
+    server->setStateDirectory(stateDir);
+    server->moveToThread(&serverThread);
+    QObject::connect(&serverThread, &QThread::started, server, &SyncServer::initialize);
+    QObject::connect(server, &SyncServer::logMessage, &app, &printLine);
+    QObject::connect(server, &SyncServer::pendingDevice, &app, [](const QString &deviceId, const QString &displayName) {
+        printLine(QString("Device not in whitelist: %1 (%2)").arg(displayName, deviceId));
+    });
+    QObject::connect(server, &SyncServer::clientAuthenticated, &app, [](quintptr clientId, const QString &displayName) {
+        printLine(QString("Client connected: %1 (#%2)").arg(displayName).arg(clientId));
+    });
+    QObject::connect(server, &SyncServer::clientDisconnected, &app, [](quintptr clientId) {
+        printLine(QString("Client disconnected: #%1").arg(clientId));
+    });
+    // 脚本等待这一行再连接客户端：根目录已在此前的排队调用中建好索引
+    QObject::connect(server, &SyncServer::listeningChanged, &app, [port](bool listening) {
+        if (listening) printLine(QString("LISTENING %1").arg(port));
+    });
+    QObject::connect(server, &SyncServer::startFailed, &app, [](quint16 failedPort) {
+        printLine(QString("Failed to listen on port %1").arg(failedPort));
+        QCoreApplication::exit(1);
+    });
+    serverThread.start();
+
+    // 排队调用按顺序执行：先下发设置和根目录，最后开始监听
+    QMetaObject::invokeMethod(server, [server, settings]() { server->applySettings(settings); });
+    for (const QString &path : std::as_const(rootPaths)) {
+        QMetaObject::invokeMethod(server, [server, path]() { server->addRoot(path, false); });
+    }
+    QMetaObject::invokeMethod(server, [server, port]() { server->start(quint16(port)); });
+
+    // 标准输入关闭即退出：拉起本进程的脚本结束时管道随之关闭，服务不会残留
+    std::thread([]() {
+        while (std::fgetc(stdin) != EOF) {}
+        if (QCoreApplication *instance = QCoreApplication::instance()) {
+            QMetaObject::invokeMethod(instance, &QCoreApplication::quit, Qt::QueuedConnection);
+        }
+    }).detach();
+
+    const int exitCode = app.exec();
+    QMetaObject::invokeMethod(server, &SyncServer::shutdown, Qt::BlockingQueuedConnection);
+    serverThread.quit();
+    serverThread.wait();
+    delete server;
+    return exitCode;
+}
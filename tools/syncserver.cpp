@@ -0,0 +1,1621 @@
+#include "syncserver.h"
+#include <QDirIterator>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDataStream>
+#include <QDateTime>
+#include <QTimer>
+#include <QThread>
+#include <QHostInfo>
+#include <QNetworkInterface>
+#include <QFile>
+#include <QLocale>
+#include <QtEndian>
+#include <QBuffer>
+#include <QImage>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QCoreApplication>
+#include <QUuid>
+#include <algorithm>
+#include <utility>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+namespace {
+// 分块协议能力名：客户端在 AUTH 的 caps 中声明后，文件改用 SYNC_BEGIN / SYNC_CHUNK / SYNC_END 流式发送。
+const QString kChunkedCapability = QStringLiteral("chunked_v1");
+// 服务端在 SYNC_BEGIN / SYNC_END 中附带 mtime 与内容摘要，客户端原样记下并在 Manifest 中回报，
+// 也可以在 partial 中上报未完成的传输以便按块续传。
+const QString kContentManifestCapability = QStringLiteral("manifest_v2");
+// 预览优先：Manifest 带 mode="preview" 时，缺失的文件先发 PREVIEW 缩略图，原图通过 FETCH 按需获取，
+// 或在 fullInBackground 为 true 时排在所有其他发送之后补齐。
+const QString kPreviewCapability = QStringLiteral("preview_v1");
+// 预览图长边像素与编码质量。
+constexpr int kPreviewMaxEdge = 320;
+constexpr int kPreviewQuality = 80;
+// 开始发送一个预览时，顺带让线程池提前生成队列里后面几个。
+constexpr int kPreviewPrefetch = 4;
+// 预览磁盘缓存按 路径 + 大小 + 修改时间 命名，原图变化或删除后旧文件不会再被读到；
+// 启动时和每生成一批预览后按最近使用时间清理：超过保留天数的删除，总量超出上限时从最旧的删起。
+constexpr qint64 kPreviewCacheMaxBytes = 512ll * 1024 * 1024;
+constexpr int kPreviewCacheMaxAgeDays = 30;
+constexpr int kPreviewPruneInterval = 1000;
+// 压缩：双方都在握手中声明后，较大的控制包（文件夹列表、Manifest）用 zlib 压缩后再加密。
+// 明文头中 jsonLen 的最高位为 1 表示其后的 JSON + 数据整体经过 qCompress。
+// 客户端还可以用 encoding="bin1" 把 Manifest 编码为紧凑的二进制放在数据段中。
+const QString kCompressionCapability = QStringLiteral("deflate_v1");
+constexpr quint32 kCompressedFlag = 0x80000000u;
+// 短于这个长度的 JSON 压缩收益抵不过开销，保持原样；帧流里的 BEGIN / END 和广播的删除通知都在此之下，
+// 因而仍能对所有客户端共用同一份密文。
+constexpr int kCompressMinBytes = 512;
+// 解压后的上限，防止压缩炸弹。
+constexpr quint32 kMaxDecompressedBytes = 256u * 1024u * 1024u;
+// 变更序号：FOLDER_LIST 带上 indexId 和当前序号；客户端收完所有已排队的发送后会收到 SYNC_SEQ，
+// 重连时在 Manifest 中给出 since / indexId，服务端只回放这之后的新增、修改和删除。
+const QString kChangesCapability = QStringLiteral("changes_v1");
+// 删除记录的保留上限，超出后丢弃最早的记录并抬高 compactedSeq。
+constexpr int kMaxDeletionRecords = 20000;
+// 索引变化后延迟写盘，合并连续的变化。
+constexpr int kIndexSaveDelayMs = 5000;
+// 每块明文大小；每块单独加密，内存占用与文件大小无关。
+constexpr qint64 kSyncChunkSize = 256 * 1024;
+// socket 待发字节超过这个值就暂停读盘，等 bytesWritten 后继续。
+constexpr qint64 kSendHighWaterBytes = 1024 * 1024;
+// 广播时最快的客户端最多领先最慢的这么多帧，已加密帧的缓存因此有上限（约 4 MB）。
+constexpr int kMaxBufferedFrames = 16;
+// 已连接列表中发送进度的刷新间隔。
+constexpr int kProgressRefreshMs = 250;
+// 目录变化事件的合并窗口。
+constexpr int kDirChangeCoalesceMs = 300;
+// 新文件的大小和修改时间保持不变这么久才视为写入完成。
+constexpr int kStabilityCheckMs = 500;
+constexpr qint64 kFileStableMs = 1000;
+// 大小一直为 0 的文件（占位文件或真正的空文件）等这么久就放弃；之后真正写入时目录变化会重新加入。
+constexpr qint64 kEmptyFileTimeoutMs = 30 * 1000;
+// 待稳定超过这么久的文件不再压住 SYNC_SEQ；它稳定后推送时会重新取序号，客户端不会漏掉。
+constexpr qint64 kPendingSeqHoldMs = 60 * 1000;
+// 客户端只发送 AUTH 和 Manifest 之类的控制包，不需要容纳整张大图。
+constexpr quint32 kMaxIncomingPacketBytes = 64u * 1024u * 1024u;
+
+// 二进制 Manifest（bin1）：[u32 条目数]，之后每条：
+//   [u8 flags][u16 与上一条路径相同的 UTF-8 前缀长度][u16 后缀长度][后缀][i64 size][i64 mtime]
+//   flags & 1：后跟 32 字节原始内容摘要；flags & 2：这是 partial 条目，后跟 [i64 received]。
+// 路径按字典序排列时共享前缀很长，单条通常只有二三十字节。解出的结果与 JSON 形式的 files / partial 相同。
+bool decodeBinaryManifest(const QByteArray &data, QJsonObject &files, QJsonObject &partial) {
+    QDataStream in(data);
+    in.setByteOrder(QDataStream::BigEndian);
+    quint32 count = 0;
+    in >> count;
+    QByteArray previousPath;
+    for (quint32 i = 0; i < count; ++i) {
+        quint8 flags = 0;
+        quint16 shared = 0;
+        quint16 suffixLen = 0;
+        in >> flags >> shared >> suffixLen;
+        if (in.status() != QDataStream::Ok || shared > previousPath.size()) return false;
+        QByteArray suffix(suffixLen, Qt::Uninitialized);
+        if (in.readRawData(suffix.data(), suffixLen) != suffixLen) return false;
+        const QByteArray pathBytes = previousPath.left(shared) + suffix;
+        qint64 size = 0;
+        qint64 mtime = 0;
+        in >> size >> mtime;
+        QJsonObject entry;
+        entry["size"] = size;
+        entry["mtime"] = mtime;
+        if (flags & 1) {
+            QByteArray hash(32, Qt::Uninitialized);
+            if (in.readRawData(hash.data(), 32) != 32) return false;
+            entry["hash"] = QString::fromLatin1(hash.toHex());
+        }
+        if (flags & 2) {
+            qint64 received = 0;
+            in >> received;
+            entry["received"] = received;
+        }
+        if (in.status() != QDataStream::Ok) return false;
+        (flags & 2 ? partial : files).insert(QString::fromUtf8(pathBytes), entry);
+        previousPath = pathBytes;
+    }
+    return true;
+}
+
+// 在线程池中运行：命中磁盘缓存直接读取，否则按目标尺寸解码、编码后写入缓存。
+QByteArray loadOrBuildPreview(const QString &filePath, const QString &cachePath, const QByteArray &format) {
+    QFile cached(cachePath);
+    // 修改时间记作最近使用时间，清理时据此保留常用的预览。
+    // Windows 上只读句柄改不了文件时间，所以以读写方式打开（ExistingOnly 避免创建空文件）。
+    if (cached.open(QIODevice::ReadWrite | QIODevice::ExistingOnly)) {
+        const QByteArray data = cached.readAll();
+        if (!cached.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime)) {
+            // 改时间失败时重写一遍缓存，否则常用的预览会按首次生成时间被清理掉
+            cached.close();
+            QSaveFile out(cachePath);
+            if (out.open(QIODevice::WriteOnly) && out.write(data) == data.size()) out.commit();
+        }
+        return data;
+    }
+    if (cached.open(QIODevice::ReadOnly)) return cached.readAll();
+
+    QImageReader reader(filePath);
+    reader.setAutoTransform(true);
+    const QSize original = reader.size();
+    if (original.isValid() && (original.width() > kPreviewMaxEdge || original.height() > kPreviewMaxEdge)) {
+        reader.setScaledSize(original.scaled(kPreviewMaxEdge, kPreviewMaxEdge, Qt::KeepAspectRatio));
+    }
+    const QImage image = reader.read();
+    if (image.isNull()) return QByteArray();
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    if (!buffer.open(QIODevice::WriteOnly) || !image.save(&buffer, format.constData(), kPreviewQuality)) return QByteArray();
+
+    QDir().mkpath(QFileInfo(cachePath).absolutePath());
+    QSaveFile out(cachePath);
+    if (out.open(QIODevice::WriteOnly) && out.write(data) == data.size()) out.commit();
+    return data;
+}
+
+// 在线程池中运行：删除过期的预览，再按最近使用时间从旧到新删到总量不超过上限。
+void prunePreviewCache(const QString &cacheDir) {
+    QFileInfoList files = QDir(cacheDir).entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
+    std::sort(files.begin(), files.end(), [](const QFileInfo &a, const QFileInfo &b) {
+        return a.lastModified() > b.lastModified();
+    });
+    const QDateTime expiry = QDateTime::currentDateTime().addDays(-kPreviewCacheMaxAgeDays);
+    qint64 keptBytes = 0;
+    for (const QFileInfo &file : std::as_const(files)) {
+        if (file.lastModified() < expiry || keptBytes + file.size() > kPreviewCacheMaxBytes) {
+            QFile::remove(file.absoluteFilePath());
+        } else {
+            keptBytes += file.size();
+        }
+    }
+}
+}
+
+SyncServer::SyncServer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SyncServer::~SyncServer()
+{
+    // socket、监控器和定时器都属于服务线程，不能在析构所在的线程里关闭
+    Q_ASSERT_X(m_isShutDown || !tcpServer, "SyncServer", "shutdown() must run on the server thread before destruction");
+}
+
+void SyncServer::setStateDirectory(const QString &dir) {
+    m_stateDir = dir;
+}
+
+// 在服务线程启动后调用：socket 和监控器必须在所属线程中创建。
+void SyncServer::initialize() {
+    tcpServer = new QTcpServer(this);
+    udpDiscoverySocket = new QUdpSocket(this);
+    watcher = new QFileSystemWatcher(this);
+
+    connect(tcpServer, &QTcpServer::newConnection, this, &SyncServer::newClientConnected);
+    connect(udpDiscoverySocket, &QUdpSocket::readyRead, this, &SyncServer::onDiscoveryReadyRead);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &SyncServer::handleDirectoryChange);
+
+    m_dirChangeTimer = new QTimer(this);
+    m_dirChangeTimer->setSingleShot(true);
+    m_dirChangeTimer->setInterval(kDirChangeCoalesceMs);
+    connect(m_dirChangeTimer, &QTimer::timeout, this, &SyncServer::processPendingDirChanges);
+    m_stabilityTimer = new QTimer(this);
+    m_stabilityTimer->setInterval(kStabilityCheckMs);
+    connect(m_stabilityTimer, &QTimer::timeout, this, &SyncServer::checkPendingFileStability);
+
+    // 预览缓存按 路径 + 大小 + 修改时间 命名，文件变化后自然失效；不再用到的旧文件由 prunePreviewCache 清理
+    // 指定了状态目录（无界面模式）时预览缓存也放在那里，不与界面程序共用
+    m_previewCacheDir = m_stateDir.isEmpty()
+        ? QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/sync_previews"
+        : m_stateDir + "/sync_previews";
+    if (m_stateDir.isEmpty()) m_stateDir = QCoreApplication::applicationDirPath() + "/config";
+    m_previewFormat = QImageWriter::supportedImageFormats().contains("webp") ? QByteArray("webp") : QByteArray("jpg");
+    m_previewPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+    m_previewPool.start([cacheDir = m_previewCacheDir]() { prunePreviewCache(cacheDir); });
+
+    m_indexSaveTimer = new QTimer(this);
+    m_indexSaveTimer->setSingleShot(true);
+    m_indexSaveTimer->setInterval(kIndexSaveDelayMs);
+    connect(m_indexSaveTimer, &QTimer::timeout, this, &SyncServer::saveSyncIndex);
+    loadSyncIndex();
+}
+
+void SyncServer::shutdown() {
+    if (m_isShutDown) return;
+    m_isShutDown = true;
+    // 等线程池里的预览任务结束，它们会回调本对象
+    m_previewPool.clear();
+    m_previewPool.waitForDone();
+    if (m_dirChangeTimer) m_dirChangeTimer->stop();
+    if (m_stabilityTimer) m_stabilityTimer->stop();
+    if (m_indexSaveTimer && m_indexSaveTimer->isActive()) {
+        m_indexSaveTimer->stop();
+        saveSyncIndex();
+    }
+    if (watcher) {
+        watcher->disconnect(this);
+        const QStringList watchedFiles = watcher->files();
+        if (!watchedFiles.isEmpty()) watcher->removePaths(watchedFiles);
+        const QStringList watchedDirs = watcher->directories();
+        if (!watchedDirs.isEmpty()) watcher->removePaths(watchedDirs);
+    }
+    if (tcpServer) {
+        tcpServer->disconnect(this);
+        tcpServer->close();
+    }
+    if (udpDiscoverySocket) {
+        udpDiscoverySocket->disconnect(this);
+        udpDiscoverySocket->close();
+    }
+    const QList<QTcpSocket*> sockets = clients;
+    for (QTcpSocket *client : sockets) {
+        if (!client) continue;
+        client->disconnect(this);
+        client->abort();
+        client->setParent(nullptr);
+        delete client;
+    }
+    clients.clear();
+    m_clientExpectedSizes.clear();
+    m_authenticatedClients.clear();
+    m_sendStates.clear();
+    delete watcher;
+    watcher = nullptr;
+    delete tcpServer;
+    tcpServer = nullptr;
+    delete udpDiscoverySocket;
+    udpDiscoverySocket = nullptr;
+}
+
+void SyncServer::applySettings(const SyncServer::Settings &settings) {
+    m_settings = settings;
+}
+
+void SyncServer::start(quint16 port) {
+    if (!tcpServer || tcpServer->isListening()) return;
+    if (tcpServer->listen(QHostAddress::Any, port)) {
+        startDiscoveryResponder(port);
+        emit logMessage(QString("服务已启动，监听端口: %1").arg(port));
+        emit listeningChanged(true);
+    } else {
+        emit startFailed(port);
+    }
+}
+
+void SyncServer::stop() {
+    if (!tcpServer || !tcpServer->isListening()) return;
+    stopDiscoveryResponder();
+    tcpServer->close();
+    for (auto client : clients) client->disconnectFromHost();
+    emit logMessage("服务已停止。");
+    emit listeningChanged(false);
+}
+
+void SyncServer::addRoot(const QString &rootPath, bool sendExisting) {
+    if (!watcher || m_rootPaths.contains(rootPath)) return;
+    m_rootPaths.append(rootPath);
+    // 先放入上次保存的索引项：扫描时大小和修改时间没变的文件沿用原来的摘要和序号
+    const QHash<QString, SyncIndexEntry> persisted = m_persistedRoots.take(rootPath);
+    for (auto it = persisted.cbegin(); it != persisted.cend(); ++it) {
+        m_fileIndex.insert(it.key(), it.value());
+        m_changeLog.insert(it->seq, it.key());
+        m_unverifiedKeys.insert(it.key());
+    }
+    addPathRecursive(rootPath, rootPath);
+    // 扫描中没有再出现的文件是停机期间被删除的
+    const QSet<QString> missing = std::exchange(m_unverifiedKeys, {});
+    for (const QString &key : missing) recordDeletion(key, m_fileIndex.take(key).seq);
+    scheduleIndexSave();
+    if (!sendExisting) return;
+
+    // 立即向已连接客户端补发新目录中的图片（索引刚建好，无需再遍历一次磁盘）
+    QStringList files;
+    for (auto it = m_fileIndex.cbegin(); it != m_fileIndex.cend(); ++it) {
+        if (it->rootPath == rootPath) files << it->fullPath;
+    }
+    for (const QString &filePath : std::as_const(files)) sendFile(filePath, rootPath, SendPriority::Backfill);
+}
+
+void SyncServer::removeRoot(const QString &rootPath) {
+    m_rootPaths.removeAll(rootPath);
+    removePathRecursive(rootPath);
+    dropDirIndex(rootPath, false);
+    dropPendingFiles(rootPath);
+    scheduleIndexSave();
+}
+
+void SyncServer::kickClient(quintptr clientId) {
+    for (QTcpSocket *client : std::as_const(clients)) {
+        if (quintptr(client) != clientId) continue;
+        if (client->state() == QAbstractSocket::ConnectedState) {
+            emit logMessage("🔌 强制断开客户端连接...");
+            client->disconnectFromHost();
+        }
+        return;
+    }
+}
+
+// ======================= UDP 发现 =======================
+void SyncServer::startDiscoveryResponder(quint16 port) {
+    stopDiscoveryResponder();
+
+    const bool bound = udpDiscoverySocket->bind(
+        QHostAddress::AnyIPv4,
+        port,
+        QAbstractSocket::ShareAddress | QAbstractSocket::ReuseAddressHint
+    );
+    if (bound) {
+        emit logMessage(QString("UDP 发现服务已启动，监听端口: %1").arg(port));
+    } else {
+        emit logMessage("⚠️ UDP 发现服务启动失败，手机端自动扫描可能不可用。");
+    }
+}
+
+void SyncServer::stopDiscoveryResponder() {
+    if (udpDiscoverySocket && udpDiscoverySocket->state() != QAbstractSocket::UnconnectedState) {
+        udpDiscoverySocket->close();
+    }
+}
+
+QString SyncServer::getLocalIPv4AddressForPeer(const QHostAddress &peerAddress) const {
+    const QHostAddress peerV4(peerAddress.toIPv4Address());
+    const quint32 peer = peerV4.toIPv4Address();
+
+    for (const QNetworkInterface &networkInterface : QNetworkInterface::allInterfaces()) {
+        if (!(networkInterface.flags() & QNetworkInterface::IsUp)
+            || !(networkInterface.flags() & QNetworkInterface::IsRunning)
+            || (networkInterface.flags() & QNetworkInterface::IsLoopBack)) {
+            continue;
+        }
+
+        for (const QNetworkAddressEntry &entry : networkInterface.addressEntries()) {
+            const QHostAddress address = entry.ip();
+            if (address.protocol() != QAbstractSocket::IPv4Protocol || address.isLoopback()) {
+                continue;
+            }
+
+            const quint32 ip = address.toIPv4Address();
+            const quint32 mask = entry.netmask().toIPv4Address();
+            if (mask != 0 && peer != 0 && (ip & mask) == (peer & mask)) {
+                return address.toString();
+            }
+        }
+    }
+
+    for (const QHostAddress &address : QNetworkInterface::allAddresses()) {
+        if (address.protocol() == QAbstractSocket::IPv4Protocol && !address.isLoopback()) {
+            return address.toString();
+        }
+    }
+
+    return QString();
+}
+
+void SyncServer::onDiscoveryReadyRead() {
+    while (udpDiscoverySocket->hasPendingDatagrams()) {
+        QByteArray datagram;
+        datagram.resize(int(udpDiscoverySocket->pendingDatagramSize()));
+
+        QHostAddress senderAddress;
+        quint16 senderPort = 0;
+        udpDiscoverySocket->readDatagram(datagram.data(), datagram.size(), &senderAddress, &senderPort);
+
+        const QJsonObject request = QJsonDocument::fromJson(datagram).object();
+        if (request["cmd"].toString() != "SD_SYNC_DISCOVER") continue;
+        if (request["version"].toInt() != 1) continue;
+        if (!tcpServer->isListening()) continue;
+
+        const quint16 port = tcpServer->serverPort();
+        const QString localIp = getLocalIPv4AddressForPeer(senderAddress);
+
+        QJsonObject response;
+        response["cmd"] = "SD_SYNC_DISCOVER_RESPONSE";
+        response["version"] = 1;
+        response["app"] = "SD_LoRA_Manager";
+        response["name"] = QHostInfo::localHostName();
+        response["ip"] = localIp;
+        response["port"] = int(port);
+
+        const QByteArray payload = QJsonDocument(response).toJson(QJsonDocument::Compact);
+        udpDiscoverySocket->writeDatagram(payload, senderAddress, senderPort);
+    }
+}
+
+// ======================= AES-GCM 加解密 =======================
+QByteArray SyncServer::encryptAESGCM(const QByteArray &plaintext, const QByteArray &key, QByteArray &iv, QByteArray &tag) {
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) return QByteArray();
+    int len = 0;
+    int ciphertext_len = 0;
+    QByteArray ciphertext(plaintext.length() + 16, 0);
+
+    if (EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL) != 1) {
+        EVP_CIPHER_CTX_free(ctx);
+        return QByteArray();
+    }
+    QByteArray paddedKey = key.leftJustified(32, '\0', true);
+
+    if (EVP_EncryptInit_ex(ctx, NULL, NULL,
+                           reinterpret_cast<const unsigned char*>(paddedKey.constData()),
+                           reinterpret_cast<const unsigned char*>(iv.constData())) != 1) {
+        EVP_CIPHER_CTX_free(ctx);
+        return QByteArray();
+    }
+    if (EVP_EncryptUpdate(ctx,
+                          reinterpret_cast<unsigned char*>(ciphertext.data()),
+                          &len,
+                          reinterpret_cast<const unsigned char*>(plaintext.constData()),
+                          plaintext.length()) != 1) {
+        EVP_CIPHER_CTX_free(ctx);
+        return QByteArray();
+    }
+    ciphertext_len = len;
+    if (EVP_EncryptFinal_ex(ctx, reinterpret_cast<unsigned char*>(ciphertext.data()) + ciphertext_len, &len) != 1) {
+        EVP_CIPHER_CTX_free(ctx);
+        return QByteArray();
+    }
+    ciphertext_len += len;
+
+    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, 16, tag.data());
+    EVP_CIPHER_CTX_free(ctx);
+
+    return ciphertext.left(ciphertext_len);
+}
+
+QByteArray SyncServer::decryptAESGCM(const QByteArray &ciphertext, const QByteArray &key, const QByteArray &iv, const QByteArray &tag, bool &success) {
+    success = false;
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) return QByteArray();
+    int len = 0;
+    int plaintext_len = 0;
+    QByteArray plaintext(ciphertext.length() + 16, 0);
+
+    QByteArray paddedKey = key.leftJustified(32, '\0', true);
+
+    if (EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL) != 1
+        || EVP_DecryptInit_ex(ctx, NULL, NULL,
+                              reinterpret_cast<const unsigned char*>(paddedKey.constData()),
+                              reinterpret_cast<const unsigned char*>(iv.constData())) != 1
+        || EVP_DecryptUpdate(ctx,
+                             reinterpret_cast<unsigned char*>(plaintext.data()),
+                             &len,
+                             reinterpret_cast<const unsigned char*>(ciphertext.constData()),
+                             ciphertext.length()) != 1) {
+        EVP_CIPHER_CTX_free(ctx);
+        return QByteArray();
+    }
+    plaintext_len = len;
+
+    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, 16, const_cast<char*>(tag.constData()));
+    int ret = EVP_DecryptFinal_ex(ctx, reinterpret_cast<unsigned char*>(plaintext.data()) + plaintext_len, &len);
+
+    success = (ret > 0);
+    EVP_CIPHER_CTX_free(ctx);
+
+    if (!success) return QByteArray();
+    return plaintext.left(plaintext_len + len);
+}
+
+// ======================= 通讯协议 =======================
+void SyncServer::sendPacket(QTcpSocket* client, const QJsonObject& metadata, const QByteArray& fileData) {
+    if (!client || client->state() != QAbstractSocket::ConnectedState) return;
+    client->write(sealPacket(metadata, fileData, m_sendStates.value(client).compression));
+}
+
+// 每个包用随机 IV 加密一次，得到的线上字节可原样写给任意多个客户端。
+// compress 只对不带数据的较大控制包生效；文件数据已经是压缩过的图片格式，不再处理。
+QByteArray SyncServer::sealPacket(const QJsonObject& metadata, const QByteArray& fileData, bool compress) {
+    const QByteArray jsonBytes = QJsonDocument(metadata).toJson(QJsonDocument::Compact);
+    quint32 jsonLen = jsonBytes.size();
+    QByteArray compressed;
+    if (compress && fileData.isEmpty() && jsonBytes.size() >= kCompressMinBytes) {
+        compressed = qCompress(jsonBytes);
+        if (compressed.size() >= jsonBytes.size()) compressed.clear();
+    }
+    const QByteArray &body = compressed.isEmpty() ? jsonBytes : compressed;
+    if (!compressed.isEmpty()) jsonLen |= kCompressedFlag;
+    const quint32 dataLen = fileData.size();
+    const quint32 totalLen = 4 + body.size() + dataLen;
+
+    QByteArray plainPacket;
+    plainPacket.reserve(8 + body.size() + dataLen);
+    QDataStream plainOut(&plainPacket, QIODevice::WriteOnly);
+    plainOut.setByteOrder(QDataStream::BigEndian);
+    plainOut << totalLen << jsonLen;
+    plainOut.writeRawData(body.constData(), body.size());
+    if (dataLen > 0) plainOut.writeRawData(fileData.constData(), dataLen);
+
+    QByteArray iv(12, 0); RAND_bytes((unsigned char*)iv.data(), 12);
+    QByteArray tag(16, 0);
+
+    const QByteArray cipher = encryptAESGCM(plainPacket, m_settings.aesKey, iv, tag);
+    plainPacket.clear();
+
+    const quint32 cipherPayloadLen = cipher.size() + 12 + 16;
+    QByteArray wire;
+    wire.reserve(4 + cipherPayloadLen);
+    QDataStream out(&wire, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::BigEndian);
+    out << cipherPayloadLen;
+    out.writeRawData(iv.constData(), 12);
+    out.writeRawData(tag.constData(), 16);
+    out.writeRawData(cipher.constData(), cipher.size());
+    return wire;
+}
+
+void SyncServer::broadcastPacket(const QJsonObject& metadata) {
+    if (m_authenticatedClients.isEmpty()) return;
+    const QByteArray wire = sealPacket(metadata);
+    for (QTcpSocket *client : m_authenticatedClients) {
+        if (client->state() == QAbstractSocket::ConnectedState) client->write(wire);
+    }
+}
+
+void SyncServer::newClientConnected() {
+    QTcpSocket *client = tcpServer->nextPendingConnection();
+    clients << client;
+    m_clientExpectedSizes[client] = 0;
+
+    QString clientInfo = client->peerAddress().toString().remove("::ffff:") + ":" + QString::number(client->peerPort());
+    emit logMessage("🔌 建立物理连接: " + clientInfo + " (等待认证...)");
+
+    connect(client, &QTcpSocket::readyRead, this, &SyncServer::onClientReadyRead);
+    connect(client, &QTcpSocket::bytesWritten, this, &SyncServer::onClientBytesWritten);
+
+    connect(client, &QTcpSocket::disconnected, this, &SyncServer::handleClientDisconnected);
+}
+
+void SyncServer::onClientReadyRead() {
+    QTcpSocket *client = qobject_cast<QTcpSocket*>(sender());
+    if (!client) return;
+
+    QDataStream in(client);
+    in.setByteOrder(QDataStream::BigEndian);
+
+    while (true) {
+        if (m_clientExpectedSizes[client] == 0) {
+            if (client->bytesAvailable() < 4) return;
+            in >> m_clientExpectedSizes[client];
+        }
+
+        quint32 expectedSize = m_clientExpectedSizes[client];
+        if (expectedSize < 28 || expectedSize > kMaxIncomingPacketBytes) {
+            emit logMessage("⚠️ 警告: 收到异常同步数据包长度，已断开客户端。");
+            m_clientExpectedSizes[client] = 0;
+            client->disconnectFromHost();
+            return;
+        }
+        if (client->bytesAvailable() < expectedSize) return;
+
+        QByteArray iv = client->read(12);
+        QByteArray tag = client->read(16);
+        QByteArray ciphertext = client->read(expectedSize - 28);
+        m_clientExpectedSizes[client] = 0;
+
+        bool decSuccess = false;
+        QByteArray plaintext = decryptAESGCM(ciphertext, m_settings.aesKey, iv, tag, decSuccess);
+
+        if (!decSuccess) {
+            emit logMessage("⚠️ 警告: 客户端加密认证失败，可能密钥错误，已断开！");
+            client->disconnectFromHost();
+            return;
+        }
+
+        if (plaintext.size() < 8) {
+            emit logMessage("⚠️ 警告: 同步数据包明文头不完整，已断开客户端。");
+            client->disconnectFromHost();
+            return;
+        }
+
+        QDataStream plainIn(plaintext);
+        plainIn.setByteOrder(QDataStream::BigEndian);
+        quint32 plainTotalLen = 0;
+        quint32 jsonLen = 0;
+        plainIn >> plainTotalLen >> jsonLen;
+
+        // plainTotalLen is encoded as sizeof(jsonLen) + JSON + optional data.
+        const quint64 actualPayloadLength = static_cast<quint64>(plaintext.size() - 4);
+        if (plainIn.status() != QDataStream::Ok || static_cast<quint64>(plainTotalLen) != actualPayloadLength) {
+            emit logMessage("⚠️ 警告: 同步数据包长度字段无效，已断开客户端。");
+            client->disconnectFromHost();
+            return;
+        }
+        QByteArray body = plaintext.mid(8);
+        plaintext.clear();
+        if (jsonLen & kCompressedFlag) {
+            jsonLen &= ~kCompressedFlag;
+            // qCompress 的前 4 字节是解压后的长度，先检查再解压
+            const quint32 declared = body.size() >= 4 ? qFromBigEndian<quint32>(body.constData()) : 0;
+            body = declared <= kMaxDecompressedBytes ? qUncompress(body) : QByteArray();
+            if (body.isEmpty()) {
+                emit logMessage("⚠️ 警告: 同步数据包解压失败，已断开客户端。");
+                client->disconnectFromHost();
+                return;
+            }
+        }
+        if (jsonLen > static_cast<quint32>(body.size())) {
+            emit logMessage("⚠️ 警告: 同步数据包长度字段无效，已断开客户端。");
+            client->disconnectFromHost();
+            return;
+        }
+
+        QByteArray jsonBytes = body.left(jsonLen);
+        const QByteArray payload = body.mid(jsonLen);
+        QJsonParseError jsonError;
+        const QJsonDocument jsonDocument = QJsonDocument::fromJson(jsonBytes, &jsonError);
+        if (jsonError.error != QJsonParseError::NoError || !jsonDocument.isObject()) {
+            emit logMessage("⚠️ 警告: 同步数据包 JSON 无效，已断开客户端。");
+            client->disconnectFromHost();
+            return;
+        }
+        QJsonObject json = jsonDocument.object();
+        QString cmd = json["cmd"].toString();
+
+        if (cmd == "AUTH") {
+            QString deviceId = json["deviceId"].toString();
+            QString deviceName = json["deviceName"].toString();
+            QString displayName = deviceName + " (" + deviceId + ")";
+
+            // === 1. 白名单拦截逻辑 ===
+            if (m_settings.whitelistEnabled && !m_settings.whitelist.contains(deviceId)) {
+                emit logMessage("🚫 拦截未授权设备: " + displayName);
+                // 交给界面加入待审核列表
+                emit pendingDevice(deviceId, displayName);
+                client->disconnectFromHost();
+                return;
+            }
+
+            // === 2. 认证成功逻辑 ===
+            const QJsonArray caps = json["caps"].toArray();
+            const bool chunked = caps.contains(kChunkedCapability);
+            const bool previews = chunked && caps.contains(kPreviewCapability);
+            const bool compression = caps.contains(kCompressionCapability);
+            const bool changes = caps.contains(kChangesCapability);
+            emit logMessage("✅ 设备认证成功: " + displayName + (chunked ? " [分块传输]" : "") + (previews ? " [预览优先]" : "")
+                            + (compression ? " [压缩]" : ""));
+            m_authenticatedClients.insert(client);
+            m_sendStates[client].chunked = chunked;
+            m_sendStates[client].previews = previews;
+            m_sendStates[client].compression = compression;
+            m_sendStates[client].changes = changes;
+
+            // 交给界面加入已连接列表
+            QString ip = client->peerAddress().toString().remove("::ffff:");
+            QString activeName = displayName + " [" + ip + "]";
+            emit clientAuthenticated(quintptr(client), activeName);
+
+            // 发送文件夹列表
+            QJsonArray folders;
+            for(const QString &path : m_rootPaths) folders.append(QFileInfo(path).fileName());
+            QJsonObject respJson; respJson["cmd"] = "FOLDER_LIST"; respJson["folders"] = folders;
+            respJson["caps"] = QJsonArray{kChunkedCapability, kContentManifestCapability, kPreviewCapability,
+                                          kCompressionCapability, kChangesCapability};
+            persistChangeSeq(m_changeSeq);
+            respJson["indexId"] = m_indexId;
+            respJson["seq"] = qint64(m_changeSeq);
+            sendPacket(client, respJson);
+        }
+        else if (cmd == "CLIENT_MANIFEST") {
+            if (!m_authenticatedClients.contains(client)) return;
+            processClientManifest(client, json, payload);
+        }
+        else if (cmd == "FETCH") {
+            if (!m_authenticatedClients.contains(client)) return;
+            fetchOriginals(client, json["paths"].toArray());
+        }
+    }
+}
+
+void SyncServer::handleClientDisconnected() {
+    QTcpSocket *client = qobject_cast<QTcpSocket*>(sender());
+    if (!client) return;
+
+    emit clientDisconnected(quintptr(client));
+    m_authenticatedClients.remove(client);
+    releaseClientTransfers(client);
+    clients.removeAll(client);
+    client->deleteLater();
+    emit logMessage("🔌 客户端已断开连接");
+}
+
+// ======================= 文件与目录管理 =======================
+QString SyncServer::findRootForPath(const QString &path) {
+    const QString normalizedPath = QDir::cleanPath(
+        QDir::fromNativeSeparators(QFileInfo(path).absoluteFilePath()));
+    QString bestMatch;
+#ifdef Q_OS_WIN
+    constexpr Qt::CaseSensitivity pathCaseSensitivity = Qt::CaseInsensitive;
+#else
+    constexpr Qt::CaseSensitivity pathCaseSensitivity = Qt::CaseSensitive;
+#endif
+    for (const QString &root : m_rootPaths) {
+        const QString normalizedRoot = QDir::cleanPath(
+            QDir::fromNativeSeparators(QFileInfo(root).absoluteFilePath()));
+        if (normalizedRoot.isEmpty()) continue;
+        const bool exactMatch = normalizedPath.compare(normalizedRoot, pathCaseSensitivity) == 0;
+        const bool childMatch = normalizedPath.startsWith(normalizedRoot + '/', pathCaseSensitivity);
+        if ((exactMatch || childMatch) && normalizedRoot.size() > bestMatch.size()) {
+            bestMatch = root;
+        }
+    }
+    return bestMatch;
+}
+QString SyncServer::getRelativePathWithRoot(const QString &fullPath, const QString &rootPath) {
+    QDir rootDir(rootPath);
+    QString rootFolderName = QFileInfo(rootPath).fileName();
+    return rootFolderName + "/" + rootDir.relativeFilePath(fullPath).replace("\\", "/");
+}
+bool SyncServer::isImage(const QString &fileName) {
+    static QStringList filters = {"*.png", "*.jpg", "*.jpeg", "*.webp"};
+    for (const QString &f : filters) if (QDir::match(f, fileName.toLower())) return true;
+    return false;
+}
+void SyncServer::sendFile(const QString &filePath, const QString &rootPath, SendPriority priority) {
+    sendFileToClients(QList<QTcpSocket*>(m_authenticatedClients.begin(), m_authenticatedClients.end()), filePath, rootPath, priority);
+}
+
+void SyncServer::sendFileToClients(const QList<QTcpSocket*> &targets, const QString &filePath, const QString &rootPath,
+                                   SendPriority priority, qint64 resumeOffset) {
+    const QString relativePath = getRelativePathWithRoot(filePath, rootPath);
+    const qint64 bytes = QFileInfo(filePath).size();
+    // 同一次调用里的分块客户端共用一条帧流，旧版客户端共用另一条（整包同样只加密一次）。
+    QSharedPointer<SealedStream> chunkedStream;
+    QSharedPointer<SealedStream> legacyStream;
+    QList<QTcpSocket*> queued;
+    for (QTcpSocket *client : targets) {
+        auto stateIt = m_sendStates.find(client);
+        if (stateIt == m_sendStates.end()) continue;
+        ClientSendState &state = stateIt.value();
+        QSharedPointer<SealedStream> &stream = state.chunked ? chunkedStream : legacyStream;
+        if (!stream) {
+            stream = QSharedPointer<SealedStream>::create();
+            stream->id = m_nextTransferId++;
+            stream->filePath = filePath;
+            stream->relativePath = relativePath;
+            stream->legacy = !state.chunked;
+            stream->startOffset = state.chunked ? resumeOffset : 0;
+        }
+        OutgoingTransfer transfer;
+        transfer.stream = stream;
+        transfer.bytes = bytes;
+        QQueue<OutgoingTransfer> &queue = priority == SendPriority::Live ? state.live
+                                        : priority == SendPriority::Backfill ? state.backfill : state.background;
+        queue.enqueue(transfer);
+        state.totalFiles++;
+        state.totalBytes += bytes;
+        queued << client;
+    }
+
+    // 空闲的客户端在生成第一帧之前全部就位，才能共享同一份密文。
+    for (QTcpSocket *client : queued) currentTransfer(m_sendStates[client]);
+    for (QTcpSocket *client : queued) pumpClientTransfers(client);
+}
+
+void SyncServer::onClientBytesWritten() {
+    if (QTcpSocket *client = qobject_cast<QTcpSocket*>(sender())) pumpClientTransfers(client);
+}
+
+SyncServer::OutgoingTransfer *SyncServer::currentTransfer(ClientSendState &state) {
+    for (QQueue<OutgoingTransfer> *queue : state.queues()) {
+        if (!queue->isEmpty() && queue->head().active) return &queue->head();
+    }
+    QQueue<OutgoingTransfer> *next = nullptr;
+    for (QQueue<OutgoingTransfer> *queue : state.queues()) {
+        if (!queue->isEmpty()) {
+            next = queue;
+            break;
+        }
+    }
+    if (!next) return nullptr;
+
+    OutgoingTransfer &transfer = next->head();
+    if (transfer.stream->producedFrames > 0) {
+        // 其他客户端已经先开始、早期帧不再保留：为这个客户端单独重新读盘加密。
+        const SealedStream &shared = *transfer.stream;
+        auto own = QSharedPointer<SealedStream>::create();
+        own->id = m_nextTransferId++;
+        own->filePath = shared.filePath;
+        own->relativePath = shared.relativePath;
+        own->legacy = shared.legacy;
+        own->preview = shared.preview;
+        own->startOffset = shared.startOffset;
+        transfer.stream = own;
+    }
+    transfer.stream->activeReaders++;
+    transfer.active = true;
+    return &transfer;
+}
+
+void SyncServer::finishCurrentTransfer(ClientSendState &state) {
+    for (QQueue<OutgoingTransfer> *queue : state.queues()) {
+        if (queue->isEmpty() || !queue->head().active) continue;
+        const OutgoingTransfer transfer = queue->dequeue();
+        transfer.stream->activeReaders--;
+        state.doneFiles++;
+        // 中止、续传跳过的部分也计入已完成，进度最终对齐到总量。
+        state.doneBytes += qMax<qint64>(0, transfer.bytes - transfer.sentBytes);
+        break;
+    }
+    if (state.live.isEmpty() && state.backfill.isEmpty() && state.background.isEmpty()) {
+        state.totalFiles = state.doneFiles = 0;
+        state.totalBytes = state.doneBytes = 0;
+    }
+}
+
+void SyncServer::produceNextFrame(const QSharedPointer<SealedStream> &streamPtr) {
+    SealedStream &stream = *streamPtr;
+    QByteArray wire;
+    qint64 payloadBytes = 0;
+
+    if (stream.preview) {
+        // 预览在线程池中生成，完成前不产生帧，调用方等待唤醒
+        if (!stream.previewReady) {
+            requestPreview(streamPtr);
+            return;
+        }
+        stream.complete = true;
+        if (stream.previewData.isEmpty()) return;
+        const QFileInfo info(stream.filePath);
+        QJsonObject json; json["cmd"] = "PREVIEW";
+        json["path"] = stream.relativePath;
+        json["size"] = info.size();
+        json["mtime"] = info.lastModified().toMSecsSinceEpoch();
+        json["format"] = QString::fromLatin1(m_previewFormat);
+        wire = sealPacket(json, stream.previewData);
+        stream.previewData.clear();
+        SealedFrame frame;
+        frame.wire = wire;
+        frame.remaining = stream.activeReaders;
+        stream.frames.insert(stream.producedFrames++, frame);
+        return;
+    }
+
+    QFile file(stream.filePath);
+    const bool opened = file.open(QIODevice::ReadOnly);
+
+    if (stream.legacy) {
+        stream.complete = true;
+        if (!opened) return;
+        const QByteArray data = file.readAll();
+        QJsonObject json; json["cmd"] = "SYNC";
+        json["path"] = stream.relativePath;
+        json["size"] = data.size();
+        wire = sealPacket(json, data);
+        payloadBytes = data.size();
+    } else if (stream.size < 0) {
+        if (!opened) {
+            // 还没发出 BEGIN，客户端无需知道这次传输。
+            stream.complete = true;
+            return;
+        }
+        stream.size = file.size();
+        stream.mtimeMs = QFileInfo(file).lastModified().toMSecsSinceEpoch();
+        if (stream.startOffset > stream.size) stream.startOffset = 0;
+        stream.readOffset = stream.startOffset;
+        stream.chunkSeq = quint32(stream.startOffset / kSyncChunkSize);
+        QJsonObject beginJson; beginJson["cmd"] = "SYNC_BEGIN";
+        beginJson["id"] = qint64(stream.id);
+        beginJson["path"] = stream.relativePath;
+        beginJson["size"] = stream.size;
+        beginJson["mtime"] = stream.mtimeMs;
+        beginJson["chunkSize"] = kSyncChunkSize;
+        if (stream.startOffset > 0) {
+            // 续传：客户端保留 offset 之前的内容，块序号从 seq 接着编。
+            beginJson["offset"] = stream.startOffset;
+            beginJson["seq"] = qint64(stream.chunkSeq);
+        }
+        const auto indexIt = m_fileIndex.constFind(stream.relativePath);
+        if (indexIt != m_fileIndex.constEnd() && !indexIt->hash.isEmpty()
+            && indexIt->size == stream.size && indexIt->mtimeMs == stream.mtimeMs) {
+            beginJson["hash"] = indexIt->hash;
+        }
+        wire = sealPacket(beginJson);
+    } else if (stream.readOffset < stream.size) {
+        const qint64 want = qMin(kSyncChunkSize, stream.size - stream.readOffset);
+        QByteArray chunk;
+        if (opened && file.seek(stream.readOffset)) chunk = file.read(want);
+        if (chunk.size() != want) {
+            // 文件在传输中被截断或删除：通知客户端丢弃已收到的部分。
+            QJsonObject abortJson; abortJson["cmd"] = "SYNC_ABORT"; abortJson["id"] = qint64(stream.id);
+            wire = sealPacket(abortJson);
+            stream.complete = true;
+        } else {
+            QJsonObject chunkJson; chunkJson["cmd"] = "SYNC_CHUNK";
+            chunkJson["id"] = qint64(stream.id);
+            chunkJson["seq"] = qint64(stream.chunkSeq);
+            wire = sealPacket(chunkJson, chunk);
+            if (stream.startOffset == 0) stream.hasher.addData(chunk);
+            payloadBytes = chunk.size();
+            stream.readOffset += chunk.size();
+            ++stream.chunkSeq;
+        }
+    } else {
+        QJsonObject endJson; endJson["cmd"] = "SYNC_END";
+        endJson["id"] = qint64(stream.id);
+        endJson["chunks"] = qint64(stream.chunkSeq);
+        // 从头发送时摘要是顺带算出的，写回索引，下次比对不必再读文件。
+        auto indexIt = m_fileIndex.find(stream.relativePath);
+        const bool indexMatches = indexIt != m_fileIndex.end()
+            && indexIt->size == stream.size && indexIt->mtimeMs == stream.mtimeMs;
+        QString hash;
+        if (stream.startOffset == 0) {
+            hash = QString::fromLatin1(stream.hasher.result().toHex());
+            if (indexMatches && indexIt->hash != hash) {
+                indexIt->hash = hash;
+                scheduleIndexSave();
+            }
+        } else if (indexMatches) {
+            hash = indexIt->hash;
+        }
+        if (!hash.isEmpty()) endJson["hash"] = hash;
+        wire = sealPacket(endJson);
+        stream.complete = true;
+    }
+
+    SealedFrame frame;
+    frame.wire = wire;
+    frame.remaining = stream.activeReaders;
+    frame.payloadBytes = payloadBytes;
+    stream.frames.insert(stream.producedFrames++, frame);
+}
+
+void SyncServer::pumpClientTransfers(QTcpSocket *client) {
+    auto stateIt = m_sendStates.find(client);
+    if (stateIt == m_sendStates.end() || client->state() != QAbstractSocket::ConnectedState) return;
+    ClientSendState &state = stateIt.value();
+    bool released = false;
+
+    // socket 写缓冲低于水位时才继续取帧：在途字节有上限，新文件不会排在几千个已写入缓冲的补发文件后面。
+    while (client->bytesToWrite() < kSendHighWaterBytes) {
+        OutgoingTransfer *transfer = currentTransfer(state);
+        if (!transfer) break;
+        SealedStream &stream = *transfer->stream;
+
+        if (transfer->nextFrame >= stream.producedFrames) {
+            if (!stream.complete) {
+                // 领先太多时等待同一流上落后的客户端写出、释放旧帧后再继续。
+                if (stream.frames.size() >= kMaxBufferedFrames) break;
+                if (stream.preview && !stream.previewRequested) {
+                    // 顺带预取同一队列后面几个预览，线程池并行生成
+                    int prefetched = 0;
+                    for (const OutgoingTransfer &queued : std::as_const(state.backfill)) {
+                        if (prefetched >= kPreviewPrefetch) break;
+                        if (!queued.stream->preview || queued.stream == transfer->stream) continue;
+                        requestPreview(queued.stream);
+                        ++prefetched;
+                    }
+                }
+                produceNextFrame(transfer->stream);
+                // 预览尚未生成：等线程池完成后再唤醒
+                if (transfer->nextFrame >= stream.producedFrames && !stream.complete) break;
+            }
+            if (transfer->nextFrame >= stream.producedFrames) {
+                finishCurrentTransfer(state);
+                continue;
+            }
+        }
+
+        auto frameIt = stream.frames.find(transfer->nextFrame);
+        client->write(frameIt->wire);
+        transfer->sentBytes += frameIt->payloadBytes;
+        state.doneBytes += frameIt->payloadBytes;
+        if (--frameIt->remaining <= 0) {
+            stream.frames.erase(frameIt);
+            released = true;
+        }
+        ++transfer->nextFrame;
+
+        if (stream.complete && transfer->nextFrame >= stream.producedFrames) finishCurrentTransfer(state);
+    }
+
+    if (released) scheduleFanoutWake();
+    scheduleProgressRefresh();
+
+    // 队列全部发完后告知客户端已同步到的序号，下次重连从这里开始增量
+    if (state.changes && state.manifestHandled && state.live.isEmpty() && state.backfill.isEmpty() && state.background.isEmpty()) {
+        const quint64 seq = clientSafeSeq();
+        if (seq != state.reportedSeq) {
+            state.reportedSeq = seq;
+            persistChangeSeq(seq);
+            QJsonObject json; json["cmd"] = "SYNC_SEQ";
+            json["indexId"] = m_indexId;
+            json["seq"] = qint64(seq);
+            sendPacket(client, json);
+        }
+    }
+}
+
+void SyncServer::releaseClientTransfers(QTcpSocket *client) {
+    auto stateIt = m_sendStates.find(client);
+    if (stateIt == m_sendStates.end()) return;
+    // 断开的客户端不再读取：把它未写出的帧计数减掉，否则同一流上的其他客户端会一直等它。
+    for (QQueue<OutgoingTransfer> *queue : stateIt->queues()) {
+        if (queue->isEmpty() || !queue->head().active) continue;
+        const OutgoingTransfer &transfer = queue->head();
+        SealedStream &stream = *transfer.stream;
+        for (quint32 frame = transfer.nextFrame; frame < stream.producedFrames; ++frame) {
+            auto frameIt = stream.frames.find(frame);
+            if (frameIt != stream.frames.end() && --frameIt->remaining <= 0) stream.frames.erase(frameIt);
+        }
+        stream.activeReaders--;
+    }
+    m_sendStates.erase(stateIt);
+    scheduleFanoutWake();
+}
+
+void SyncServer::scheduleFanoutWake() {
+    // 旧帧释放后，之前因窗口已满而停下的客户端要重新取帧；合并到下一轮事件循环，避免互相递归。
+    if (m_fanoutWakePending) return;
+    m_fanoutWakePending = true;
+    QTimer::singleShot(0, this, [this]() {
+        m_fanoutWakePending = false;
+        const QList<QTcpSocket*> targets = m_sendStates.keys();
+        for (QTcpSocket *client : targets) pumpClientTransfers(client);
+    });
+}
+
+void SyncServer::scheduleProgressRefresh() {
+    if (m_progressRefreshPending) return;
+    m_progressRefreshPending = true;
+    QTimer::singleShot(kProgressRefreshMs, this, [this]() {
+        m_progressRefreshPending = false;
+        for (auto it = m_sendStates.begin(); it != m_sendStates.end(); ++it) reportClientProgress(it.key(), it.value());
+    });
+}
+
+void SyncServer::reportClientProgress(QTcpSocket *client, ClientSendState &state) {
+    const int liveCount = state.live.size();
+    const int backfillCount = state.backfill.size();
+    const int backgroundCount = state.background.size();
+    QString text = "空闲";
+    QString toolTip;
+    if (liveCount + backfillCount + backgroundCount > 0) {
+        const QLocale locale;
+        text = QString("⬆ %1/%2 · %3 / %4")
+                   .arg(state.doneFiles).arg(state.totalFiles)
+                   .arg(locale.formattedDataSize(state.doneBytes), locale.formattedDataSize(state.totalBytes));
+        toolTip = QString("待发送：新文件 %1 个，补发 %2 个，后台原图 %3 个").arg(liveCount).arg(backfillCount).arg(backgroundCount);
+    }
+    if (text == state.reportedProgress) return;
+    state.reportedProgress = text;
+    emit clientProgress(quintptr(client), text, toolTip);
+}
+
+void SyncServer::sendDeleteNotification(const QString &relativePath) {
+    QJsonObject json; json["cmd"] = "DELETE"; json["path"] = relativePath;
+    broadcastPacket(json);
+}
+void SyncServer::sendFolderDeleteNotification(const QString &relativePath) {
+    QJsonObject json; json["cmd"] = "DELETE_FOLDER"; json["path"] = relativePath;
+    broadcastPacket(json);
+}
+
+void SyncServer::processClientManifest(QTcpSocket* client, const QJsonObject& json, const QByteArray& payload) {
+    // files: {path: size}（旧版）或 {path: {size, mtime, hash}}，mtime / hash 为之前收到的服务端值。
+    // partial: {path: {size, mtime, received}}，描述客户端未完成的传输。
+    // encoding: "bin1" 时两者都以二进制形式放在数据段中。
+    // mode: "preview" 时缺失的文件只发预览；fullInBackground 为 true 时原图排到最后补齐。
+    // since / indexId: 客户端上次收到的 SYNC_SEQ，仍然有效时只回放变更日志。
+    if (json.contains("since") && sendChangesSince(client, json)) return;
+    QJsonObject filesObj = json["files"].toObject();
+    QJsonObject partialObj = json["partial"].toObject();
+    if (json["encoding"].toString() == "bin1" && !decodeBinaryManifest(payload, filesObj, partialObj)) {
+        emit logMessage("⚠️ 警告: 二进制 Manifest 格式无效，已忽略。");
+        return;
+    }
+    const ClientSendState clientState = m_sendStates.value(client);
+    const bool chunked = clientState.chunked;
+    const bool previewMode = clientState.previews && json["mode"].toString() == "preview";
+    const bool fullInBackground = previewMode && json["fullInBackground"].toBool();
+    emit logMessage(QString("[Sync] 收到客户端 Manifest，文件数: %1").arg(filesObj.size()));
+    int sentCount = 0;
+    int resumedCount = 0;
+    for (auto it = m_fileIndex.begin(); it != m_fileIndex.end(); ++it) {
+        SyncIndexEntry &entry = it.value();
+        // 仍在写入的文件稳定后会作为新文件推送
+        if (m_pendingFiles.contains(entry.fullPath)) continue;
+        const QJsonValue reported = filesObj.value(it.key());
+        if (!reported.isUndefined() && !manifestEntryDiffers(entry, reported)) continue;
+
+        qint64 resumeOffset = 0;
+        const QJsonObject partial = partialObj.value(it.key()).toObject();
+        if (chunked && !partial.isEmpty()
+            && partial.value("size").toInteger(-1) == entry.size
+            && partial.value("mtime").toInteger() == entry.mtimeMs) {
+            // 只信任完整的块，最后一个可能写了一半的块重新发送。
+            resumeOffset = qBound<qint64>(0, partial.value("received").toInteger(), entry.size) / kSyncChunkSize * kSyncChunkSize;
+        }
+        if (previewMode && resumeOffset == 0) {
+            sendPreviewToClient(client, entry);
+            if (fullInBackground) sendFileToClients({client}, entry.fullPath, entry.rootPath, SendPriority::Background);
+        } else {
+            sendFileToClients({client}, entry.fullPath, entry.rootPath, SendPriority::Backfill, resumeOffset);
+        }
+        sentCount++;
+        if (resumeOffset > 0) resumedCount++;
+    }
+    emit logMessage(QString("[Sync] 差异比对完成，共发送 %1 个更新文件（其中续传 %2 个）%3。")
+                        .arg(sentCount).arg(resumedCount).arg(previewMode ? "，预览优先" : ""));
+    // 全部排队后才允许发 SYNC_SEQ；没有需要发送的文件时也要让客户端拿到当前序号
+    if (m_sendStates.contains(client)) m_sendStates[client].manifestHandled = true;
+    pumpClientTransfers(client);
+}
+
+bool SyncServer::sendChangesSince(QTcpSocket *client, const QJsonObject &json) {
+    const quint64 since = quint64(json["since"].toInteger(-1));
+    if (json["indexId"].toString() != m_indexId || since < m_compactedSeq || since > m_changeSeq) {
+        emit logMessage("[Sync] 客户端的变更序号已失效，改为完整比对。");
+        return false;
+    }
+    int sentCount = 0;
+    int deletedCount = 0;
+    for (auto it = m_changeLog.upperBound(since); it != m_changeLog.end(); ++it) {
+        const auto indexIt = m_fileIndex.constFind(it.value());
+        if (indexIt != m_fileIndex.constEnd() && indexIt->seq == it.key()) {
+            if (m_pendingFiles.contains(indexIt->fullPath)) continue;
+            sendFileToClients({client}, indexIt->fullPath, indexIt->rootPath, SendPriority::Backfill);
+            sentCount++;
+        } else if (m_deletedPaths.value(it.value()) == it.key()) {
+            QJsonObject deleteJson; deleteJson["cmd"] = "DELETE"; deleteJson["path"] = it.value();
+            sendPacket(client, deleteJson);
+            deletedCount++;
+        }
+    }
+    emit logMessage(QString("[Sync] 增量同步：自序号 %1 起发送 %2 个更新文件、%3 个删除。")
+                        .arg(since).arg(sentCount).arg(deletedCount));
+    if (m_sendStates.contains(client)) m_sendStates[client].manifestHandled = true;
+    pumpClientTransfers(client);
+    return true;
+}
+
+void SyncServer::sendPreviewToClient(QTcpSocket *client, const SyncIndexEntry &entry) {
+    auto stateIt = m_sendStates.find(client);
+    if (stateIt == m_sendStates.end()) return;
+    auto stream = QSharedPointer<SealedStream>::create();
+    stream->id = m_nextTransferId++;
+    stream->filePath = entry.fullPath;
+    stream->relativePath = getRelativePathWithRoot(entry.fullPath, entry.rootPath);
+    stream->preview = true;
+    OutgoingTransfer transfer;
+    transfer.stream = stream;
+    stateIt->backfill.enqueue(transfer);
+    stateIt->totalFiles++;
+    pumpClientTransfers(client);
+}
+
+void SyncServer::requestPreview(const QSharedPointer<SealedStream> &stream) {
+    if (stream->previewRequested) return;
+    stream->previewRequested = true;
+    const QFileInfo info(stream->filePath);
+    const QByteArray key = QString("%1|%2|%3").arg(stream->filePath).arg(info.size())
+                               .arg(info.lastModified().toMSecsSinceEpoch()).toUtf8();
+    const QString cachePath = m_previewCacheDir + "/"
+        + QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex())
+        + "." + QString::fromLatin1(m_previewFormat);
+    const QString filePath = stream->filePath;
+    const QByteArray format = m_previewFormat;
+    const QWeakPointer<SealedStream> weak = stream;
+    if (++m_previewsSincePrune >= kPreviewPruneInterval) {
+        m_previewsSincePrune = 0;
+        m_previewPool.start([cacheDir = m_previewCacheDir]() { prunePreviewCache(cacheDir); });
+    }
+    m_previewPool.start([this, weak, filePath, cachePath, format]() {
+        const QByteArray data = loadOrBuildPreview(filePath, cachePath, format);
+        QMetaObject::invokeMethod(this, [this, weak, data]() {
+            const QSharedPointer<SealedStream> target = weak.toStrongRef();
+            if (!target) return;
+            target->previewData = data;
+            target->previewReady = true;
+            scheduleFanoutWake();
+        });
+    });
+}
+
+void SyncServer::fetchOriginals(QTcpSocket *client, const QJsonArray &paths) {
+    auto stateIt = m_sendStates.find(client);
+    if (stateIt == m_sendStates.end()) return;
+    for (const QJsonValue &value : paths) {
+        const QString relativePath = value.toString();
+        const auto indexIt = m_fileIndex.constFind(relativePath);
+        if (indexIt == m_fileIndex.constEnd()) continue;
+        // 已排在后台的同一原图改为立即发送，避免重复
+        QQueue<OutgoingTransfer> &background = stateIt->background;
+        for (auto it = background.begin(); it != background.end();) {
+            if (!it->active && it->stream->relativePath == relativePath) {
+                stateIt->totalFiles--;
+                stateIt->totalBytes -= it->bytes;
+                it = background.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        sendFileToClients({client}, indexIt->fullPath, indexIt->rootPath, SendPriority::Live);
+    }
+}
+
+bool SyncServer::manifestEntryDiffers(SyncIndexEntry &entry, const QJsonValue &reported) {
+    if (!reported.isObject()) return reported.toVariant().toLongLong() != entry.size;
+    const QJsonObject obj = reported.toObject();
+    if (obj.value("size").toInteger(-1) != entry.size) return true;
+    if (obj.value("mtime").toInteger() == entry.mtimeMs) return false;
+    // mtime 不同但大小相同（例如被重新保存）：有摘要时按内容判断，避免重传相同的文件。
+    const QString hash = obj.value("hash").toString();
+    if (hash.isEmpty()) return true;
+    return hash.compare(indexedHash(entry), Qt::CaseInsensitive) != 0;
+}
+
+QString SyncServer::indexedHash(SyncIndexEntry &entry) {
+    if (!entry.hash.isEmpty()) return entry.hash;
+    QFile file(entry.fullPath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() != entry.size) return QString();
+    QCryptographicHash hasher(QCryptographicHash::Blake2b_256);
+    if (!hasher.addData(&file)) return QString();
+    entry.hash = QString::fromLatin1(hasher.result().toHex());
+    scheduleIndexSave();
+    return entry.hash;
+}
+
+void SyncServer::refreshDirIndex(const QString &rootPath, const QString &dirPath, const QFileInfoList &entries) {
+    QSet<QString> &keys = m_dirIndexKeys[dirPath];
+    QSet<QString> present;
+    for (const QFileInfo &info : entries) {
+        if (!info.isFile() || !isImage(info.fileName())) continue;
+        const QString relativePath = getRelativePathWithRoot(info.absoluteFilePath(), rootPath);
+        const qint64 mtimeMs = info.lastModified().toMSecsSinceEpoch();
+        SyncIndexEntry &entry = m_fileIndex[relativePath];
+        entry.fullPath = info.absoluteFilePath();
+        entry.rootPath = rootPath;
+        if (entry.size != info.size() || entry.mtimeMs != mtimeMs) {
+            entry.hash.clear();
+            entry.size = info.size();
+            entry.mtimeMs = mtimeMs;
+            touchIndexEntry(relativePath, entry);
+        }
+        if (!m_unverifiedKeys.isEmpty()) m_unverifiedKeys.remove(relativePath);
+        present.insert(relativePath);
+    }
+    for (const QString &key : std::as_const(keys)) {
+        if (!present.contains(key)) recordDeletion(key, m_fileIndex.take(key).seq);
+    }
+    keys = present;
+}
+
+void SyncServer::touchIndexEntry(const QString &key, SyncIndexEntry &entry) {
+    if (entry.seq > 0) m_changeLog.remove(entry.seq);
+    entry.seq = ++m_changeSeq;
+    m_changeLog.insert(entry.seq, key);
+    if (const quint64 deletedSeq = m_deletedPaths.take(key)) m_deletionLog.remove(deletedSeq);
+    scheduleIndexSave();
+}
+
+void SyncServer::recordDeletion(const QString &key, quint64 entrySeq) {
+    // 被删除前的新增 / 修改记录已经没有意义，只保留删除
+    if (entrySeq > 0) m_changeLog.remove(entrySeq);
+    const quint64 seq = ++m_changeSeq;
+    const quint64 previous = m_deletedPaths.value(key);
+    if (previous > 0) {
+        m_changeLog.remove(previous);
+        m_deletionLog.remove(previous);
+    }
+    // 删除记录超出上限时丢弃最早的，更早的序号从此只能完整比对
+    while (m_deletionLog.size() >= kMaxDeletionRecords) {
+        const auto oldest = m_deletionLog.begin();
+        m_deletedPaths.remove(oldest.value());
+        m_changeLog.remove(oldest.key());
+        m_compactedSeq = oldest.key();
+        m_deletionLog.erase(oldest);
+    }
+    m_deletedPaths.insert(key, seq);
+    m_deletionLog.insert(seq, key);
+    m_changeLog.insert(seq, key);
+    scheduleIndexSave();
+}
+
+quint64 SyncServer::clientSafeSeq() {
+    // 仍在写入的文件还没有推送，序号不能越过它们
+    // 迟迟不稳定的文件不再计入，否则所有客户端的序号都会停住
+    quint64 seq = m_changeSeq;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = m_pendingFiles.cbegin(); it != m_pendingFiles.cend(); ++it) {
+        if (now - it->firstSeenMs > kPendingSeqHoldMs) continue;
+        const auto indexIt = m_fileIndex.constFind(getRelativePathWithRoot(it.key(), it->rootPath));
+        if (indexIt != m_fileIndex.constEnd() && indexIt->seq > 0) seq = qMin(seq, indexIt->seq - 1);
+    }
+    return seq;
+}
+
+void SyncServer::scheduleIndexSave() {
+    if (m_indexSaveTimer && !m_indexSaveTimer->isActive()) m_indexSaveTimer->start();
+}
+
+// 发给客户端的序号必须先落盘：否则崩溃后以同一 indexId 重新分配这些序号，
+// 客户端带着它们重连时会跳过新的变化。
+void SyncServer::persistChangeSeq(quint64 seq) {
+    if (seq <= m_savedChangeSeq) return;
+    if (m_indexSaveTimer) m_indexSaveTimer->stop();
+    saveSyncIndex();
+}
+
+// 索引文件：{"version", "indexId", "seq", "compactedSeq",
+//            "roots": {根目录: {相对路径: [size, mtime, hash, seq]}}, "deleted": {相对路径: seq}}
+void SyncServer::loadSyncIndex() {
+    QFile file(m_stateDir + "/sync_index.json");
+    const QJsonObject root = file.open(QIODevice::ReadOnly) ? QJsonDocument::fromJson(file.readAll()).object() : QJsonObject();
+    if (root.value("version").toInt() != 1 || root.value("indexId").toString().isEmpty()) {
+        m_indexId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+        return;
+    }
+    m_indexId = root.value("indexId").toString();
+    m_changeSeq = quint64(root.value("seq").toInteger());
+    m_savedChangeSeq = m_changeSeq;
+    m_compactedSeq = quint64(root.value("compactedSeq").toInteger());
+    const QJsonObject roots = root.value("roots").toObject();
+    for (auto rootIt = roots.begin(); rootIt != roots.end(); ++rootIt) {
+        QHash<QString, SyncIndexEntry> &entries = m_persistedRoots[rootIt.key()];
+        const QJsonObject files = rootIt.value().toObject();
+        const QDir rootDir(rootIt.key());
+        const QString rootName = QFileInfo(rootIt.key()).fileName();
+        for (auto it = files.begin(); it != files.end(); ++it) {
+            const QJsonArray values = it.value().toArray();
+            if (values.size() < 4 || !it.key().startsWith(rootName + "/")) continue;
+            SyncIndexEntry entry;
+            entry.fullPath = rootDir.absoluteFilePath(it.key().mid(rootName.size() + 1));
+            entry.rootPath = rootIt.key();
+            entry.size = values.at(0).toInteger(-1);
+            entry.mtimeMs = values.at(1).toInteger();
+            entry.hash = values.at(2).toString();
+            entry.seq = quint64(values.at(3).toInteger());
+            entries.insert(it.key(), entry);
+        }
+    }
+    const QJsonObject deleted = root.value("deleted").toObject();
+    for (auto it = deleted.begin(); it != deleted.end(); ++it) {
+        const quint64 seq = quint64(it.value().toInteger());
+        m_deletedPaths.insert(it.key(), seq);
+        m_deletionLog.insert(seq, it.key());
+        m_changeLog.insert(seq, it.key());
+    }
+}
+
+void SyncServer::saveSyncIndex() {
+    QJsonObject roots;
+    for (const QString &rootPath : std::as_const(m_rootPaths)) roots.insert(rootPath, QJsonObject());
+    QHash<QString, QJsonObject> files;
+    const auto appendEntry = [&files](const QString &key, const SyncIndexEntry &entry) {
+        files[entry.rootPath].insert(key, QJsonArray{entry.size, entry.mtimeMs, entry.hash, qint64(entry.seq)});
+    };
+    for (auto it = m_fileIndex.cbegin(); it != m_fileIndex.cend(); ++it) appendEntry(it.key(), it.value());
+    // 本次还没有添加的根目录原样保留
+    for (auto rootIt = m_persistedRoots.cbegin(); rootIt != m_persistedRoots.cend(); ++rootIt) {
+        for (auto it = rootIt->cbegin(); it != rootIt->cend(); ++it) appendEntry(it.key(), it.value());
+    }
+    for (auto it = files.cbegin(); it != files.cend(); ++it) roots.insert(it.key(), it.value());
+    QJsonObject deleted;
+    for (auto it = m_deletedPaths.cbegin(); it != m_deletedPaths.cend(); ++it) deleted.insert(it.key(), qint64(it.value()));
+
+    QJsonObject root;
+    root["version"] = 1;
+    root["indexId"] = m_indexId;
+    root["seq"] = qint64(m_changeSeq);
+    root["compactedSeq"] = qint64(m_compactedSeq);
+    root["roots"] = roots;
+    root["deleted"] = deleted;
+
+    QDir().mkpath(m_stateDir);
+    QSaveFile file(m_stateDir + "/sync_index.json");
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        emit logMessage("⚠️ 同步索引保存失败: " + file.errorString());
+        return;
+    }
+    m_savedChangeSeq = m_changeSeq;
+}
+
+void SyncServer::dropDirIndex(const QString &dirPath, bool recordDeletions) {
+    const QString prefix = dirPath + "/";
+    for (auto it = m_dirIndexKeys.begin(); it != m_dirIndexKeys.end();) {
+        if (it.key() == dirPath || it.key().startsWith(prefix)) {
+            for (const QString &key : std::as_const(it.value())) {
+                const quint64 seq = m_fileIndex.take(key).seq;
+                // 移除同步根目录不等于删除文件，客户端不应据此删除本地副本
+                if (recordDeletions) recordDeletion(key, seq);
+                else m_changeLog.remove(seq);
+            }
+            it = m_dirIndexKeys.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SyncServer::addPathRecursive(const QString &rootPath, const QString &path) {
+    if (!m_watchedPathsMap.contains(rootPath)) m_watchedPathsMap[rootPath] = QSet<QString>();
+    QDirIterator it(path, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    if(!m_watchedPathsMap[rootPath].contains(path)) {
+        if (watcher->addPath(path)) {
+            m_watchedPathsMap[rootPath].insert(path);
+            updateDirState(path);
+        } else {
+            emit logMessage("⚠️ 无法监控目录: " + path);
+        }
+    }
+    while (it.hasNext()) {
+        QString subDir = it.next();
+        if(!m_watchedPathsMap[rootPath].contains(subDir)) {
+            if (watcher->addPath(subDir)) {
+                m_watchedPathsMap[rootPath].insert(subDir);
+                updateDirState(subDir);
+            } else {
+                emit logMessage("⚠️ 无法监控目录: " + subDir);
+            }
+        }
+    }
+}
+void SyncServer::removePathRecursive(const QString &rootPath) {
+    if (!m_watchedPathsMap.contains(rootPath)) return;
+    for (const QString &path : m_watchedPathsMap[rootPath]) watcher->removePath(path);
+    m_watchedPathsMap.remove(rootPath);
+}
+void SyncServer::updateDirState(const QString &dirPath) {
+    // 一次带属性的列目录同时得到文件快照、子目录和索引所需的信息。
+    const QFileInfoList entries = QDir(dirPath).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+    QHash<QString, FileSnapshot> files;
+    QSet<QString> subdirs;
+    for (const QFileInfo &info : entries) {
+        if (info.isDir()) {
+            subdirs.insert(info.fileName());
+        } else {
+            files.insert(info.fileName(), FileSnapshot{info.size(), info.lastModified().toMSecsSinceEpoch()});
+        }
+    }
+    m_dirFileState[dirPath] = files;
+    m_dirSubdirState[dirPath] = subdirs;
+
+    const QString rootPath = findRootForPath(dirPath);
+    if (!rootPath.isEmpty()) refreshDirIndex(rootPath, dirPath, entries);
+}
+void SyncServer::handleDirectoryChange(const QString &path) {
+    // WebUI 保存一张图会连续触发多次 directoryChanged：先记下目录，窗口结束后每个目录只扫描一次。
+    m_pendingDirChanges.insert(path);
+    if (!m_dirChangeTimer->isActive()) m_dirChangeTimer->start();
+}
+void SyncServer::processPendingDirChanges() {
+    const QSet<QString> paths = std::exchange(m_pendingDirChanges, {});
+    for (const QString &path : paths) scanChangedDirectory(path);
+    if (!m_pendingFiles.isEmpty() && !m_stabilityTimer->isActive()) m_stabilityTimer->start();
+}
+void SyncServer::scanChangedDirectory(const QString &path) {
+    QString rootPath = findRootForPath(path);
+    if (rootPath.isEmpty()) return;
+    if (!m_dirFileState.contains(path)) {
+        updateDirState(path);
+        return;
+    }
+    // 目录本身被删除时由父目录的变化事件处理
+    if (!QFileInfo::exists(path)) return;
+
+    const QHash<QString, FileSnapshot> oldFiles = m_dirFileState.value(path);
+    const QSet<QString> oldSubdirSet = m_dirSubdirState.value(path);
+    updateDirState(path);
+    const QHash<QString, FileSnapshot> &currentFiles = m_dirFileState[path];
+    const QSet<QString> currentSubdirSet = m_dirSubdirState.value(path);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    // 处理文件：新增或大小 / 修改时间变化的文件先进入待稳定列表，不立即发送半截文件
+    for (auto it = currentFiles.cbegin(); it != currentFiles.cend(); ++it) {
+        if (!isImage(it.key())) continue;
+        const auto oldIt = oldFiles.constFind(it.key());
+        if (oldIt != oldFiles.cend() && oldIt.value() == it.value()) continue;
+        PendingFile &pending = m_pendingFiles[path + "/" + it.key()];
+        pending.rootPath = rootPath;
+        pending.snapshot = it.value();
+        pending.stableSinceMs = now;
+        if (pending.firstSeenMs == 0) pending.firstSeenMs = now;
+    }
+    for (auto it = oldFiles.cbegin(); it != oldFiles.cend(); ++it) {
+        if (currentFiles.contains(it.key()) || !isImage(it.key())) continue;
+        const QString fullPath = path + "/" + it.key();
+        m_pendingFiles.remove(fullPath);
+        sendDeleteNotification(getRelativePathWithRoot(fullPath, rootPath));
+    }
+
+    // 处理文件夹
+    const QSet<QString> addedSubdirs = currentSubdirSet - oldSubdirSet;
+    for (const QString &subdirName : addedSubdirs) {
+        QString fullPath = path + "/" + subdirName;
+        if (m_watchedPathsMap[rootPath].contains(fullPath)) continue;
+        addPathRecursive(rootPath, fullPath);
+        // 新目录里已有的图片（例如按日期新建的输出目录）同样等稳定后推送
+        const QString prefix = fullPath + "/";
+        for (auto dirIt = m_dirFileState.cbegin(); dirIt != m_dirFileState.cend(); ++dirIt) {
+            if (dirIt.key() != fullPath && !dirIt.key().startsWith(prefix)) continue;
+            for (auto fileIt = dirIt->cbegin(); fileIt != dirIt->cend(); ++fileIt) {
+                if (!isImage(fileIt.key())) continue;
+                PendingFile &pending = m_pendingFiles[dirIt.key() + "/" + fileIt.key()];
+                pending.rootPath = rootPath;
+                pending.snapshot = fileIt.value();
+                pending.stableSinceMs = now;
+                if (pending.firstSeenMs == 0) pending.firstSeenMs = now;
+            }
+        }
+    }
+    const QSet<QString> deletedSubdirs = oldSubdirSet - currentSubdirSet;
+    for (const QString &subdirName : deletedSubdirs) {
+        const QString fullPath = path + "/" + subdirName;
+        dropDirIndex(fullPath);
+        dropPendingFiles(fullPath);
+        // 忘掉已删除目录的快照与监控记录，同名目录重建后能重新加入监控
+        const QString prefix = fullPath + "/";
+        QSet<QString> &watched = m_watchedPathsMap[rootPath];
+        for (auto watchedIt = watched.begin(); watchedIt != watched.end();) {
+            if (*watchedIt == fullPath || watchedIt->startsWith(prefix)) {
+                m_dirFileState.remove(*watchedIt);
+                m_dirSubdirState.remove(*watchedIt);
+                watchedIt = watched.erase(watchedIt);
+            } else {
+                ++watchedIt;
+            }
+        }
+        sendFolderDeleteNotification(getRelativePathWithRoot(fullPath, rootPath));
+    }
+}
+void SyncServer::dropPendingFiles(const QString &pathPrefix) {
+    const QString prefix = pathPrefix + "/";
+    for (auto it = m_pendingFiles.begin(); it != m_pendingFiles.end();) {
+        if (it.key().startsWith(prefix)) it = m_pendingFiles.erase(it);
+        else ++it;
+    }
+}
+void SyncServer::checkPendingFileStability() {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QList<QPair<QString, PendingFile>> ready;
+    for (auto it = m_pendingFiles.begin(); it != m_pendingFiles.end();) {
+        const QFileInfo info(it.key());
+        if (!info.exists()) {
+            it = m_pendingFiles.erase(it);
+            continue;
+        }
+        const FileSnapshot snapshot{info.size(), info.lastModified().toMSecsSinceEpoch()};
+        if (snapshot != it->snapshot) {
+            // 仍在写入：重新计时
+            it->snapshot = snapshot;
+            it->stableSinceMs = now;
+            ++it;
+            continue;
+        }
+        if (snapshot.size <= 0) {
+            // 空文件不推送；长时间仍为空就移出列表，计时器才能停下
+            if (now - it->stableSinceMs >= kEmptyFileTimeoutMs) it = m_pendingFiles.erase(it);
+            else ++it;
+            continue;
+        }
+        if (now - it->stableSinceMs < kFileStableMs) {
+            ++it;
+            continue;
+        }
+        ready.append(qMakePair(it.key(), it.value()));
+        it = m_pendingFiles.erase(it);
+    }
+    for (const auto &file : std::as_const(ready)) {
+        // 索引以稳定后的属性为准，随后的 SYNC_END 才能把摘要写回
+        auto indexIt = m_fileIndex.find(getRelativePathWithRoot(file.first, file.second.rootPath));
+        if (indexIt != m_fileIndex.end()) {
+            if (indexIt->size != file.second.snapshot.size || indexIt->mtimeMs != file.second.snapshot.mtimeMs) {
+                indexIt->size = file.second.snapshot.size;
+                indexIt->mtimeMs = file.second.snapshot.mtimeMs;
+                indexIt->hash.clear();
+            }
+            // 推送时重新取序号，客户端的 SYNC_SEQ 在此之前不会越过它
+            touchIndexEntry(indexIt.key(), indexIt.value());
+        }
+        sendFile(file.first, file.second.rootPath);
+    }
+    if (m_pendingFiles.isEmpty()) m_stabilityTimer->stop();
+}
@@ -0,0 +1,253 @@
+#ifndef SYNCSERVER_H
+#define SYNCSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUdpSocket>
+#include <QFileSystemWatcher>
+#include <QMap>
+#include <QHash>
+#include <QQueue>
+#include <QSet>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QSharedPointer>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QThreadPool>
+#include <array>
+
+class QTimer;
+
+// 同步服务本体：TCP 服务、UDP 发现、目录监控、加解密和读盘都在专用线程里运行。
+// SyncWidget 只负责界面，通过排队调用下发操作和设置快照，通过信号接收日志与客户端状态。
+// 本类的所有成员只在所属线程中访问。
+class SyncServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 界面设置的快照，每次修改后整体下发，服务线程不再读取任何控件。
+    struct Settings {
+        QByteArray aesKey;
+        bool whitelistEnabled = false;
+        QSet<QString> whitelist;
+    };
+
+    explicit SyncServer(QObject *parent = nullptr);
+    ~SyncServer() override;
+
+    // 索引文件和预览缓存的存放目录，须在 initialize() 之前设置；默认为程序目录下的 config 和系统缓存目录。
+    void setStateDirectory(const QString &dir);
+
+    // 以下方法须在服务线程中调用（QMetaObject::invokeMethod）。
+    void initialize();
+    void shutdown();   // 析构前必须调用；重复调用无副作用
+    void applySettings(const SyncServer::Settings &settings);
+    void start(quint16 port);
+    void stop();
+    void addRoot(const QString &rootPath, bool sendExisting);
+    void removeRoot(const QString &rootPath);
+    void kickClient(quintptr clientId);
+
+signals:
+    void logMessage(const QString &msg);
+    void listeningChanged(bool listening);
+    void startFailed(quint16 port);
+    void pendingDevice(const QString &deviceId, const QString &displayName);
+    void clientAuthenticated(quintptr clientId, const QString &displayName);
+    void clientDisconnected(quintptr clientId);
+    void clientProgress(quintptr clientId, const QString &text, const QString &toolTip);
+
+private slots:
+    void newClientConnected();
+    void onClientReadyRead();
+    void onDiscoveryReadyRead();
+    void onClientBytesWritten();
+    void handleClientDisconnected();
+    void handleDirectoryChange(const QString &path);
+    void processPendingDirChanges();
+    void checkPendingFileStability();
+
+private:
+    struct SealedFrame {
+        QByteArray wire;
+        int remaining = 0;         // 尚未写出的客户端数
+        qint64 payloadBytes = 0;   // 帧内文件数据的字节数，用于进度
+    };
+
+    // 一个文件的帧流：按偏移从磁盘读取，每帧只加密一次，所有正在读它的客户端写出同一份密文。
+    // 帧在最后一个客户端写出后释放；最快的客户端领先太多时等待，内存占用与文件大小无关。
+    struct SealedStream {
+        quint32 id = 0;
+        QString filePath;
+        QString relativePath;
+        bool legacy = false;       // 旧版客户端：整个文件封装成一个 SYNC 帧
+        bool preview = false;      // 预览帧：缩略图封装成一个 PREVIEW 帧，在线程池里生成
+        bool previewRequested = false;
+        bool previewReady = false;
+        QByteArray previewData;    // 生成失败时为空，此时不发送任何帧
+        qint64 size = -1;          // 生成 SYNC_BEGIN 时确定，之后文件变化则中止
+        qint64 mtimeMs = 0;
+        qint64 startOffset = 0;    // 断点续传时从客户端已有的整块之后开始
+        qint64 readOffset = 0;
+        quint32 chunkSeq = 0;
+        QCryptographicHash hasher{QCryptographicHash::Blake2b_256};   // 从头发送时顺带算出内容摘要
+        quint32 producedFrames = 0;
+        bool complete = false;     // 已生成 END / ABORT 帧，或文件无法打开
+        int activeReaders = 0;     // 正在读取本流的客户端数，新帧按这个数计引用
+        QMap<quint32, SealedFrame> frames;
+    };
+
+    struct OutgoingTransfer {
+        QSharedPointer<SealedStream> stream;
+        quint32 nextFrame = 0;
+        bool active = false;       // 已开始发送；每个客户端同一时刻只有一个
+        qint64 bytes = 0;          // 入队时的文件大小
+        qint64 sentBytes = 0;
+    };
+
+    enum class SendPriority { Live, Backfill, Background };
+
+    // 服务端文件索引：目录变化时增量维护，Manifest 比对只查这里，不再遍历磁盘。
+    struct SyncIndexEntry {
+        QString fullPath;
+        QString rootPath;
+        qint64 size = -1;
+        qint64 mtimeMs = 0;
+        QString hash;              // 内容摘要（hex），size / mtime 变化后清空，按需重新计算
+        quint64 seq = 0;           // 最近一次新增或修改时的变更序号
+    };
+
+    // 目录快照中的一个文件；比较这两项即可判断新增 / 修改，无需重新读取内容。
+    struct FileSnapshot {
+        qint64 size = -1;
+        qint64 mtimeMs = 0;
+        bool operator==(const FileSnapshot &other) const { return size == other.size && mtimeMs == other.mtimeMs; }
+        bool operator!=(const FileSnapshot &other) const { return !(*this == other); }
+    };
+
+    // 新出现或被修改、还可能在写入中的文件；大小和修改时间稳定一段时间后才发送。
+    struct PendingFile {
+        QString rootPath;
+        FileSnapshot snapshot;
+        qint64 stableSinceMs = 0;
+        qint64 firstSeenMs = 0;    // 进入待稳定列表的时间，超过上限后不再阻挡 SYNC_SEQ
+    };
+
+    // 每个客户端的发送队列：监控到的新文件排在补发之前，正在发送的文件总是先发完。
+    struct ClientSendState {
+        bool chunked = false;      // 客户端在 AUTH 中声明支持分块协议
+        bool previews = false;     // 客户端支持预览优先模式
+        bool compression = false;  // 客户端能解压 jsonLen 带压缩标志的包
+        bool changes = false;      // 客户端记录变更序号，重连时只请求增量
+        bool manifestHandled = false;   // 收到 Manifest 之前不发 SYNC_SEQ，否则客户端会跳过补发
+        quint64 reportedSeq = 0;   // 上次通过 SYNC_SEQ 告知客户端的序号
+        QQueue<OutgoingTransfer> live;
+        QQueue<OutgoingTransfer> backfill;
+        QQueue<OutgoingTransfer> background;   // 预览模式下在后台补齐的原图
+        std::array<QQueue<OutgoingTransfer>*, 3> queues() { return {&live, &backfill, &background}; }   // 按优先级
+        // 本轮进度，队列清空后归零
+        int totalFiles = 0;
+        int doneFiles = 0;
+        qint64 totalBytes = 0;
+        qint64 doneBytes = 0;
+        QString reportedProgress;  // 上次发给界面的文本，没变化就不再发
+    };
+
+    // 网络与文件监听（在服务线程中创建）
+    QTcpServer *tcpServer = nullptr;
+    QUdpSocket *udpDiscoverySocket = nullptr;
+    QFileSystemWatcher *watcher = nullptr;
+    QTimer *m_dirChangeTimer = nullptr;     // 合并短时间内的目录变化事件
+    QTimer *m_stabilityTimer = nullptr;     // 轮询待稳定文件
+    QList<QTcpSocket*> clients;
+    QMap<QTcpSocket*, quint32> m_clientExpectedSizes;
+    QSet<QTcpSocket*> m_authenticatedClients;
+    QHash<QTcpSocket*, ClientSendState> m_sendStates;
+    quint32 m_nextTransferId = 1;
+    bool m_fanoutWakePending = false;
+    bool m_progressRefreshPending = false;
+    bool m_isShutDown = false;
+    Settings m_settings;
+    QThreadPool m_previewPool;               // 解码、缩放和编码预览图，不占用网络线程
+    QString m_previewCacheDir;
+    QByteArray m_previewFormat;
+    int m_previewsSincePrune = 0;            // 距上次清理预览缓存以来请求的预览数
+
+    // 目录状态
+    QStringList m_rootPaths;
+    QMap<QString, QSet<QString>> m_watchedPathsMap;
+    QMap<QString, QHash<QString, FileSnapshot>> m_dirFileState;   // 目录 → 文件名 → 快照
+    QSet<QString> m_pendingDirChanges;
+    QHash<QString, PendingFile> m_pendingFiles;                    // 完整路径 → 待稳定文件
+    QMap<QString, QSet<QString>> m_dirSubdirState;
+    QHash<QString, SyncIndexEntry> m_fileIndex;         // 相对路径（含根目录名）→ 索引项
+    QHash<QString, QSet<QString>> m_dirIndexKeys;       // 目录 → 该目录下直接包含的索引键
+
+    // 持久化索引与变更日志：重启后沿用上次的摘要和序号，重连的客户端只需请求某个序号之后的变化。
+    QString m_stateDir;                                 // sync_index.json 所在目录
+    QString m_indexId;                                  // 索引文件丢失或重建时更换，客户端据此判断序号是否仍然有效
+    quint64 m_changeSeq = 0;
+    quint64 m_savedChangeSeq = 0;                       // 已写入索引文件的 m_changeSeq
+    quint64 m_compactedSeq = 0;                         // 早于此序号的删除记录已丢弃，无法再做增量
+    QMap<quint64, QString> m_changeLog;                 // 序号 → 索引键（新增 / 修改 / 删除）
+    QHash<QString, quint64> m_deletedPaths;             // 已删除的索引键 → 删除时的序号
+    QMap<quint64, QString> m_deletionLog;               // 与 m_deletedPaths 相同的记录按序号排列，超限时丢弃最早的
+    QHash<QString, QHash<QString, SyncIndexEntry>> m_persistedRoots;   // 启动时读入、尚未添加的根目录
+    QSet<QString> m_unverifiedKeys;                     // 从文件读入、本次扫描还未确认存在的索引键
+    QTimer *m_indexSaveTimer = nullptr;
+
+    void startDiscoveryResponder(quint16 port);
+    void stopDiscoveryResponder();
+    QString getLocalIPv4AddressForPeer(const QHostAddress &peerAddress) const;
+    void addPathRecursive(const QString &rootPath, const QString &path);
+    void removePathRecursive(const QString &rootPath);
+    void updateDirState(const QString &dirPath);
+    void scanChangedDirectory(const QString &path);
+    void dropPendingFiles(const QString &pathPrefix);
+    void refreshDirIndex(const QString &rootPath, const QString &dirPath, const QFileInfoList &entries);
+    void dropDirIndex(const QString &dirPath, bool recordDeletions = true);
+    QString indexedHash(SyncIndexEntry &entry);
+    void touchIndexEntry(const QString &key, SyncIndexEntry &entry);
+    void recordDeletion(const QString &key, quint64 entrySeq);
+    quint64 clientSafeSeq();
+    bool sendChangesSince(QTcpSocket *client, const QJsonObject &json);
+    void loadSyncIndex();
+    void saveSyncIndex();
+    void scheduleIndexSave();
+    void persistChangeSeq(quint64 seq);
+    bool manifestEntryDiffers(SyncIndexEntry &entry, const QJsonValue &reported);
+    QString findRootForPath(const QString &path);
+    QString getRelativePathWithRoot(const QString &fullPath, const QString &rootPath);
+    bool isImage(const QString &fileName);
+
+    // 协议与通讯
+    void sendPacket(QTcpSocket* client, const QJsonObject& metadata, const QByteArray& fileData = QByteArray());
+    QByteArray sealPacket(const QJsonObject& metadata, const QByteArray& fileData = QByteArray(), bool compress = false);
+    void broadcastPacket(const QJsonObject& metadata);
+    void processClientManifest(QTcpSocket* client, const QJsonObject& json, const QByteArray& payload);
+    void sendFile(const QString &filePath, const QString &rootPath, SendPriority priority = SendPriority::Live);
+    void sendFileToClients(const QList<QTcpSocket*> &targets, const QString &filePath, const QString &rootPath,
+                           SendPriority priority, qint64 resumeOffset = 0);
+    void sendPreviewToClient(QTcpSocket *client, const SyncIndexEntry &entry);
+    void fetchOriginals(QTcpSocket *client, const QJsonArray &paths);
+    void requestPreview(const QSharedPointer<SealedStream> &stream);
+    OutgoingTransfer *currentTransfer(ClientSendState &state);
+    void finishCurrentTransfer(ClientSendState &state);
+    void pumpClientTransfers(QTcpSocket *client);
+    void produceNextFrame(const QSharedPointer<SealedStream> &streamPtr);
+    void releaseClientTransfers(QTcpSocket *client);
+    void scheduleFanoutWake();
+    void scheduleProgressRefresh();
+    void reportClientProgress(QTcpSocket *client, ClientSendState &state);
+    void sendDeleteNotification(const QString &relativePath);
+    void sendFolderDeleteNotification(const QString &relativePath);
+
+    // AES-GCM (OpenSSL)
+    QByteArray encryptAESGCM(const QByteArray &plaintext, const QByteArray &key, QByteArray &iv, QByteArray &tag);
+    QByteArray decryptAESGCM(const QByteArray &ciphertext, const QByteArray &key, const QByteArray &iv, const QByteArray &tag, bool &success);
+};
+
+#endif // SYNCSERVER_H
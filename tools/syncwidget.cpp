@@ -2,19 +2,12 @@
 #include "ui_syncwidget.h"
 #include "styleconstants.h"
 #include <QFileDialog>
-#include <QDirIterator>
-#include <QJsonDocument>
-#include <QJsonArray>
-#include <QDataStream>
 #include <QMessageBox>
+#include <QSettings>
 #include <QDateTime>
 #include <QDesktopServices>
 #include <QTimer>
-#include <QHostInfo>
-#include <QNetworkInterface>
-#include <QFile>
-#include <openssl/evp.h>
-#include <openssl/rand.h>
+#include <QThread>
 #include <QHBoxLayout>
 #include <QUrl>
 
@@ -25,14 +18,33 @@ SyncWidget::SyncWidget(QWidget *parent) :
     ui->setupUi(this);
     setStyleSheet(AppStyle::loadToolPageQss());
 
-    // 初始化网络和文件监控
-    tcpServer = new QTcpServer(this);
-    udpDiscoverySocket = new QUdpSocket(this);
-    watcher = new QFileSystemWatcher(this);
+    // 同步服务放到独立线程：网络、加解密、目录比对和读盘都不再占用界面线程
+    m_serverThread = new QThread(this);
+    m_serverThread->setObjectName("SyncServer");
+    m_server = new SyncServer();
+    m_server->moveToThread(m_serverThread);
+    connect(m_serverThread, &QThread::started, m_server, &SyncServer::initialize);
+    connect(m_server, &SyncServer::logMessage, this, &SyncWidget::logMsg);
+    connect(m_server, &SyncServer::pendingDevice, this, &SyncWidget::addPendingDeviceItem);
+    connect(m_server, &SyncServer::clientAuthenticated, this, &SyncWidget::addActiveClientItem);
+    connect(m_server, &SyncServer::clientDisconnected, this, &SyncWidget::removeActiveClientItem);
+    connect(m_server, &SyncServer::clientProgress, this, &SyncWidget::updateClientProgress);
+    connect(m_server, &SyncServer::listeningChanged, this, [this](bool listening) {
+        m_serverListening = listening;
+        if (listening) {
+            ui->btnStart->setText("停止服务 / Stop");
+            ui->btnStart->setStyleSheet(QString("background-color: %1; color: %2; font-weight: bold;")
+                                             .arg(AppStyle::SyncStopRed(), AppStyle::WhiteText()));
+        } else {
+            ui->btnStart->setText("启动服务 / Start");
+            ui->btnStart->setStyleSheet("");
+        }
+    });
+    connect(m_server, &SyncServer::startFailed, this, [this](quint16) {
+        QMessageBox::critical(this, "错误", "端口被占用或启动失败");
+    });
+    m_serverThread->start();
 
-    connect(tcpServer, &QTcpServer::newConnection, this, &SyncWidget::newClientConnected);
-    connect(udpDiscoverySocket, &QUdpSocket::readyRead, this, &SyncWidget::onDiscoveryReadyRead);
-    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &SyncWidget::handleDirectoryChange);
     connect(ui->btnGetMobileApp, &QPushButton::clicked, this, [this]() {
         const QUrl url("https://github.com/hanbinhsh/SD_Image_Synchronizer_PE/releases/latest");
         if (QDesktopServices::openUrl(url)) {
@@ -58,32 +70,12 @@ SyncWidget::SyncWidget(QWidget *parent) :
 SyncWidget::~SyncWidget()
 {
     saveSettings();
-    if (watcher) {
-        watcher->disconnect(this);
-        const QStringList watchedFiles = watcher->files();
-        if (!watchedFiles.isEmpty()) watcher->removePaths(watchedFiles);
-        const QStringList watchedDirs = watcher->directories();
-        if (!watchedDirs.isEmpty()) watcher->removePaths(watchedDirs);
-    }
-    if (tcpServer) {
-        tcpServer->disconnect(this);
-        tcpServer->close();
-    }
-    if (udpDiscoverySocket) {
-        udpDiscoverySocket->disconnect(this);
-        udpDiscoverySocket->close();
-    }
-    const QList<QTcpSocket*> sockets = clients;
-    for (QTcpSocket *client : sockets) {
-        if (!client) continue;
-        client->disconnect(this);
-        client->abort();
-        client->setParent(nullptr);
-        delete client;
-    }
-    clients.clear();
-    m_clientExpectedSizes.clear();
-    m_authenticatedClients.clear();
+    // 先断开信号再同步关闭服务：关闭过程中的日志和断线通知不再回到正在析构的界面。
+    m_server->disconnect(this);
+    QMetaObject::invokeMethod(m_server, &SyncServer::shutdown, Qt::BlockingQueuedConnection);
+    m_serverThread->quit();
+    m_serverThread->wait();
+    delete m_server;
     delete ui;
 }
 
@@ -109,11 +101,12 @@ void SyncWidget::loadSettings() {
         m_whitelistedDevices.insert(id);
         addWhitelistItem(id);
     }
+    pushSettingsSnapshot();
 
     m_rootPaths = settings.value("rootPaths").toStringList();
     for (const QString &path : m_rootPaths) {
         addFolderItem(path);
-        addPathRecursive(path, path);
+        QMetaObject::invokeMethod(m_server, [server = m_server, path]() { server->addRoot(path, false); });
     }
     settings.endGroup();
 
@@ -132,6 +125,16 @@ void SyncWidget::saveSettings() {
     settings.setValue("whitelist", QStringList(m_whitelistedDevices.begin(), m_whitelistedDevices.end()));
     settings.setValue("rootPaths", m_rootPaths);
     settings.endGroup();
+    pushSettingsSnapshot();
+}
+
+// 服务线程只读这份快照，不直接访问控件。
+void SyncWidget::pushSettingsSnapshot() {
+    SyncServer::Settings snapshot;
+    snapshot.aesKey = ui->editAesKey->text().toUtf8();
+    snapshot.whitelistEnabled = ui->chkWhitelist->isChecked();
+    snapshot.whitelist = m_whitelistedDevices;
+    QMetaObject::invokeMethod(m_server, [server = m_server, snapshot]() { server->applySettings(snapshot); });
 }
 
 // UI 改变即刻触发保存
@@ -142,109 +145,12 @@ void SyncWidget::on_editAesKey_editingFinished() { saveSettings(); }
 
 // ======================= UI 按钮响应 =======================
 void SyncWidget::on_btnStart_clicked() {
-    if (tcpServer->isListening()) {
-        stopDiscoveryResponder();
-        tcpServer->close();
-        for (auto client : clients) client->disconnectFromHost();
-        ui->btnStart->setText("启动服务 / Start");
-        ui->btnStart->setStyleSheet("");
-        logMsg("服务已停止。");
-    } else {
-        quint16 port = ui->editPort->text().toUShort();
-        if (tcpServer->listen(QHostAddress::Any, port)) {
-            startDiscoveryResponder(port);
-            ui->btnStart->setText("停止服务 / Stop");
-            ui->btnStart->setStyleSheet(QString("background-color: %1; color: %2; font-weight: bold;")
-                                             .arg(AppStyle::SyncStopRed(), AppStyle::WhiteText()));
-            logMsg(QString("服务已启动，监听端口: %1").arg(port));
-        } else {
-            QMessageBox::critical(this, "错误", "端口被占用或启动失败");
-        }
-    }
-}
-
-void SyncWidget::startDiscoveryResponder(quint16 port) {
-    stopDiscoveryResponder();
-
-    const bool bound = udpDiscoverySocket->bind(
-        QHostAddress::AnyIPv4,
-        port,
-        QAbstractSocket::ShareAddress | QAbstractSocket::ReuseAddressHint
-    );
-    if (bound) {
-        logMsg(QString("UDP 发现服务已启动，监听端口: %1").arg(port));
+    if (m_serverListening) {
+        QMetaObject::invokeMethod(m_server, &SyncServer::stop);
     } else {
-        logMsg("⚠️ UDP 发现服务启动失败，手机端自动扫描可能不可用。");
-    }
-}
-
-void SyncWidget::stopDiscoveryResponder() {
-    if (udpDiscoverySocket && udpDiscoverySocket->state() != QAbstractSocket::UnconnectedState) {
-        udpDiscoverySocket->close();
-    }
-}
-
-QString SyncWidget::getLocalIPv4AddressForPeer(const QHostAddress &peerAddress) const {
-    const QHostAddress peerV4(peerAddress.toIPv4Address());
-    const quint32 peer = peerV4.toIPv4Address();
-
-    for (const QNetworkInterface &networkInterface : QNetworkInterface::allInterfaces()) {
-        if (!(networkInterface.flags() & QNetworkInterface::IsUp)
-            || !(networkInterface.flags() & QNetworkInterface::IsRunning)
-            || (networkInterface.flags() & QNetworkInterface::IsLoopBack)) {
-            continue;
-        }
-
-        for (const QNetworkAddressEntry &entry : networkInterface.addressEntries()) {
-            const QHostAddress address = entry.ip();
-            if (address.protocol() != QAbstractSocket::IPv4Protocol || address.isLoopback()) {
-                continue;
-            }
-
-            const quint32 ip = address.toIPv4Address();
-            const quint32 mask = entry.netmask().toIPv4Address();
-            if (mask != 0 && peer != 0 && (ip & mask) == (peer & mask)) {
-                return address.toString();
-            }
-        }
-    }
-
-    for (const QHostAddress &address : QNetworkInterface::allAddresses()) {
-        if (address.protocol() == QAbstractSocket::IPv4Protocol && !address.isLoopback()) {
-            return address.toString();
-        }
-    }
-
-    return QString();
-}
-
-void SyncWidget::onDiscoveryReadyRead() {
-    while (udpDiscoverySocket->hasPendingDatagrams()) {
-        QByteArray datagram;
-        datagram.resize(int(udpDiscoverySocket->pendingDatagramSize()));
-
-        QHostAddress senderAddress;
-        quint16 senderPort = 0;
-        udpDiscoverySocket->readDatagram(datagram.data(), datagram.size(), &senderAddress, &senderPort);
-
-        const QJsonObject request = QJsonDocument::fromJson(datagram).object();
-        if (request["cmd"].toString() != "SD_SYNC_DISCOVER") continue;
-        if (request["version"].toInt() != 1) continue;
-        if (!tcpServer->isListening()) continue;
-
-        const quint16 port = tcpServer->serverPort();
-        const QString localIp = getLocalIPv4AddressForPeer(senderAddress);
-
-        QJsonObject response;
-        response["cmd"] = "SD_SYNC_DISCOVER_RESPONSE";
-        response["version"] = 1;
-        response["app"] = "SD_LoRA_Manager";
-        response["name"] = QHostInfo::localHostName();
-        response["ip"] = localIp;
-        response["port"] = int(port);
-
-        const QByteArray payload = QJsonDocument(response).toJson(QJsonDocument::Compact);
-        udpDiscoverySocket->writeDatagram(payload, senderAddress, senderPort);
+        pushSettingsSnapshot();
+        const quint16 port = ui->editPort->text().toUShort();
+        QMetaObject::invokeMethod(m_server, [server = m_server, port]() { server->start(port); });
     }
 }
 
@@ -254,402 +160,10 @@ void SyncWidget::on_btnAddFolder_clicked() {
 
     m_rootPaths.append(dir);
     addFolderItem(dir);
-    addPathRecursive(dir, dir);
     saveSettings();
 
-    // 立即向已连接客户端发送新图片
-    QDirIterator it(dir, QStringList() << "*.png" << "*.jpg" << "*.jpeg" << "*.webp", QDir::Files, QDirIterator::Subdirectories);
-    while (it.hasNext()) sendFile(it.next(), dir);
-}
-
-// ======================= AES-GCM 加解密 =======================
-QByteArray SyncWidget::encryptAESGCM(const QByteArray &plaintext, const QByteArray &key, QByteArray &iv, QByteArray &tag) {
-    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) return QByteArray();
-    int len = 0;
-    int ciphertext_len = 0;
-    QByteArray ciphertext(plaintext.length() + 16, 0);
-
-    if (EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
-        return QByteArray();
-    }
-    QByteArray paddedKey = key.leftJustified(32, '\0', true);
-
-    if (EVP_EncryptInit_ex(ctx, NULL, NULL,
-                           reinterpret_cast<const unsigned char*>(paddedKey.constData()),
-                           reinterpret_cast<const unsigned char*>(iv.constData())) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
-        return QByteArray();
-    }
-    if (EVP_EncryptUpdate(ctx,
-                          reinterpret_cast<unsigned char*>(ciphertext.data()),
-                          &len,
-                          reinterpret_cast<const unsigned char*>(plaintext.constData()),
-                          plaintext.length()) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
-        return QByteArray();
-    }
-    ciphertext_len = len;
-    if (EVP_EncryptFinal_ex(ctx, reinterpret_cast<unsigned char*>(ciphertext.data()) + ciphertext_len, &len) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
-        return QByteArray();
-    }
-    ciphertext_len += len;
-
-    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, 16, tag.data());
-    EVP_CIPHER_CTX_free(ctx);
-
-    return ciphertext.left(ciphertext_len);
-}
-
-QByteArray SyncWidget::decryptAESGCM(const QByteArray &ciphertext, const QByteArray &key, const QByteArray &iv, const QByteArray &tag, bool &success) {
-    success = false;
-    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) return QByteArray();
-    int len = 0;
-    int plaintext_len = 0;
-    QByteArray plaintext(ciphertext.length() + 16, 0);
-
-    QByteArray paddedKey = key.leftJustified(32, '\0', true);
-
-    if (EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL) != 1
-        || EVP_DecryptInit_ex(ctx, NULL, NULL,
-                              reinterpret_cast<const unsigned char*>(paddedKey.constData()),
-                              reinterpret_cast<const unsigned char*>(iv.constData())) != 1
-        || EVP_DecryptUpdate(ctx,
-                             reinterpret_cast<unsigned char*>(plaintext.data()),
-                             &len,
-                             reinterpret_cast<const unsigned char*>(ciphertext.constData()),
-                             ciphertext.length()) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
-        return QByteArray();
-    }
-    plaintext_len = len;
-
-    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, 16, const_cast<char*>(tag.constData()));
-    int ret = EVP_DecryptFinal_ex(ctx, reinterpret_cast<unsigned char*>(plaintext.data()) + plaintext_len, &len);
-
-    success = (ret > 0);
-    EVP_CIPHER_CTX_free(ctx);
-
-    if (!success) return QByteArray();
-    return plaintext.left(plaintext_len + len);
-}
-
-// ======================= 通讯协议 =======================
-void SyncWidget::sendPacket(QTcpSocket* client, const QJsonObject& metadata, const QByteArray& fileData) {
-    if (!client || client->state() != QAbstractSocket::ConnectedState) return;
-
-    QByteArray jsonBytes = QJsonDocument(metadata).toJson(QJsonDocument::Compact);
-    quint32 jsonLen = jsonBytes.size();
-    quint32 dataLen = fileData.size();
-    quint32 totalLen = 4 + jsonLen + dataLen;
-
-    QByteArray plainPacket;
-    QDataStream plainOut(&plainPacket, QIODevice::WriteOnly);
-    plainOut.setByteOrder(QDataStream::BigEndian);
-    plainOut << totalLen << jsonLen;
-    plainOut.writeRawData(jsonBytes.constData(), jsonLen);
-    if (dataLen > 0) plainOut.writeRawData(fileData.constData(), dataLen);
-
-    QByteArray aesKey = ui->editAesKey->text().toUtf8();
-    QByteArray iv(12, 0); RAND_bytes((unsigned char*)iv.data(), 12);
-    QByteArray tag(16, 0);
-
-    QByteArray cipher = encryptAESGCM(plainPacket, aesKey, iv, tag);
-
-    quint32 cipherPayloadLen = cipher.size() + 12 + 16;
-    QByteArray finalPacket;
-    QDataStream out(&finalPacket, QIODevice::WriteOnly);
-    out.setByteOrder(QDataStream::BigEndian);
-    
-    out << cipherPayloadLen;
-    out.writeRawData(iv.data(), 12);
-    out.writeRawData(tag.data(), 16);
-    out.writeRawData(cipher.data(), cipher.size());
-
-    client->write(finalPacket);
-    client->flush();
-}
-
-void SyncWidget::newClientConnected() {
-    QTcpSocket *client = tcpServer->nextPendingConnection();
-    clients << client;
-    m_clientExpectedSizes[client] = 0;
-
-    QString clientInfo = client->peerAddress().toString().remove("::ffff:") + ":" + QString::number(client->peerPort());
-    logMsg("🔌 建立物理连接: " + clientInfo + " (等待认证...)");
-
-    connect(client, &QTcpSocket::readyRead, this, &SyncWidget::onClientReadyRead);
-
-    connect(client, &QTcpSocket::disconnected, this, &SyncWidget::handleClientDisconnected);
-}
-
-void SyncWidget::onClientReadyRead() {
-    QTcpSocket *client = qobject_cast<QTcpSocket*>(sender());
-    if (!client) return;
-
-    QDataStream in(client);
-    in.setByteOrder(QDataStream::BigEndian);
-
-    while (true) {
-        if (m_clientExpectedSizes[client] == 0) {
-            if (client->bytesAvailable() < 4) return;
-            in >> m_clientExpectedSizes[client];
-        }
-
-        quint32 expectedSize = m_clientExpectedSizes[client];
-        if (expectedSize < 28 || expectedSize > 512u * 1024u * 1024u) {
-            logMsg("⚠️ 警告: 收到异常同步数据包长度，已断开客户端。");
-            m_clientExpectedSizes[client] = 0;
-            client->disconnectFromHost();
-            return;
-        }
-        if (client->bytesAvailable() < expectedSize) return;
-
-        QByteArray iv = client->read(12);
-        QByteArray tag = client->read(16);
-        QByteArray ciphertext = client->read(expectedSize - 28);
-        m_clientExpectedSizes[client] = 0;
-
-        bool decSuccess = false;
-        QByteArray aesKey = ui->editAesKey->text().toUtf8();
-        QByteArray plaintext = decryptAESGCM(ciphertext, aesKey, iv, tag, decSuccess);
-
-        if (!decSuccess) {
-            logMsg("⚠️ 警告: 客户端加密认证失败，可能密钥错误，已断开！");
-            client->disconnectFromHost();
-            return;
-        }
-
-        if (plaintext.size() < 8) {
-            logMsg("⚠️ 警告: 同步数据包明文头不完整，已断开客户端。");
-            client->disconnectFromHost();
-            return;
-        }
-
-        QDataStream plainIn(plaintext);
-        plainIn.setByteOrder(QDataStream::BigEndian);
-        quint32 plainTotalLen = 0;
-        quint32 jsonLen = 0;
-        plainIn >> plainTotalLen >> jsonLen;
-
-        // plainTotalLen is encoded as sizeof(jsonLen) + JSON + optional data.
-        const quint64 actualPayloadLength = static_cast<quint64>(plaintext.size() - 4);
-        const quint64 jsonEnd = 8ull + static_cast<quint64>(jsonLen);
-        if (plainIn.status() != QDataStream::Ok
-            || static_cast<quint64>(plainTotalLen) != actualPayloadLength
-            || jsonEnd > static_cast<quint64>(plaintext.size())) {
-            logMsg("⚠️ 警告: 同步数据包长度字段无效，已断开客户端。");
-            client->disconnectFromHost();
-            return;
-        }
-
-        QByteArray jsonBytes = plaintext.mid(8, jsonLen);
-        QJsonParseError jsonError;
-        const QJsonDocument jsonDocument = QJsonDocument::fromJson(jsonBytes, &jsonError);
-        if (jsonError.error != QJsonParseError::NoError || !jsonDocument.isObject()) {
-            logMsg("⚠️ 警告: 同步数据包 JSON 无效，已断开客户端。");
-            client->disconnectFromHost();
-            return;
-        }
-        QJsonObject json = jsonDocument.object();
-        QString cmd = json["cmd"].toString();
-
-        if (cmd == "AUTH") {
-            QString deviceId = json["deviceId"].toString();
-            QString deviceName = json["deviceName"].toString();
-            QString displayName = deviceName + " (" + deviceId + ")";
-
-            // === 1. 白名单拦截逻辑 ===
-            if (ui->chkWhitelist->isChecked() && !m_whitelistedDevices.contains(deviceId)) {
-                logMsg("🚫 拦截未授权设备: " + displayName);
-                // 【核心：添加到待审核 UI】
-                addPendingDeviceItem(deviceId, displayName);
-                client->disconnectFromHost();
-                return;
-            }
-
-            // === 2. 认证成功逻辑 ===
-            logMsg("✅ 设备认证成功: " + displayName);
-            m_authenticatedClients.insert(client);
-
-            // 【核心：添加到已连接 UI】
-            QString ip = client->peerAddress().toString().remove("::ffff:");
-            QString activeName = displayName + " [" + ip + "]";
-            addActiveClientItem(client, activeName);
-
-            // 发送文件夹列表
-            QJsonArray folders;
-            for(const QString &path : m_rootPaths) folders.append(QFileInfo(path).fileName());
-            QJsonObject respJson; respJson["cmd"] = "FOLDER_LIST"; respJson["folders"] = folders;
-            sendPacket(client, respJson);
-        }
-        else if (cmd == "CLIENT_MANIFEST") {
-            if (!m_authenticatedClients.contains(client)) return;
-            processClientManifest(client, json);
-        }
-    }
-}
-
-// ======================= 文件与目录管理 =======================
-QString SyncWidget::findRootForPath(const QString &path) {
-    const QString normalizedPath = QDir::cleanPath(
-        QDir::fromNativeSeparators(QFileInfo(path).absoluteFilePath()));
-    QString bestMatch;
-#ifdef Q_OS_WIN
-    constexpr Qt::CaseSensitivity pathCaseSensitivity = Qt::CaseInsensitive;
-#else
-    constexpr Qt::CaseSensitivity pathCaseSensitivity = Qt::CaseSensitive;
-#endif
-    for (const QString &root : m_rootPaths) {
-        const QString normalizedRoot = QDir::cleanPath(
-            QDir::fromNativeSeparators(QFileInfo(root).absoluteFilePath()));
-        if (normalizedRoot.isEmpty()) continue;
-        const bool exactMatch = normalizedPath.compare(normalizedRoot, pathCaseSensitivity) == 0;
-        const bool childMatch = normalizedPath.startsWith(normalizedRoot + '/', pathCaseSensitivity);
-        if ((exactMatch || childMatch) && normalizedRoot.size() > bestMatch.size()) {
-            bestMatch = root;
-        }
-    }
-    return bestMatch;
-}
-QString SyncWidget::getRelativePathWithRoot(const QString &fullPath, const QString &rootPath) {
-    QDir rootDir(rootPath);
-    QString rootFolderName = QFileInfo(rootPath).fileName();
-    return rootFolderName + "/" + rootDir.relativeFilePath(fullPath).replace("\\", "/");
-}
-bool SyncWidget::isImage(const QString &fileName) {
-    static QStringList filters = {"*.png", "*.jpg", "*.jpeg", "*.webp"};
-    for (const QString &f : filters) if (QDir::match(f, fileName.toLower())) return true;
-    return false;
-}
-
-void SyncWidget::sendFile(const QString &filePath, const QString &rootPath) {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) return;
-    QByteArray data = file.readAll();
-    file.close();
-
-    QJsonObject json; json["cmd"] = "SYNC";
-    json["path"] = getRelativePathWithRoot(filePath, rootPath);
-    json["size"] = data.size();
-
-    for (QTcpSocket *client : m_authenticatedClients) sendPacket(client, json, data);
-}
-void SyncWidget::sendDeleteNotification(const QString &relativePath) {
-    QJsonObject json; json["cmd"] = "DELETE"; json["path"] = relativePath;
-    for (QTcpSocket *client : m_authenticatedClients) sendPacket(client, json);
-}
-void SyncWidget::sendFolderDeleteNotification(const QString &relativePath) {
-    QJsonObject json; json["cmd"] = "DELETE_FOLDER"; json["path"] = relativePath;
-    for (QTcpSocket *client : m_authenticatedClients) sendPacket(client, json);
-}
-
-void SyncWidget::processClientManifest(QTcpSocket* client, const QJsonObject& json) {
-    QJsonObject filesObj = json["files"].toObject();
-    logMsg(QString("[Sync] 收到客户端 Manifest，文件数: %1").arg(filesObj.size()));
-    int sentCount = 0;
-    for (const QString &rootPath : m_rootPaths) {
-        QDirIterator it(rootPath, QStringList() << "*.png" << "*.jpg" << "*.jpeg" << "*.webp", QDir::Files, QDirIterator::Subdirectories);
-        while (it.hasNext()) {
-            QString fullPath = it.next();
-            QString relativePath = getRelativePathWithRoot(fullPath, rootPath);
-            bool needSend = !filesObj.contains(relativePath) || filesObj[relativePath].toVariant().toLongLong() != QFileInfo(fullPath).size();
-            if (needSend) {
-                sendFile(fullPath, rootPath);
-                sentCount++;
-                if (sentCount % 10 == 0) client->flush();
-            }
-        }
-    }
-    logMsg(QString("[Sync] 差异比对完成，共发送 %1 个更新文件。").arg(sentCount));
-}
-
-void SyncWidget::addPathRecursive(const QString &rootPath, const QString &path) {
-    if (!m_watchedPathsMap.contains(rootPath)) m_watchedPathsMap[rootPath] = QSet<QString>();
-    QDirIterator it(path, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
-    if(!m_watchedPathsMap[rootPath].contains(path)) {
-        if (watcher->addPath(path)) {
-            m_watchedPathsMap[rootPath].insert(path);
-            updateDirState(path);
-        } else {
-            logMsg("⚠️ 无法监控目录: " + path);
-        }
-    }
-    while (it.hasNext()) {
-        QString subDir = it.next();
-        if(!m_watchedPathsMap[rootPath].contains(subDir)) {
-            if (watcher->addPath(subDir)) {
-                m_watchedPathsMap[rootPath].insert(subDir);
-                updateDirState(subDir);
-            } else {
-                logMsg("⚠️ 无法监控目录: " + subDir);
-            }
-        }
-    }
-}
-void SyncWidget::removePathRecursive(const QString &rootPath) {
-    if (!m_watchedPathsMap.contains(rootPath)) return;
-    for (const QString &path : m_watchedPathsMap[rootPath]) watcher->removePath(path);
-    m_watchedPathsMap.remove(rootPath);
-}
-void SyncWidget::updateDirState(const QString &dirPath) {
-    QDir dir(dirPath);
-    dir.setFilter(QDir::Files | QDir::NoDotAndDotDot);
-    QStringList fileList = dir.entryList();
-    m_dirFileState[dirPath] = QSet<QString>(fileList.begin(), fileList.end());
-
-    dir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
-    QStringList subDirList = dir.entryList();
-    m_dirSubdirState[dirPath] = QSet<QString>(subDirList.begin(), subDirList.end());
-}
-void SyncWidget::handleDirectoryChange(const QString &path) {
-    QString rootPath = findRootForPath(path);
-    if (rootPath.isEmpty()) return;
-    QDir dir(path);
-
-    // 处理文件
-    dir.setFilter(QDir::Files | QDir::NoDotAndDotDot);
-    QStringList currentFileList = dir.entryList();
-    QSet<QString> currentFileSet(currentFileList.begin(), currentFileList.end());
-    if (!m_dirFileState.contains(path)) {
-        m_dirFileState[path] = currentFileSet;
-        updateDirState(path);
-        return;
-    }
-    QSet<QString> oldFileSet = m_dirFileState.value(path);
-    
-    QSet<QString> addedFiles = currentFileSet - oldFileSet;
-    for (const QString &fileName : addedFiles) {
-        QString fullPath = dir.absoluteFilePath(fileName);
-        if (isImage(fileName) && QFileInfo(fullPath).size() > 0) sendFile(fullPath, rootPath);
-    }
-    QSet<QString> deletedFiles = oldFileSet - currentFileSet;
-    for (const QString &fileName : deletedFiles) {
-        if (isImage(fileName)) {
-            sendDeleteNotification(getRelativePathWithRoot(path + "/" + fileName, rootPath));
-        }
-    }
-    m_dirFileState[path] = currentFileSet;
-
-    // 处理文件夹
-    dir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
-    QStringList currentSubDirList = dir.entryList();
-    QSet<QString> currentSubdirSet(currentSubDirList.begin(), currentSubDirList.end());
-    QSet<QString> oldSubdirSet = m_dirSubdirState.value(path);
-    
-    QSet<QString> addedSubdirs = currentSubdirSet - oldSubdirSet;
-    for (const QString &subdirName : addedSubdirs) {
-        QString fullPath = path + "/" + subdirName;
-        if (!m_watchedPathsMap[rootPath].contains(fullPath)) addPathRecursive(rootPath, fullPath);
-    }
-    QSet<QString> deletedSubdirs = oldSubdirSet - currentSubdirSet;
-    for (const QString &subdirName : deletedSubdirs) {
-        sendFolderDeleteNotification(getRelativePathWithRoot(path + "/" + subdirName, rootPath));
-    }
-    m_dirSubdirState[path] = currentSubdirSet;
+    // 服务线程建立监控与索引后，立即向已连接客户端发送新图片
+    QMetaObject::invokeMethod(m_server, [server = m_server, dir]() { server->addRoot(dir, true); });
 }
 
 // ===========================列表创建===============================
@@ -757,7 +271,7 @@ void SyncWidget::addWhitelistItem(const QString &deviceId) {
 }
 
 // 4. 已连接设备项
-void SyncWidget::addActiveClientItem(QTcpSocket *client, const QString &displayName) {
+void SyncWidget::addActiveClientItem(quintptr clientId, const QString &displayName) {
     QListWidgetItem *item = new QListWidgetItem(ui->listActive);
     item->setSizeHint(QSize(0, 42));
 
@@ -777,21 +291,26 @@ void SyncWidget::addActiveClientItem(QTcpSocket *client, const QString &displayN
     btnKick->setCursor(Qt::PointingHandCursor);
     btnKick->setStyleSheet(AppStyle::dangerButtonStyle());
 
+    QLabel *lblProgress = new QLabel("空闲");
+    lblProgress->setStyleSheet(AppStyle::MutedLabelStyle());
+    m_clientProgressLabels.insert(clientId, lblProgress);
+
     layout->addWidget(lblName, 1);
+    layout->addWidget(lblProgress, 0);
     layout->addWidget(btnKick, 0);
 
     ui->listActive->setItemWidget(item, widget);
-    item->setData(Qt::UserRole, QVariant::fromValue((void*)client));
+    item->setData(Qt::UserRole, QVariant::fromValue(clientId));
 
-    connect(btnKick, &QPushButton::clicked, this, [this, client]() {
-        kickActiveClient(client);
+    connect(btnKick, &QPushButton::clicked, this, [this, clientId]() {
+        kickActiveClient(clientId);
         if(QPushButton* btn = qobject_cast<QPushButton*>(sender())) btn->setEnabled(false);
     });
 }
 // ============按钮点击==============
 void SyncWidget::removeFolderByPath(const QString &path) {
     m_rootPaths.removeAll(path);
-    removePathRecursive(path);
+    QMetaObject::invokeMethod(m_server, [server = m_server, path]() { server->removeRoot(path); });
     saveSettings();
     logMsg("已移除监控文件夹: " + path);
 }
@@ -811,33 +330,27 @@ void SyncWidget::removeWhitelistDevice(const QString &deviceId) {
     logMsg("🛡️ 已移除白名单设备: " + deviceId);
 
     // 可选：如果该设备当前正连着，是否强制踢出？
-    for (QTcpSocket *client : m_authenticatedClients) {
-        // 如果你需要踢出，需要在 authenticated 列表里找到对应 socket 并 disconnect
-        // 因为目前 socket 没有直接绑定 deviceId，你可能需要在 onClientReadyRead 里额外记录
-    }
+    // 目前服务端的 socket 没有直接绑定 deviceId，需要在 SyncServer::onClientReadyRead 里额外记录后才能踢出
 }
 
-void SyncWidget::kickActiveClient(QTcpSocket *client) {
-    if (client && client->state() == QAbstractSocket::ConnectedState) {
-        logMsg("🔌 强制断开客户端连接...");
-        client->disconnectFromHost();
-    }
+void SyncWidget::kickActiveClient(quintptr clientId) {
+    QMetaObject::invokeMethod(m_server, [server = m_server, clientId]() { server->kickClient(clientId); });
 }
 
-void SyncWidget::handleClientDisconnected() {
-    QTcpSocket *client = qobject_cast<QTcpSocket*>(sender());
-    if (!client) return;
-
-    // 遍历【已连接列表】，找到对应的 socket 并从 UI 删除
+void SyncWidget::removeActiveClientItem(quintptr clientId) {
+    // 遍历【已连接列表】，找到对应的客户端并从 UI 删除
     for(int i = 0; i < ui->listActive->count(); ++i) {
-        if (ui->listActive->item(i)->data(Qt::UserRole).value<void*>() == client) {
+        if (ui->listActive->item(i)->data(Qt::UserRole).value<quintptr>() == clientId) {
             delete ui->listActive->takeItem(i);
             break;
         }
     }
+    m_clientProgressLabels.remove(clientId);
+}
 
-    m_authenticatedClients.remove(client);
-    clients.removeAll(client);
-    client->deleteLater();
-    logMsg("🔌 客户端已断开连接");
+void SyncWidget::updateClientProgress(quintptr clientId, const QString &text, const QString &toolTip) {
+    QLabel *label = m_clientProgressLabels.value(clientId);
+    if (!label) return;
+    label->setText(text);
+    label->setToolTip(toolTip);
 }
@@ -2,18 +2,17 @@
 #define SYNCWIDGET_H
 
 #include <QWidget>
-#include <QTcpServer>
-#include <QTcpSocket>
-#include <QUdpSocket>
-#include <QFileSystemWatcher>
-#include <QSettings>
-#include <QMap>
 #include <QSet>
-#include <QJsonObject>
+#include <QHash>
+#include <QPointer>
+
+#include "syncserver.h"
 
 namespace Ui {
 class SyncWidget;
 }
+class QLabel;
+class QThread;
 
 class SyncWidget : public QWidget
 {
@@ -33,29 +32,17 @@ private slots:
     void on_editPort_editingFinished();
     void on_editAesKey_editingFinished();
 
-    // 网络与文件监控回调
-    void newClientConnected();
-    void onClientReadyRead();
-    void onDiscoveryReadyRead();
-    void handleDirectoryChange(const QString &path);
-
 private:
     Ui::SyncWidget *ui;
 
-    // 网络与文件监听
-    QTcpServer *tcpServer;
-    QUdpSocket *udpDiscoverySocket;
-    QFileSystemWatcher *watcher;
-    QList<QTcpSocket*> clients;
-    QMap<QTcpSocket*, quint32> m_clientExpectedSizes;
-    QSet<QTcpSocket*> m_authenticatedClients;
+    // 同步服务运行在独立线程中，界面只通过排队调用和信号与它交互
+    QThread *m_serverThread = nullptr;
+    SyncServer *m_server = nullptr;
+    bool m_serverListening = false;
 
-    // 目录状态
     QStringList m_rootPaths;
-    QMap<QString, QSet<QString>> m_watchedPathsMap;
-    QMap<QString, QSet<QString>> m_dirFileState;
-    QMap<QString, QSet<QString>> m_dirSubdirState;
     QSet<QString> m_whitelistedDevices;
+    QHash<quintptr, QPointer<QLabel>> m_clientProgressLabels;
 
     bool m_isLoading = false;
 
@@ -63,40 +50,21 @@ private:
     void addFolderItem(const QString &path);
     void addPendingDeviceItem(const QString &deviceId, const QString &displayName);
     void addWhitelistItem(const QString &deviceId);
-    void addActiveClientItem(QTcpSocket *client, const QString &displayName);
+    void addActiveClientItem(quintptr clientId, const QString &displayName);
 
     // 内嵌按钮触发的槽函数
     void removeFolderByPath(const QString &path);
     void allowPendingDevice(const QString &deviceId, const QString &displayName);
     void removeWhitelistDevice(const QString &deviceId);
-    void kickActiveClient(QTcpSocket *client);
-
-    void handleClientDisconnected();
+    void kickActiveClient(quintptr clientId);
+    void removeActiveClientItem(quintptr clientId);
+    void updateClientProgress(quintptr clientId, const QString &text, const QString &toolTip);
 
     // 核心功能函数
     void loadSettings();
     void saveSettings();
+    void pushSettingsSnapshot();
     void logMsg(const QString &msg);
-    void startDiscoveryResponder(quint16 port);
-    void stopDiscoveryResponder();
-    QString getLocalIPv4AddressForPeer(const QHostAddress &peerAddress) const;
-    void addPathRecursive(const QString &rootPath, const QString &path);
-    void removePathRecursive(const QString &rootPath);
-    void updateDirState(const QString &dirPath);
-    QString findRootForPath(const QString &path);
-    QString getRelativePathWithRoot(const QString &fullPath, const QString &rootPath);
-    bool isImage(const QString &fileName);
-
-    // 协议与通讯
-    void sendPacket(QTcpSocket* client, const QJsonObject& metadata, const QByteArray& fileData = QByteArray());
-    void processClientManifest(QTcpSocket* client, const QJsonObject& json);
-    void sendFile(const QString &filePath, const QString &rootPath);
-    void sendDeleteNotification(const QString &relativePath);
-    void sendFolderDeleteNotification(const QString &relativePath);
-
-    // AES-GCM (OpenSSL)
-    QByteArray encryptAESGCM(const QByteArray &plaintext, const QByteArray &key, QByteArray &iv, QByteArray &tag);
-    QByteArray decryptAESGCM(const QByteArray &ciphertext, const QByteArray &key, const QByteArray &iv, const QByteArray &tag, bool &success);
 };
 
 #endif // SYNCWIDGET_H
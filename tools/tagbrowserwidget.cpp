@@ -1,4 +1,5 @@
 #include "tagbrowserwidget.h"
+#include "gallerycorpus.h"
 #include "styleconstants.h"
 #include "tableviewstylehelper.h"
 #include "tagutils.h"
@@ -86,105 +87,22 @@ QHash<QString, TagTranslationInfo> readMergedTranslationInfosWorker(const QStrin
     return infos;
 }
 
-QString cleanUserTagTextWorker(QString tag)
+// 用户 Tag 直接取全局 Tag 统计，不再逐图重新解析提示词。
+QVector<UserTagUsageRow> readUserTagRowsWorker(const GalleryCorpusSnapshot &corpus, int scope)
 {
-    tag = tag.trimmed();
-    if (tag.isEmpty()) return QString();
-
-    static const QSet<QString> emoticons = {":)", ":-)", ":(", ":-(", "^_^", "T_T", "o_o", "O_O"};
-    if (emoticons.contains(tag)) return tag;
-
-    static QRegularExpression weightRegex(":[0-9.]+$");
-    tag.remove(weightRegex);
-
-    static QRegularExpression bracketRegex("[\\{\\}\\[\\]\\(\\)]");
-    tag.remove(bracketRegex);
-
-    return tag.trimmed();
-}
-
-QStringList parseUserPromptTagsWorker(const QString &prompt)
-{
-    QString normalized = prompt;
-    normalized.replace("\r\n", ",");
-    normalized.replace('\n', ',');
-    normalized.replace('\r', ',');
-
-    static const QSet<QString> blockedTags = {
-        "BREAK", "ADDCOMM", "ADDBASE", "ADDCOL", "ADDROW"
-    };
-
-    QStringList tags;
-    const QStringList parts = normalized.split(',', Qt::SkipEmptyParts);
-    for (const QString &part : parts) {
-        const QString tag = cleanUserTagTextWorker(part);
-        if (tag.isEmpty()) continue;
-        bool blocked = false;
-        for (const QString &blockedTag : blockedTags) {
-            if (tag.compare(blockedTag, Qt::CaseInsensitive) == 0) {
-                blocked = true;
-                break;
-            }
-        }
-        if (!blocked) tags.append(tag);
-    }
-    return tags;
-}
-
-void addPromptTagCounts(const QString &prompt, QMap<QString, int> &counts,
-                        QHash<QString, QString> &displayTags)
-{
-    if (prompt.trimmed().isEmpty()) return;
-    QSet<QString> tagsInImage;
-    for (const QString &tag : parseUserPromptTagsWorker(prompt)) {
-        const QString key = TagUtils::normalizedPromptTagKey(tag);
-        if (key.isEmpty() || tagsInImage.contains(key)) continue;
-        tagsInImage.insert(key);
-        if (!displayTags.contains(key)) displayTags.insert(key, tag);
-        counts[key]++;
-    }
-}
-
-void appendUserTagRows(const QMap<QString, int> &counts,
-                       const QHash<QString, QString> &displayTags,
-                       const QString &kind, QVector<UserTagUsageRow> &rows)
-{
-    for (auto it = counts.constBegin(); it != counts.constEnd(); ++it) {
+    QVector<UserTagUsageRow> rows;
+    const QVector<TagStatistics::TagCount> counts = corpus.tagStats.query();
+    rows.reserve(scope == 2 ? counts.size() * 2 : counts.size());
+    auto appendRow = [&rows](const QString &tag, const QString &kind, int count) {
         UserTagUsageRow row;
-        row.tag = displayTags.value(it.key(), it.key());
+        row.tag = tag;
         row.kind = kind;
-        row.count = it.value();
+        row.count = count;
         rows.append(row);
-    }
-}
-
-QVector<UserTagUsageRow> readUserTagRowsWorker(const QString &cachePath, int scope)
-{
-    QVector<UserTagUsageRow> rows;
-    QFile file(cachePath);
-    if (!file.open(QIODevice::ReadOnly)) return rows;
-
-    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
-    QMap<QString, int> positiveCounts;
-    QMap<QString, int> negativeCounts;
-    QHash<QString, QString> positiveDisplayTags;
-    QHash<QString, QString> negativeDisplayTags;
-    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
-        if (it.key().startsWith("__")) continue;
-        const QJsonObject obj = it.value().toObject();
-        if (scope == 0 || scope == 2) {
-            addPromptTagCounts(obj["p"].toString(), positiveCounts, positiveDisplayTags);
-        }
-        if (scope == 1 || scope == 2) {
-            addPromptTagCounts(obj["np"].toString(), negativeCounts, negativeDisplayTags);
-        }
-    }
-
-    if (scope == 0 || scope == 2) {
-        appendUserTagRows(positiveCounts, positiveDisplayTags, "正面", rows);
-    }
-    if (scope == 1 || scope == 2) {
-        appendUserTagRows(negativeCounts, negativeDisplayTags, "负面", rows);
+    };
+    for (const TagStatistics::TagCount &count : counts) {
+        if ((scope == 0 || scope == 2) && count.positive > 0) appendRow(count.display, "正面", count.positive);
+        if ((scope == 1 || scope == 2) && count.negative > 0) appendRow(count.display, "负面", count.negative);
     }
 
     std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
@@ -427,6 +345,10 @@ TagBrowserWidget::TagBrowserWidget(QWidget *parent)
     ui->tableUserTags->setSortingEnabled(true);
 
     connect(ui->tabWidgetTagBrowser, &QTabWidget::currentChanged, this, &TagBrowserWidget::onTabChanged);
+    // 图库 Tag 统计更新后，已打开过的用户 Tag 表跟着刷新
+    connect(GalleryCorpus::instance(), &GalleryCorpus::indexesChanged, this, [this]() {
+        if (m_userTagsLoaded || m_userTagsLoading) loadUserTags();
+    });
     connect(ui->editSearch, &QLineEdit::textChanged, this, &TagBrowserWidget::onSearchTextChanged);
     connect(ui->comboSearchMatchMode, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
         m_proxy->setMatchMode(index);
@@ -821,7 +743,7 @@ void TagBrowserWidget::updateUserTagTranslations()
 void TagBrowserWidget::updateUserTagStatusLabel()
 {
     if (m_userTagsLoading) {
-        ui->lblUserTagEmptyState->setText("正在读取 user_gallery_cache.json 并统计 Tag...");
+        ui->lblUserTagEmptyState->setText("正在统计图库 Tag...");
         ui->lblUserTagEmptyState->setVisible(true);
         ui->lblUserTagStatus->setText("用户 Tag 加载中...");
         ui->tableUserTags->setVisible(false);
@@ -859,7 +781,7 @@ void TagBrowserWidget::loadUserTags()
         m_userTagWatcher = nullptr;
     }
 
-    const QString cachePath = qApp->applicationDirPath() + "/config/user_gallery_cache.json";
+    const GalleryCorpusSnapshot corpus = GalleryCorpus::instance()->snapshot();
     const int scope = ui->comboUserTagScope->currentIndex();
     m_userTagWatcher = new QFutureWatcher<QVector<UserTagUsageRow>>(this);
     connect(m_userTagWatcher, &QFutureWatcher<QVector<UserTagUsageRow>>::finished, this, [this, generation]() {
@@ -921,8 +843,8 @@ void TagBrowserWidget::loadUserTags()
         updateUserTagStatusLabel();
     });
 
-    m_userTagWatcher->setFuture(QtConcurrent::run([cachePath, scope]() {
-        return readUserTagRowsWorker(cachePath, scope);
+    m_userTagWatcher->setFuture(QtConcurrent::run([corpus, scope]() {
+        return readUserTagRowsWorker(corpus, scope);
     }));
 }
 
@@ -1,5 +1,8 @@
 #include "usageanalysiswidget.h"
 #include "chartwidgets.h"
+#include "fileutils.h"
+#include "gallerycorpus.h"
+#include "perceptualhash.h"
 #include "styleconstants.h"
 #include "tableviewstylehelper.h"
 #include "ui_usageanalysiswidget.h"
@@ -7,6 +10,7 @@
 #include <QApplication>
 #include <QClipboard>
 #include <QComboBox>
+#include <QDir>
 #include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
@@ -19,7 +23,9 @@
 #include <QTableWidget>
 #include <QTextStream>
 #include <QTimer>
+#include <QTreeWidget>
 #include <QVBoxLayout>
+#include <QtConcurrent/QtConcurrent>
 #include <algorithm>
 
 namespace {
@@ -96,6 +102,68 @@ public:
 private:
     qint64 m_bytes = 0;
 };
+
+// 在后台线程运行：按感知哈希聚类图库图片，每组保留文件最大的一张（通常是高清修复版本）。
+// clusters() 按相似关系传递合并，A~B~C 的链条两端可能差得很远；因此再拆成以保留图片为中心的组，
+// 只有与保留图片相差不超过 maxDistance 位的才算副本，其余的在剩下的图片中重新选保留图片。
+GalleryDuplicateScan scanGalleryDuplicates(const GalleryCorpusSnapshot &corpus, int maxDistance)
+{
+    GalleryDuplicateScan scan;
+    scan.maxDistance = maxDistance;
+    QVector<const UserImageInfo *> images;
+    QVector<quint64> hashes;
+    for (const UserImageInfo &info : corpus.images) {
+        if (info.path.startsWith("__")) continue;
+        ++scan.totalImages;
+        if (!info.perceptualHashValid) continue;
+        images.append(&info);
+        hashes.append(info.perceptualHash);
+    }
+    scan.hashedImages = int(images.size());
+
+    for (QVector<int> remaining : PerceptualHash::clusters(hashes, maxDistance)) {
+        while (remaining.size() > 1) {
+            int kept = remaining.first();
+            for (int index : std::as_const(remaining)) {
+                if (images.at(index)->fileSize > images.at(kept)->fileSize) kept = index;
+            }
+            QVector<int> members;
+            QVector<int> rest;
+            for (int index : std::as_const(remaining)) {
+                if (PerceptualHash::distance(hashes.at(index), hashes.at(kept)) <= maxDistance) members.append(index);
+                else rest.append(index);
+            }
+            remaining = rest;
+            if (members.size() < 2) continue;
+            GalleryDuplicateCluster cluster;
+            auto append = [&](int index) {
+                GalleryDuplicateImage image;
+                image.path = images.at(index)->path;
+                image.bytes = qMax<qint64>(0, images.at(index)->fileSize);
+                image.distance = PerceptualHash::distance(hashes.at(index), hashes.at(kept));
+                cluster.images.append(image);
+            };
+            append(kept);
+            for (int index : members) {
+                if (index == kept) continue;
+                append(index);
+                cluster.reclaimableBytes += cluster.images.constLast().bytes;
+            }
+            std::sort(cluster.images.begin() + 1, cluster.images.end(), [](const auto &a, const auto &b) {
+                if (a.distance != b.distance) return a.distance < b.distance;
+                return a.path < b.path;
+            });
+            scan.duplicateImages += int(cluster.images.size()) - 1;
+            scan.reclaimableBytes += cluster.reclaimableBytes;
+            scan.clusters.append(cluster);
+        }
+    }
+    std::sort(scan.clusters.begin(), scan.clusters.end(), [](const auto &a, const auto &b) {
+        if (a.reclaimableBytes != b.reclaimableBytes) return a.reclaimableBytes > b.reclaimableBytes;
+        return a.images.first().path < b.images.first().path;
+    });
+    return scan;
+}
 }
 
 UsageAnalysisWidget::UsageAnalysisWidget(QWidget *parent)
@@ -159,6 +227,26 @@ UsageAnalysisWidget::UsageAnalysisWidget(QWidget *parent)
     largestHeader->setSectionResizeMode(3, QHeaderView::Fixed);
     largestHeader->resizeSection(3, 110);
 
+    // 图库重复图片 Tab
+    ui->treeDuplicates->setUniformRowHeights(true);
+    ui->treeDuplicates->header()->setStretchLastSection(false);
+    ui->treeDuplicates->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    ui->treeDuplicates->header()->setSectionResizeMode(1, QHeaderView::Stretch);
+    ui->treeDuplicates->header()->setSectionResizeMode(2, QHeaderView::Fixed);
+    ui->treeDuplicates->header()->setSectionResizeMode(3, QHeaderView::Fixed);
+    ui->treeDuplicates->header()->resizeSection(2, 110);
+    ui->treeDuplicates->header()->resizeSection(3, 90);
+    duplicateWatcher = new QFutureWatcher<GalleryDuplicateScan>(this);
+    connect(duplicateWatcher, &QFutureWatcher<GalleryDuplicateScan>::finished, this, [this]() {
+        ui->btnFindDuplicates->setEnabled(true);
+        showDuplicateScan(duplicateWatcher->result());
+    });
+    connect(ui->btnFindDuplicates, &QPushButton::clicked, this, &UsageAnalysisWidget::onFindDuplicatesClicked);
+    connect(ui->treeDuplicates, &QTreeWidget::itemDoubleClicked, this, [this](QTreeWidgetItem *item) {
+        const QString path = item ? item->data(0, Qt::UserRole).toString() : QString();
+        if (!path.isEmpty()) FileUtils::showFileInFolder(path, this);
+    });
+
     connect(ui->btnRefreshAnalysis, &QPushButton::clicked, this, &UsageAnalysisWidget::requestRefresh);
     connect(ui->editSearchModels, &QLineEdit::textChanged, this, &UsageAnalysisWidget::onSearchTextChanged);
     connect(ui->btnExportAnalysisCsv, &QPushButton::clicked, this, &UsageAnalysisWidget::onExportAnalysisCsvClicked);
@@ -343,6 +431,66 @@ void UsageAnalysisWidget::refreshDiskSpace()
     ui->tableLargestModels->horizontalHeader()->resizeSection(3, 110);
 }
 
+void UsageAnalysisWidget::onFindDuplicatesClicked()
+{
+    if (duplicateWatcher->isRunning()) return;
+    const GalleryCorpusSnapshot corpus = GalleryCorpus::instance()->snapshot();
+    if (!corpus.isLoaded()) {
+        ui->lblDuplicateSummary->setText("图库缓存尚未加载。");
+        return;
+    }
+    ui->btnFindDuplicates->setEnabled(false);
+    ui->lblDuplicateSummary->setText("正在查找重复图片...");
+    const int maxDistance = ui->spinDuplicateDistance->value();
+    duplicateWatcher->setFuture(QtConcurrent::run([corpus, maxDistance]() {
+        return scanGalleryDuplicates(corpus, maxDistance);
+    }));
+}
+
+void UsageAnalysisWidget::showDuplicateScan(const GalleryDuplicateScan &scan)
+{
+    // 组数可能很多，只列出可释放空间最大的一部分
+    constexpr int kMaxListedClusters = 500;
+    ui->treeDuplicates->setUpdatesEnabled(false);
+    ui->treeDuplicates->clear();
+    const int listed = qMin(kMaxListedClusters, int(scan.clusters.size()));
+    // 相似关系按链条传递合并后再拆组，组内只列出与保留图片足够接近的副本
+    const QString groupHint = QString("相似图片按链条传递合并（A 像 B、B 像 C 即归为一类），"
+                                      "再拆成以保留图片为中心的组：组内每张与保留图片最多相差 %1 位")
+                                  .arg(scan.maxDistance);
+    for (int i = 0; i < listed; ++i) {
+        const GalleryDuplicateCluster &cluster = scan.clusters.at(i);
+        auto *group = new QTreeWidgetItem(ui->treeDuplicates);
+        group->setText(0, QString("%1 张相似图片").arg(cluster.images.size()));
+        group->setText(2, humanSize(cluster.reclaimableBytes));
+        group->setToolTip(0, groupHint);
+        group->setToolTip(2, "删除保留图片以外的副本可释放的空间");
+        for (int j = 0; j < cluster.images.size(); ++j) {
+            const GalleryDuplicateImage &image = cluster.images.at(j);
+            const QFileInfo info(image.path);
+            auto *child = new QTreeWidgetItem(group);
+            child->setText(0, info.fileName());
+            child->setToolTip(0, image.path);
+            child->setData(0, Qt::UserRole, image.path);
+            child->setText(1, QDir::toNativeSeparators(info.absolutePath()));
+            child->setText(2, humanSize(image.bytes));
+            child->setText(3, j == 0 ? QString("保留") : image.distance == 0 ? QString("相同") : QString("差 %1 位").arg(image.distance));
+        }
+    }
+    ui->treeDuplicates->setUpdatesEnabled(true);
+
+    QString summary = QString("重复 %1 组 %2 张 · 可释放 %3")
+                          .arg(scan.clusters.size())
+                          .arg(scan.duplicateImages)
+                          .arg(humanSize(scan.reclaimableBytes));
+    if (scan.clusters.size() > listed) summary += QString("（列出前 %1 组）").arg(listed);
+    if (scan.hashedImages < scan.totalImages) {
+        summary += QString(" · 已计算指纹 %1 / %2 张，其余仍在后台计算").arg(scan.hashedImages).arg(scan.totalImages);
+    }
+    ui->lblDuplicateSummary->setText(summary);
+    ui->lblDuplicateSummary->setToolTip(groupHint);
+}
+
 void UsageAnalysisWidget::fillTopTable(QTableWidget *table, const QVector<QPair<QString, int>> &rows, const QString &nameHeader)
 {
     table->setSortingEnabled(false);
@@ -2,6 +2,7 @@
 #define USAGEANALYSISWIDGET_H
 
 #include <QDateTime>
+#include <QFutureWatcher>
 #include <QMap>
 #include <QString>
 #include <QVector>
@@ -44,6 +45,29 @@ struct UsageAnalysisData
     QDateTime generatedAt;
 };
 
+struct GalleryDuplicateImage
+{
+    QString path;
+    qint64 bytes = 0;
+    int distance = 0;          // 与保留图片的感知哈希相差的位数
+};
+
+struct GalleryDuplicateCluster
+{
+    QVector<GalleryDuplicateImage> images;   // 第一张为保留的图片（文件最大），其余可清理
+    qint64 reclaimableBytes = 0;
+};
+
+struct GalleryDuplicateScan
+{
+    QVector<GalleryDuplicateCluster> clusters;   // 按可释放空间从大到小
+    int totalImages = 0;
+    int hashedImages = 0;
+    int duplicateImages = 0;
+    qint64 reclaimableBytes = 0;
+    int maxDistance = 0;                          // 扫描时使用的最大汉明距离
+};
+
 class UsageAnalysisWidget : public QWidget
 {
     Q_OBJECT
@@ -61,6 +85,7 @@ signals:
 private slots:
     void onSearchTextChanged(const QString &text);
     void onExportAnalysisCsvClicked();
+    void onFindDuplicatesClicked();
 
 private:
     Ui::UsageAnalysisWidget *ui;
@@ -70,8 +95,10 @@ private:
     void refreshModelTable();
     void refreshCharts();
     void refreshDiskSpace();
+    void showDuplicateScan(const GalleryDuplicateScan &scan);
     void setStatus(const QString &text);
 
+    QFutureWatcher<GalleryDuplicateScan> *duplicateWatcher = nullptr;
     PieChartWidget *folderPie = nullptr;
     BarChartWidget *folderBar = nullptr;
     PieChartWidget *categoryPie = nullptr;
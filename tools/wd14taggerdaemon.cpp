@@ -0,0 +1,482 @@
+#include "wd14taggerdaemon.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDir>
+#include <QImage>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+// 空闲这么久后结束进程，模型常驻会占用数百 MB 内存或显存。
+constexpr int kIdleTimeoutMs = 5 * 60 * 1000;
+// 关闭 stdin 后等待脚本自行退出的时间，超时再强制结束。
+constexpr int kGracefulExitMs = 3000;
+// stderr 只用于出错时展示，保留末尾这么多字节即可。
+constexpr qsizetype kMaxStderrBytes = 64 * 1024;
+// 单个返回帧的上限（分数个数 × 4 字节），防止异常输出撑爆缓冲。
+constexpr qint64 kMaxScoresBytes = 16 * 1024 * 1024;
+
+// 缩放目标尺寸与脚本中的 fit_size 使用同一整数规则：只缩小不放大，保持比例，短边四舍五入。
+QSize wd14FitSize(int width, int height, int maxWidth, int maxHeight)
+{
+    if (width <= maxWidth && height <= maxHeight) return QSize(width, height);
+    if (qint64(width) * maxHeight >= qint64(height) * maxWidth) {
+        return QSize(maxWidth, int(qMax<qint64>(1, (qint64(height) * maxWidth * 2 + width) / (2 * qint64(width)))));
+    }
+    return QSize(int(qMax<qint64>(1, (qint64(width) * maxHeight * 2 + height) / (2 * qint64(height)))), maxHeight);
+}
+
+// 沿一个维度做面积平均缩小：输出第 i 个覆盖输入区间 [i*n/m, (i+1)*n/m)，用 double 前缀和在边界处按比例取像素。
+// 与脚本中的 area_resize_axis 逐步对应（相同的运算和求和顺序），两条路径得到相同的数值。
+void areaResampleLine(const double *in, qsizetype inStride, int n, double *out, qsizetype outStride, int m,
+                      QVector<double> &prefix)
+{
+    prefix.resize(n + 1);
+    prefix[0] = 0.0;
+    for (int j = 0; j < n; ++j) prefix[j + 1] = prefix[j] + in[j * inStride];
+    const double scale = double(n) / double(m);
+    auto integral = [&](int i) {
+        const double x = double(i) * double(n) / double(m);
+        const int k = int(std::floor(x));
+        if (k >= n) return prefix[n];
+        return prefix[k] + (x - double(k)) * in[k * inStride];
+    };
+    double previous = integral(0);
+    for (int i = 0; i < m; ++i) {
+        const double next = integral(i + 1);
+        out[i * outStride] = (next - previous) / scale;
+        previous = next;
+    }
+}
+
+// 与脚本中的 preprocess 一致：按 fit_size 的尺寸面积平均缩小，保持比例居中贴到白色画布上，RGB → BGR，值域 0-255。
+// 单图（这里）和批量（脚本）两条路径使用同一种重采样，阈值附近的 Tag 不会因路径不同而变化。
+Wd14Tensor preprocessWd14Image(const QString &imagePath, int width, int height, bool nchw)
+{
+    Wd14Tensor tensor;
+    QElapsedTimer timer;
+    timer.start();
+
+    // 不用 QImageReader::setScaledSize：解码器内部的缩小与脚本的重采样不同
+    QImageReader reader(imagePath);
+    reader.setAutoTransform(true);
+    QImage image = reader.read();
+    if (image.isNull()) {
+        tensor.error = "Failed to read image: " + reader.errorString();
+        return tensor;
+    }
+    image = image.convertToFormat(QImage::Format_RGB888);
+    const int sourceWidth = image.width();
+    const int sourceHeight = image.height();
+    const QSize fitted = wd14FitSize(sourceWidth, sourceHeight, width, height);
+    const int fittedWidth = fitted.width();
+    const int fittedHeight = fitted.height();
+
+    // 先横向再纵向，只在尺寸变化的维度上重采样（与脚本相同）
+    QVector<double> pixels(qsizetype(sourceWidth) * sourceHeight * 3);
+    for (int y = 0; y < sourceHeight; ++y) {
+        const uchar *src = image.constScanLine(y);
+        double *dst = pixels.data() + qsizetype(y) * sourceWidth * 3;
+        for (int x = 0; x < sourceWidth * 3; ++x) dst[x] = src[x];
+    }
+    image = QImage();
+    QVector<double> prefix;
+    if (fittedWidth != sourceWidth) {
+        QVector<double> resized(qsizetype(fittedWidth) * sourceHeight * 3);
+        for (int y = 0; y < sourceHeight; ++y) {
+            for (int c = 0; c < 3; ++c) {
+                areaResampleLine(pixels.constData() + qsizetype(y) * sourceWidth * 3 + c, 3, sourceWidth,
+                                 resized.data() + qsizetype(y) * fittedWidth * 3 + c, 3, fittedWidth, prefix);
+            }
+        }
+        pixels = std::move(resized);
+    }
+    if (fittedHeight != sourceHeight) {
+        QVector<double> resized(qsizetype(fittedWidth) * fittedHeight * 3);
+        const qsizetype rowStride = qsizetype(fittedWidth) * 3;
+        for (qsizetype column = 0; column < rowStride; ++column) {
+            areaResampleLine(pixels.constData() + column, rowStride, sourceHeight,
+                             resized.data() + column, rowStride, fittedHeight, prefix);
+        }
+        pixels = std::move(resized);
+    }
+
+    const qsizetype plane = qsizetype(width) * height;
+    tensor.data = QByteArray(plane * 3 * qsizetype(sizeof(float)), Qt::Uninitialized);
+    float *out = reinterpret_cast<float *>(tensor.data.data());
+    std::fill(out, out + plane * 3, 255.0f);
+
+    const int left = (width - fittedWidth) / 2;
+    const int top = (height - fittedHeight) / 2;
+    for (int y = 0; y < fittedHeight; ++y) {
+        const double *src = pixels.constData() + qsizetype(y) * fittedWidth * 3;
+        const qsizetype offset = qsizetype(top + y) * width + left;
+        if (nchw) {
+            float *blue = out + offset;
+            float *green = out + plane + offset;
+            float *red = out + 2 * plane + offset;
+            for (int x = 0; x < fittedWidth; ++x) {
+                red[x] = float(src[3 * x]);
+                green[x] = float(src[3 * x + 1]);
+                blue[x] = float(src[3 * x + 2]);
+            }
+        } else {
+            float *dst = out + offset * 3;
+            for (int x = 0; x < fittedWidth; ++x) {
+                dst[3 * x] = float(src[3 * x + 2]);
+                dst[3 * x + 1] = float(src[3 * x + 1]);
+                dst[3 * x + 2] = float(src[3 * x]);
+            }
+        }
+    }
+    tensor.elapsedSec = timer.nsecsElapsed() / 1e9;
+    return tensor;
+}
+
+QStringList splitCsvLine(const QString &line)
+{
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+    for (int i = 0; i < line.size(); ++i) {
+        const QChar ch = line.at(i);
+        if (quoted) {
+            if (ch == '"' && i + 1 < line.size() && line.at(i + 1) == '"') {
+                field += '"';
+                ++i;
+            } else if (ch == '"') {
+                quoted = false;
+            } else {
+                field += ch;
+            }
+        } else if (ch == '"') {
+            quoted = true;
+        } else if (ch == ',') {
+            fields << field;
+            field.clear();
+        } else {
+            field += ch;
+        }
+    }
+    fields << field;
+    return fields;
+}
+
+// selected_tags.csv：需要 name 和 category 两列，与脚本中的 load_labels 相同。
+QVector<Wd14Label> loadWd14Labels(const QString &csvPath, QString *error)
+{
+    QFile file(csvPath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *error = "selected_tags.csv not found: " + csvPath;
+        return {};
+    }
+    const QStringList lines = QString::fromUtf8(file.readAll()).split('\n');
+    if (lines.isEmpty()) {
+        *error = "selected_tags.csv is empty";
+        return {};
+    }
+    QString headerLine = lines.first().trimmed();
+    if (headerLine.startsWith(QChar(0xFEFF))) headerLine.remove(0, 1);
+    const QStringList header = splitCsvLine(headerLine);
+    const int nameColumn = header.indexOf("name");
+    const int categoryColumn = header.indexOf("category");
+    if (nameColumn < 0 || categoryColumn < 0) {
+        *error = "selected_tags.csv must contain name and category columns";
+        return {};
+    }
+    QVector<Wd14Label> labels;
+    labels.reserve(lines.size());
+    for (int i = 1; i < lines.size(); ++i) {
+        const QString line = lines.at(i).trimmed();
+        if (line.isEmpty()) continue;
+        const QStringList fields = splitCsvLine(line);
+        if (fields.size() <= std::max(nameColumn, categoryColumn)) continue;
+        bool ok = false;
+        const int category = fields.at(categoryColumn).trimmed().toInt(&ok);
+        const QString name = fields.at(nameColumn).trimmed();
+        if (ok && !name.isEmpty()) labels.append({name, category});
+    }
+    return labels;
+}
+
+QString wd14CategoryName(int category)
+{
+    if (category == 9) return QStringLiteral("rating");
+    if (category == 0) return QStringLiteral("general");
+    if (category == 4) return QStringLiteral("character");
+    return QStringLiteral("other");
+}
+
+Wd14InferenceResult wd14ScoresToResult(const QByteArray &scores, const QVector<Wd14Label> &labels, double threshold)
+{
+    Wd14InferenceResult result;
+    result.ok = true;
+    const float *values = reinterpret_cast<const float *>(scores.constData());
+    const qsizetype count = std::min<qsizetype>(scores.size() / qsizetype(sizeof(float)), labels.size());
+    for (qsizetype i = 0; i < count; ++i) {
+        const Wd14Label &label = labels.at(i);
+        float confidence = values[i];
+        if (!std::isfinite(confidence)) confidence = 0.0f;
+        if (label.category != 9 && confidence < threshold) continue;
+        Wd14TagScore score;
+        score.tag = label.name;
+        score.category = wd14CategoryName(label.category);
+        score.confidence = confidence;
+        (label.category == 9 ? result.ratings : result.tags).append(score);
+    }
+    std::sort(result.ratings.begin(), result.ratings.end(), [](const Wd14TagScore &a, const Wd14TagScore &b) {
+        return a.confidence > b.confidence;
+    });
+    std::sort(result.tags.begin(), result.tags.end(), [](const Wd14TagScore &a, const Wd14TagScore &b) {
+        if (a.confidence != b.confidence) return a.confidence > b.confidence;
+        return a.tag.compare(b.tag, Qt::CaseInsensitive) < 0;
+    });
+    return result;
+}
+} // namespace
+
+Wd14TaggerDaemon::Wd14TaggerDaemon(QObject *parent)
+    : QObject(parent)
+{
+    m_process = new QProcess(this);
+    m_process->setProcessChannelMode(QProcess::SeparateChannels);
+    connect(m_process, &QProcess::started, this, &Wd14TaggerDaemon::advance);
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &Wd14TaggerDaemon::readResponses);
+    connect(m_process, &QProcess::readyReadStandardError, this, [this]() {
+        m_stderrBuffer += m_process->readAllStandardError();
+        if (m_stderrBuffer.size() > kMaxStderrBytes) m_stderrBuffer.remove(0, m_stderrBuffer.size() - kMaxStderrBytes);
+    });
+    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &Wd14TaggerDaemon::handleProcessFinished);
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error != QProcess::FailedToStart) return;
+        m_stage = Stage::Idle;
+        emit startFailed(m_process->errorString());
+    });
+
+    m_preprocessWatcher = new QFutureWatcher<Wd14Tensor>(this);
+    connect(m_preprocessWatcher, &QFutureWatcher<Wd14Tensor>::finished, this, [this]() {
+        if (m_stage != Stage::Preprocessing) return;
+        m_tensor = m_preprocessWatcher->result();
+        if (!m_tensor.error.isEmpty()) {
+            fail("WD14 inference failed: " + m_tensor.error);
+            return;
+        }
+        m_stage = Stage::Inferring;
+        advance();
+    });
+
+    m_idleTimer = new QTimer(this);
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(kIdleTimeoutMs);
+    connect(m_idleTimer, &QTimer::timeout, this, [this]() {
+        if (isBusy() || m_process->state() == QProcess::NotRunning) return;
+        // 关闭 stdin 后脚本读到 EOF 自行退出
+        m_stopping = true;
+        m_process->closeWriteChannel();
+        m_exitTimer->start();
+    });
+    // 宽限期后仍未退出就强制结束；QProcess 会被复用，重新启动前必须停掉，否则会杀掉新进程
+    m_exitTimer = new QTimer(this);
+    m_exitTimer->setSingleShot(true);
+    m_exitTimer->setInterval(kGracefulExitMs);
+    connect(m_exitTimer, &QTimer::timeout, this, [this]() {
+        if (m_stopping && m_process->state() != QProcess::NotRunning) m_process->kill();
+    });
+}
+
+Wd14TaggerDaemon::~Wd14TaggerDaemon()
+{
+    m_process->disconnect(this);
+    m_preprocessWatcher->disconnect(this);
+    m_preprocessWatcher->waitForFinished();
+    if (m_process->state() != QProcess::NotRunning) {
+        m_process->kill();
+        m_process->waitForFinished(1000);
+    }
+}
+
+bool Wd14TaggerDaemon::isRunning() const
+{
+    return m_process->state() == QProcess::Running && !m_stopping;
+}
+
+void Wd14TaggerDaemon::request(const QString &pythonPath, const QString &scriptPath,
+                               const QString &imagePath, const QString &modelDir, double threshold)
+{
+    if (isBusy()) return;
+    if (m_process->state() != QProcess::NotRunning
+        && (pythonPath != m_pythonPath || scriptPath != m_scriptPath || m_stopping)) {
+        shutdown();
+    }
+    m_pythonPath = pythonPath;
+    m_scriptPath = scriptPath;
+    m_imagePath = imagePath;
+    m_modelDir = modelDir;
+    m_threshold = threshold;
+    m_tensor = Wd14Tensor();
+    m_retried = false;
+    m_stderrBuffer.clear();
+    m_idleTimer->stop();
+
+    // 模型尺寸已知时预处理和进程启动同时进行
+    if (m_model.dir == modelDir) {
+        startPreprocessing();
+    } else {
+        m_stage = Stage::Describing;
+    }
+    if (m_process->state() == QProcess::Running) advance();
+    else ensureStarted();
+}
+
+void Wd14TaggerDaemon::shutdown()
+{
+    m_idleTimer->stop();
+    m_exitTimer->stop();
+    if (m_process->state() != QProcess::NotRunning) {
+        m_stopping = true;
+        m_process->kill();
+        m_process->waitForFinished(1000);
+    }
+    m_stopping = false;
+    m_stdoutBuffer.clear();
+    if (isBusy()) fail("WD14 Python 进程已停止。");
+}
+
+void Wd14TaggerDaemon::ensureStarted()
+{
+    if (m_process->state() != QProcess::NotRunning) return;
+    m_exitTimer->stop();
+    m_stopping = false;
+    m_stdoutBuffer.clear();
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert("PYTHONUNBUFFERED", "1");
+    environment.insert("PYTHONIOENCODING", "utf-8");
+    m_process->setProcessEnvironment(environment);
+    m_process->start(m_pythonPath, {m_scriptPath, "--serve"});
+}
+
+void Wd14TaggerDaemon::advance()
+{
+    if (m_process->state() != QProcess::Running) return;
+    if (m_stage == Stage::Describing) {
+        QJsonObject header;
+        header["cmd"] = "describe";
+        header["model_dir"] = m_modelDir;
+        sendFrame(header);
+    } else if (m_stage == Stage::Inferring) {
+        QJsonObject header;
+        header["cmd"] = "infer";
+        header["model_dir"] = m_modelDir;
+        header["width"] = m_model.width;
+        header["height"] = m_model.height;
+        header["nchw"] = m_model.nchw;
+        header["tensor_bytes"] = qint64(m_tensor.data.size());
+        sendFrame(header, m_tensor.data);
+    }
+}
+
+void Wd14TaggerDaemon::startPreprocessing()
+{
+    m_stage = Stage::Preprocessing;
+    const QString imagePath = m_imagePath;
+    const int width = m_model.width;
+    const int height = m_model.height;
+    const bool nchw = m_model.nchw;
+    m_preprocessWatcher->setFuture(QtConcurrent::run([imagePath, width, height, nchw]() {
+        return preprocessWd14Image(imagePath, width, height, nchw);
+    }));
+}
+
+void Wd14TaggerDaemon::sendFrame(const QJsonObject &header, const QByteArray &payload)
+{
+    QJsonObject frame = header;
+    m_awaitingId = m_nextId++;
+    frame["id"] = m_awaitingId;
+    m_process->write(QJsonDocument(frame).toJson(QJsonDocument::Compact));
+    m_process->write("\n");
+    if (!payload.isEmpty()) m_process->write(payload);
+}
+
+void Wd14TaggerDaemon::readResponses()
+{
+    m_stdoutBuffer += m_process->readAllStandardOutput();
+    while (true) {
+        const qsizetype newline = m_stdoutBuffer.indexOf('\n');
+        if (newline < 0) return;
+        const QJsonObject header = QJsonDocument::fromJson(m_stdoutBuffer.left(newline)).object();
+        const qint64 payloadBytes = qBound<qint64>(0, header.value("scores_bytes").toInteger(), kMaxScoresBytes);
+        if (m_stdoutBuffer.size() < newline + 1 + payloadBytes) return;
+        const QByteArray payload = m_stdoutBuffer.mid(newline + 1, payloadBytes);
+        m_stdoutBuffer.remove(0, newline + 1 + payloadBytes);
+        // ready 事件和过期请求的结果直接丢弃
+        if (isBusy() && header.value("id").toInteger(-1) == m_awaitingId) handleResponse(header, payload);
+    }
+}
+
+void Wd14TaggerDaemon::handleResponse(const QJsonObject &header, const QByteArray &payload)
+{
+    if (!header.value("ok").toBool(false)) {
+        fail(header.value("error").toString("WD14 Python 反推失败。"));
+        return;
+    }
+    if (m_stage == Stage::Describing) {
+        ModelInfo model;
+        model.dir = m_modelDir;
+        model.width = header.value("width").toInt();
+        model.height = header.value("height").toInt();
+        model.nchw = header.value("nchw").toBool();
+        QString error;
+        model.labels = loadWd14Labels(QDir(m_modelDir).filePath("selected_tags.csv"), &error);
+        if (model.width <= 0 || model.height <= 0 || model.labels.isEmpty()) {
+            m_model = ModelInfo();
+            fail(error.isEmpty() ? QStringLiteral("WD14 模型输入尺寸无效。") : error);
+            return;
+        }
+        m_model = model;
+        startPreprocessing();
+        return;
+    }
+    if (m_stage != Stage::Inferring) return;
+    Wd14InferenceResult result = wd14ScoresToResult(payload, m_model.labels, m_threshold);
+    result.elapsedSec = m_tensor.elapsedSec + header.value("elapsed_sec").toDouble();
+    complete(result);
+}
+
+void Wd14TaggerDaemon::handleProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    Q_UNUSED(exitStatus);
+    m_stdoutBuffer.clear();
+    const bool expected = std::exchange(m_stopping, false);
+    if (!isBusy() || expected) return;
+    if (!m_retried) {
+        // 处理中崩溃（例如显存不足后被系统结束）：重启一次，started 后按当前阶段重发
+        m_retried = true;
+        ensureStarted();
+        return;
+    }
+    const QString stderrText = QString::fromUtf8(m_stderrBuffer).trimmed();
+    fail(stderrText.isEmpty() ? QString("WD14 Python 进程异常退出 (exit %1)。").arg(exitCode) : stderrText.right(1000));
+}
+
+void Wd14TaggerDaemon::fail(const QString &error)
+{
+    Wd14InferenceResult result;
+    result.error = error;
+    complete(result);
+}
+
+void Wd14TaggerDaemon::complete(Wd14InferenceResult result)
+{
+    m_stage = Stage::Idle;
+    m_tensor = Wd14Tensor();
+    if (m_process->state() == QProcess::Running) m_idleTimer->start();
+    emit finished(result);
+}
@@ -0,0 +1,100 @@
+#ifndef WD14TAGGERDAEMON_H
+#define WD14TAGGERDAEMON_H
+
+#include "wd14historymodel.h"
+
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <QJsonObject>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QVector>
+
+class QTimer;
+
+struct Wd14Label
+{
+    QString name;
+    int category = -1;
+};
+
+// 预处理好的模型输入
+struct Wd14Tensor
+{
+    QByteArray data;           // float32，本机字节序
+    QString error;
+    double elapsedSec = 0.0;
+};
+
+// 常驻的 WD14 Python 进程（wd14_tagger.py --serve）：解释器启动、onnxruntime 导入和模型加载只发生一次，
+// 之后每次单图反推只剩推理本身。空闲一段时间后退出以释放内存，处理请求时进程崩溃会自动重启并重发一次。
+//
+// 图片解码、缩放、补边和 BGR 转换在本进程的线程池里完成，张量以原始 float32 经 stdin 发给 Python；
+// Python 只跑模型，把原始分数原样返回，阈值筛选和排序也在这里做，不再经过逐个标签的 JSON。
+// 每帧是一行 JSON 头，头中 tensor_bytes / scores_bytes 给出紧随其后的二进制长度。
+class Wd14TaggerDaemon : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Wd14TaggerDaemon(QObject *parent = nullptr);
+    ~Wd14TaggerDaemon() override;
+
+    bool isBusy() const { return m_stage != Stage::Idle; }
+    // 进程已启动，模型大概率已经加载
+    bool isRunning() const;
+    // 解释器或脚本与当前进程不同时先重启。忙碌时忽略。
+    void request(const QString &pythonPath, const QString &scriptPath,
+                 const QString &imagePath, const QString &modelDir, double threshold);
+    // 结束进程释放模型占用的内存（例如开始批量任务前）；正在处理的请求会以失败结束。
+    void shutdown();
+
+signals:
+    void finished(const Wd14InferenceResult &result);
+    void startFailed(const QString &error);
+
+private:
+    enum class Stage { Idle, Describing, Preprocessing, Inferring };
+
+    struct ModelInfo {
+        QString dir;
+        int width = 0;
+        int height = 0;
+        bool nchw = false;
+        QVector<Wd14Label> labels;
+    };
+
+    void ensureStarted();
+    void advance();
+    void startPreprocessing();
+    void sendFrame(const QJsonObject &header, const QByteArray &payload = QByteArray());
+    void readResponses();
+    void handleResponse(const QJsonObject &header, const QByteArray &payload);
+    void handleProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void fail(const QString &error);
+    void complete(Wd14InferenceResult result);
+
+    QProcess *m_process = nullptr;
+    QTimer *m_idleTimer = nullptr;
+    QTimer *m_exitTimer = nullptr;          // 空闲退出的宽限期
+    QFutureWatcher<Wd14Tensor> *m_preprocessWatcher = nullptr;
+    QString m_pythonPath;
+    QString m_scriptPath;
+    QByteArray m_stdoutBuffer;
+    QByteArray m_stderrBuffer;
+    ModelInfo m_model;
+
+    // 当前请求
+    Stage m_stage = Stage::Idle;
+    QString m_imagePath;
+    QString m_modelDir;
+    double m_threshold = 0.35;
+    Wd14Tensor m_tensor;
+    qint64 m_awaitingId = 0;
+    bool m_retried = false;
+    bool m_stopping = false;
+    qint64 m_nextId = 1;
+};
+
+#endif // WD14TAGGERDAEMON_H
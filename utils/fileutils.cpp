@@ -1,3 +1,4 @@
+#define OPENSSL_SUPPRESS_DEPRECATED
 #include "fileutils.h"
 
 #include <QCryptographicHash>
@@ -8,6 +9,8 @@
 #include <QProcess>
 #include <QUrl>
 
+#include <cstring>
+
 namespace FileUtils {
 
 QString calculateSha256Hex(const QString &filePath, bool uppercase)
@@ -36,6 +39,68 @@ QString calculateSha256Hex(const QString &filePath, bool uppercase)
     return uppercase ? result.toUpper() : result;
 }
 
+namespace {
+constexpr char kSha256StateMagic[] = "S256";
+// 版本 2 起保存 OpenSSL 的 SHA256_CTX；旧版本的状态不再接受，续传时回退到整文件校验
+constexpr int kSha256StateVersion = 2;
+constexpr qsizetype kSha256StateHeaderSize = 4 + 1;
+} // namespace
+
+// SHA256_Init / Update / Final 在 OpenSSL 3 中标记为弃用，但只有它们的上下文是可以直接保存的普通结构体；
+// 底层仍走 OpenSSL 按 CPU 选择的 SHA-NI / AVX 实现。
+void Sha256Stream::reset()
+{
+    SHA256_Init(&m_context);
+}
+
+void Sha256Stream::addData(const char *data, qsizetype size)
+{
+    if (!data || size <= 0) return;
+    SHA256_Update(&m_context, data, size_t(size));
+}
+
+quint64 Sha256Stream::processedBytes() const
+{
+    return ((quint64(m_context.Nh) << 32) | m_context.Nl) / 8;
+}
+
+QString Sha256Stream::resultHex(bool uppercase) const
+{
+    // 在副本上结束计算，流本身仍可继续追加数据。
+    SHA256_CTX copy = m_context;
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256_Final(digest, &copy);
+    const QString result = QString::fromLatin1(
+        QByteArray(reinterpret_cast<const char *>(digest), SHA256_DIGEST_LENGTH).toHex());
+    return uppercase ? result.toUpper() : result;
+}
+
+QByteArray Sha256Stream::saveState() const
+{
+    QByteArray out(kSha256StateMagic, 4);
+    out.append(char(kSha256StateVersion));
+    out.append(reinterpret_cast<const char *>(&m_context), qsizetype(sizeof(SHA256_CTX)));
+    return out;
+}
+
+bool Sha256Stream::restoreState(const QByteArray &state)
+{
+    if (state.size() != kSha256StateHeaderSize + qsizetype(sizeof(SHA256_CTX))
+        || !state.startsWith(kSha256StateMagic) || state.at(4) != char(kSha256StateVersion)) {
+        return false;
+    }
+    SHA256_CTX context;
+    std::memcpy(&context, state.constData() + kSha256StateHeaderSize, sizeof(SHA256_CTX));
+    // 缓冲区中的字节数必须与已处理的总长度一致，否则视为损坏
+    const quint64 totalBytes = ((quint64(context.Nh) << 32) | context.Nl) / 8;
+    if (context.md_len != SHA256_DIGEST_LENGTH || context.num >= SHA256_CBLOCK
+        || context.num != totalBytes % SHA256_CBLOCK) {
+        return false;
+    }
+    m_context = context;
+    return true;
+}
+
 bool showFileInFolder(const QString &filePath, QObject *processParent)
 {
     const QString trimmed = filePath.trimmed();
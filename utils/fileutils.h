@@ -1,13 +1,37 @@
 #ifndef FILEUTILS_H
 #define FILEUTILS_H
 
+#include <QByteArray>
 #include <QString>
 
+#include <openssl/sha.h>
+
 class QObject;
 
 namespace FileUtils {
 
 QString calculateSha256Hex(const QString &filePath, bool uppercase = true);
+
+// 可序列化中间状态的流式 SHA-256：下载时边写边算，断点续传时从保存的状态继续，
+// 不必在完成后重新读取整个文件。计算交给 OpenSSL，保存的状态就是 SHA256_CTX 本身。
+class Sha256Stream
+{
+public:
+    Sha256Stream() { reset(); }
+
+    void reset();
+    void addData(const char *data, qsizetype size);
+    void addData(const QByteArray &data) { addData(data.constData(), data.size()); }
+    quint64 processedBytes() const;
+    QString resultHex(bool uppercase = true) const;
+
+    QByteArray saveState() const;
+    bool restoreState(const QByteArray &state);
+
+private:
+    SHA256_CTX m_context{};
+};
+
 bool showFileInFolder(const QString &filePath, QObject *processParent = nullptr);
 
 } // namespace FileUtils
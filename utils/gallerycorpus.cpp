@@ -0,0 +1,119 @@
+#include "gallerycorpus.h"
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QtConcurrent/QtConcurrent>
+
+#include <utility>
+
+namespace {
+bool imageChanged(const UserImageInfo &a, const UserImageInfo &b)
+{
+    return a.lastModified != b.lastModified
+           || a.parserVersion != b.parserVersion
+           || a.cleanTags != b.cleanTags
+           || a.negativeCleanTags != b.negativeCleanTags
+           || a.prompt != b.prompt
+           || a.negativePrompt != b.negativePrompt
+           || a.parameters != b.parameters;
+}
+} // namespace
+
+GalleryCorpus::GalleryCorpus(QObject *parent)
+    : QObject(parent)
+{
+    m_indexWatcher = new QFutureWatcher<IndexUpdate>(this);
+    connect(m_indexWatcher, &QFutureWatcher<IndexUpdate>::finished, this, [this]() {
+        const IndexUpdate update = m_indexWatcher->result();
+        m_indexedImages = update.images;
+        {
+            QMutexLocker locker(&m_mutex);
+            m_snapshot.tagStats = update.stats;
+            m_snapshot.searchIndex = update.searchIndex;
+            m_snapshot.indexesVersion = update.version;
+        }
+        emit indexesChanged(update.version);
+        if (std::exchange(m_indexPending, false)) scheduleIndexUpdate();
+    });
+}
+
+GalleryCorpus *GalleryCorpus::instance()
+{
+    // 挂在 qApp 下，随应用一起析构
+    static GalleryCorpus *corpus = new GalleryCorpus(QCoreApplication::instance());
+    return corpus;
+}
+
+GalleryCorpusSnapshot GalleryCorpus::snapshot() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_snapshot;
+}
+
+quint64 GalleryCorpus::version() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_snapshot.version;
+}
+
+void GalleryCorpus::publish(const QMap<QString, UserImageInfo> &images)
+{
+    quint64 version = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_snapshot.images = images;
+        version = ++m_snapshot.version;
+    }
+    emit changed(version);
+    scheduleIndexUpdate();
+}
+
+void GalleryCorpus::publishPerceptualHashes(const QMap<QString, UserImageInfo> &images)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_snapshot.images = images;
+    }
+    emit perceptualHashesChanged();
+}
+
+void GalleryCorpus::scheduleIndexUpdate()
+{
+    // 同一时刻只有一个更新任务；期间的发布合并成完成后的一次
+    if (m_indexWatcher->isRunning()) {
+        m_indexPending = true;
+        return;
+    }
+    const GalleryCorpusSnapshot current = snapshot();
+    const QMap<QString, UserImageInfo> previous = m_indexedImages;
+    m_indexWatcher->setFuture(QtConcurrent::run([current, previous]() {
+        IndexUpdate update;
+        update.version = current.version;
+        update.images = current.images;
+        update.stats = current.tagStats;
+        update.searchIndex = current.searchIndex;
+
+        // 两个 QMap 都按路径有序，同步遍历一遍即可得到差异，只处理新增、删除和内容变化的图片
+        auto add = [&update](const UserImageInfo &info) {
+            update.stats.addImage(info);
+            update.searchIndex.addImage(info);
+        };
+        auto oldIt = previous.constBegin();
+        auto newIt = current.images.constBegin();
+        while (oldIt != previous.constEnd() || newIt != current.images.constEnd()) {
+            if (newIt == current.images.constEnd() || (oldIt != previous.constEnd() && oldIt.key() < newIt.key())) {
+                update.stats.removeImage(oldIt.key());
+                update.searchIndex.removeImage(oldIt.key());
+                ++oldIt;
+            } else if (oldIt == previous.constEnd() || newIt.key() < oldIt.key()) {
+                add(newIt.value());
+                ++newIt;
+            } else {
+                if (imageChanged(oldIt.value(), newIt.value())) add(newIt.value());
+                ++oldIt;
+                ++newIt;
+            }
+        }
+        return update;
+    }));
+}
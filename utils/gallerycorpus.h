@@ -0,0 +1,87 @@
+#ifndef GALLERYCORPUS_H
+#define GALLERYCORPUS_H
+
+#include "imageparameters.h"
+#include "promptsearchindex.h"
+#include "tagstatistics.h"
+
+#include <QFutureWatcher>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+struct UserImageInfo {
+    QString path;
+    QString prompt;
+    QStringList cleanTags;
+    QStringList negativeCleanTags;
+    QString negativePrompt;
+    QString parameters;
+    ImageParameters params;             // 由 parameters 和 prompt 提取的结构化参数，随缓存保存
+    qint64 lastModified = 0;
+    int parserVersion = 0;
+    // 感知哈希由主窗口在后台补算；fileSize < 0 表示这张图（当前的 lastModified）还没算过
+    quint64 perceptualHash = 0;
+    qint64 fileSize = -1;
+    bool perceptualHashValid = false;   // 解码失败时为 false，不再重试
+};
+
+// 图库语料的只读快照。images 与主窗口的 imageCache 隐式共享，取快照不复制数据，
+// 主窗口之后修改 imageCache 时才会分离，已发出的快照保持不变，可以交给后台线程遍历。
+struct GalleryCorpusSnapshot {
+    quint64 version = 0;                   // 每次发布递增；0 表示主窗口尚未加载图库缓存
+    QMap<QString, UserImageInfo> images;   // 图片路径 → 信息
+    TagStatistics tagStats;                // 以下两项在后台增量更新，可能落后于 images
+    PromptSearchIndex searchIndex;
+    quint64 indexesVersion = 0;            // tagStats 和 searchIndex 对应的 version
+
+    bool isLoaded() const { return version != 0; }
+    bool indexesCurrent() const { return isLoaded() && indexesVersion == version; }
+};
+
+// 进程内共享的图库语料：主窗口在 imageCache 变化后发布，各工具页从这里取快照，
+// 不再各自读取和解析 user_gallery_cache.json。
+class GalleryCorpus : public QObject
+{
+    Q_OBJECT
+
+public:
+    static GalleryCorpus *instance();
+
+    // 可在任意线程调用。
+    GalleryCorpusSnapshot snapshot() const;
+    quint64 version() const;
+
+    // 在主线程调用。
+    void publish(const QMap<QString, UserImageInfo> &images);
+    // 只有感知哈希变化时用：替换快照里的图片数据，但不递增 version、不重建索引（索引不依赖哈希），
+    // 只发出 perceptualHashesChanged。
+    void publishPerceptualHashes(const QMap<QString, UserImageInfo> &images);
+
+signals:
+    void changed(quint64 version);
+    void indexesChanged(quint64 version);
+    void perceptualHashesChanged();
+
+private:
+    struct IndexUpdate {
+        quint64 version = 0;
+        QMap<QString, UserImageInfo> images;
+        TagStatistics stats;
+        PromptSearchIndex searchIndex;
+    };
+
+    explicit GalleryCorpus(QObject *parent = nullptr);
+    void scheduleIndexUpdate();
+
+    mutable QMutex m_mutex;
+    GalleryCorpusSnapshot m_snapshot;
+    // 以下只在主线程访问
+    QFutureWatcher<IndexUpdate> *m_indexWatcher = nullptr;
+    QMap<QString, UserImageInfo> m_indexedImages;   // 索引当前对应的图片集合，用于求差异
+    bool m_indexPending = false;
+};
+
+#endif // GALLERYCORPUS_H
@@ -0,0 +1,248 @@
+#include "imageparameters.h"
+
+#include <QJsonArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QSet>
+
+#include <utility>
+
+namespace {
+QString unquoted(QString value)
+{
+    value = value.trimmed();
+    if (value.size() >= 2 && value.startsWith('"') && value.endsWith('"')) value = value.mid(1, value.size() - 2);
+    return value.trimmed();
+}
+
+// 模型哈希至少 6 位（AutoV1 短哈希），过短的多半是误识别
+QString validHash(const QString &text)
+{
+    static const QRegularExpression hashRegex(QStringLiteral("^\\s*([A-Fa-f0-9]{6,128})"));
+    const QRegularExpressionMatch match = hashRegex.match(text);
+    return match.hasMatch() ? ImageParameters::normalizedHash(match.captured(1)) : QString();
+}
+
+void appendUnique(QStringList &list, const QString &value)
+{
+    const QString trimmed = value.trimmed();
+    if (trimmed.isEmpty() || list.contains(trimmed)) return;
+    list.append(ImageParameters::intern(trimmed));
+}
+
+void appendLora(QVector<ImageParameters::Lora> &loras, const QString &name, double weight, bool fromPrompt)
+{
+    const QString trimmed = name.trimmed();
+    if (trimmed.isEmpty()) return;
+    for (const ImageParameters::Lora &lora : std::as_const(loras)) {
+        if (lora.name.compare(trimmed, Qt::CaseInsensitive) == 0) return;
+    }
+    ImageParameters::Lora lora;
+    lora.name = ImageParameters::intern(trimmed);
+    lora.weight = weight;
+    lora.fromPrompt = fromPrompt;
+    loras.append(lora);
+}
+
+double weightOrDefault(const QString &text)
+{
+    bool ok = false;
+    const double weight = text.trimmed().toDouble(&ok);
+    return ok ? weight : 1.0;
+}
+} // namespace
+
+ImageParameters ImageParameters::parse(const QString &parameters, const QString &prompt)
+{
+    ImageParameters params;
+
+    static const QRegularExpression promptLoraRegex(QStringLiteral("<\\s*(?:lora|lyco)\\s*:\\s*([^:>]+)(?::\\s*([^:>]*))?"),
+                                                    QRegularExpression::CaseInsensitiveOption);
+    auto loraIt = promptLoraRegex.globalMatch(prompt);
+    while (loraIt.hasNext()) {
+        const QRegularExpressionMatch match = loraIt.next();
+        appendLora(params.loras, match.captured(1), weightOrDefault(match.captured(2)), true);
+    }
+    if (parameters.isEmpty()) return params;
+
+    // 单值字段：A1111 的 "Key: value, Key: value" 与 ComfyUI 整理出的逐行参数都是这种形式
+    static const QRegularExpression fieldRegex(
+        QStringLiteral("(?:^|[,\\n\\r])\\s*([A-Za-z][A-Za-z0-9 _-]*?)\\s*:\\s*(\"[^\"]*\"|[^,\\n\\r]*)"));
+    static const QRegularExpression sizeRegex(QStringLiteral("^(\\d+)\\s*x\\s*(\\d+)$"));
+    static const QRegularExpression addNetModelRegex(QStringLiteral("^addnet model (hash )?\\d+$"));
+    auto fieldIt = fieldRegex.globalMatch(parameters);
+    while (fieldIt.hasNext()) {
+        const QRegularExpressionMatch match = fieldIt.next();
+        const QString key = match.captured(1).simplified().toCaseFolded();
+        const QString value = unquoted(match.captured(2));
+        if (value.isEmpty()) continue;
+
+        if (key == "seed") {
+            bool ok = false;
+            quint64 seed = value.toULongLong(&ok);
+            // 部分前端会写出负数种子（如 -1 或溢出后的值），按相同的 64 位位模式保存
+            if (!ok) seed = quint64(value.toLongLong(&ok));
+            if (ok && !params.hasSeed) {
+                params.seed = seed;
+                params.hasSeed = true;
+            }
+        } else if (key == "steps") {
+            if (params.steps == 0) params.steps = value.toInt();
+        } else if (key == "cfg scale" || key == "cfg") {
+            if (params.cfg == 0.0) params.cfg = value.toDouble();
+        } else if (key == "sampler") {
+            if (params.sampler.isEmpty()) params.sampler = intern(value);
+        } else if (key == "scheduler" || key == "schedule type") {
+            if (params.scheduler.isEmpty()) params.scheduler = intern(value);
+        } else if (key == "size") {
+            const QRegularExpressionMatch size = sizeRegex.match(value);
+            if (size.hasMatch() && params.width == 0) {
+                params.width = size.captured(1).toInt();
+                params.height = size.captured(2).toInt();
+            }
+        } else if (key == "model" || key == "checkpoint") {
+            appendUnique(params.checkpointNames, value);
+        } else if (key == "model hash") {
+            appendUnique(params.checkpointHashes, validHash(value));
+        } else if (key == "source") {
+            if (value.startsWith("ComfyUI", Qt::CaseInsensitive)) params.isComfy = true;
+        } else {
+            const QRegularExpressionMatch addNet = addNetModelRegex.match(key);
+            if (!addNet.hasMatch()) continue;
+            if (addNet.capturedLength(1) > 0) appendUnique(params.loraHashes, validHash(value));
+            else appendLora(params.loras, value, 1.0, false);
+        }
+    }
+
+    // 以下几个块本身含逗号，单独按整行提取
+    static const QRegularExpression loraHashesRegex(
+        QStringLiteral("(?:^|[,\\n\\r])\\s*Lora\\s+hashes\\s*:\\s*(\"[^\"]*\"|[^\\n\\r]*)"),
+        QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression namedValueRegex(QStringLiteral("([^:,]+?)\\s*:\\s*([^,]*)"));
+    auto blockIt = loraHashesRegex.globalMatch(parameters);
+    while (blockIt.hasNext()) {
+        auto entryIt = namedValueRegex.globalMatch(unquoted(blockIt.next().captured(1)));
+        while (entryIt.hasNext()) {
+            const QRegularExpressionMatch entry = entryIt.next();
+            appendLora(params.loras, entry.captured(1), 1.0, false);
+            appendUnique(params.loraHashes, validHash(entry.captured(2)));
+        }
+    }
+
+    static const QRegularExpression comfyLorasRegex(QStringLiteral("(?:^|[,\\n\\r])\\s*ComfyUI\\s+LoRAs\\s*:\\s*([^\\n\\r]*)"),
+                                                    QRegularExpression::CaseInsensitiveOption);
+    auto comfyIt = comfyLorasRegex.globalMatch(parameters);
+    while (comfyIt.hasNext()) {
+        const QStringList entries = comfyIt.next().captured(1).split(',', Qt::SkipEmptyParts);
+        for (const QString &entry : entries) {
+            const int colon = entry.indexOf(':');
+            appendLora(params.loras, colon > 0 ? entry.left(colon) : entry,
+                       colon > 0 ? weightOrDefault(entry.mid(colon + 1)) : 1.0, false);
+        }
+    }
+
+    static const QRegularExpression comfyHashesRegex(
+        QStringLiteral("(?:^|[,\\n\\r])\\s*ComfyUI\\s+Lora\\s+hashes\\s*:\\s*([^\\n\\r]*)"),
+        QRegularExpression::CaseInsensitiveOption);
+    auto comfyHashIt = comfyHashesRegex.globalMatch(parameters);
+    while (comfyHashIt.hasNext()) {
+        auto entryIt = namedValueRegex.globalMatch(comfyHashIt.next().captured(1));
+        while (entryIt.hasNext()) appendUnique(params.loraHashes, validHash(entryIt.next().captured(2)));
+    }
+
+    return params;
+}
+
+QJsonObject ImageParameters::toJson() const
+{
+    QJsonObject object;
+    object["v"] = kVersion;
+    if (!sampler.isEmpty()) object["sa"] = sampler;
+    if (!scheduler.isEmpty()) object["sc"] = scheduler;
+    if (!checkpointNames.isEmpty()) object["ck"] = QJsonArray::fromStringList(checkpointNames);
+    if (!checkpointHashes.isEmpty()) object["ckh"] = QJsonArray::fromStringList(checkpointHashes);
+    if (!loras.isEmpty()) {
+        QJsonArray array;
+        for (const Lora &lora : loras) {
+            QJsonObject entry;
+            entry["n"] = lora.name;
+            if (lora.weight != 1.0) entry["w"] = lora.weight;
+            if (lora.fromPrompt) entry["p"] = true;
+            array.append(entry);
+        }
+        object["lo"] = array;
+    }
+    if (!loraHashes.isEmpty()) object["loh"] = QJsonArray::fromStringList(loraHashes);
+    if (hasSeed) object["sd"] = QString::number(seed);   // 存为字符串避免精度问题
+    if (steps > 0) object["st"] = steps;
+    if (cfg != 0.0) object["cfg"] = cfg;
+    if (width > 0 && height > 0) {
+        object["w"] = width;
+        object["h"] = height;
+    }
+    if (isComfy) object["cu"] = true;
+    return object;
+}
+
+bool ImageParameters::fromJson(const QJsonObject &object, ImageParameters *params)
+{
+    if (!params || object.value("v").toInt() != kVersion) return false;
+
+    auto internedList = [](const QJsonValue &value) {
+        QStringList list;
+        for (const QJsonValue &entry : value.toArray()) {
+            const QString text = entry.toString();
+            if (!text.isEmpty()) list.append(intern(text));
+        }
+        return list;
+    };
+
+    ImageParameters result;
+    result.sampler = intern(object.value("sa").toString());
+    result.scheduler = intern(object.value("sc").toString());
+    result.checkpointNames = internedList(object.value("ck"));
+    result.checkpointHashes = internedList(object.value("ckh"));
+    for (const QJsonValue &value : object.value("lo").toArray()) {
+        const QJsonObject entry = value.toObject();
+        Lora lora;
+        lora.name = intern(entry.value("n").toString());
+        if (lora.name.isEmpty()) continue;
+        lora.weight = entry.value("w").toDouble(1.0);
+        lora.fromPrompt = entry.value("p").toBool(false);
+        result.loras.append(lora);
+    }
+    result.loraHashes = internedList(object.value("loh"));
+    if (object.contains("sd")) result.seed = object.value("sd").toString().toULongLong(&result.hasSeed);
+    result.steps = object.value("st").toInt();
+    result.cfg = object.value("cfg").toDouble();
+    result.width = object.value("w").toInt();
+    result.height = object.value("h").toInt();
+    result.isComfy = object.value("cu").toBool(false);
+    *params = result;
+    return true;
+}
+
+QString ImageParameters::intern(const QString &text)
+{
+    if (text.isEmpty()) return QString();
+    static QMutex mutex;
+    static QSet<QString> pool;
+    QMutexLocker locker(&mutex);
+    const auto it = pool.constFind(text);
+    if (it != pool.constEnd()) return *it;
+    pool.insert(text);
+    return text;
+}
+
+QString ImageParameters::normalizedHash(const QString &hash)
+{
+    QString result;
+    result.reserve(hash.size());
+    for (const QChar ch : hash) {
+        const char16_t c = ch.unicode();
+        if ((c >= u'0' && c <= u'9') || (c >= u'a' && c <= u'f')) result.append(ch);
+        else if (c >= u'A' && c <= u'F') result.append(QChar(char16_t(c - u'A' + u'a')));
+    }
+    return result;
+}
@@ -0,0 +1,50 @@
+#ifndef IMAGEPARAMETERS_H
+#define IMAGEPARAMETERS_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// 图片生成参数的结构化记录。解析图片元数据时从参数文本（A1111 的 "Key: value, ..." 或
+// 整理后的 ComfyUI 逐行参数）和正面提示词中提取一次，随图库缓存保存；
+// 模型使用统计、画廊筛选 / 分组和各类索引直接读字段，不再对参数文本反复跑正则。
+struct ImageParameters {
+    // 格式版本：提取规则变化时递增，缓存中版本不符的记录会在加载时从参数文本重新提取
+    static constexpr int kVersion = 1;
+
+    struct Lora {
+        QString name;
+        double weight = 1.0;       // 只有提示词 <lora:name:weight> 和 ComfyUI LoRAs 带权重，其余记为 1
+        bool fromPrompt = false;   // 来自正面提示词，而不是参数里的 LoRA 列表 / 哈希块
+    };
+
+    QString sampler;
+    QString scheduler;
+    QStringList checkpointNames;   // "Model:" 与 "Checkpoint:"
+    QStringList checkpointHashes;  // "Model hash:"，小写十六进制
+    QVector<Lora> loras;           // 按名称去重，提示词中的在前
+    QStringList loraHashes;        // "Lora hashes" / "ComfyUI Lora hashes" / "AddNet Model hash N"
+    quint64 seed = 0;
+    bool hasSeed = false;
+    int steps = 0;
+    double cfg = 0.0;
+    int width = 0;
+    int height = 0;
+    bool isComfy = false;          // "Source: ComfyUI"
+
+    QString checkpoint() const { return checkpointNames.value(0); }
+
+    static ImageParameters parse(const QString &parameters, const QString &prompt);
+
+    // 只写非默认字段；fromJson 遇到版本不符时返回 false
+    QJsonObject toJson() const;
+    static bool fromJson(const QJsonObject &object, ImageParameters *params);
+
+    // 取值有限的字符串（采样器、模型名、LoRA 名和哈希）在所有记录间共享同一份数据。线程安全。
+    static QString intern(const QString &text);
+    // 只保留十六进制字符并转小写
+    static QString normalizedHash(const QString &hash);
+};
+
+#endif // IMAGEPARAMETERS_H
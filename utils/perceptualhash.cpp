@@ -0,0 +1,114 @@
+#include "perceptualhash.h"
+
+#include <QHash>
+#include <QImage>
+#include <QImageReader>
+#include <QtAlgorithms>
+
+#include <numeric>
+#include <vector>
+
+namespace PerceptualHash {
+
+namespace {
+constexpr int kChunkCount = 4;
+constexpr int kChunkBits = 16;
+
+inline int chunkOf(quint64 hash, int index)
+{
+    return int((hash >> (index * kChunkBits)) & 0xFFFF);
+}
+
+int findRoot(QVector<int> &parent, int node)
+{
+    while (parent[node] != node) {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+} // namespace
+
+bool computeDHash(const QString &imagePath, quint64 *hash)
+{
+    QImageReader reader(imagePath);
+    // 只需要很小的图：JPEG 等格式可以在解码阶段直接缩小，省掉大部分解码开销
+    const QSize size = reader.size();
+    if (size.isValid() && size.width() > 64 && size.height() > 64) reader.setScaledSize(QSize(64, 64));
+    QImage image = reader.read();
+    if (image.isNull()) return false;
+
+    image = image.convertToFormat(QImage::Format_Grayscale8)
+                .scaled(9, 8, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    quint64 value = 0;
+    int bit = 0;
+    for (int y = 0; y < 8; ++y) {
+        const uchar *line = image.constScanLine(y);
+        for (int x = 0; x < 8; ++x, ++bit) {
+            if (line[x] < line[x + 1]) value |= quint64(1) << bit;
+        }
+    }
+    if (hash) *hash = value;
+    return true;
+}
+
+int distance(quint64 a, quint64 b)
+{
+    return qPopulationCount(a ^ b);
+}
+
+QVector<QVector<int>> clusters(const QVector<quint64> &hashes, int maxDistance)
+{
+    maxDistance = qBound(0, maxDistance, kMaxClusterDistance);
+
+    // 相同哈希先合并成一个节点，大量完全相同的图不会在近邻查询里两两比较
+    QHash<quint64, int> nodeOfHash;
+    QVector<quint64> nodes;
+    QVector<int> nodeOfIndex(hashes.size());
+    for (int i = 0; i < hashes.size(); ++i) {
+        auto it = nodeOfHash.constFind(hashes.at(i));
+        if (it == nodeOfHash.constEnd()) {
+            it = nodeOfHash.insert(hashes.at(i), int(nodes.size()));
+            nodes.append(hashes.at(i));
+        }
+        nodeOfIndex[i] = it.value();
+    }
+
+    QVector<int> parent(nodes.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    if (maxDistance > 0) {
+        // 多索引哈希：距离不超过 maxDistance 时，4 段中至少有一段相差不超过 maxDistance / 4 位
+        std::vector<QVector<int>> tables(size_t(kChunkCount) << kChunkBits);
+        for (int node = 0; node < nodes.size(); ++node) {
+            for (int k = 0; k < kChunkCount; ++k) {
+                tables[(size_t(k) << kChunkBits) | size_t(chunkOf(nodes.at(node), k))].append(node);
+            }
+        }
+        const bool probeNeighbors = maxDistance / kChunkCount >= 1;
+        for (int node = 0; node < nodes.size(); ++node) {
+            const quint64 hash = nodes.at(node);
+            for (int k = 0; k < kChunkCount; ++k) {
+                const int chunk = chunkOf(hash, k);
+                for (int flip = -1; flip < (probeNeighbors ? kChunkBits : 0); ++flip) {
+                    const int probe = flip < 0 ? chunk : (chunk ^ (1 << flip));
+                    for (int other : tables[(size_t(k) << kChunkBits) | size_t(probe)]) {
+                        if (other <= node || distance(hash, nodes.at(other)) > maxDistance) continue;
+                        const int a = findRoot(parent, node);
+                        const int b = findRoot(parent, other);
+                        if (a != b) parent[b] = a;
+                    }
+                }
+            }
+        }
+    }
+
+    QHash<int, QVector<int>> members;
+    for (int i = 0; i < hashes.size(); ++i) members[findRoot(parent, nodeOfIndex.at(i))].append(i);
+    QVector<QVector<int>> result;
+    for (auto it = members.cbegin(); it != members.cend(); ++it) {
+        if (it.value().size() > 1) result.append(it.value());
+    }
+    return result;
+}
+
+} // namespace PerceptualHash
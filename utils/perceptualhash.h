@@ -0,0 +1,24 @@
+#ifndef PERCEPTUALHASH_H
+#define PERCEPTUALHASH_H
+
+#include <QString>
+#include <QVector>
+
+namespace PerceptualHash {
+
+// 64 位 dHash：缩成 9x8 灰度图，每行相邻像素比较亮度。对缩放、重新压缩和轻微调色不敏感，
+// 同一张图的高清修复版本与原图通常只差几位。读取或解码失败时返回 false。
+bool computeDHash(const QString &imagePath, quint64 *hash);
+
+int distance(quint64 a, quint64 b);
+
+// 支持的最大相似阈值：多索引哈希把 64 位分成 4 段，阈值不超过 7 时必有一段相差不超过 1 位。
+constexpr int kMaxClusterDistance = 7;
+
+// 把汉明距离不超过 maxDistance 的哈希连成组（传递闭包），只返回两个及以上成员的组，
+// 成员为 hashes 的下标。相同哈希先合并，再按 4 段 16 位建多索引表查近邻，30 万张也只需查表。
+QVector<QVector<int>> clusters(const QVector<quint64> &hashes, int maxDistance);
+
+} // namespace PerceptualHash
+
+#endif // PERCEPTUALHASH_H
@@ -0,0 +1,395 @@
+#include "promptsearchindex.h"
+#include "gallerycorpus.h"
+#include "tagutils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace {
+// BM25 参数
+constexpr double kK1 = 1.2;
+constexpr double kB = 0.75;
+
+// 连续的字母 / 数字算一个词，大小写折叠
+QStringList searchWords(const QString &text)
+{
+    QStringList words;
+    QString current;
+    for (const QChar ch : text) {
+        if (ch.isLetterOrNumber()) {
+            current += ch;
+        } else if (!current.isEmpty()) {
+            words << current.toCaseFolded();
+            current.clear();
+        }
+    }
+    if (!current.isEmpty()) words << current.toCaseFolded();
+    return words;
+}
+
+bool isWordField(const QString &field)
+{
+    return field == "sampler" || field == "scheduler" || field == "model";
+}
+
+// cfg 的统一写法，7 与 7.0 视为相同
+QString normalizedParameterValue(const QString &value)
+{
+    const QString trimmed = value.trimmed().toCaseFolded();
+    bool ok = false;
+    const double number = trimmed.toDouble(&ok);
+    return ok ? QString::number(number, 'g', 15) : trimmed;
+}
+
+// seed / steps 按精确整数比较：不经过 double，超过 2^53 的种子也不会被舍入成别的值
+QString normalizedIntegerValue(const QString &value)
+{
+    QString trimmed = value.trimmed();
+    if (trimmed.startsWith('+')) trimmed.remove(0, 1);
+    bool ok = false;
+    const quint64 number = trimmed.toULongLong(&ok);
+    return ok ? QString::number(number) : trimmed.toCaseFolded();
+}
+
+bool isIntegerField(const QString &field)
+{
+    return field == "seed" || field == "steps";
+}
+
+QVector<quint32> intersected(const QVector<quint32> &a, const QVector<quint32> &b)
+{
+    QVector<quint32> result;
+    std::set_intersection(a.constBegin(), a.constEnd(), b.constBegin(), b.constEnd(), std::back_inserter(result));
+    return result;
+}
+
+QVector<quint32> united(const QVector<quint32> &a, const QVector<quint32> &b)
+{
+    QVector<quint32> result;
+    result.reserve(a.size() + b.size());
+    std::set_union(a.constBegin(), a.constEnd(), b.constBegin(), b.constEnd(), std::back_inserter(result));
+    return result;
+}
+
+QVector<quint32> subtracted(const QVector<quint32> &a, const QVector<quint32> &b)
+{
+    QVector<quint32> result;
+    std::set_difference(a.constBegin(), a.constEnd(), b.constBegin(), b.constEnd(), std::back_inserter(result));
+    return result;
+}
+} // namespace
+
+void PromptSearchIndex::addImage(const UserImageInfo &info)
+{
+    if (info.path.isEmpty() || info.path.startsWith("__")) return;
+    removeImage(info.path);
+
+    QHash<QString, int> frequencies;
+    quint32 length = 0;
+    auto addTerm = [&frequencies, &length](const QString &field, const QString &text) {
+        if (text.isEmpty()) return;
+        ++frequencies[field + ':' + text];
+        ++length;
+    };
+    for (const QString &word : searchWords(info.prompt)) addTerm("p", word);
+    for (const QString &word : searchWords(info.negativePrompt)) addTerm("n", word);
+    for (const QString &tag : info.cleanTags) addTerm("t", TagUtils::normalizedPromptTagKey(tag));
+    for (const QString &tag : info.negativeCleanTags) addTerm("nt", TagUtils::normalizedPromptTagKey(tag));
+
+    // 参数字段直接取解析时提取好的结构化记录
+    const ImageParameters &params = info.params;
+    for (const QString &word : searchWords(params.sampler)) addTerm("sampler", word);
+    for (const QString &word : searchWords(params.scheduler)) addTerm("scheduler", word);
+    for (const QString &model : params.checkpointNames) {
+        for (const QString &word : searchWords(model)) addTerm("model", word);
+    }
+    // 数值与查询端走同一个归一化，超长种子也能对上
+    if (params.hasSeed) addTerm("seed", QString::number(params.seed));
+    if (params.steps > 0) addTerm("steps", QString::number(params.steps));
+    if (params.cfg != 0.0) addTerm("cfg", normalizedParameterValue(QString::number(params.cfg, 'g', 15)));
+    if (params.width > 0 && params.height > 0) addTerm("size", QString("%1x%2").arg(params.width).arg(params.height));
+
+    Document document;
+    document.path = info.path;
+    document.length = length;
+    document.lastModified = info.lastModified;
+    const quint32 id = quint32(m_documents.size());
+    m_documents.append(document);
+    m_documentIds.insert(info.path, id);
+    m_totalLength += length;
+
+    // 文档号递增分配，直接追加即可保持倒排表有序
+    for (auto term = frequencies.constBegin(); term != frequencies.constEnd(); ++term) {
+        Posting posting;
+        posting.document = id;
+        posting.frequency = quint16(qMin(term.value(), 0xFFFF));
+        m_postings[term.key()].append(posting);
+    }
+}
+
+void PromptSearchIndex::removeImage(const QString &path)
+{
+    const auto it = m_documentIds.constFind(path);
+    if (it == m_documentIds.constEnd()) return;
+    Document &document = m_documents[int(it.value())];
+    m_totalLength -= document.length;
+    document = Document();
+    m_documentIds.erase(it);
+
+    if (m_documents.size() > 1024 && m_documents.size() > 2 * m_documentIds.size()) compact();
+}
+
+void PromptSearchIndex::compact()
+{
+    // 按原顺序重新编号，倒排表仍然有序
+    QVector<quint32> remap(m_documents.size(), 0);
+    QVector<Document> documents;
+    documents.reserve(m_documentIds.size());
+    for (int i = 0; i < m_documents.size(); ++i) {
+        if (m_documents.at(i).path.isEmpty()) continue;
+        remap[i] = quint32(documents.size());
+        m_documentIds[m_documents.at(i).path] = quint32(documents.size());
+        documents.append(m_documents.at(i));
+    }
+
+    for (auto it = m_postings.begin(); it != m_postings.end();) {
+        QVector<Posting> &postings = it.value();
+        auto kept = postings.begin();
+        for (const Posting &posting : std::as_const(postings)) {
+            if (m_documents.at(int(posting.document)).path.isEmpty()) continue;
+            *kept = posting;
+            kept->document = remap.at(int(posting.document));
+            ++kept;
+        }
+        postings.erase(kept, postings.end());
+        if (postings.isEmpty()) {
+            it = m_postings.erase(it);
+        } else {
+            postings.squeeze();
+            ++it;
+        }
+    }
+    m_documents = documents;
+}
+
+QVector<PromptSearchIndex::Group> PromptSearchIndex::parseQuery(const QString &query) const
+{
+    // 按空白切分，引号内的空白保留
+    QStringList tokens;
+    QString current;
+    bool inQuote = false;
+    for (const QChar ch : query) {
+        if (ch == '"') inQuote = !inQuote;
+        if (ch.isSpace() && !inQuote) {
+            if (!current.isEmpty()) tokens << current;
+            current.clear();
+        } else {
+            current += ch;
+        }
+    }
+    if (!current.isEmpty()) tokens << current;
+
+    QVector<Group> groups;
+    bool pendingOr = false;
+    for (QString token : std::as_const(tokens)) {
+        if (token == "OR") {
+            pendingOr = !groups.isEmpty();
+            continue;
+        }
+        bool excluded = false;
+        if (token.size() > 1 && token.startsWith('-')) {
+            excluded = true;
+            token.remove(0, 1);
+        }
+
+        QString field;
+        QString value = token;
+        const int colon = int(token.indexOf(':'));
+        const int quote = int(token.indexOf('"'));
+        if (colon > 0 && (quote < 0 || colon < quote)) {
+            static const QStringList knownFields = {"neg", "tag", "negtag", "sampler", "scheduler",
+                                                    "model", "seed", "steps", "cfg", "size"};
+            const QString name = token.left(colon).toCaseFolded();
+            if (knownFields.contains(name)) {
+                field = name;
+                value = token.mid(colon + 1);
+            }
+        }
+        const bool quoted = value.startsWith('"');
+        if (quoted) {
+            value.remove(0, 1);
+            if (value.endsWith('"')) value.chop(1);
+        }
+        const bool prefix = value.endsWith('*');
+        if (prefix) value.chop(1);
+
+        Alternative alternative;
+        auto addTerm = [&alternative](const QString &key, bool isPrefix) {
+            Term term;
+            term.key = key;
+            term.prefix = isPrefix;
+            alternative.append(term);
+        };
+        auto addWords = [&](const QString &indexField) {
+            const QStringList words = searchWords(value);
+            for (int i = 0; i < words.size(); ++i) addTerm(indexField + ':' + words.at(i), prefix && i == words.size() - 1);
+        };
+        if (field == "tag" || field == "negtag" || (field.isEmpty() && quoted)) {
+            const QString key = TagUtils::normalizedPromptTagKey(value);
+            if (!key.isEmpty()) addTerm((field == "negtag" ? "nt:" : "t:") + key, prefix);
+        } else if (field.isEmpty()) {
+            addWords("p");
+        } else if (field == "neg") {
+            addWords("n");
+        } else if (isWordField(field)) {
+            addWords(field);
+        } else {
+            const QString normalized = isIntegerField(field) ? normalizedIntegerValue(value)
+                                                             : normalizedParameterValue(value);
+            if (!normalized.isEmpty()) addTerm(field + ':' + normalized, prefix);
+        }
+        if (alternative.isEmpty()) continue;
+
+        if (std::exchange(pendingOr, false) && !excluded && !groups.last().excluded) {
+            groups.last().alternatives.append(alternative);
+        } else {
+            Group group;
+            group.alternatives.append(alternative);
+            group.excluded = excluded;
+            groups.append(group);
+        }
+    }
+    return groups;
+}
+
+QVector<const QVector<PromptSearchIndex::Posting> *> PromptSearchIndex::postingsFor(const Term &term) const
+{
+    QVector<const QVector<Posting> *> lists;
+    if (!term.prefix) {
+        const auto it = m_postings.constFind(term.key);
+        if (it != m_postings.constEnd()) lists.append(&it.value());
+        return lists;
+    }
+    for (auto it = m_postings.lowerBound(term.key); it != m_postings.constEnd() && it.key().startsWith(term.key); ++it) {
+        lists.append(&it.value());
+    }
+    return lists;
+}
+
+QVector<quint32> PromptSearchIndex::documentsFor(const Term &term) const
+{
+    const QVector<const QVector<Posting> *> lists = postingsFor(term);
+    QVector<quint32> documents;
+    for (const QVector<Posting> *postings : lists) {
+        for (const Posting &posting : *postings) {
+            if (isLive(posting.document)) documents.append(posting.document);
+        }
+    }
+    // 前缀匹配到多个词时需要合并
+    if (lists.size() > 1) {
+        std::sort(documents.begin(), documents.end());
+        documents.erase(std::unique(documents.begin(), documents.end()), documents.end());
+    }
+    return documents;
+}
+
+QVector<quint32> PromptSearchIndex::documentsFor(const Group &group) const
+{
+    QVector<quint32> result;
+    for (const Alternative &alternative : group.alternatives) {
+        QVector<quint32> matched;
+        for (int i = 0; i < alternative.size(); ++i) {
+            matched = i == 0 ? documentsFor(alternative.at(i)) : intersected(matched, documentsFor(alternative.at(i)));
+            if (matched.isEmpty()) break;
+        }
+        result = united(result, matched);
+    }
+    return result;
+}
+
+QVector<PromptSearchIndex::Hit> PromptSearchIndex::search(const QString &query, int limit) const
+{
+    const QVector<Group> groups = parseQuery(query);
+    if (groups.isEmpty() || m_documentIds.isEmpty()) return {};
+
+    QVector<quint32> candidates;
+    bool hasRequired = false;
+    for (const Group &group : groups) {
+        if (group.excluded) continue;
+        candidates = hasRequired ? intersected(candidates, documentsFor(group)) : documentsFor(group);
+        hasRequired = true;
+        if (candidates.isEmpty()) return {};
+    }
+    if (!hasRequired) {
+        // 只有排除条件时从全部图片中排除
+        candidates.reserve(m_documentIds.size());
+        for (int i = 0; i < m_documents.size(); ++i) {
+            if (isLive(quint32(i))) candidates.append(quint32(i));
+        }
+    }
+    for (const Group &group : groups) {
+        if (group.excluded) candidates = subtracted(candidates, documentsFor(group));
+    }
+    if (candidates.isEmpty()) return {};
+
+    // BM25：对命中的每个正向词累加得分
+    QHash<quint32, double> scores;
+    scores.reserve(candidates.size());
+    for (quint32 document : std::as_const(candidates)) scores.insert(document, 0.0);
+    const double documentCount = double(m_documentIds.size());
+    const double averageLength = qMax(1.0, double(m_totalLength) / documentCount);
+    for (const Group &group : groups) {
+        if (group.excluded) continue;
+        for (const Alternative &alternative : group.alternatives) {
+            for (const Term &term : alternative) {
+                for (const QVector<Posting> *postings : postingsFor(term)) {
+                    // 倒排表里可能还留着已删除文档的记录，df 只数仍存在的文档
+                    const double df = double(std::count_if(postings->constBegin(), postings->constEnd(),
+                                                           [this](const Posting &posting) { return isLive(posting.document); }));
+                    const double idf = std::log(1.0 + (documentCount - df + 0.5) / (df + 0.5));
+                    for (const Posting &posting : *postings) {
+                        const auto score = scores.find(posting.document);
+                        if (score == scores.end()) continue;
+                        const double tf = posting.frequency;
+                        const double length = m_documents.at(int(posting.document)).length;
+                        score.value() += idf * tf * (kK1 + 1.0) / (tf + kK1 * (1.0 - kB + kB * length / averageLength));
+                    }
+                }
+            }
+        }
+    }
+
+    struct Ranked {
+        double score;
+        qint64 lastModified;
+        quint32 document;
+    };
+    QVector<Ranked> ranked;
+    ranked.reserve(candidates.size());
+    for (quint32 document : std::as_const(candidates)) {
+        ranked.append({scores.value(document), m_documents.at(int(document)).lastModified, document});
+    }
+    auto before = [](const Ranked &a, const Ranked &b) {
+        if (a.score != b.score) return a.score > b.score;
+        if (a.lastModified != b.lastModified) return a.lastModified > b.lastModified;
+        return a.document > b.document;
+    };
+    if (limit >= 0 && limit < ranked.size()) {
+        std::partial_sort(ranked.begin(), ranked.begin() + limit, ranked.end(), before);
+        ranked.resize(limit);
+    } else {
+        std::sort(ranked.begin(), ranked.end(), before);
+    }
+
+    QVector<Hit> hits;
+    hits.reserve(ranked.size());
+    for (const Ranked &entry : std::as_const(ranked)) {
+        Hit hit;
+        hit.path = m_documents.at(int(entry.document)).path;
+        hit.score = entry.score;
+        hits.append(hit);
+    }
+    return hits;
+}
@@ -0,0 +1,74 @@
+#ifndef PROMPTSEARCHINDEX_H
+#define PROMPTSEARCHINDEX_H
+
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+struct UserImageInfo;
+
+// 图库提示词全文索引：正面 / 负面提示词的词与 Tag、以及生成参数（采样器、种子、步数等）建倒排表，
+// 图片加入 / 离开时增量维护。值类型，成员都是隐式共享的 Qt 容器，可以整体拷贝给其他线程只读使用。
+//
+// 查询语法（大小写不敏感）：
+//   空格分隔的条件同时满足；条件之间写 OR 表示满足其一；前缀 - 表示排除
+//   词末尾加 * 为前缀匹配，如 silv*
+//   "long hair" 或 tag:long_hair 按完整 Tag 匹配（空格、下划线、连字符视为相同）
+//   neg:词 / negtag:Tag 在负面提示词中查找
+//   sampler: scheduler: model: seed: steps: cfg: size: 按生成参数查找
+// 未加字段的词在正面提示词中查找。结果按 BM25 相关度排序，相同时较新的图片在前。
+class PromptSearchIndex
+{
+public:
+    struct Hit {
+        QString path;
+        double score = 0.0;
+    };
+
+    // 已存在同一路径时先移除旧记录。
+    void addImage(const UserImageInfo &info);
+    void removeImage(const QString &path);
+
+    bool contains(const QString &path) const { return m_documentIds.contains(path); }
+    int imageCount() const { return int(m_documentIds.size()); }
+    // limit < 0 时返回全部命中。查询为空或不含任何有效条件时返回空。
+    QVector<Hit> search(const QString &query, int limit = -1) const;
+
+private:
+    struct Posting {
+        quint32 document = 0;
+        quint16 frequency = 0;
+    };
+
+    struct Document {
+        QString path;              // 为空表示已删除
+        quint32 length = 0;        // 词数，用于 BM25 长度归一化
+        qint64 lastModified = 0;
+    };
+
+    struct Term {
+        QString key;               // "字段:词"
+        bool prefix = false;
+    };
+    using Alternative = QVector<Term>;    // 同时满足
+    struct Group {
+        QVector<Alternative> alternatives;  // 满足其一
+        bool excluded = false;
+    };
+
+    QVector<Group> parseQuery(const QString &query) const;
+    QVector<const QVector<Posting> *> postingsFor(const Term &term) const;
+    QVector<quint32> documentsFor(const Term &term) const;
+    QVector<quint32> documentsFor(const Group &group) const;
+    bool isLive(quint32 document) const { return !m_documents.at(int(document)).path.isEmpty(); }
+    void compact();
+
+    QMap<QString, QVector<Posting>> m_postings;   // "字段:词" → 按文档号升序；有序以支持前缀匹配
+    // 文档号 → 文档。删除只留空位，倒排表里的旧记录在查询时跳过，空位过多时 compact() 统一清理
+    QVector<Document> m_documents;
+    QHash<QString, quint32> m_documentIds;        // 图片路径 → 文档号
+    quint64 m_totalLength = 0;
+};
+
+#endif // PROMPTSEARCHINDEX_H
@@ -0,0 +1,316 @@
+#include "roaringbitmap.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+constexpr int kArrayLimit = 4096;    // 超过后位图更省空间
+constexpr int kWordCount = 1024;     // 65536 位
+
+inline bool testBit(const QVector<quint64> &words, quint16 low)
+{
+    return (words.at(low >> 6) >> (low & 63)) & 1;
+}
+} // namespace
+
+bool RoaringBitmap::Container::contains(quint16 low) const
+{
+    if (isBitmap()) return testBit(words, low);
+    return std::binary_search(array.constBegin(), array.constEnd(), low);
+}
+
+void RoaringBitmap::Container::add(quint16 low)
+{
+    if (isBitmap()) {
+        quint64 &word = words[low >> 6];
+        const quint64 mask = quint64(1) << (low & 63);
+        if (word & mask) return;
+        word |= mask;
+        ++cardinality;
+        return;
+    }
+    if (array.isEmpty() || array.constLast() < low) {
+        array.append(low);
+    } else {
+        const auto it = std::lower_bound(array.begin(), array.end(), low);
+        if (*it == low) return;
+        array.insert(it, low);
+    }
+    ++cardinality;
+    if (cardinality > kArrayLimit) normalize();
+}
+
+void RoaringBitmap::Container::normalize()
+{
+    if (isBitmap() && cardinality <= kArrayLimit) {
+        array.clear();
+        array.reserve(cardinality);
+        for (int i = 0; i < kWordCount; ++i) {
+            quint64 word = words.at(i);
+            while (word) {
+                array.append(quint16(i * 64 + qCountTrailingZeroBits(word)));
+                word &= word - 1;
+            }
+        }
+        words.clear();
+    } else if (!isBitmap() && cardinality > kArrayLimit) {
+        words = toWords();
+        array.clear();
+    }
+}
+
+QVector<quint64> RoaringBitmap::Container::toWords() const
+{
+    if (isBitmap()) return words;
+    QVector<quint64> result(kWordCount, 0);
+    for (quint16 low : array) result[low >> 6] |= quint64(1) << (low & 63);
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::intersect(const Container &a, const Container &b)
+{
+    Container result;
+    if (a.isBitmap() && b.isBitmap()) {
+        result.words.resize(kWordCount);
+        for (int i = 0; i < kWordCount; ++i) {
+            result.words[i] = a.words.at(i) & b.words.at(i);
+            result.cardinality += qPopulationCount(result.words.at(i));
+        }
+        result.normalize();
+    } else if (a.isBitmap() || b.isBitmap()) {
+        const Container &bitmap = a.isBitmap() ? a : b;
+        const Container &array = a.isBitmap() ? b : a;
+        for (quint16 low : array.array) {
+            if (testBit(bitmap.words, low)) result.array.append(low);
+        }
+        result.cardinality = int(result.array.size());
+    } else {
+        std::set_intersection(a.array.constBegin(), a.array.constEnd(), b.array.constBegin(), b.array.constEnd(),
+                              std::back_inserter(result.array));
+        result.cardinality = int(result.array.size());
+    }
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::unite(const Container &a, const Container &b)
+{
+    Container result;
+    if (!a.isBitmap() && !b.isBitmap() && a.cardinality + b.cardinality <= kArrayLimit) {
+        result.array.reserve(a.cardinality + b.cardinality);
+        std::set_union(a.array.constBegin(), a.array.constEnd(), b.array.constBegin(), b.array.constEnd(),
+                       std::back_inserter(result.array));
+        result.cardinality = int(result.array.size());
+        return result;
+    }
+    result.words = a.toWords();
+    if (b.isBitmap()) {
+        for (int i = 0; i < kWordCount; ++i) result.words[i] |= b.words.at(i);
+    } else {
+        for (quint16 low : b.array) result.words[low >> 6] |= quint64(1) << (low & 63);
+    }
+    for (quint64 word : std::as_const(result.words)) result.cardinality += qPopulationCount(word);
+    result.normalize();
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::subtract(const Container &a, const Container &b)
+{
+    Container result;
+    if (!a.isBitmap()) {
+        for (quint16 low : a.array) {
+            if (!b.contains(low)) result.array.append(low);
+        }
+        result.cardinality = int(result.array.size());
+        return result;
+    }
+    result.words = a.words;
+    if (b.isBitmap()) {
+        for (int i = 0; i < kWordCount; ++i) result.words[i] &= ~b.words.at(i);
+    } else {
+        for (quint16 low : b.array) result.words[low >> 6] &= ~(quint64(1) << (low & 63));
+    }
+    for (quint64 word : std::as_const(result.words)) result.cardinality += qPopulationCount(word);
+    result.normalize();
+    return result;
+}
+
+int RoaringBitmap::intersectionCount(const Container &a, const Container &b)
+{
+    int count = 0;
+    if (a.isBitmap() && b.isBitmap()) {
+        for (int i = 0; i < kWordCount; ++i) count += qPopulationCount(a.words.at(i) & b.words.at(i));
+    } else if (a.isBitmap() || b.isBitmap()) {
+        const Container &bitmap = a.isBitmap() ? a : b;
+        const Container &array = a.isBitmap() ? b : a;
+        for (quint16 low : array.array) count += testBit(bitmap.words, low) ? 1 : 0;
+    } else {
+        auto x = a.array.constBegin();
+        auto y = b.array.constBegin();
+        while (x != a.array.constEnd() && y != b.array.constEnd()) {
+            if (*x < *y) {
+                ++x;
+            } else if (*y < *x) {
+                ++y;
+            } else {
+                ++count;
+                ++x;
+                ++y;
+            }
+        }
+    }
+    return count;
+}
+
+RoaringBitmap RoaringBitmap::range(quint32 count)
+{
+    RoaringBitmap result;
+    for (quint32 start = 0; start < count; start += 0x10000) {
+        const quint32 size = qMin<quint32>(count - start, 0x10000);
+        Container container;
+        container.words.fill(0, kWordCount);
+        for (quint32 i = 0; i < size / 64; ++i) container.words[int(i)] = ~quint64(0);
+        if (size % 64) container.words[int(size / 64)] = (quint64(1) << (size % 64)) - 1;
+        container.cardinality = int(size);
+        container.normalize();
+        result.m_keys.append(quint16(start >> 16));
+        result.m_containers.append(container);
+    }
+    return result;
+}
+
+void RoaringBitmap::add(quint32 value)
+{
+    const quint16 high = quint16(value >> 16);
+    const quint16 low = quint16(value & 0xFFFF);
+    if (m_keys.isEmpty() || m_keys.constLast() < high) {
+        m_keys.append(high);
+        m_containers.append(Container());
+        m_containers.last().add(low);
+        return;
+    }
+    const auto it = std::lower_bound(m_keys.begin(), m_keys.end(), high);
+    const int index = int(it - m_keys.begin());
+    if (*it != high) {
+        m_keys.insert(index, high);
+        m_containers.insert(index, Container());
+    }
+    m_containers[index].add(low);
+}
+
+bool RoaringBitmap::contains(quint32 value) const
+{
+    const quint16 high = quint16(value >> 16);
+    const auto it = std::lower_bound(m_keys.constBegin(), m_keys.constEnd(), high);
+    if (it == m_keys.constEnd() || *it != high) return false;
+    return m_containers.at(int(it - m_keys.constBegin())).contains(quint16(value & 0xFFFF));
+}
+
+quint64 RoaringBitmap::cardinality() const
+{
+    quint64 total = 0;
+    for (const Container &container : m_containers) total += quint64(container.cardinality);
+    return total;
+}
+
+QVector<quint32> RoaringBitmap::toVector() const
+{
+    QVector<quint32> values;
+    values.reserve(qsizetype(cardinality()));
+    for (int i = 0; i < m_keys.size(); ++i) {
+        const quint32 base = quint32(m_keys.at(i)) << 16;
+        const Container &container = m_containers.at(i);
+        if (container.isBitmap()) {
+            for (int w = 0; w < kWordCount; ++w) {
+                quint64 word = container.words.at(w);
+                while (word) {
+                    values.append(base | quint32(w * 64 + qCountTrailingZeroBits(word)));
+                    word &= word - 1;
+                }
+            }
+        } else {
+            for (quint16 low : container.array) values.append(base | low);
+        }
+    }
+    return values;
+}
+
+RoaringBitmap RoaringBitmap::operator&(const RoaringBitmap &other) const
+{
+    RoaringBitmap result;
+    int i = 0;
+    int j = 0;
+    while (i < m_keys.size() && j < other.m_keys.size()) {
+        if (m_keys.at(i) < other.m_keys.at(j)) {
+            ++i;
+        } else if (other.m_keys.at(j) < m_keys.at(i)) {
+            ++j;
+        } else {
+            Container container = intersect(m_containers.at(i), other.m_containers.at(j));
+            if (container.cardinality > 0) {
+                result.m_keys.append(m_keys.at(i));
+                result.m_containers.append(container);
+            }
+            ++i;
+            ++j;
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::operator|(const RoaringBitmap &other) const
+{
+    RoaringBitmap result;
+    int i = 0;
+    int j = 0;
+    while (i < m_keys.size() || j < other.m_keys.size()) {
+        if (j == other.m_keys.size() || (i < m_keys.size() && m_keys.at(i) < other.m_keys.at(j))) {
+            result.m_keys.append(m_keys.at(i));
+            result.m_containers.append(m_containers.at(i++));
+        } else if (i == m_keys.size() || other.m_keys.at(j) < m_keys.at(i)) {
+            result.m_keys.append(other.m_keys.at(j));
+            result.m_containers.append(other.m_containers.at(j++));
+        } else {
+            result.m_keys.append(m_keys.at(i));
+            result.m_containers.append(unite(m_containers.at(i++), other.m_containers.at(j++)));
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::operator-(const RoaringBitmap &other) const
+{
+    RoaringBitmap result;
+    int j = 0;
+    for (int i = 0; i < m_keys.size(); ++i) {
+        while (j < other.m_keys.size() && other.m_keys.at(j) < m_keys.at(i)) ++j;
+        if (j < other.m_keys.size() && other.m_keys.at(j) == m_keys.at(i)) {
+            Container container = subtract(m_containers.at(i), other.m_containers.at(j));
+            if (container.cardinality == 0) continue;
+            result.m_keys.append(m_keys.at(i));
+            result.m_containers.append(container);
+        } else {
+            result.m_keys.append(m_keys.at(i));
+            result.m_containers.append(m_containers.at(i));
+        }
+    }
+    return result;
+}
+
+quint64 RoaringBitmap::intersectionCardinality(const RoaringBitmap &other) const
+{
+    quint64 total = 0;
+    int i = 0;
+    int j = 0;
+    while (i < m_keys.size() && j < other.m_keys.size()) {
+        if (m_keys.at(i) < other.m_keys.at(j)) {
+            ++i;
+        } else if (other.m_keys.at(j) < m_keys.at(i)) {
+            ++j;
+        } else {
+            total += quint64(intersectionCount(m_containers.at(i++), other.m_containers.at(j++)));
+        }
+    }
+    return total;
+}
@@ -0,0 +1,51 @@
+#ifndef ROARINGBITMAP_H
+#define ROARINGBITMAP_H
+
+#include <QVector>
+#include <QtGlobal>
+
+// 压缩位图（Roaring 结构）：按高 16 位分块，块内元素不超过 4096 个时存有序数组，否则存 65536 位的位图。
+// 用于画廊 Tag 筛选，多个 Tag 的与 / 或 / 差以及交集计数都按块批量计算。值类型，可直接拷贝。
+class RoaringBitmap
+{
+public:
+    // [0, count)
+    static RoaringBitmap range(quint32 count);
+
+    // 按升序追加最快；乱序也可以。
+    void add(quint32 value);
+    bool contains(quint32 value) const;
+    bool isEmpty() const { return m_keys.isEmpty(); }
+    quint64 cardinality() const;
+    // 升序
+    QVector<quint32> toVector() const;
+
+    RoaringBitmap operator&(const RoaringBitmap &other) const;
+    RoaringBitmap operator|(const RoaringBitmap &other) const;
+    RoaringBitmap operator-(const RoaringBitmap &other) const;   // 差集，即 AND NOT
+    // 等价于 (*this & other).cardinality()，但不生成中间结果
+    quint64 intersectionCardinality(const RoaringBitmap &other) const;
+
+private:
+    struct Container {
+        QVector<quint16> array;    // 有序数组形式
+        QVector<quint64> words;    // 位图形式，非空时固定 1024 个字
+        int cardinality = 0;
+
+        bool isBitmap() const { return !words.isEmpty(); }
+        bool contains(quint16 low) const;
+        void add(quint16 low);
+        void normalize();          // 按元素个数在两种形式之间切换
+        QVector<quint64> toWords() const;
+    };
+
+    static Container intersect(const Container &a, const Container &b);
+    static Container unite(const Container &a, const Container &b);
+    static Container subtract(const Container &a, const Container &b);
+    static int intersectionCount(const Container &a, const Container &b);
+
+    QVector<quint16> m_keys;         // 高 16 位，升序
+    QVector<Container> m_containers; // 与 m_keys 一一对应，不存空块
+};
+
+#endif // ROARINGBITMAP_H
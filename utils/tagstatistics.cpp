@@ -0,0 +1,264 @@
+#include "tagstatistics.h"
+#include "gallerycorpus.h"
+#include "tagutils.h"
+
+#include <QDir>
+#include <QSet>
+
+#include <algorithm>
+
+namespace {
+constexpr qint64 kDayMs = 24LL * 60 * 60 * 1000;
+
+#ifdef Q_OS_WIN
+constexpr Qt::CaseSensitivity kPathCase = Qt::CaseInsensitive;
+#else
+constexpr Qt::CaseSensitivity kPathCase = Qt::CaseSensitive;
+#endif
+
+QVector<int> sortedUnique(QVector<int> ids)
+{
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+QStringList referencedModels(const UserImageInfo &info)
+{
+    QStringList models;
+    for (const ImageParameters::Lora &lora : info.params.loras) {
+        if (lora.fromPrompt) models << TagStatistics::normalizedModelKey(lora.name);
+    }
+    if (!info.params.checkpointNames.isEmpty()) models << TagStatistics::normalizedModelKey(info.params.checkpoint());
+
+    models.removeAll(QString());
+    models.removeDuplicates();
+    return models;
+}
+} // namespace
+
+TagStatistics::Scope TagStatistics::Scope::folder(const QString &dirPath)
+{
+    Scope scope;
+    scope.kind = Folder;
+    scope.value = dirPath;
+    return scope;
+}
+
+TagStatistics::Scope TagStatistics::Scope::model(const QString &modelName)
+{
+    Scope scope;
+    scope.kind = Model;
+    scope.value = modelName;
+    return scope;
+}
+
+TagStatistics::Scope TagStatistics::Scope::dateRange(qint64 fromMs, qint64 toMs)
+{
+    Scope scope;
+    scope.kind = DateRange;
+    scope.fromMs = fromMs;
+    scope.toMs = toMs;
+    return scope;
+}
+
+TagStatistics::Scope TagStatistics::Scope::images(const QStringList &imagePaths)
+{
+    Scope scope;
+    scope.kind = Images;
+    scope.paths = imagePaths;
+    return scope;
+}
+
+QString TagStatistics::normalizedModelKey(const QString &name)
+{
+    QString key = QDir::fromNativeSeparators(name.trimmed());
+    key = key.mid(key.lastIndexOf('/') + 1);
+    static const QStringList extensions = {".safetensors", ".ckpt", ".pt", ".pth", ".bin"};
+    for (const QString &extension : extensions) {
+        if (key.endsWith(extension, Qt::CaseInsensitive)) {
+            key.chop(extension.size());
+            break;
+        }
+    }
+    return key.trimmed().toCaseFolded();
+}
+
+bool TagStatistics::isIgnoredTagKey(const QString &key)
+{
+    // 区域提示词的分隔关键字不是 Tag
+    static const QSet<QString> ignoredKeys = {"break", "addcomm", "addbase", "addcol", "addrow"};
+    return ignoredKeys.contains(key);
+}
+
+int TagStatistics::internTag(const QString &rawTag)
+{
+    const auto cached = m_rawTagIds.constFind(rawTag);
+    if (cached != m_rawTagIds.constEnd()) return cached.value();
+
+    const QString key = TagUtils::normalizedPromptTagKey(rawTag);
+    int id = -1;
+    if (!key.isEmpty() && !isIgnoredTagKey(key)) {
+        const auto existing = m_keyIds.constFind(key);
+        if (existing != m_keyIds.constEnd()) {
+            id = existing.value();
+        } else {
+            id = int(m_keys.size());
+            m_keyIds.insert(key, id);
+            m_keys.append(key);
+            m_display.append(rawTag.trimmed());
+        }
+    }
+    m_rawTagIds.insert(rawTag, id);
+    return id;
+}
+
+void TagStatistics::addImage(const UserImageInfo &info)
+{
+    if (info.path.isEmpty() || info.path.startsWith("__")) return;
+    removeImage(info.path);
+
+    ImageRecord record;
+    record.positive.reserve(info.cleanTags.size());
+    for (const QString &tag : info.cleanTags) {
+        const int id = internTag(tag);
+        if (id >= 0) record.positive.append(id);
+    }
+    record.negative.reserve(info.negativeCleanTags.size());
+    for (const QString &tag : info.negativeCleanTags) {
+        const int id = internTag(tag);
+        if (id >= 0) record.negative.append(id);
+    }
+    record.positive = sortedUnique(record.positive);
+    record.negative = sortedUnique(record.negative);
+    const QString path = QDir::fromNativeSeparators(info.path);
+    record.folder = path.left(qMax(0, int(path.lastIndexOf('/'))));
+    record.models = referencedModels(info);
+    record.day = info.lastModified / kDayMs;
+
+    apply(m_global, record, 1);
+    apply(m_byFolder[record.folder], record, 1);
+    for (const QString &model : std::as_const(record.models)) apply(m_byModel[model], record, 1);
+    apply(m_byDay[record.day], record, 1);
+    m_images.insert(info.path, record);
+}
+
+void TagStatistics::removeImage(const QString &path)
+{
+    const auto it = m_images.constFind(path);
+    if (it == m_images.constEnd()) return;
+    const ImageRecord record = it.value();
+    m_images.remove(path);
+
+    auto release = [&record](auto &byKey, const auto &key) {
+        auto bucket = byKey.find(key);
+        if (bucket == byKey.end()) return;
+        apply(bucket.value(), record, -1);
+        if (bucket.value().isEmpty()) byKey.erase(bucket);
+    };
+    apply(m_global, record, -1);
+    release(m_byFolder, record.folder);
+    for (const QString &model : record.models) release(m_byModel, model);
+    release(m_byDay, record.day);
+}
+
+void TagStatistics::apply(CountMap &counts, const ImageRecord &record, int delta)
+{
+    auto bump = [&counts, delta](int id, int Counter::*field) {
+        Counter &counter = counts[id];
+        counter.*field += delta;
+        if (delta < 0 && counter.positive <= 0 && counter.negative <= 0 && counter.any <= 0) counts.remove(id);
+    };
+    for (int id : record.positive) bump(id, &Counter::positive);
+    for (int id : record.negative) bump(id, &Counter::negative);
+
+    // any：两个有序 id 列表的并集
+    auto p = record.positive.constBegin();
+    auto n = record.negative.constBegin();
+    while (p != record.positive.constEnd() || n != record.negative.constEnd()) {
+        int id;
+        if (n == record.negative.constEnd() || (p != record.positive.constEnd() && *p < *n)) {
+            id = *p++;
+        } else if (p == record.positive.constEnd() || *n < *p) {
+            id = *n++;
+        } else {
+            id = *p++;
+            ++n;
+        }
+        bump(id, &Counter::any);
+    }
+}
+
+void TagStatistics::mergeInto(CountMap &target, const CountMap &source)
+{
+    for (auto it = source.constBegin(); it != source.constEnd(); ++it) {
+        Counter &counter = target[it.key()];
+        counter.positive += it.value().positive;
+        counter.negative += it.value().negative;
+        counter.any += it.value().any;
+    }
+}
+
+QVector<TagStatistics::TagCount> TagStatistics::query(const Scope &scope) const
+{
+    switch (scope.kind) {
+    case Scope::Global:
+        return toRows(m_global);
+    case Scope::Model:
+        return toRows(m_byModel.value(normalizedModelKey(scope.value)));
+    case Scope::Folder: {
+        QString dir = QDir::fromNativeSeparators(scope.value);
+        while (dir.endsWith('/')) dir.chop(1);
+        const QString prefix = dir + '/';
+        CountMap counts;
+        for (auto it = m_byFolder.constBegin(); it != m_byFolder.constEnd(); ++it) {
+            if (it.key().compare(dir, kPathCase) == 0 || it.key().startsWith(prefix, kPathCase)) {
+                mergeInto(counts, it.value());
+            }
+        }
+        return toRows(counts);
+    }
+    case Scope::DateRange: {
+        CountMap counts;
+        const qint64 lastDay = scope.toMs / kDayMs;
+        for (auto it = m_byDay.lowerBound(scope.fromMs / kDayMs); it != m_byDay.constEnd() && it.key() <= lastDay; ++it) {
+            mergeInto(counts, it.value());
+        }
+        return toRows(counts);
+    }
+    case Scope::Images: {
+        QSet<QString> seen;
+        QVector<const ImageRecord *> records;
+        records.reserve(scope.paths.size());
+        for (const QString &path : scope.paths) {
+            if (seen.contains(path)) continue;
+            seen.insert(path);
+            const auto it = m_images.constFind(path);
+            if (it != m_images.constEnd()) records.append(&it.value());
+        }
+        // 覆盖了全部图片时直接用全局汇总
+        if (records.size() == m_images.size()) return toRows(m_global);
+        CountMap counts;
+        for (const ImageRecord *record : std::as_const(records)) apply(counts, *record, 1);
+        return toRows(counts);
+    }
+    }
+    return {};
+}
+
+QVector<TagStatistics::TagCount> TagStatistics::toRows(const CountMap &counts) const
+{
+    QVector<TagCount> rows;
+    rows.reserve(counts.size());
+    for (auto it = counts.constBegin(); it != counts.constEnd(); ++it) {
+        if (it.value().any <= 0) continue;
+        TagCount row;
+        row.key = m_keys.at(it.key());
+        row.display = m_display.at(it.key());
+        row.positive = it.value().positive;
+        row.negative = it.value().negative;
+        row.any = it.value().any;
+        rows.append(row);
+    }
+    return rows;
+}
@@ -0,0 +1,87 @@
+#ifndef TAGSTATISTICS_H
+#define TAGSTATISTICS_H
+
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct UserImageInfo;
+
+// 图库 Tag 频次统计：按 TagUtils::normalizedPromptTagKey 归一化，每张图内去重后计数。
+// 图片加入 / 离开时只增减这张图涉及的计数，不再整库重算；全局、目录、模型和日期的汇总都随之维护，
+// 查询只是读取（日期范围按天累加，目录按前缀累加）。值类型，成员都是隐式共享的 Qt 容器，可以整体拷贝给其他线程只读使用。
+class TagStatistics
+{
+public:
+    struct TagCount {
+        QString key;               // 归一化后的 key
+        QString display;           // 首次出现时的原文，用于显示
+        int positive = 0;          // 正面提示词中含此 Tag 的图片数
+        int negative = 0;          // 负面提示词中含此 Tag 的图片数
+        int any = 0;               // 正面或负面中含此 Tag 的图片数
+    };
+
+    struct Scope {
+        enum Kind { Global, Folder, Model, DateRange, Images };
+        Kind kind = Global;
+        QString value;             // Folder：目录（含子目录）；Model：模型名
+        qint64 fromMs = 0;         // DateRange：按 lastModified 所在的天，闭区间
+        qint64 toMs = 0;
+        QStringList paths;         // Images：指定的图片集合
+
+        static Scope global() { return Scope(); }
+        static Scope folder(const QString &dirPath);
+        static Scope model(const QString &modelName);
+        static Scope dateRange(qint64 fromMs, qint64 toMs);
+        static Scope images(const QStringList &imagePaths);
+    };
+
+    // 已存在同一路径时先移除旧记录。
+    void addImage(const UserImageInfo &info);
+    void removeImage(const QString &path);
+
+    bool contains(const QString &path) const { return m_images.contains(path); }
+    int imageCount() const { return int(m_images.size()); }
+    // 未排序；计数全为 0 的 Tag 不会出现。
+    QVector<TagCount> query(const Scope &scope = Scope()) const;
+
+    // 模型名的匹配 key：去掉目录和扩展名后大小写折叠。
+    static QString normalizedModelKey(const QString &name);
+    // 不计为 Tag 的归一化 key（BREAK 等区域提示词关键字）。画廊按行逐项统计时也用它，与本类计数一致。
+    static bool isIgnoredTagKey(const QString &key);
+
+private:
+    struct Counter {
+        int positive = 0;
+        int negative = 0;
+        int any = 0;
+    };
+    using CountMap = QHash<int, Counter>;   // Tag id → 计数
+
+    struct ImageRecord {
+        QVector<int> positive;     // 排序去重后的 Tag id
+        QVector<int> negative;
+        QString folder;
+        QStringList models;
+        qint64 day = 0;
+    };
+
+    int internTag(const QString &rawTag);
+    static void apply(CountMap &counts, const ImageRecord &record, int delta);
+    static void mergeInto(CountMap &target, const CountMap &source);
+    QVector<TagCount> toRows(const CountMap &counts) const;
+
+    QHash<QString, int> m_rawTagIds;       // 原始 Tag 文本 → id，相同文本只归一化一次
+    QHash<QString, int> m_keyIds;          // 归一化 key → id
+    QVector<QString> m_keys;
+    QVector<QString> m_display;
+    QHash<QString, ImageRecord> m_images;  // 图片路径 → 记录
+    CountMap m_global;
+    QHash<QString, CountMap> m_byFolder;   // 图片所在目录（不含子目录）
+    QHash<QString, CountMap> m_byModel;    // 提示词 / 参数中引用的模型
+    QMap<qint64, CountMap> m_byDay;        // lastModified 所在的天（UTC）
+};
+
+#endif // TAGSTATISTICS_H
@@ -57,6 +57,7 @@
 #include <atomic>
 #include <cmath>
 #include <functional>
+#include <numeric>
 #include <utility>
 #include <QElapsedTimer>
 #include <QSharedPointer>
@@ -83,6 +84,7 @@
 #include "utils/styleconstants.h"
 #include "utils/fileutils.h"
 #include "utils/tagutils.h"
+#include "utils/perceptualhash.h"
 
 namespace {
 QVector<TagTranslationSource> buildTagTranslationSources(const QStringList &paths,
@@ -104,10 +106,41 @@ QString normalizedHomeTagKey(const QString &tag)
     return tag.trimmed().toCaseFolded();
 }
 
-QString normalizedPromptTagKey(QString tag)
+// 画廊条目的归一化 Tag key（排序去重）；扫描时已写入 cacheRole，缺失时补算并缓存
+QStringList userGalleryItemTagKeys(QListWidgetItem *item, int tagRole, int cacheRole)
 {
-    tag.replace('_', ' ');
-    return tag.simplified().toCaseFolded();
+    const QVariant cached = item->data(cacheRole);
+    if (cached.isValid()) return cached.toStringList();
+
+    QStringList keys;
+    const QStringList tags = item->data(tagRole).toStringList();
+    keys.reserve(tags.size());
+    for (const QString &tag : tags) {
+        const QString key = TagUtils::normalizedPromptTagKey(tag);
+        if (!key.isEmpty()) keys.append(key);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.removeDuplicates();
+    item->setData(cacheRole, keys);
+    return keys;
+}
+
+// 画廊分组方式，与 comboUserGalleryGroupMode 的条目顺序一致
+enum UserGalleryGroupMode {
+    UserGalleryNoGrouping = 0,
+    UserGalleryGroupBySeedPrompt = 1,
+    UserGalleryGroupBySimilarity = 2
+};
+// “相似画面”分组的 dHash 汉明距离阈值，与重复图片检测的默认值一致
+constexpr int kUserGallerySimilarDistance = 4;
+
+// 同种子同提示词的分组 key：建条目时算一次写入条目，筛选时只比较整数。
+// 没有种子的图返回 0，不与任何图合并。
+quint64 userImageSeedGroupKey(const UserImageInfo &info)
+{
+    if (!info.params.hasSeed) return 0;
+    const quint64 key = quint64(qHashMulti(0, info.params.seed, info.prompt.simplified()));
+    return key ? key : 1;
 }
 
 PreviewMetadataPayload previewPayloadFromImageInfo(const ImageInfo &img)
@@ -592,6 +625,42 @@ bool parseCivArchivePayload(const QByteArray &data,
     return false;
 }
 
+// 元信息同步流水线参数：同时在途的模型数、Civitai 请求速率与批量 Hash 查询的每批数量。
+constexpr int kMetadataSyncMaxInFlight = 6;
+constexpr double kMetadataSyncRequestsPerSecond = 4.0;
+constexpr double kMetadataSyncRequestBurst = 6.0;
+constexpr int kMetadataSyncBulkHashBatchSize = 100;
+constexpr int kMetadataSyncMaxBackoffSeconds = 120;
+
+// 元信息同步和更新检查使用的 Civitai API 根地址；设置 SD_LORA_MANAGER_CIVITAI_API 可指向本地模拟服务做压测。
+QString civitaiApiBase()
+{
+    static const QString base = [] {
+        QString value = qEnvironmentVariable("SD_LORA_MANAGER_CIVITAI_API").trimmed();
+        while (value.endsWith('/')) value.chop(1);
+        return value.isEmpty() ? QStringLiteral("https://civitai.com/api/v1") : value;
+    }();
+    return base;
+}
+
+QUrl civitaiApiUrl(const QString &path)
+{
+    return QUrl(civitaiApiBase() + path);
+}
+
+// Retry-After 可以是秒数或 HTTP 日期，解析失败返回 -1。
+int retryAfterSeconds(QNetworkReply *reply)
+{
+    const QByteArray value = reply->rawHeader("Retry-After").trimmed();
+    if (value.isEmpty()) return -1;
+    bool ok = false;
+    const int seconds = value.toInt(&ok);
+    if (ok) return qMax(0, seconds);
+    const QDateTime when = QDateTime::fromString(QString::fromLatin1(value), Qt::RFC2822Date);
+    if (!when.isValid()) return -1;
+    return int(qMax<qint64>(0, QDateTime::currentDateTimeUtc().secsTo(when)));
+}
+
 QUrl civArchiveLookupUrl(const MetadataSyncJob &job)
 {
     QString hash = job.snapshot.currentSha256.trimmed();
@@ -838,6 +907,39 @@ public:
     }
 };
 
+// 画廊条目：折叠为组代表时在右上角画组内数量角标
+class UserGalleryGroupDelegate : public QStyledItemDelegate
+{
+public:
+    explicit UserGalleryGroupDelegate(QObject *parent = nullptr)
+        : QStyledItemDelegate(parent)
+    {
+    }
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override
+    {
+        QStyledItemDelegate::paint(painter, option, index);
+        const int groupSize = index.data(ROLE_USER_IMAGE_GROUP_SIZE).toInt();
+        if (groupSize < 2) return;
+
+        const QString text = QString("×%1").arg(groupSize);
+        QFont font = option.font;
+        font.setBold(true);
+        const QFontMetrics metrics(font);
+        QRect badge(0, 0, metrics.horizontalAdvance(text) + 10, metrics.height() + 2);
+        badge.moveTopRight(option.rect.topRight() + QPoint(-4, 4));
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing);
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(AppStyle::color("accentBlue"));
+        painter->drawRoundedRect(badge, badge.height() / 2.0, badge.height() / 2.0);
+        painter->setPen(Qt::white);
+        painter->setFont(font);
+        painter->drawText(badge, Qt::AlignCenter, text);
+        painter->restore();
+    }
+};
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
@@ -1025,6 +1127,7 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->modelList, &QListWidget::customContextMenuRequested, this, &MainWindow::onSidebarContextMenu);
     ui->collectionTree->setContextMenuPolicy(Qt::CustomContextMenu);
     ui->collectionTree->setItemDelegate(new HighlightItemDelegate(ui->collectionTree));
+    ui->listUserImages->setItemDelegate(new UserGalleryGroupDelegate(ui->listUserImages));
     connect(ui->collectionTree, &QTreeWidget::customContextMenuRequested, this, &MainWindow::onCollectionTreeContextMenu);
     ui->collectionTree->setSelectionMode(QAbstractItemView::ExtendedSelection);
     // 工具栏按钮
@@ -1104,9 +1207,10 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->listUserImages, &QListWidget::itemDoubleClicked, this, [this](QListWidgetItem *item){
         if (!item) return;
         QString path = item->data(ROLE_USER_IMAGE_PATH).toString(); // 取出全路径
-        if (!path.isEmpty()) {
-            openImageViewer(visibleUserGalleryImagePaths(), path);
-        }
+        if (path.isEmpty()) return;
+        // 折叠的组代表：浏览整组
+        const QStringList groupPaths = item->data(ROLE_USER_IMAGE_GROUP_PATHS).toStringList();
+        openImageViewer(groupPaths.size() > 1 ? groupPaths : visibleUserGalleryImagePaths(), path);
     });
     // 3. 信号连接
     // 切换 Tab 按钮
@@ -1154,6 +1258,23 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->editUserTagSearch, &QLineEdit::textChanged, this, [this](const QString &text){
         tagFlowWidget->setSearchText(text);
     });
+    // 提示词搜索走图库语料的全文索引；输入停顿后再筛选，避免每个字符都重排画廊
+    userPromptSearchTimer = new QTimer(this);
+    userPromptSearchTimer->setSingleShot(true);
+    userPromptSearchTimer->setInterval(200);
+    connect(userPromptSearchTimer, &QTimer::timeout, this, [this]() {
+        applyUserGalleryTagFilter(tagFlowWidget->getSelectedTags(), true);
+    });
+    connect(ui->editUserPromptSearch, &QLineEdit::textChanged, userPromptSearchTimer, qOverload<>(&QTimer::start));
+    connect(ui->comboUserGalleryGroupMode, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int) {
+        applyUserGalleryTagFilter(tagFlowWidget->getSelectedTags(), true);
+    });
+    // 索引在后台更新，完成后按新索引重新筛选一次
+    connect(GalleryCorpus::instance(), &GalleryCorpus::indexesChanged, this, [this]() {
+        if (!ui->editUserPromptSearch->text().trimmed().isEmpty()) {
+            applyUserGalleryTagFilter(tagFlowWidget->getSelectedTags(), false);
+        }
+    });
     connect(ui->chkUserTagLoraOnly, &QCheckBox::toggled, this, [this](bool checked){
         tagFlowWidget->setLoraOnly(checked);
     });
@@ -1228,6 +1349,9 @@ MainWindow::MainWindow(QWidget *parent)
         loadModelHighlightColors();
         loadModelUserNotes();
         loadUserGalleryCache();
+        GalleryCorpus::instance()->publish(imageCache);
+        scheduleUserImageSimilarGrouping();
+        scheduleUserImagePerceptualHashing();
         ui->comboSort->setCurrentIndex(0);
 
         // 扫描完成后（异步）刷新状态栏计数，并按需检查软件更新。
@@ -1380,80 +1504,18 @@ static QStringList splitCivitaiFullNameForMatch(const QString &name)
     return out;
 }
 
-static QStringList extractLoraNamesFromPromptWorker(const QString &prompt)
-{
-    QStringList names;
-    static QRegularExpression loraRegex("<\\s*(?:lora|lyco)\\s*:\\s*([^:>]+)",
-                                        QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatchIterator it = loraRegex.globalMatch(prompt);
-    while (it.hasNext()) {
-        const QString name = it.next().captured(1).trimmed();
-        if (!name.isEmpty()) names.append(name);
-    }
-    return names;
-}
-
-static QStringList extractLoraNamesFromMetadataWorker(const QString &metadata)
-{
-    QStringList names;
-    if (metadata.isEmpty()) return names;
-
-    static QRegularExpression addNetModelRegex("(?:^|[,\\n\\r])\\s*AddNet\\s+Model\\s+\\d+\\s*:\\s*([^,\\n\\r]+)",
-                                               QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatchIterator addNetIt = addNetModelRegex.globalMatch(metadata);
-    while (addNetIt.hasNext()) {
-        const QString name = addNetIt.next().captured(1).trimmed();
-        if (!name.isEmpty()) names.append(name);
-    }
-
-    static QRegularExpression loraHashesBlockRegex("(?:^|[,\\n\\r])\\s*Lora\\s+hashes\\s*:\\s*(\"[^\"]*\"|[^\\n\\r]*)",
-                                                   QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatchIterator blockIt = loraHashesBlockRegex.globalMatch(metadata);
-    while (blockIt.hasNext()) {
-        QString block = blockIt.next().captured(1).trimmed();
-        if (block.startsWith('"') && block.endsWith('"') && block.size() >= 2) {
-            block = block.mid(1, block.size() - 2);
-        }
-
-        static QRegularExpression loraHashNameRegex("([^:,]+?)\\s*:");
-        QRegularExpressionMatchIterator nameIt = loraHashNameRegex.globalMatch(block);
-        while (nameIt.hasNext()) {
-            const QString name = nameIt.next().captured(1).trimmed();
-            if (!name.isEmpty()) names.append(name);
-        }
-    }
-
-    static QRegularExpression comfyLoraBlockRegex("(?:^|[,\\n\\r])\\s*ComfyUI\\s+LoRAs\\s*:\\s*([^\\n\\r]*)",
-                                                  QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatchIterator comfyIt = comfyLoraBlockRegex.globalMatch(metadata);
-    while (comfyIt.hasNext()) {
-        const QStringList entries = comfyIt.next().captured(1).split(',', Qt::SkipEmptyParts);
-        for (QString entry : entries) {
-            entry = entry.trimmed();
-            const int colon = entry.indexOf(':');
-            if (colon > 0) entry = entry.left(colon).trimmed();
-            if (!entry.isEmpty()) names.append(entry);
-        }
-    }
-
-    return names;
-}
-
-static QStringList extractCheckpointNamesFromParametersWorker(const QString &parameters);
 static void addLoraNameVariantsWorker(const QString &name, QSet<QString> &out);
 static bool nameSetsIntersectWorker(const QSet<QString> &imageNames, const QSet<QString> &targetNames);
 
-static bool promptUsesLoraWorker(const QString &prompt, const QString &parameters, const QSet<QString> &normalizedLoraNames)
+static bool promptUsesLoraWorker(const ImageParameters &params, const QSet<QString> &normalizedLoraNames)
 {
     if (normalizedLoraNames.isEmpty()) return false;
 
-    QStringList usedLoras = extractLoraNamesFromPromptWorker(prompt);
-    usedLoras.append(extractLoraNamesFromMetadataWorker(parameters));
-    for (const QString &usedLora : usedLoras) {
+    for (const ImageParameters::Lora &lora : params.loras) {
         QSet<QString> usedVariants;
-        addLoraNameVariantsWorker(usedLora, usedVariants);
+        addLoraNameVariantsWorker(lora.name, usedVariants);
         if (usedVariants.isEmpty()) {
-            const QString normalized = normalizeLoraNameForMatch(usedLora);
+            const QString normalized = normalizeLoraNameForMatch(lora.name);
             if (!normalized.isEmpty()) usedVariants.insert(normalized);
         }
         if (nameSetsIntersectWorker(usedVariants, normalizedLoraNames)) {
@@ -1463,12 +1525,11 @@ static bool promptUsesLoraWorker(const QString &prompt, const QString &parameter
     return false;
 }
 
-static bool parametersUseCheckpointWorker(const QString &parameters, const QSet<QString> &normalizedCheckpointNames)
+static bool parametersUseCheckpointWorker(const ImageParameters &params, const QSet<QString> &normalizedCheckpointNames)
 {
     if (normalizedCheckpointNames.isEmpty()) return false;
 
-    const QStringList usedCheckpoints = extractCheckpointNamesFromParametersWorker(parameters);
-    for (const QString &usedCheckpoint : usedCheckpoints) {
+    for (const QString &usedCheckpoint : params.checkpointNames) {
         if (normalizedCheckpointNames.contains(normalizeModelNameForMatch(usedCheckpoint))) {
             return true;
         }
@@ -1569,100 +1630,7 @@ static QSet<QString> collectCheckpointHashesFromJsonFileWorker(const QString &pa
     return out;
 }
 
-static QSet<QString> extractLoraHashValuesFromParametersWorker(const QString &parameters)
-{
-    QSet<QString> hashes;
-    if (parameters.isEmpty()) return hashes;
-
-    static QRegularExpression loraHashesBlockRegex("(?:^|[,\\n\\r])\\s*Lora\\s+hashes\\s*:\\s*(\"[^\"]*\"|[^\\n\\r]*)",
-                                                   QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatchIterator blockIt = loraHashesBlockRegex.globalMatch(parameters);
-    while (blockIt.hasNext()) {
-        QString block = blockIt.next().captured(1).trimmed();
-        if (block.startsWith('"') && block.endsWith('"') && block.size() >= 2) {
-            block = block.mid(1, block.size() - 2);
-        }
-        static QRegularExpression hashInBlockRegex(":\\s*([A-Fa-f0-9]{6,128})");
-        QRegularExpressionMatchIterator hashIt = hashInBlockRegex.globalMatch(block);
-        while (hashIt.hasNext()) {
-            const QString normalized = normalizeSummaryHashForMatch(hashIt.next().captured(1));
-            if (!normalized.isEmpty()) hashes.insert(normalized);
-        }
-    }
-
-    static QRegularExpression comfyHashesBlockRegex("(?:^|[,\\n\\r])\\s*ComfyUI\\s+Lora\\s+hashes\\s*:\\s*([^\\n\\r]*)",
-                                                    QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatchIterator comfyIt = comfyHashesBlockRegex.globalMatch(parameters);
-    while (comfyIt.hasNext()) {
-        const QString block = comfyIt.next().captured(1);
-        static QRegularExpression hashInComfyRegex(":\\s*([A-Fa-f0-9]{6,128})");
-        QRegularExpressionMatchIterator hashIt = hashInComfyRegex.globalMatch(block);
-        while (hashIt.hasNext()) {
-            const QString normalized = normalizeSummaryHashForMatch(hashIt.next().captured(1));
-            if (!normalized.isEmpty()) hashes.insert(normalized);
-        }
-    }
-
-    static QRegularExpression addNetHashRegex("(?:^|[,\\n\\r])\\s*AddNet\\s+Model\\s+hash\\s+\\d+\\s*:\\s*([A-Fa-f0-9]{6,128})",
-                                              QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatchIterator addNetIt = addNetHashRegex.globalMatch(parameters);
-    while (addNetIt.hasNext()) {
-        const QString normalized = normalizeSummaryHashForMatch(addNetIt.next().captured(1));
-        if (!normalized.isEmpty()) hashes.insert(normalized);
-    }
-
-    return hashes;
-}
-
-static QStringList extractCheckpointNamesFromParametersWorker(const QString &parameters)
-{
-    QStringList names;
-    if (parameters.isEmpty()) return names;
-
-    static QRegularExpression modelRegex("(?:^|[,\\n\\r])\\s*Model\\s*:\\s*([^,\\n\\r]+)",
-                                         QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatchIterator modelIt = modelRegex.globalMatch(parameters);
-    while (modelIt.hasNext()) {
-        const QString name = modelIt.next().captured(1).trimmed();
-        if (!name.isEmpty()) names.append(name);
-    }
-
-    static QRegularExpression checkpointRegex("(?:^|[,\\n\\r])\\s*Checkpoint\\s*:\\s*([^,\\n\\r]+)",
-                                              QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatchIterator checkpointIt = checkpointRegex.globalMatch(parameters);
-    while (checkpointIt.hasNext()) {
-        const QString name = checkpointIt.next().captured(1).trimmed();
-        if (!name.isEmpty()) names.append(name);
-    }
-
-    return names;
-}
-
-static QSet<QString> extractCheckpointHashValuesFromParametersWorker(const QString &parameters)
-{
-    QSet<QString> hashes;
-    if (parameters.isEmpty()) return hashes;
-
-    static QRegularExpression modelHashRegex("(?:^|[,\\n\\r])\\s*Model\\s+hash\\s*:\\s*([A-Fa-f0-9]{6,128})",
-                                             QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatchIterator it = modelHashRegex.globalMatch(parameters);
-    while (it.hasNext()) {
-        const QString normalized = normalizeSummaryHashForMatch(it.next().captured(1));
-        if (!normalized.isEmpty()) hashes.insert(normalized);
-    }
-    return hashes;
-}
-
-static bool parametersAreFromComfyWorker(const QString &parameters)
-{
-    if (parameters.isEmpty()) return false;
-
-    static QRegularExpression sourceRegex("(?:^|[\\n\\r])\\s*Source\\s*:\\s*ComfyUI\\b",
-                                          QRegularExpression::CaseInsensitiveOption);
-    return sourceRegex.match(parameters).hasMatch();
-}
-
-static bool hashSetsMatchByPrefixWorker(const QSet<QString> &imageHashes, const QSet<QString> &targetHashes)
+static bool hashSetsMatchByPrefixWorker(const QStringList &imageHashes, const QSet<QString> &targetHashes)
 {
     if (imageHashes.isEmpty() || targetHashes.isEmpty()) return false;
 
@@ -1689,9 +1657,9 @@ static bool nameSetsIntersectWorker(const QSet<QString> &imageNames, const QSet<
 
 struct CachedImageUsageInfo {
     QSet<QString> usedLoraNames;
-    QSet<QString> loraHashes;
+    QStringList loraHashes;
     QSet<QString> usedCheckpointNames;
-    QSet<QString> checkpointHashes;
+    QStringList checkpointHashes;
     bool isComfy = false;
     qint64 lastModified = 0;
 };
@@ -1819,25 +1787,23 @@ static QList<ModelUsageStatResult> calculateModelUsageStatsWorker(
     for (auto it = imageCache.constBegin(); it != imageCache.constEnd(); ++it) {
         const UserImageInfo &info = it.value();
         CachedImageUsageInfo cached;
-        QStringList usedNames = extractLoraNamesFromPromptWorker(info.prompt);
-        usedNames.append(extractLoraNamesFromMetadataWorker(info.parameters));
-        for (const QString &usedName : usedNames) {
+        // 参数在解析图片时已提取为结构化记录，这里只做名称归一化
+        for (const ImageParameters::Lora &lora : info.params.loras) {
             QSet<QString> usedVariants;
-            addLoraNameVariantsWorker(usedName, usedVariants);
+            addLoraNameVariantsWorker(lora.name, usedVariants);
             if (usedVariants.isEmpty()) {
-                const QString normalized = normalizeLoraNameForMatch(usedName);
+                const QString normalized = normalizeLoraNameForMatch(lora.name);
                 if (!normalized.isEmpty()) usedVariants.insert(normalized);
             }
             for (const QString &variant : usedVariants) cached.usedLoraNames.insert(variant);
         }
-        cached.loraHashes = extractLoraHashValuesFromParametersWorker(info.parameters);
-        cached.isComfy = parametersAreFromComfyWorker(info.parameters);
-        const QStringList checkpointNames = extractCheckpointNamesFromParametersWorker(info.parameters);
-        for (const QString &checkpointName : checkpointNames) {
+        cached.loraHashes = info.params.loraHashes;
+        cached.isComfy = info.params.isComfy;
+        for (const QString &checkpointName : info.params.checkpointNames) {
             const QString normalized = normalizeModelNameForMatch(checkpointName);
             if (!normalized.isEmpty()) cached.usedCheckpointNames.insert(normalized);
         }
-        cached.checkpointHashes = extractCheckpointHashValuesFromParametersWorker(info.parameters);
+        cached.checkpointHashes = info.params.checkpointHashes;
         cached.lastModified = info.lastModified;
 
         if (!cached.usedLoraNames.isEmpty() || !cached.loraHashes.isEmpty()
@@ -1873,7 +1839,7 @@ static QList<ModelUsageStatResult> calculateModelUsageStatsWorker(
         for (const CachedImageUsageInfo &image : imageInfos) {
             bool matched = false;
             if (useSummary) {
-                const QSet<QString> &imageHashes = candidate.isCheckpoint ? image.checkpointHashes : image.loraHashes;
+                const QStringList &imageHashes = candidate.isCheckpoint ? image.checkpointHashes : image.loraHashes;
                 matched = hashSetsMatchByPrefixWorker(imageHashes, targetHashes);
                 if (!matched && comfyModelNameFallback && image.isComfy && imageHashes.isEmpty()) {
                     const QSet<QString> &targetNames = candidate.isCheckpoint
@@ -1926,6 +1892,7 @@ static void parsePngInfoWorker(const QString &path, UserImageInfo &info, bool sp
     info.parameters = parsed.parametersText.trimmed();
     info.cleanTags = parsePromptsToTagsWorker(info.prompt, splitOnNewline, filterTags);
     info.negativeCleanTags = parsePromptsToTagsWorker(info.negativePrompt, splitOnNewline, filterTags);
+    info.params = ImageParameters::parse(info.parameters, info.prompt);
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
@@ -1967,6 +1934,12 @@ MainWindow::~MainWindow()
     if (metadataScanWatcher && metadataScanWatcher->isRunning()) metadataScanWatcher->waitForFinished();
     if (metadataHealthWatcher && metadataHealthWatcher->isRunning()) metadataHealthWatcher->waitForFinished();
     if (imageLoadWatcher && imageLoadWatcher->isRunning()) imageLoadWatcher->waitForFinished();
+    if (userImageHashWatcher && userImageHashWatcher->isRunning()) {
+        userImageHashWatcher->cancel();
+        userImageHashWatcher->waitForFinished();
+    }
+    if (userImageSimilarGroupWatcher && userImageSimilarGroupWatcher->isRunning()) userImageSimilarGroupWatcher->waitForFinished();
+    if (userGalleryHashesDirty) saveUserGalleryCache();
     saveGlobalConfig();
     cancelPendingTasks();
     if (backgroundThreadPool) backgroundThreadPool->clear();
@@ -4060,11 +4033,10 @@ void MainWindow::refreshUsageAnalysisWidget()
         data.models.append(model);
     }
 
-    for (auto it = imageCache.cbegin(); it != imageCache.cend(); ++it) {
-        for (const QString &tag : it.value().cleanTags) {
-            const QString clean = tag.trimmed();
-            if (!clean.isEmpty()) data.positiveTagCounts[clean] += 1;
-        }
+    // 图库 Tag 统计在后台增量维护，这里只读取；统计更新后会再次刷新
+    const GalleryCorpusSnapshot corpus = GalleryCorpus::instance()->snapshot();
+    for (const TagStatistics::TagCount &count : corpus.tagStats.query()) {
+        if (count.positive > 0) data.positiveTagCounts[count.display] += count.positive;
     }
 
     usageAnalysisWidget->setAnalysisData(data);
@@ -8092,6 +8064,8 @@ void MainWindow::onClearUserGalleryCacheClicked()
     if (reply != QMessageBox::Yes) return;
 
     imageCache.clear();
+    GalleryCorpus::instance()->publish(imageCache);
+    scheduleUserImageSimilarGrouping();
     QString cachePath = qApp->applicationDirPath() + "/config/user_gallery_cache.json";
     QFile::remove(cachePath);
     refreshModelUsageStatsAsync();
@@ -8412,6 +8386,13 @@ void MainWindow::scanForUserImages(const QString &loraBaseName) {
 
                     // 如果没命中缓存，或者文件被修改过，则解析
                     if (needParse) {
+                        // 文件没变、只是解析器升级时，沿用已算好的感知哈希
+                        const auto cached = currentCacheCopy.constFind(path);
+                        if (cached != currentCacheCopy.constEnd() && cached->lastModified == currentModified) {
+                            info.perceptualHash = cached->perceptualHash;
+                            info.fileSize = cached->fileSize;
+                            info.perceptualHashValid = cached->perceptualHashValid;
+                        }
                         info.path = path;
                         info.lastModified = currentModified;
                         parsePngInfoWorker(path, info, splitOnNewline, filterTags); // 解析 I/O 操作
@@ -8427,19 +8408,19 @@ void MainWindow::scanForUserImages(const QString &loraBaseName) {
                     if (isGlobalMode) {
                         matched = true;
                     } else if (useSummaryHashMatch) {
-                        const QSet<QString> imageHashes = selectedIsCheckpoint
-                                                              ? extractCheckpointHashValuesFromParametersWorker(info.parameters)
-                                                              : extractLoraHashValuesFromParametersWorker(info.parameters);
+                        const QStringList &imageHashes = selectedIsCheckpoint
+                                                             ? info.params.checkpointHashes
+                                                             : info.params.loraHashes;
                         matched = hashSetsMatchByPrefixWorker(imageHashes, targetSummaryHashes);
-                        if (!matched && comfyModelNameFallback && parametersAreFromComfyWorker(info.parameters) && imageHashes.isEmpty()) {
+                        if (!matched && comfyModelNameFallback && info.params.isComfy && imageHashes.isEmpty()) {
                             matched = selectedIsCheckpoint
-                                          ? parametersUseCheckpointWorker(info.parameters, normalizedLoraNames)
-                                          : promptUsesLoraWorker(info.prompt, info.parameters, normalizedLoraNames);
+                                          ? parametersUseCheckpointWorker(info.params, normalizedLoraNames)
+                                          : promptUsesLoraWorker(info.params, normalizedLoraNames);
                         }
                     } else if (selectedIsCheckpoint) {
-                        matched = parametersUseCheckpointWorker(info.parameters, normalizedLoraNames);
+                        matched = parametersUseCheckpointWorker(info.params, normalizedLoraNames);
                     } else {
-                        matched = promptUsesLoraWorker(info.prompt, info.parameters, normalizedLoraNames);
+                        matched = promptUsesLoraWorker(info.params, normalizedLoraNames);
                     }
 
                     if (matched) {
@@ -8498,7 +8479,10 @@ void MainWindow::scanForUserImages(const QString &loraBaseName) {
             }
             // 保存到磁盘，下次启动就快了
             saveUserGalleryCache();
+            GalleryCorpus::instance()->publish(imageCache);
             refreshModelUsageStatsAsync();
+            scheduleUserImageSimilarGrouping();
+            scheduleUserImagePerceptualHashing();
         }
 
         // Add results in small batches so a large gallery does not freeze the
@@ -8532,7 +8516,7 @@ void MainWindow::scanForUserImages(const QString &loraBaseName) {
                     QStringList keys;
                     keys.reserve(tags.size());
                     for (const QString &tag : tags) {
-                        const QString key = normalizedPromptTagKey(tag);
+                        const QString key = TagUtils::normalizedPromptTagKey(tag);
                         if (!key.isEmpty()) keys.append(key);
                     }
                     std::sort(keys.begin(), keys.end());
@@ -8543,6 +8527,7 @@ void MainWindow::scanForUserImages(const QString &loraBaseName) {
                               makeNormalizedTagKeys(info.cleanTags));
                 item->setData(ROLE_USER_IMAGE_NEG_KEYS,
                               makeNormalizedTagKeys(info.negativeCleanTags));
+                item->setData(ROLE_USER_IMAGE_SEED_GROUP, userImageSeedGroupKey(info));
                 item->setIcon(placeholderIcon);
                 item->setData(ROLE_PREVIEW_PLACEHOLDER, true);
                 ui->listUserImages->addItem(item);
@@ -8590,9 +8575,9 @@ void MainWindow::refreshUserTagFlowStats(bool applyGalleryFilter,
         QSet<QString> perImageTagKeys;
         const QStringList positiveTags = item->data(ROLE_USER_IMAGE_TAGS).toStringList();
         for (const QString &tag : positiveTags) {
-            if (tag.compare("BREAK", Qt::CaseInsensitive) == 0) continue;
-            const QString key = normalizedPromptTagKey(tag);
-            if (key.isEmpty()) continue;
+            // 与图库 Tag 统计同一套归一化和过滤，快慢两条路径的计数一致
+            const QString key = TagUtils::normalizedPromptTagKey(tag);
+            if (key.isEmpty() || TagStatistics::isIgnoredTagKey(key)) continue;
             perImageTagKeys.insert(key);
             positiveTagKeys.insert(key);
             if (!tagDisplayText.contains(key)) tagDisplayText.insert(key, tag);
@@ -8600,9 +8585,8 @@ void MainWindow::refreshUserTagFlowStats(bool applyGalleryFilter,
         if (includeNegative) {
             const QStringList negativeTags = item->data(ROLE_USER_IMAGE_NEG_TAGS).toStringList();
             for (const QString &tag : negativeTags) {
-                if (tag.compare("BREAK", Qt::CaseInsensitive) == 0) continue;
-                const QString key = normalizedPromptTagKey(tag);
-                if (key.isEmpty()) continue;
+                const QString key = TagUtils::normalizedPromptTagKey(tag);
+                if (key.isEmpty() || TagStatistics::isIgnoredTagKey(key)) continue;
                 perImageTagKeys.insert(key);
                 negativeTagKeys.insert(key);
                 if (!tagDisplayText.contains(key)) tagDisplayText.insert(key, tag);
@@ -8613,8 +8597,24 @@ void MainWindow::refreshUserTagFlowStats(bool applyGalleryFilter,
         }
     };
 
+    const GalleryCorpusSnapshot corpus = GalleryCorpus::instance()->snapshot();
     if (currentOnly) {
         addTagsFromItem(ui->listUserImages->currentItem());
+    } else if (corpus.indexesCurrent()) {
+        // 列表中的图片都已在图库 Tag 统计中，按图片集合直接汇总，不再逐项归一化
+        QStringList paths;
+        paths.reserve(ui->listUserImages->count());
+        for (int i = 0; i < ui->listUserImages->count(); ++i) {
+            paths.append(ui->listUserImages->item(i)->data(ROLE_USER_IMAGE_PATH).toString());
+        }
+        for (const TagStatistics::TagCount &count : corpus.tagStats.query(TagStatistics::Scope::images(paths))) {
+            const int imageCount = includeNegative ? count.any : count.positive;
+            if (imageCount <= 0) continue;
+            tagDisplayText.insert(count.key, count.display);
+            if (count.positive > 0) positiveTagKeys.insert(count.key);
+            if (includeNegative && count.negative > 0) negativeTagKeys.insert(count.key);
+            tagCounts[count.display] += imageCount;
+        }
     } else {
         for (int i = 0; i < ui->listUserImages->count(); ++i) {
             addTagsFromItem(ui->listUserImages->item(i));
@@ -8622,6 +8622,16 @@ void MainWindow::refreshUserTagFlowStats(bool applyGalleryFilter,
     }
 
     tagFlowWidget->setData(tagCounts);
+    userTagFlowShownCounts = tagCounts;
+    // 选中 Tag 后按位图重算剩余计数；“当前图”模式只看一张图，不需要
+    userTagFlowBaseCounts.clear();
+    userTagFlowKeys.clear();
+    if (!currentOnly) {
+        userTagFlowBaseCounts = tagCounts;
+        for (auto it = tagCounts.constBegin(); it != tagCounts.constEnd(); ++it) {
+            userTagFlowKeys.insert(it.key(), TagUtils::normalizedPromptTagKey(it.key()));
+        }
+    }
     QHash<QString, TagFlowWidget::VisualRole> visualRoles;
     if (includeNegative) {
         for (const QString &key : std::as_const(negativeTagKeys)) {
@@ -8726,6 +8736,50 @@ void MainWindow::onTagFilterChanged(const QSet<QString> &selectedTags) {
     applyUserGalleryTagFilter(selectedTags, true);
 }
 
+void MainWindow::ensureUserGalleryTagBitmaps()
+{
+    const int rowCount = ui->listUserImages->count();
+    if (userGalleryTagBitmaps.generation == userGalleryGeneration && userGalleryTagBitmaps.rowCount == rowCount) {
+        if (userGalleryTagBitmaps.similarGroupsVersion == userImageSimilarGroupsVersion) return;
+        // 行不变，只有相似分组重新算过
+        QVector<quint64> &keys = userGalleryTagBitmaps.similarGroupKeys;
+        for (int row = 0; row < rowCount; ++row) {
+            keys[row] = userImageSimilarGroups.value(userGalleryTagBitmaps.rowPaths.at(row));
+        }
+        userGalleryTagBitmaps.similarGroupsVersion = userImageSimilarGroupsVersion;
+        return;
+    }
+
+    // 列表只在扫描时整体重建或追加，行号在同一代内稳定；逐行追加，位图按升序构建
+    UserGalleryTagBitmaps bitmaps;
+    bitmaps.generation = userGalleryGeneration;
+    bitmaps.rowCount = rowCount;
+    bitmaps.rowByPath.reserve(rowCount);
+    bitmaps.rowPaths.reserve(rowCount);
+    bitmaps.seedGroupKeys.fill(0, rowCount);
+    bitmaps.similarGroupsVersion = userImageSimilarGroupsVersion;
+    bitmaps.similarGroupKeys.fill(0, rowCount);
+    for (int row = 0; row < rowCount; ++row) {
+        QListWidgetItem *item = ui->listUserImages->item(row);
+        if (!item) {
+            bitmaps.rowPaths.append(QString());
+            continue;
+        }
+        const QString path = item->data(ROLE_USER_IMAGE_PATH).toString();
+        bitmaps.rowPaths.append(path);
+        bitmaps.rowByPath.insert(path, quint32(row));
+        bitmaps.seedGroupKeys[row] = item->data(ROLE_USER_IMAGE_SEED_GROUP).toULongLong();
+        bitmaps.similarGroupKeys[row] = userImageSimilarGroups.value(path);
+        for (const QString &key : userGalleryItemTagKeys(item, ROLE_USER_IMAGE_TAGS, ROLE_USER_IMAGE_TAG_KEYS)) {
+            bitmaps.positive[key].add(quint32(row));
+        }
+        for (const QString &key : userGalleryItemTagKeys(item, ROLE_USER_IMAGE_NEG_TAGS, ROLE_USER_IMAGE_NEG_KEYS)) {
+            bitmaps.negative[key].add(quint32(row));
+        }
+    }
+    userGalleryTagBitmaps = bitmaps;
+}
+
 void MainWindow::applyUserGalleryTagFilter(const QSet<QString> &selectedTags,
                                            bool resetScrollToTop) {
     const quint64 layoutGeneration = ++userGalleryLayoutGeneration;
@@ -8735,81 +8789,117 @@ void MainWindow::applyUserGalleryTagFilter(const QSet<QString> &selectedTags,
     const int previousHorizontalScroll = ui->listUserImages->horizontalScrollBar()
                                              ? ui->listUserImages->horizontalScrollBar()->value()
                                              : 0;
-    int visibleCount = 0;
     const bool includeNegative = ui->chkUserTagIncludeNegative && ui->chkUserTagIncludeNegative->isChecked();
     const QString currentImagePath = ui->listUserImages->currentItem()
                                          ? ui->listUserImages->currentItem()->data(ROLE_USER_IMAGE_PATH).toString()
                                          : QString();
     QSet<QString> selectedTagKeys;
     for (const QString &tag : selectedTags) {
-        const QString key = normalizedPromptTagKey(tag);
+        const QString key = TagUtils::normalizedPromptTagKey(tag);
         if (!key.isEmpty()) selectedTagKeys.insert(key);
     }
-
-    struct FilteredGalleryItem {
-        QListWidgetItem *item = nullptr;
-        bool visible = false;
+    const QString promptQuery = ui->editUserPromptSearch->text().trimmed();
+
+    // 按位图求交：先取全部行，再依次与提示词搜索结果、每个选中 Tag 的行集合相与。
+    // 提示词索引可能还在后台追赶最新扫描，先用已有的结果，indexesChanged 后会再筛一次
+    ensureUserGalleryTagBitmaps();
+    const int rowCount = ui->listUserImages->count();
+    RoaringBitmap matchedRows = RoaringBitmap::range(quint32(rowCount));
+    if (!promptQuery.isEmpty()) {
+        const QVector<PromptSearchIndex::Hit> hits = GalleryCorpus::instance()->snapshot().searchIndex.search(promptQuery);
+        QVector<quint32> promptRows;
+        promptRows.reserve(hits.size());
+        for (const PromptSearchIndex::Hit &hit : hits) {
+            const auto row = userGalleryTagBitmaps.rowByPath.constFind(hit.path);
+            if (row != userGalleryTagBitmaps.rowByPath.constEnd()) promptRows.append(row.value());
+        }
+        std::sort(promptRows.begin(), promptRows.end());
+        RoaringBitmap promptBitmap;
+        for (quint32 row : std::as_const(promptRows)) promptBitmap.add(row);
+        matchedRows = matchedRows & promptBitmap;
+    }
+    auto rowsWithTag = [this, includeNegative](const QString &key) {
+        const RoaringBitmap positive = userGalleryTagBitmaps.positive.value(key);
+        return includeNegative ? positive | userGalleryTagBitmaps.negative.value(key) : positive;
     };
-    QVector<FilteredGalleryItem> filteredItems;
-    filteredItems.reserve(ui->listUserImages->count());
-
-    for (int i = 0; i < ui->listUserImages->count(); ++i) {
-        QListWidgetItem *item = ui->listUserImages->item(i);
-        auto normalizedKeys = [item](int tagRole, int cacheRole) {
-            const QVariant cached = item->data(cacheRole);
-            if (cached.isValid()) return cached.toStringList();
-
-            QStringList keys;
-            const QStringList tags = item->data(tagRole).toStringList();
-            keys.reserve(tags.size());
-            for (const QString &tag : tags) {
-                const QString key = normalizedPromptTagKey(tag);
-                if (!key.isEmpty()) keys.append(key);
-            }
-            std::sort(keys.begin(), keys.end());
-            keys.removeDuplicates();
-            item->setData(cacheRole, keys);
-            return keys;
-        };
-
-        const QStringList positiveTagKeys = normalizedKeys(ROLE_USER_IMAGE_TAGS,
-                                                            ROLE_USER_IMAGE_TAG_KEYS);
-        const QStringList negativeTagKeys = includeNegative
-                                                ? normalizedKeys(ROLE_USER_IMAGE_NEG_TAGS,
-                                                                 ROLE_USER_IMAGE_NEG_KEYS)
-                                                : QStringList();
-
-        bool match = true;
-        // AND 逻辑：必须包含所有选中的 Tag
-        for (const QString &selTag : selectedTagKeys) {
-            const bool tagFound = std::binary_search(positiveTagKeys.cbegin(),
-                                                     positiveTagKeys.cend(), selTag)
-                                  || (includeNegative
-                                      && std::binary_search(negativeTagKeys.cbegin(),
-                                                            negativeTagKeys.cend(), selTag));
-            if (!tagFound) {
-                match = false;
-                break;
+    // AND 逻辑：必须包含所有选中的 Tag
+    for (const QString &key : std::as_const(selectedTagKeys)) {
+        if (matchedRows.isEmpty()) break;
+        matchedRows = matchedRows & rowsWithTag(key);
+    }
+    const int visibleCount = int(matchedRows.cardinality());
+
+    const QVector<quint32> matchedRowList = matchedRows.toVector();
+    QVector<bool> rowVisible(rowCount, false);
+    for (quint32 row : matchedRowList) rowVisible[int(row)] = true;
+
+    // 分组折叠：每组只显示最新的一张（列表按修改时间倒序，即组内行号最小者），其余隐藏；
+    // 代表条目记下组内数量和路径，用于角标和双击浏览整组。只在筛选结果内分组，TagFlow 计数仍按全部结果
+    const int groupMode = ui->comboUserGalleryGroupMode->currentIndex();
+    QHash<int, QStringList> groupPathsByRow;
+    int groupCount = visibleCount;
+    if (groupMode != UserGalleryNoGrouping && visibleCount > 1) {
+        QVector<int> groupOfIndex(matchedRowList.size());
+        std::iota(groupOfIndex.begin(), groupOfIndex.end(), 0);
+        // 相似组号由后台按感知哈希预先聚类，还没有哈希的图组号为 0，暂时各自成组
+        const QVector<quint64> &groupKeys = groupMode == UserGalleryGroupBySeedPrompt
+            ? userGalleryTagBitmaps.seedGroupKeys
+            : userGalleryTagBitmaps.similarGroupKeys;
+        QHash<quint64, int> firstIndexOfKey;
+        for (int i = 0; i < matchedRowList.size(); ++i) {
+            const quint64 key = groupKeys.at(int(matchedRowList.at(i)));
+            if (key == 0) continue;
+            const auto first = firstIndexOfKey.constFind(key);
+            if (first == firstIndexOfKey.constEnd()) firstIndexOfKey.insert(key, i);
+            else groupOfIndex[i] = first.value();
+        }
+        groupCount = 0;
+        for (int i = 0; i < matchedRowList.size(); ++i) {
+            const int row = int(matchedRowList.at(i));
+            const int representative = int(matchedRowList.at(groupOfIndex.at(i)));
+            if (representative == row) ++groupCount;
+            else rowVisible[row] = false;
+            groupPathsByRow[representative].append(userGalleryTagBitmaps.rowPaths.at(row));
+        }
+    }
+
+    // TagFlow 显示在当前筛选结果中仍会出现的 Tag 及其剩余计数；计数为 0 的 Tag 除非已选中否则隐藏
+    if (!userTagFlowBaseCounts.isEmpty()) {
+        QMap<QString, int> shownCounts;
+        if (selectedTagKeys.isEmpty() && promptQuery.isEmpty()) {
+            shownCounts = userTagFlowBaseCounts;
+        } else {
+            for (auto it = userTagFlowBaseCounts.constBegin(); it != userTagFlowBaseCounts.constEnd(); ++it) {
+                const int count = int(rowsWithTag(userTagFlowKeys.value(it.key())).intersectionCardinality(matchedRows));
+                if (count > 0 || selectedTags.contains(it.key())) shownCounts.insert(it.key(), count);
             }
         }
-
-        if (match) {
-            visibleCount++;
+        if (shownCounts != userTagFlowShownCounts) {
+            tagFlowWidget->setData(shownCounts);
+            userTagFlowShownCounts = shownCounts;
         }
-        filteredItems.append({item, match});
     }
 
     ui->listUserImages->setUpdatesEnabled(false);
     QListWidgetItem *restoredCurrentItem = nullptr;
-    for (const FilteredGalleryItem &entry : std::as_const(filteredItems)) {
-        if (!entry.item) continue;
-        const bool shouldHide = !entry.visible;
-        if (entry.item->isHidden() != shouldHide) {
-            entry.item->setHidden(shouldHide);
+    for (int row = 0; row < rowCount; ++row) {
+        QListWidgetItem *item = ui->listUserImages->item(row);
+        if (!item) continue;
+        const bool shouldHide = !rowVisible.at(row);
+        if (item->isHidden() != shouldHide) {
+            item->setHidden(shouldHide);
+        }
+        const QStringList groupPaths = shouldHide ? QStringList() : groupPathsByRow.value(row);
+        if (groupPaths.size() > 1) {
+            item->setData(ROLE_USER_IMAGE_GROUP_SIZE, int(groupPaths.size()));
+            item->setData(ROLE_USER_IMAGE_GROUP_PATHS, groupPaths);
+        } else if (item->data(ROLE_USER_IMAGE_GROUP_SIZE).isValid()) {
+            item->setData(ROLE_USER_IMAGE_GROUP_SIZE, QVariant());
+            item->setData(ROLE_USER_IMAGE_GROUP_PATHS, QVariant());
         }
         if (!currentImagePath.isEmpty()
-            && entry.item->data(ROLE_USER_IMAGE_PATH).toString() == currentImagePath) {
-            restoredCurrentItem = entry.item;
+            && item->data(ROLE_USER_IMAGE_PATH).toString() == currentImagePath) {
+            restoredCurrentItem = item;
         }
     }
     if (restoredCurrentItem && !restoredCurrentItem->isHidden()) {
@@ -8873,7 +8963,11 @@ void MainWindow::applyUserGalleryTagFilter(const QSet<QString> &selectedTags,
     // QListView::Adjust may schedule another geometry pass after the first event.
     QTimer::singleShot(50, this, resetFilteredGalleryViewport);
 
-    ui->statusbar->showMessage(QString("筛选: %1 张图片符合条件").arg(visibleCount));
+    if (groupMode != UserGalleryNoGrouping) {
+        ui->statusbar->showMessage(QString("筛选: %1 张图片符合条件，折叠为 %2 组").arg(visibleCount).arg(groupCount));
+    } else {
+        ui->statusbar->showMessage(QString("筛选: %1 张图片符合条件").arg(visibleCount));
+    }
 }
 
 void MainWindow::onGalleryButtonClicked()
@@ -9061,6 +9155,8 @@ void MainWindow::ensureToolTabLoaded(int index)
                     this, &MainWindow::refreshUsageAnalysisWidget);
             connect(usageAnalysisWidget, &UsageAnalysisWidget::requestOpenModel,
                     this, &MainWindow::jumpToDownloadSource);
+            connect(GalleryCorpus::instance(), &GalleryCorpus::indexesChanged,
+                    usageAnalysisWidget, [this]() { refreshUsageAnalysisWidget(); });
             refreshUsageAnalysisWidget();
             newPage = usageAnalysisWidget;
             break;
@@ -9146,6 +9242,9 @@ void MainWindow::initDownloadsPage()
     downloadsPage->initializeAppearance();
     downloadManager = new DownloadManager(downloadsPage, netManager, backgroundThreadPool, this);
     downloadManager->setPlaceholderIcon(placeholderIcon);
+    downloadManager->setTransferLimits(optDownloadConcurrency,
+                                       optDownloadSegments,
+                                       qint64(optDownloadBandwidthLimitKB) * 1024);
     downloadManager->setNetworkCallbacks(
         [this](const QUrl &url, bool allowCivitaiAuth) {
             return makeNetworkRequest(url, allowCivitaiAuth);
@@ -9172,6 +9271,12 @@ void MainWindow::initDownloadsPage()
             downloadsPage, &DownloadsPage::setStatusText);
     connect(downloadManager, &DownloadManager::modelFileReady,
             this, &MainWindow::finishModelDownload);
+    if (downloadManager->hasInterruptedDownloads()) {
+        // 上次退出时仍在下载/排队的模型：启动后按 .part 断点续传。
+        QTimer::singleShot(0, this, [this]() {
+            if (downloadManager) downloadManager->resumeInterruptedDownloads();
+        });
+    }
     connect(ui->modelList, &QListWidget::itemSelectionChanged,
             this, &MainWindow::updateDownloadModelActionButtons);
 
@@ -9327,6 +9432,7 @@ void MainWindow::initDownloadsPage()
                     downloadsPage->setStatusText("没有可从 CivArchive 补充的模型。");
                     return;
                 }
+                resetMetadataSyncPipeline();
                 downloadsPage->setStatusText(QString("正在从 CivArchive 补充元信息... 0/%1").arg(metadataSyncTotal));
                 processNextMetadataSyncJob();
             });
@@ -9440,7 +9546,7 @@ void MainWindow::checkUpdateForSnapshot(const UpdateCheckSnapshot &snapshot)
     addOrUpdateDownloadCard(pending, "检查中...");
 
     if (snapshot.modelId > 0) {
-        QNetworkReply *reply = netManager->get(makeNetworkRequest(QUrl(QString("https://civitai.com/api/v1/models/%1").arg(snapshot.modelId))));
+        QNetworkReply *reply = netManager->get(makeNetworkRequest(civitaiApiUrl(QString("/models/%1").arg(snapshot.modelId))));
         reply->setProperty("filePath", snapshot.filePath);
         reply->setProperty("baseName", snapshot.baseName);
         reply->setProperty("modelDir", snapshot.modelDir);
@@ -9998,26 +10104,211 @@ void MainWindow::startMetadataSyncForPaths(const QStringList &filePaths, bool up
         downloadsPage->setStatusText("没有可同步的模型。");
         return;
     }
+    resetMetadataSyncPipeline();
     downloadsPage->setStatusText(QString("正在同步元信息... 0/%1").arg(metadataSyncTotal));
+    startMetadataSyncBulkHashLookup();
     processNextMetadataSyncJob();
 }
 
+void MainWindow::resetMetadataSyncPipeline()
+{
+    metadataSyncInFlightPaths.clear();
+    metadataSyncMaxInFlight = kMetadataSyncMaxInFlight;
+    metadataSyncPendingBulkLookups = 0;
+    metadataSyncRequestQueue.clear();
+    ++metadataSyncRequestGeneration;
+    metadataSyncRequestTokens = kMetadataSyncRequestBurst;
+    metadataSyncTokenClock.start();
+    metadataSyncBackoffUntil = 0;
+    metadataSyncBackoffLevel = 0;
+    metadataSyncVersionsByHash.clear();
+    metadataSyncUnknownHashes.clear();
+    metadataSyncModelRoots.clear();
+}
+
+void MainWindow::startMetadataSyncBulkHashLookup()
+{
+    // 已有缓存 Hash、尚未关联模型 ID 的条目先批量查询，命中后直接请求模型详情，省掉逐个 by-hash 请求。
+    if (optRecalculateKnownMetadataHash) return;
+    QStringList hashes;
+    QSet<QString> seen;
+    for (const MetadataSyncJob &job : std::as_const(pendingMetadataSyncJobs)) {
+        if (job.civArchiveOnly || job.snapshot.modelId > 0) continue;
+        const QString hash = job.snapshot.currentSha256.trimmed().toUpper();
+        if (hash.isEmpty() || seen.contains(hash)) continue;
+        seen.insert(hash);
+        hashes.append(hash);
+    }
+    if (hashes.isEmpty()) return;
+
+    for (int i = 0; i < hashes.size(); i += kMetadataSyncBulkHashBatchSize) {
+        ++metadataSyncPendingBulkLookups;
+        requestMetadataSyncBulkHashBatch(hashes.mid(i, kMetadataSyncBulkHashBatchSize));
+    }
+    downloadsPage->setStatusText(QString("正在批量匹配 %1 个 Hash...").arg(hashes.size()));
+}
+
+void MainWindow::requestMetadataSyncBulkHashBatch(const QStringList &hashes)
+{
+    scheduleMetadataSyncRequest([this, hashes]() {
+        QNetworkRequest request = makeNetworkRequest(civitaiApiUrl("/model-versions/by-hash"));
+        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+        QNetworkReply *reply = netManager->post(request, QJsonDocument(QJsonArray::fromStringList(hashes)).toJson(QJsonDocument::Compact));
+        connect(reply, &QNetworkReply::finished, this, [this, reply, hashes]() {
+            reply->deleteLater();
+            if (!metadataSyncRunning) return;
+            const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            if (status == 429) {
+                noteMetadataSyncRateLimited(reply);
+                requestMetadataSyncBulkHashBatch(hashes);
+                return;
+            }
+
+            const QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
+            if (reply->error() == QNetworkReply::NoError && doc.isArray()) {
+                const QSet<QString> requested(hashes.cbegin(), hashes.cend());
+                QSet<QString> matched;
+                for (const QJsonValue &value : doc.array()) {
+                    const QJsonObject version = value.toObject();
+                    for (const QJsonValue &fileVal : version.value("files").toArray()) {
+                        const QString sha = fileVal.toObject().value("hashes").toObject().value("SHA256").toString().toUpper();
+                        if (!requested.contains(sha)) continue;
+                        metadataSyncVersionsByHash.insert(sha, version);
+                        matched.insert(sha);
+                    }
+                }
+                for (const QString &hash : hashes) {
+                    if (!matched.contains(hash)) metadataSyncUnknownHashes.insert(hash);
+                }
+            } else {
+                // 批量接口不可用时不算失败，这批条目回退到逐个 by-hash 查询。
+                qWarning() << "Bulk hash lookup failed, falling back to per-model lookups:" << civitaiNetworkErrorMessage(reply);
+            }
+
+            if (--metadataSyncPendingBulkLookups <= 0) {
+                metadataSyncPendingBulkLookups = 0;
+                processNextMetadataSyncJob();
+            }
+        });
+    });
+}
+
 void MainWindow::processNextMetadataSyncJob()
 {
     if (!metadataSyncRunning) return;
-    if (pendingMetadataSyncJobs.isEmpty()) {
-        metadataSyncRunning = false;
-        if (metadataSyncPreviewImages && metadataPreviewTasksPending > 0) {
-            metadataSyncWaitingForPreviews = true;
-            downloadsPage->setStatusText(QString("正在同步预览图元信息... 剩余 %1 个任务").arg(metadataPreviewTasksPending));
-            return;
-        }
-        finishMetadataSyncBatch();
+    // 批量 Hash 结果回来之前先不派发，避免同一个 Hash 又被单独查询一次。
+    if (metadataSyncPendingBulkLookups > 0) return;
+    while (metadataSyncInFlightPaths.size() < metadataSyncMaxInFlight && !pendingMetadataSyncJobs.isEmpty()) {
+        const MetadataSyncJob job = pendingMetadataSyncJobs.dequeue();
+        metadataSyncInFlightPaths.insert(job.snapshot.filePath);
+        downloadsPage->updateMetadataScanItemStatus(job.snapshot.filePath, "同步中...", QString());
+        fetchMetadataForSyncJob(job);
+        // 条目可能同步完成并递归结束整批任务。
+        if (!metadataSyncRunning) return;
+    }
+    if (!pendingMetadataSyncJobs.isEmpty() || !metadataSyncInFlightPaths.isEmpty()) return;
+
+    metadataSyncRunning = false;
+    metadataSyncRequestQueue.clear();
+    ++metadataSyncRequestGeneration;
+    if (metadataSyncPreviewImages && metadataPreviewTasksPending > 0) {
+        metadataSyncWaitingForPreviews = true;
+        downloadsPage->setStatusText(QString("正在同步预览图元信息... 剩余 %1 个任务").arg(metadataPreviewTasksPending));
         return;
     }
-    const MetadataSyncJob job = pendingMetadataSyncJobs.dequeue();
-    downloadsPage->updateMetadataScanItemStatus(job.snapshot.filePath, "同步中...", QString());
-    fetchMetadataForSyncJob(job);
+    finishMetadataSyncBatch();
+}
+
+void MainWindow::finishMetadataSyncJob(const MetadataSyncJob &job, bool succeeded)
+{
+    metadataSyncInFlightPaths.remove(job.snapshot.filePath);
+    if (succeeded) {
+        // 加性恢复：429 后减半的并发随成功请求逐步放回上限。
+        metadataSyncBackoffLevel = 0;
+        metadataSyncMaxInFlight = qMin(kMetadataSyncMaxInFlight, metadataSyncMaxInFlight + 1);
+    }
+    ++metadataSyncDone;
+    // 命中本批次模型详情缓存的条目会在派发循环内同步结束；下一个条目放到事件循环里派发，
+    // 连续命中缓存时调用栈不会随条目数增长。
+    if (metadataSyncDispatchScheduled) return;
+    metadataSyncDispatchScheduled = true;
+    QTimer::singleShot(0, this, [this]() {
+        metadataSyncDispatchScheduled = false;
+        processNextMetadataSyncJob();
+    });
+}
+
+void MainWindow::scheduleMetadataSyncRequest(std::function<void()> send)
+{
+    metadataSyncRequestQueue.enqueue({metadataSyncRequestGeneration, std::move(send)});
+    pumpMetadataSyncRequests();
+}
+
+void MainWindow::pumpMetadataSyncRequests()
+{
+    if (!metadataSyncTokenClock.isValid()) {
+        metadataSyncRequestTokens = kMetadataSyncRequestBurst;
+        metadataSyncTokenClock.start();
+    }
+    // 令牌桶：按经过时间补充令牌，每个 Civitai 请求消耗一个。
+    const double elapsedSeconds = double(metadataSyncTokenClock.restart()) / 1000.0;
+    metadataSyncRequestTokens = qMin(kMetadataSyncRequestBurst,
+                                     metadataSyncRequestTokens + elapsedSeconds * kMetadataSyncRequestsPerSecond);
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    int waitMs = 0;
+    if (now < metadataSyncBackoffUntil) {
+        waitMs = int(metadataSyncBackoffUntil - now);
+    } else {
+        while (metadataSyncRequestTokens >= 1.0 && !metadataSyncRequestQueue.isEmpty()) {
+            const MetadataSyncRequest request = metadataSyncRequestQueue.dequeue();
+            // 排队期间批次已结束或被新批次取代，不再发出
+            if (request.generation != metadataSyncRequestGeneration) continue;
+            metadataSyncRequestTokens -= 1.0;
+            request.send();
+        }
+        if (!metadataSyncRequestQueue.isEmpty()) {
+            waitMs = qMax(1, int((1.0 - metadataSyncRequestTokens) * 1000.0 / kMetadataSyncRequestsPerSecond));
+        }
+    }
+    if (metadataSyncRequestQueue.isEmpty() || metadataSyncPumpScheduled) return;
+    metadataSyncPumpScheduled = true;
+    QTimer::singleShot(waitMs, this, [this]() {
+        metadataSyncPumpScheduled = false;
+        pumpMetadataSyncRequests();
+    });
+}
+
+void MainWindow::noteMetadataSyncRateLimited(QNetworkReply *reply)
+{
+    // 429：优先遵循 Retry-After，否则指数退避；同时把并发减半，成功后再逐步恢复。
+    int seconds = retryAfterSeconds(reply);
+    if (seconds < 0) seconds = 1 << qMin(metadataSyncBackoffLevel + 1, 6);
+    seconds = qMin(seconds, kMetadataSyncMaxBackoffSeconds);
+    ++metadataSyncBackoffLevel;
+    metadataSyncMaxInFlight = qMax(1, metadataSyncMaxInFlight / 2);
+    metadataSyncRequestTokens = 0.0;
+    metadataSyncBackoffUntil = qMax(metadataSyncBackoffUntil,
+                                    QDateTime::currentMSecsSinceEpoch() + qint64(seconds) * 1000);
+    if (downloadsPage) downloadsPage->setStatusText(QString("Civitai 请求过于频繁，%1 秒后继续同步...").arg(seconds));
+}
+
+bool MainWindow::deferMetadataSyncJobOnRateLimit(QNetworkReply *reply, const MetadataSyncJob &job)
+{
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 429) return false;
+    if (!metadataSyncRunning || !metadataSyncInFlightPaths.contains(job.snapshot.filePath)) return false;
+    noteMetadataSyncRateLimited(reply);
+
+    // 用列表里的最新快照重排到队首（计算过的 Hash 已缓存在列表项上），退避结束后从头处理。
+    MetadataSyncJob retryJob = job;
+    if (QListWidgetItem *item = findModelItemByFilePath(job.snapshot.filePath)) {
+        retryJob.snapshot = snapshotForModelItem(item);
+    }
+    metadataSyncInFlightPaths.remove(job.snapshot.filePath);
+    pendingMetadataSyncJobs.prepend(retryJob);
+    downloadsPage->updateMetadataScanItemStatus(job.snapshot.filePath, "等待限流结束后重试...", QString());
+    processNextMetadataSyncJob();
+    return true;
 }
 
 void MainWindow::fetchMetadataForSyncJob(const MetadataSyncJob &job)
@@ -10030,49 +10321,58 @@ void MainWindow::fetchMetadataForSyncJob(const MetadataSyncJob &job)
     if (job.snapshot.modelId > 0) {
         if (job.snapshot.currentVersionId > 0) {
             downloadsPage->updateMetadataScanItemStatus(job.snapshot.filePath, "正在获取完整版本元信息...", QString());
-            QNetworkReply *reply = netManager->get(makeNetworkRequest(QUrl(QString("https://civitai.com/api/v1/model-versions/%1").arg(job.snapshot.currentVersionId))));
-            reply->setProperty("filePath", job.snapshot.filePath);
-            reply->setProperty("baseName", job.snapshot.baseName);
-            reply->setProperty("modelDir", job.snapshot.modelDir);
-            reply->setProperty("displayName", job.snapshot.displayName);
-            reply->setProperty("modelId", job.snapshot.modelId);
-            reply->setProperty("currentVersionId", job.snapshot.currentVersionId);
-            reply->setProperty("currentSha256", job.snapshot.currentSha256);
-            reply->setProperty("updateExisting", job.updateExisting);
-            reply->setProperty("civArchiveOnly", job.civArchiveOnly);
-            reply->setProperty("detailFallback", job.detailFallback);
-            connect(reply, &QNetworkReply::finished, this, [this, reply]() { handleMetadataSyncVersionReply(reply); });
+            scheduleMetadataSyncRequest([this, job]() {
+                QNetworkReply *reply = netManager->get(makeNetworkRequest(civitaiApiUrl(QString("/model-versions/%1").arg(job.snapshot.currentVersionId))));
+                reply->setProperty("filePath", job.snapshot.filePath);
+                reply->setProperty("baseName", job.snapshot.baseName);
+                reply->setProperty("modelDir", job.snapshot.modelDir);
+                reply->setProperty("displayName", job.snapshot.displayName);
+                reply->setProperty("modelId", job.snapshot.modelId);
+                reply->setProperty("currentVersionId", job.snapshot.currentVersionId);
+                reply->setProperty("currentSha256", job.snapshot.currentSha256);
+                reply->setProperty("updateExisting", job.updateExisting);
+                reply->setProperty("civArchiveOnly", job.civArchiveOnly);
+                reply->setProperty("detailFallback", job.detailFallback);
+                connect(reply, &QNetworkReply::finished, this, [this, reply]() { handleMetadataSyncVersionReply(reply); });
+            });
             return;
         }
 
-        QNetworkReply *reply = netManager->get(makeNetworkRequest(QUrl(QString("https://civitai.com/api/v1/models/%1").arg(job.snapshot.modelId))));
-        reply->setProperty("filePath", job.snapshot.filePath);
-        reply->setProperty("baseName", job.snapshot.baseName);
-        reply->setProperty("modelDir", job.snapshot.modelDir);
-        reply->setProperty("displayName", job.snapshot.displayName);
-        reply->setProperty("modelId", job.snapshot.modelId);
-        reply->setProperty("currentVersionId", job.snapshot.currentVersionId);
-        reply->setProperty("currentSha256", job.snapshot.currentSha256);
-        reply->setProperty("updateExisting", job.updateExisting);
-        reply->setProperty("civArchiveOnly", job.civArchiveOnly);
-        reply->setProperty("detailFallback", job.detailFallback);
-        connect(reply, &QNetworkReply::finished, this, [this, reply]() { handleMetadataSyncModelReply(reply); });
+        requestMetadataSyncModelDetail(job, job.snapshot.modelId, QJsonObject());
         return;
     }
 
     const QString cachedHash = job.snapshot.currentSha256.trimmed();
     if (!optRecalculateKnownMetadataHash && !cachedHash.isEmpty()) {
+        // 批量查询已给出结论的 Hash 不再单独请求。
+        const QString hashKey = cachedHash.toUpper();
+        if (metadataSyncVersionsByHash.contains(hashKey)) {
+            const QJsonObject versionRoot = metadataSyncVersionsByHash.value(hashKey);
+            MetadataSyncJob matchedJob = job;
+            matchedJob.snapshot.currentVersionId = versionRoot.value("id").toInt();
+            const int modelId = versionRoot.value("modelId").toInt();
+            if (modelId > 0) {
+                requestMetadataSyncModelDetail(matchedJob, modelId, versionRoot);
+                return;
+            }
+        } else if (metadataSyncUnknownHashes.contains(hashKey)) {
+            fetchMetadataFromCivArchive(job, "无法从 Hash 匹配 Civitai 模型");
+            return;
+        }
+
         downloadsPage->updateMetadataScanItemStatus(job.snapshot.filePath, "使用缓存 Hash 同步中...", QString());
-        QNetworkReply *reply = netManager->get(makeNetworkRequest(QUrl(QString("https://civitai.com/api/v1/model-versions/by-hash/%1").arg(cachedHash))));
-        reply->setProperty("filePath", job.snapshot.filePath);
-        reply->setProperty("baseName", job.snapshot.baseName);
-        reply->setProperty("modelDir", job.snapshot.modelDir);
-        reply->setProperty("displayName", job.snapshot.displayName);
-        reply->setProperty("currentSha256", cachedHash);
-        reply->setProperty("updateExisting", job.updateExisting);
-        reply->setProperty("civArchiveOnly", job.civArchiveOnly);
-        reply->setProperty("detailFallback", job.detailFallback);
-        connect(reply, &QNetworkReply::finished, this, [this, reply]() { handleMetadataSyncHashReply(reply); });
+        scheduleMetadataSyncRequest([this, job, cachedHash]() {
+            QNetworkReply *reply = netManager->get(makeNetworkRequest(civitaiApiUrl(QString("/model-versions/by-hash/%1").arg(cachedHash))));
+            reply->setProperty("filePath", job.snapshot.filePath);
+            reply->setProperty("baseName", job.snapshot.baseName);
+            reply->setProperty("modelDir", job.snapshot.modelDir);
+            reply->setProperty("displayName", job.snapshot.displayName);
+            reply->setProperty("currentSha256", cachedHash);
+            reply->setProperty("updateExisting", job.updateExisting);
+            reply->setProperty("civArchiveOnly", job.civArchiveOnly);
+            reply->setProperty("detailFallback", job.detailFallback);
+            connect(reply, &QNetworkReply::finished, this, [this, reply]() { handleMetadataSyncHashReply(reply); });
+        });
         return;
     }
 
@@ -10106,22 +10406,51 @@ void MainWindow::fetchMetadataForSyncJob(const MetadataSyncJob &job)
         // “同步元数据时重新计算已有 Hash”）。
         if (QListWidgetItem *item = findModelItemByFilePath(job.snapshot.filePath))
             item->setData(ROLE_CIVITAI_SHA256, hash);
-        QNetworkReply *reply = netManager->get(makeNetworkRequest(QUrl(QString("https://civitai.com/api/v1/model-versions/by-hash/%1").arg(hash))));
-        reply->setProperty("filePath", job.snapshot.filePath);
-        reply->setProperty("baseName", job.snapshot.baseName);
-        reply->setProperty("modelDir", job.snapshot.modelDir);
-        reply->setProperty("displayName", job.snapshot.displayName);
-        reply->setProperty("currentSha256", hash);
-        reply->setProperty("updateExisting", job.updateExisting);
-        reply->setProperty("civArchiveOnly", job.civArchiveOnly);
-        reply->setProperty("detailFallback", job.detailFallback);
-        connect(reply, &QNetworkReply::finished, this, [this, reply]() { handleMetadataSyncHashReply(reply); });
+        scheduleMetadataSyncRequest([this, job, hash]() {
+            QNetworkReply *reply = netManager->get(makeNetworkRequest(civitaiApiUrl(QString("/model-versions/by-hash/%1").arg(hash))));
+            reply->setProperty("filePath", job.snapshot.filePath);
+            reply->setProperty("baseName", job.snapshot.baseName);
+            reply->setProperty("modelDir", job.snapshot.modelDir);
+            reply->setProperty("displayName", job.snapshot.displayName);
+            reply->setProperty("currentSha256", hash);
+            reply->setProperty("updateExisting", job.updateExisting);
+            reply->setProperty("civArchiveOnly", job.civArchiveOnly);
+            reply->setProperty("detailFallback", job.detailFallback);
+            connect(reply, &QNetworkReply::finished, this, [this, reply]() { handleMetadataSyncHashReply(reply); });
+        });
     });
     watcher->setFuture(QtConcurrent::run(backgroundThreadPool, [filePath = job.snapshot.filePath]() {
         return FileUtils::calculateSha256Hex(filePath);
     }));
 }
 
+void MainWindow::requestMetadataSyncModelDetail(const MetadataSyncJob &job, int modelId, const QJsonObject &versionHint)
+{
+    // 同一模型的多个版本文件只请求一次详情。
+    if (metadataSyncModelRoots.contains(modelId)) {
+        finishMetadataSyncModelRoot(job, metadataSyncModelRoots.value(modelId), versionHint);
+        return;
+    }
+
+    scheduleMetadataSyncRequest([this, job, modelId, versionHint]() {
+        QNetworkReply *detailReply = netManager->get(makeNetworkRequest(civitaiApiUrl(QString("/models/%1").arg(modelId))));
+        detailReply->setProperty("filePath", job.snapshot.filePath);
+        detailReply->setProperty("baseName", job.snapshot.baseName);
+        detailReply->setProperty("modelDir", job.snapshot.modelDir);
+        detailReply->setProperty("displayName", job.snapshot.displayName);
+        detailReply->setProperty("modelId", modelId);
+        detailReply->setProperty("currentVersionId", job.snapshot.currentVersionId);
+        detailReply->setProperty("currentSha256", job.snapshot.currentSha256);
+        detailReply->setProperty("updateExisting", job.updateExisting);
+        detailReply->setProperty("civArchiveOnly", job.civArchiveOnly);
+        detailReply->setProperty("detailFallback", job.detailFallback);
+        if (!versionHint.isEmpty()) {
+            detailReply->setProperty("versionHint", QJsonDocument(versionHint).toJson(QJsonDocument::Compact));
+        }
+        connect(detailReply, &QNetworkReply::finished, this, [this, detailReply]() { handleMetadataSyncModelReply(detailReply); });
+    });
+}
+
 void MainWindow::handleMetadataSyncVersionReply(QNetworkReply *reply)
 {
     MetadataSyncJob job;
@@ -10137,6 +10466,7 @@ void MainWindow::handleMetadataSyncVersionReply(QNetworkReply *reply)
     job.detailFallback = reply->property("detailFallback").toBool();
     reply->deleteLater();
 
+    if (deferMetadataSyncJobOnRateLimit(reply, job)) return;
     if (reply->error() != QNetworkReply::NoError) {
         fetchMetadataFromCivArchive(job, "版本元信息获取失败: " + civitaiNetworkErrorMessage(reply));
         return;
@@ -10150,18 +10480,7 @@ void MainWindow::handleMetadataSyncVersionReply(QNetworkReply *reply)
         return;
     }
 
-    QNetworkReply *detailReply = netManager->get(makeNetworkRequest(QUrl(QString("https://civitai.com/api/v1/models/%1").arg(modelId))));
-    detailReply->setProperty("filePath", job.snapshot.filePath);
-    detailReply->setProperty("baseName", job.snapshot.baseName);
-    detailReply->setProperty("modelDir", job.snapshot.modelDir);
-    detailReply->setProperty("displayName", job.snapshot.displayName);
-    detailReply->setProperty("currentVersionId", job.snapshot.currentVersionId);
-    detailReply->setProperty("currentSha256", job.snapshot.currentSha256);
-    detailReply->setProperty("updateExisting", job.updateExisting);
-    detailReply->setProperty("civArchiveOnly", job.civArchiveOnly);
-    detailReply->setProperty("detailFallback", job.detailFallback);
-    detailReply->setProperty("versionHint", QJsonDocument(versionRoot).toJson(QJsonDocument::Compact));
-    connect(detailReply, &QNetworkReply::finished, this, [this, detailReply]() { handleMetadataSyncModelReply(detailReply); });
+    requestMetadataSyncModelDetail(job, modelId, versionRoot);
 }
 
 void MainWindow::handleMetadataSyncHashReply(QNetworkReply *reply)
@@ -10177,6 +10496,7 @@ void MainWindow::handleMetadataSyncHashReply(QNetworkReply *reply)
     job.detailFallback = reply->property("detailFallback").toBool();
     reply->deleteLater();
 
+    if (deferMetadataSyncJobOnRateLimit(reply, job)) return;
     if (reply->error() != QNetworkReply::NoError) {
         fetchMetadataFromCivArchive(job, "Hash 匹配失败: " + civitaiNetworkErrorMessage(reply));
         return;
@@ -10190,18 +10510,7 @@ void MainWindow::handleMetadataSyncHashReply(QNetworkReply *reply)
         return;
     }
 
-    QNetworkReply *detailReply = netManager->get(makeNetworkRequest(QUrl(QString("https://civitai.com/api/v1/models/%1").arg(modelId))));
-    detailReply->setProperty("filePath", job.snapshot.filePath);
-    detailReply->setProperty("baseName", job.snapshot.baseName);
-    detailReply->setProperty("modelDir", job.snapshot.modelDir);
-    detailReply->setProperty("displayName", job.snapshot.displayName);
-    detailReply->setProperty("currentVersionId", job.snapshot.currentVersionId);
-    detailReply->setProperty("currentSha256", job.snapshot.currentSha256);
-    detailReply->setProperty("updateExisting", job.updateExisting);
-    detailReply->setProperty("civArchiveOnly", job.civArchiveOnly);
-    detailReply->setProperty("detailFallback", job.detailFallback);
-    detailReply->setProperty("versionHint", QJsonDocument(versionRoot).toJson(QJsonDocument::Compact));
-    connect(detailReply, &QNetworkReply::finished, this, [this, detailReply]() { handleMetadataSyncModelReply(detailReply); });
+    requestMetadataSyncModelDetail(job, modelId, versionRoot);
 }
 
 void MainWindow::handleMetadataSyncModelReply(QNetworkReply *reply)
@@ -10211,6 +10520,7 @@ void MainWindow::handleMetadataSyncModelReply(QNetworkReply *reply)
     job.snapshot.baseName = reply->property("baseName").toString();
     job.snapshot.modelDir = reply->property("modelDir").toString();
     job.snapshot.displayName = reply->property("displayName").toString();
+    job.snapshot.modelId = reply->property("modelId").toInt();
     job.snapshot.currentVersionId = reply->property("currentVersionId").toInt();
     job.snapshot.currentSha256 = reply->property("currentSha256").toString();
     job.updateExisting = reply->property("updateExisting").toBool();
@@ -10219,12 +10529,20 @@ void MainWindow::handleMetadataSyncModelReply(QNetworkReply *reply)
     const QJsonObject versionHint = QJsonDocument::fromJson(reply->property("versionHint").toByteArray()).object();
     reply->deleteLater();
 
+    if (deferMetadataSyncJobOnRateLimit(reply, job)) return;
     if (reply->error() != QNetworkReply::NoError) {
         fetchMetadataFromCivArchive(job, "同步失败: " + civitaiNetworkErrorMessage(reply));
         return;
     }
 
     const QJsonObject modelRoot = QJsonDocument::fromJson(reply->readAll()).object();
+    const int modelId = modelRoot.value("id").toInt(job.snapshot.modelId);
+    if (metadataSyncRunning && modelId > 0 && !modelRoot.isEmpty()) metadataSyncModelRoots.insert(modelId, modelRoot);
+    finishMetadataSyncModelRoot(job, modelRoot, versionHint);
+}
+
+void MainWindow::finishMetadataSyncModelRoot(const MetadataSyncJob &job, const QJsonObject &modelRoot, const QJsonObject &versionHint)
+{
     const bool ok = saveMetadataFromModelRoot(job, modelRoot, versionHint);
     if (!ok && !job.civArchiveOnly) {
         fetchMetadataFromCivArchive(job, "Civitai 返回成功但无法匹配当前版本");
@@ -10240,9 +10558,8 @@ void MainWindow::handleMetadataSyncModelReply(QNetworkReply *reply)
                                                 "existing",
                                                 nowText,
                                                 "同步时间");
-    ++metadataSyncDone;
-    downloadsPage->setStatusText(QString("正在同步元信息... %1/%2").arg(metadataSyncDone).arg(metadataSyncTotal));
-    processNextMetadataSyncJob();
+    downloadsPage->setStatusText(QString("正在同步元信息... %1/%2").arg(metadataSyncDone + 1).arg(metadataSyncTotal));
+    finishMetadataSyncJob(job, true);
 }
 
 bool MainWindow::tryStartCivArchiveHashCalculation(const MetadataSyncJob &job, const QString &reason)
@@ -10306,21 +10623,24 @@ void MainWindow::fetchMetadataFromCivArchive(const MetadataSyncJob &job, const Q
     }
 
     downloadsPage->updateMetadataScanItemStatus(job.snapshot.filePath, "正在查询 CivArchive...", QString());
-    QNetworkReply *reply = netManager->get(makeNetworkRequest(url, false));
-    reply->setProperty("filePath", lookupJob.snapshot.filePath);
-    reply->setProperty("baseName", lookupJob.snapshot.baseName);
-    reply->setProperty("modelDir", lookupJob.snapshot.modelDir);
-    reply->setProperty("displayName", lookupJob.snapshot.displayName);
-    reply->setProperty("modelId", lookupJob.snapshot.modelId);
-    reply->setProperty("currentVersionId", lookupJob.snapshot.currentVersionId);
-    reply->setProperty("currentSha256", lookupJob.snapshot.currentSha256);
-    reply->setProperty("updateExisting", lookupJob.updateExisting);
-    reply->setProperty("civArchiveOnly", lookupJob.civArchiveOnly);
-    reply->setProperty("detailFallback", lookupJob.detailFallback);
-    reply->setProperty("civArchiveReason", reason);
-    reply->setProperty("civArchiveUrl", url.toString());
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        handleMetadataSyncCivArchiveReply(reply);
+    // 与 Civitai 请求共用令牌桶，批量补充时不对归档站点突发请求。
+    scheduleMetadataSyncRequest([this, lookupJob, reason, url]() {
+        QNetworkReply *reply = netManager->get(makeNetworkRequest(url, false));
+        reply->setProperty("filePath", lookupJob.snapshot.filePath);
+        reply->setProperty("baseName", lookupJob.snapshot.baseName);
+        reply->setProperty("modelDir", lookupJob.snapshot.modelDir);
+        reply->setProperty("displayName", lookupJob.snapshot.displayName);
+        reply->setProperty("modelId", lookupJob.snapshot.modelId);
+        reply->setProperty("currentVersionId", lookupJob.snapshot.currentVersionId);
+        reply->setProperty("currentSha256", lookupJob.snapshot.currentSha256);
+        reply->setProperty("updateExisting", lookupJob.updateExisting);
+        reply->setProperty("civArchiveOnly", lookupJob.civArchiveOnly);
+        reply->setProperty("detailFallback", lookupJob.detailFallback);
+        reply->setProperty("civArchiveReason", reason);
+        reply->setProperty("civArchiveUrl", url.toString());
+        connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+            handleMetadataSyncCivArchiveReply(reply);
+        });
     });
 }
 
@@ -10392,9 +10712,8 @@ void MainWindow::handleMetadataSyncCivArchiveReply(QNetworkReply *reply)
                                                 "existing",
                                                 nowText,
                                                 "CivArchive");
-    ++metadataSyncDone;
-    downloadsPage->setStatusText(QString("正在同步元信息... %1/%2").arg(metadataSyncDone).arg(metadataSyncTotal));
-    processNextMetadataSyncJob();
+    downloadsPage->setStatusText(QString("正在同步元信息... %1/%2").arg(metadataSyncDone + 1).arg(metadataSyncTotal));
+    finishMetadataSyncJob(job, true);
 }
 
 void MainWindow::finishMetadataSyncJobWithFailure(const MetadataSyncJob &job, const QString &message, const QString &category)
@@ -10412,8 +10731,7 @@ void MainWindow::finishMetadataSyncJobWithFailure(const MetadataSyncJob &job, co
         m_forceResyncPreview = false;
         m_skipPreviewSync = false;
     }
-    ++metadataSyncDone;
-    processNextMetadataSyncJob();
+    finishMetadataSyncJob(job, false);
 }
 
 bool MainWindow::saveMetadataFromModelRoot(const MetadataSyncJob &job, const QJsonObject &modelRoot, const QJsonObject &versionHint)
@@ -10613,6 +10931,9 @@ void MainWindow::loadGlobalConfig() {
         optConfirmCloseWhileLauncherRunning = settings.confirmCloseWhileLauncherRunning;
         optModelUpdateDownloadPolicy = settings.modelUpdateDownloadPolicy;
         optAutoCheckUpdatesOnStartup = settings.autoCheckUpdatesOnStartup;
+        optDownloadConcurrency = settings.downloadConcurrency;
+        optDownloadSegments = settings.downloadSegments;
+        optDownloadBandwidthLimitKB = settings.downloadBandwidthLimitKB;
         optThemeId = settings.themeId;
         optCustomThemePath = settings.customThemePath;
 
@@ -10869,6 +11190,9 @@ void MainWindow::applySettingsState(SettingsState state)
     optCivitaiApiKey = state.civitaiApiKey;
     optModelUpdateDownloadPolicy = state.modelUpdateDownloadPolicy;
     optAutoCheckUpdatesOnStartup = state.autoCheckUpdatesOnStartup;
+    optDownloadConcurrency = state.downloadConcurrency;
+    optDownloadSegments = state.downloadSegments;
+    optDownloadBandwidthLimitKB = state.downloadBandwidthLimitKB;
     optUseCivitaiName = state.useCivitaiName;
     optSuppressLocalWarnings = state.suppressLocalWarnings;
     optUserGalleryMatchMode = state.userGalleryMatchMode;
@@ -10880,6 +11204,11 @@ void MainWindow::applySettingsState(SettingsState state)
     optThemeId = state.themeId;
     optCustomThemePath = state.customThemePath;
 
+    if (downloadManager) {
+        downloadManager->setTransferLimits(optDownloadConcurrency,
+                                           optDownloadSegments,
+                                           qint64(optDownloadBandwidthLimitKB) * 1024);
+    }
     if (renderThreadsChanged) {
         threadPool->setMaxThreadCount(optRenderThreadCount);
         backgroundThreadPool->setMaxThreadCount(optRenderThreadCount);
@@ -11104,6 +11433,9 @@ void MainWindow::saveGlobalConfig() {
         settings.civitaiApiKey = optCivitaiApiKey;
         settings.modelUpdateDownloadPolicy = optModelUpdateDownloadPolicy;
         settings.autoCheckUpdatesOnStartup = optAutoCheckUpdatesOnStartup;
+        settings.downloadConcurrency = optDownloadConcurrency;
+        settings.downloadSegments = optDownloadSegments;
+        settings.downloadBandwidthLimitKB = optDownloadBandwidthLimitKB;
         settings.useCivitaiName = optUseCivitaiName;
         settings.suppressLocalWarnings = optSuppressLocalWarnings;
         settings.userGalleryMatchMode = optUserGalleryMatchMode;
@@ -12535,6 +12867,16 @@ void MainWindow::loadUserGalleryCache() {
         info.parameters = obj["param"].toString();
         info.lastModified = obj["t"].toVariant().toLongLong();
         info.parserVersion = obj.value("pv").toInt(0);
+        // 旧缓存没有结构化参数（或提取规则已升级）时从参数文本补提一次，下次保存后不再需要
+        if (!ImageParameters::fromJson(obj.value("pr").toObject(), &info.params)) {
+            info.params = ImageParameters::parse(info.parameters, info.prompt);
+        }
+        if (obj.contains("sz")) {
+            info.fileSize = obj["sz"].toVariant().toLongLong();
+            bool hashOk = false;
+            info.perceptualHash = obj["ph"].toString().toULongLong(&hashOk, 16);
+            info.perceptualHashValid = hashOk;
+        }
 
         // 恢复 Tags (为了节省空间，JSON里可以不存tags，读取时解析，或者也存进去)
         // 这里建议直接解析，因为 parsePromptsToTags 是纯内存操作，很快
@@ -12560,6 +12902,11 @@ void MainWindow::saveUserGalleryCache() {
         obj["param"] = info.parameters;
         obj["t"] = QString::number(info.lastModified); // 存为字符串避免精度问题
         obj["pv"] = info.parserVersion;
+        obj["pr"] = info.params.toJson();
+        if (info.fileSize >= 0) {
+            obj["sz"] = QString::number(info.fileSize);
+            if (info.perceptualHashValid) obj["ph"] = QString::number(info.perceptualHash, 16);
+        }
 
         root.insert(info.path, obj);
     }
@@ -12573,6 +12920,123 @@ void MainWindow::saveUserGalleryCache() {
     }
 }
 
+void MainWindow::scheduleUserImagePerceptualHashing()
+{
+    if (isShuttingDown || (userImageHashWatcher && userImageHashWatcher->isRunning())) return;
+
+    // 从上次停下的位置继续找还没算过的图，避免每批都从头遍历整个缓存
+    constexpr int batchSize = 2048;
+    QList<UserImageHashJob> jobs;
+    auto collect = [this, &jobs](QMap<QString, UserImageInfo>::const_iterator it,
+                                 QMap<QString, UserImageInfo>::const_iterator end) {
+        for (; it != end && jobs.size() < batchSize; ++it) {
+            if (it.value().fileSize >= 0 || it.key().startsWith("__")) continue;
+            UserImageHashJob job;
+            job.path = it.key();
+            job.lastModified = it.value().lastModified;
+            jobs.append(job);
+        }
+    };
+    const auto resume = std::as_const(imageCache).lowerBound(userImageHashResumeKey);
+    collect(resume, imageCache.cend());
+    collect(imageCache.cbegin(), resume);
+
+    if (jobs.isEmpty()) {
+        if (userGalleryHashesDirty) {
+            saveUserGalleryCache();
+            userGalleryHashesDirty = false;
+        }
+        if (userGalleryHashesUnpublished) publishUserImagePerceptualHashes();
+        return;
+    }
+    userImageHashResumeKey = jobs.constLast().path;
+
+    if (!userImageHashWatcher) {
+        userImageHashWatcher = new QFutureWatcher<UserImageHashJob>(this);
+        connect(userImageHashWatcher, &QFutureWatcher<UserImageHashJob>::finished,
+                this, &MainWindow::mergeUserImagePerceptualHashes);
+        userImageHashPublishTimer.start();
+    }
+    userImageHashWatcher->setFuture(QtConcurrent::mapped(backgroundThreadPool, jobs, [](const UserImageHashJob &job) {
+        UserImageHashJob result = job;
+        result.fileSize = QFileInfo(job.path).size();
+        result.valid = PerceptualHash::computeDHash(job.path, &result.hash);
+        return result;
+    }));
+}
+
+void MainWindow::mergeUserImagePerceptualHashes()
+{
+    if (isShuttingDown || !userImageHashWatcher) return;
+    const QList<UserImageHashJob> results = userImageHashWatcher->future().results();
+    for (const UserImageHashJob &result : results) {
+        auto it = imageCache.find(result.path);
+        // 期间重新扫描过、文件已变化的图片丢弃结果，下一批会按新的 lastModified 重算
+        if (it == imageCache.end() || it->lastModified != result.lastModified) continue;
+        it->fileSize = result.fileSize;
+        it->perceptualHash = result.hash;
+        it->perceptualHashValid = result.valid;
+        userGalleryHashesDirty = true;
+        userGalleryHashesUnpublished = true;
+    }
+
+    // 补算期间按时间间隔发布，让工具页能看到部分结果；缓存文件留到全部算完时由 schedule 保存
+    if (userGalleryHashesUnpublished && userImageHashPublishTimer.elapsed() > 60 * 1000) {
+        publishUserImagePerceptualHashes();
+    }
+    if (userImageHashWatcher->isCanceled()) return;
+    QTimer::singleShot(0, this, &MainWindow::scheduleUserImagePerceptualHashing);
+}
+
+void MainWindow::publishUserImagePerceptualHashes()
+{
+    // 只有哈希变化，不必走 publish 重新求索引差异
+    GalleryCorpus::instance()->publishPerceptualHashes(imageCache);
+    userGalleryHashesUnpublished = false;
+    userImageHashPublishTimer.restart();
+    scheduleUserImageSimilarGrouping();
+}
+
+void MainWindow::scheduleUserImageSimilarGrouping()
+{
+    if (isShuttingDown) return;
+    // 同一时刻只有一个聚类任务；期间的请求合并成完成后的一次
+    if (userImageSimilarGroupWatcher && userImageSimilarGroupWatcher->isRunning()) {
+        userImageSimilarGroupPending = true;
+        return;
+    }
+    if (!userImageSimilarGroupWatcher) {
+        userImageSimilarGroupWatcher = new QFutureWatcher<QHash<QString, quint64>>(this);
+        connect(userImageSimilarGroupWatcher, &QFutureWatcher<QHash<QString, quint64>>::finished, this, [this]() {
+            if (isShuttingDown) return;
+            userImageSimilarGroups = userImageSimilarGroupWatcher->result();
+            ++userImageSimilarGroupsVersion;
+            if (ui->comboUserGalleryGroupMode->currentIndex() == UserGalleryGroupBySimilarity) {
+                applyUserGalleryTagFilter(tagFlowWidget->getSelectedTags(), false);
+            }
+            if (std::exchange(userImageSimilarGroupPending, false)) scheduleUserImageSimilarGrouping();
+        });
+    }
+
+    const QMap<QString, UserImageInfo> images = imageCache;   // 隐式共享，后台只读
+    userImageSimilarGroupWatcher->setFuture(QtConcurrent::run(backgroundThreadPool, [images]() {
+        QStringList paths;
+        QVector<quint64> hashes;
+        for (auto it = images.cbegin(); it != images.cend(); ++it) {
+            if (!it->perceptualHashValid || it.key().startsWith("__")) continue;
+            paths.append(it.key());
+            hashes.append(it->perceptualHash);
+        }
+        QHash<QString, quint64> groups;
+        quint64 groupId = 0;
+        for (const QVector<int> &cluster : PerceptualHash::clusters(hashes, kUserGallerySimilarDistance)) {
+            ++groupId;
+            for (int member : cluster) groups.insert(paths.at(member), groupId);
+        }
+        return groups;
+    }));
+}
+
 void MainWindow::updateModelListNames()
 {
     // 暂时关闭排序，防止修改文本时列表乱跳
@@ -41,6 +41,8 @@
 #include "pages/settingspage.h"
 #include "pages/aboutpage.h"
 #include "widgets/tagflowwidget.h"
+#include "utils/gallerycorpus.h"
+#include "utils/roaringbitmap.h"
 
 // 模型列表相关
 const int ROLE_MODEL_NAME             = Qt::UserRole;
@@ -89,6 +91,10 @@ const int ROLE_CIVITAI_VERSION_ID     = Qt::UserRole + 52;
 const int ROLE_CIVITAI_SHA256         = Qt::UserRole + 53;
 const int ROLE_SYNC_FAILED            = Qt::UserRole + 54;
 const int ROLE_SYNC_ERROR             = Qt::UserRole + 55;
+// 用户图库分组折叠
+const int ROLE_USER_IMAGE_SEED_GROUP  = Qt::UserRole + 56;  // 同种子同提示词分组 key，0 表示不参与分组
+const int ROLE_USER_IMAGE_GROUP_SIZE  = Qt::UserRole + 57;  // 作为组代表时的组内数量
+const int ROLE_USER_IMAGE_GROUP_PATHS = Qt::UserRole + 58;  // 作为组代表时组内全部图片路径
 // 收藏夹树状图
 const int ROLE_IS_COLLECTION_NODE     = Qt::UserRole + 60;  // 标记这是一个收藏夹节点
 const int ROLE_COLLECTION_NAME        = Qt::UserRole + 61;  // 存储收藏夹名称
@@ -189,17 +195,6 @@ struct ImageInfo {
     bool nsfw = false;
 };
 
-struct UserImageInfo {
-    QString path;
-    QString prompt;
-    QStringList cleanTags;
-    QStringList negativeCleanTags;
-    QString negativePrompt;
-    QString parameters;
-    qint64 lastModified = 0;
-    int parserVersion = 0;
-};
-
 struct ModelMeta {
     QString fileName;
     QString modelName;
@@ -496,6 +491,16 @@ private:
     void handleMetadataSyncVersionReply(QNetworkReply *reply);
     void handleMetadataSyncHashReply(QNetworkReply *reply);
     void handleMetadataSyncCivArchiveReply(QNetworkReply *reply);
+    void resetMetadataSyncPipeline();
+    void startMetadataSyncBulkHashLookup();
+    void requestMetadataSyncBulkHashBatch(const QStringList &hashes);
+    void requestMetadataSyncModelDetail(const MetadataSyncJob &job, int modelId, const QJsonObject &versionHint);
+    void finishMetadataSyncModelRoot(const MetadataSyncJob &job, const QJsonObject &modelRoot, const QJsonObject &versionHint);
+    void finishMetadataSyncJob(const MetadataSyncJob &job, bool succeeded);
+    void scheduleMetadataSyncRequest(std::function<void()> send);
+    void pumpMetadataSyncRequests();
+    bool deferMetadataSyncJobOnRateLimit(QNetworkReply *reply, const MetadataSyncJob &job);
+    void noteMetadataSyncRateLimited(QNetworkReply *reply);
     bool saveMetadataFromModelRoot(const MetadataSyncJob &job, const QJsonObject &modelRoot, const QJsonObject &versionHint = QJsonObject());
     void fetchMetadataFromCivArchive(const MetadataSyncJob &job, const QString &reason, bool directOnly = false);
     bool startDetailCivArchiveFallback(const QString &filePath, const QString &baseName, const QString &modelDir, const QString &reason, const QString &currentSha256 = QString());
@@ -544,6 +549,25 @@ private:
     bool metadataSyncPreviewImages = false;
     bool metadataSyncWaitingForPreviews = false;
     int metadataPreviewTasksPending = 0;
+    // 元信息同步流水线：多个模型并行，Civitai 请求走令牌桶，429 时退避并把并发减半。
+    QSet<QString> metadataSyncInFlightPaths;
+    int metadataSyncMaxInFlight = 1;
+    int metadataSyncPendingBulkLookups = 0;
+    struct MetadataSyncRequest {
+        quint64 generation = 0;          // 入队时的批次代数，与当前不符的请求丢弃
+        std::function<void()> send;
+    };
+    QQueue<MetadataSyncRequest> metadataSyncRequestQueue;
+    quint64 metadataSyncRequestGeneration = 0;
+    bool metadataSyncDispatchScheduled = false;
+    double metadataSyncRequestTokens = 0.0;
+    QElapsedTimer metadataSyncTokenClock;
+    bool metadataSyncPumpScheduled = false;
+    qint64 metadataSyncBackoffUntil = 0;     // 毫秒时间戳
+    int metadataSyncBackoffLevel = 0;
+    QHash<QString, QJsonObject> metadataSyncVersionsByHash;  // 批量 Hash 查询命中的版本，键为大写 SHA256
+    QSet<QString> metadataSyncUnknownHashes;                 // 批量查询确认 Civitai 上不存在的 Hash
+    QHash<int, QJsonObject> metadataSyncModelRoots;          // 本批次已获取的模型详情，同一模型的多个文件共用
     QString currentProcessingPath;
     QString currentProcessingBaseName;
     QString pendingHashSyncPath;
@@ -591,6 +615,7 @@ private:
                                  bool resetGalleryScrollToTop = true);
     void applyUserGalleryTagFilter(const QSet<QString> &selectedTags,
                                    bool resetScrollToTop);
+    void ensureUserGalleryTagBitmaps();
     void resetUserImageThumbLoading();
     void scheduleVisibleUserImageThumbLoad();
     void dispatchVisibleUserImageThumbLoad();
@@ -627,11 +652,51 @@ private:
     QSet<QString> loadedUserImageThumbPaths;
     QHash<QString, int> failedUserImageThumbLoads;
     QTimer *userImageThumbLoadTimer = nullptr;
+    QTimer *userPromptSearchTimer = nullptr;           // 提示词搜索输入防抖
     quint64 userGalleryGeneration = 0;
     quint64 userGalleryLayoutGeneration = 0;
+    // 画廊列表的 Tag 位图：行号即位，按 (userGalleryGeneration, 行数) 判断是否需要重建
+    struct UserGalleryTagBitmaps {
+        quint64 generation = 0;
+        int rowCount = -1;
+        QHash<QString, RoaringBitmap> positive;   // 归一化 Tag key → 正面提示词含此 Tag 的行
+        QHash<QString, RoaringBitmap> negative;
+        QHash<QString, quint32> rowByPath;
+        QStringList rowPaths;
+        QVector<quint64> seedGroupKeys;           // 行 → ROLE_USER_IMAGE_SEED_GROUP
+        quint64 similarGroupsVersion = 0;         // similarGroupKeys 对应的 userImageSimilarGroupsVersion
+        QVector<quint64> similarGroupKeys;        // 行 → 相似画面组号，0 表示不与其他图相似
+    };
+    UserGalleryTagBitmaps userGalleryTagBitmaps;
+    QMap<QString, int> userTagFlowBaseCounts;           // TagFlow 未筛选时的计数（显示文本 → 图片数）
+    QHash<QString, QString> userTagFlowKeys;            // TagFlow 显示文本 → 归一化 key
+    QMap<QString, int> userTagFlowShownCounts;          // TagFlow 当前显示的计数
     bool userGalleryGlobalMode = false;
     void loadUserGalleryCache();
     void saveUserGalleryCache();
+    // 感知哈希在后台分批补算，结果写回 imageCache；补算期间只按间隔发布给图库语料，
+    // 缓存文件在全部算完或退出时才写一次，不在主线程反复序列化整个缓存
+    struct UserImageHashJob {
+        QString path;
+        qint64 lastModified = 0;
+        qint64 fileSize = -1;
+        quint64 hash = 0;
+        bool valid = false;
+    };
+    QFutureWatcher<UserImageHashJob> *userImageHashWatcher = nullptr;
+    QString userImageHashResumeKey;                     // 下一批从这个路径继续
+    QElapsedTimer userImageHashPublishTimer;
+    bool userGalleryHashesDirty = false;                // 有哈希尚未写入缓存文件
+    bool userGalleryHashesUnpublished = false;          // 有哈希尚未发布到图库语料
+    void scheduleUserImagePerceptualHashing();
+    void mergeUserImagePerceptualHashes();
+    void publishUserImagePerceptualHashes();
+    // 相似画面分组：每次发布哈希后在后台对全部哈希聚类一次，筛选时只比较组号
+    QFutureWatcher<QHash<QString, quint64>> *userImageSimilarGroupWatcher = nullptr;
+    QHash<QString, quint64> userImageSimilarGroups;     // 图片路径 → 组号（从 1 开始）
+    quint64 userImageSimilarGroupsVersion = 1;
+    bool userImageSimilarGroupPending = false;
+    void scheduleUserImageSimilarGrouping();
 
     // === 配置变量 ===
     QStringList   loraPaths;                                                      // LoRA文件夹列表
@@ -671,6 +736,9 @@ private:
     bool          optConfirmCloseWhileLauncherRunning         = true;             // 启动器有进程运行时关闭软件是否弹窗确认
     int           optModelUpdateDownloadPolicy                = 0;                // 0: 每次询问, 1: 保留旧版, 2: 覆盖当前文件
     bool          optAutoCheckUpdatesOnStartup                = true;             // 启动时自动检查软件更新
+    int           optDownloadConcurrency                      = 2;                // 同时下载的模型数
+    int           optDownloadSegments                         = 1;                // 单文件分段连接数
+    int           optDownloadBandwidthLimitKB                 = 0;                // 下载限速 KB/s，0 为不限速
     double        optUiScale                                  = 1.0;              // 缩放比率
     QString       optThemeId                                  = "steam_dark";    // 当前程序主题
     QString       optCustomThemePath                          = "";              // 外部 QSS 主题路径